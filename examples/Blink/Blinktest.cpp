@@ -21,6 +21,18 @@
 #include "Blinktest.h"
 #include <string>
 #include <vector>
+#include "esp_task_wdt.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/timers.h"
+#include "freertos/event_groups.h"
+#include "freertos/rtossched.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_intr_alloc.h"
+#include "soc/soc.h"
 #include "info.h"
 
 /**********************
@@ -53,6 +65,166 @@ void Blinktest::serflush() {
    i_uartclient.dump();
 }
 
+/**********************
+ * qconsumer():
+ * inputs: queue handle
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Task that takes one item out of a queue 20ms after it starts.
+ */
+static void qconsumer(void *arg) {
+   int v;
+   vTaskDelay(20);
+   xQueueReceive((QueueHandle_t)arg, &v, portMAX_DELAY);
+   vTaskDelete(NULL);
+}
+
+/* Timer callback, it logs when it went off in the vector in the timer ID. */
+static void tmrlog(TimerHandle_t t) {
+   ((std::vector<sc_time> *)pvTimerGetTimerID(t))->push_back(sc_time_stamp());
+}
+
+/* Pended call, it stores its second argument where the first points. */
+static void pendedset(void *p, uint32_t v) {
+   *(uint32_t *)p = v;
+}
+
+/* Checks that a timer went off at the given times after start, in ms. */
+static void checkfired(const char *name, std::vector<sc_time> &log,
+      const sc_time &start, const int *ms, unsigned int n) {
+   unsigned int i;
+
+   if (log.size() != n) {
+      PRINTF_ERROR("TEST", "Timer %s went off %d times, expected %d", name,
+         (int)log.size(), n);
+      return;
+   }
+   for(i = 0; i < n; i = i + 1)
+      if (log[i] != start + sc_time(ms[i], SC_MS))
+         PRINTF_ERROR("TEST", "Timer %s went off at %s, expected %d ms in",
+            name, log[i].to_string().c_str(), ms[i]);
+}
+
+/* What an event group task waits for and what it got. */
+struct egtaskarg {
+   EventGroupHandle_t eg;
+   EventBits_t set;
+   EventBits_t mask;
+   BaseType_t clear;
+   BaseType_t all;
+   EventBits_t got;
+   sc_time when;
+};
+
+/**********************
+ * egtask():
+ * inputs: egtaskarg
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Task that waits on an event group, or syncs on it if it has bits to set,
+ * and logs what it got and when.
+ */
+static void egtask(void *arg) {
+   egtaskarg *a = (egtaskarg *)arg;
+   if (a->set != 0)
+      a->got = xEventGroupSync(a->eg, a->set, a->mask, portMAX_DELAY);
+   else a->got = xEventGroupWaitBits(a->eg, a->mask, a->clear, a->all,
+      portMAX_DELAY);
+   a->when = sc_time_stamp();
+   vTaskDelete(NULL);
+}
+
+/* Task that sets bits in the notification value of a task 10ms in. */
+static void notifytask(void *arg) {
+   vTaskDelay(10);
+   xTaskNotify((TaskHandle_t)arg, 0x5, eSetBits);
+   vTaskDelete(NULL);
+}
+
+/* Work for a task, how long to wait first and how long to compute. */
+struct worktaskarg {
+   int delayms;
+   int workms;
+   sc_time done;
+};
+
+/**********************
+ * worktask():
+ * inputs: worktaskarg
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Task that waits, computes, logs when it finished and then blocks, so it
+ * stays in the task list for the run time stats.
+ */
+static void worktask(void *arg) {
+   worktaskarg *w = (worktaskarg *)arg;
+   if (w->delayms > 0) vTaskDelay(w->delayms);
+   rtoscompute(sc_time(w->workms, SC_MS));
+   w->done = sc_time_stamp();
+   vTaskDelay(portMAX_DELAY);
+}
+
+/* Gets the run time of a task, in us, from the system state. */
+static uint32_t taskruntime(TaskHandle_t h) {
+   TaskStatus_t st[32];
+   UBaseType_t n, i;
+
+   n = uxTaskGetSystemState(st, 32, NULL);
+   for(i = 0; i < n; i = i + 1)
+      if (st[i].xHandle == h) return st[i].ulRunTimeCounter;
+   return 0;
+}
+
+/* esp_timer callback, it logs when it ran in the vector it is given. */
+static void esptmrlog(void *arg) {
+   ((std::vector<sc_time> *)arg)->push_back(sc_time_stamp());
+}
+
+/* Timer group alarm handler. It takes no argument, so it logs to a global. */
+static std::vector<sc_time> hwtmrlog;
+static void hwtmrisr() {
+   hwtmrlog.push_back(sc_time_stamp());
+}
+
+/* Interrupt handler that takes as long as it is told to. It runs in the
+ * interrupt driver thread, so it can simply wait.
+ */
+static int slowisrms;
+static bool slowisrdone;
+static void slowisr(void *arg) {
+   wait(slowisrms, SC_MS);
+   slowisrdone = true;
+}
+
+/* Task that restarts the chip 30ms after it starts. */
+static void restarttask(void *arg) {
+   vTaskDelay(30);
+   esp_restart();
+}
+
+/**********************
+ * touchstim():
+ * inputs: none
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Touches pad 3 each time touch_ev goes off. The testbench thread cannot do
+ * it itself while it has the chip asleep.
+ */
+void Blinktest::touchstim() {
+   while(true) {
+      wait(touch_ev);
+      espm_touch_wakeup(TOUCH_PAD_NUM3);
+   }
+}
+
 /*******************************************************************************
 ** Testbenches *****************************************************************
 *******************************************************************************/
@@ -72,12 +244,651 @@ void Blinktest::t0(void) {
    wait(500, SC_MS);
 }
 
+void Blinktest::t1(void) {
+   SC_REPORT_INFO("TEST", "Running Test T1: task watchdog.");
+
+   PRINTF_INFO("TEST", "Waiting for power-up");
+   wait(led.posedge_event());
+
+   /* The testbench subscribes itself to the task watchdog and then never
+    * resets it. With panic on, the watchdog should reset the chip.
+    */
+   esp_task_wdt_init(1, true);
+   if (esp_task_wdt_add(NULL) != ESP_OK) {
+      PRINTF_ERROR("TEST", "Could not subscribe to the task watchdog");
+   }
+   wait(1500, SC_MS);
+   if (esp_reset_reason() != ESP_RST_TASK_WDT) {
+      PRINTF_ERROR("TEST", "Expected reset reason %d but got %d",
+         ESP_RST_TASK_WDT, esp_reset_reason());
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Task watchdog reset the chip");
+   }
+
+   /* The reset drops all the tasks from the watchdog, so it does not go off
+    * again and the firmware blinks as before.
+    */
+   if (esp_task_wdt_status(NULL) == ESP_OK) {
+      PRINTF_ERROR("TEST", "Testbench still subscribed after the reset");
+   }
+   wait(sc_time(3, SC_SEC), led.posedge_event());
+   if (!led.posedge()) {
+      PRINTF_ERROR("TEST", "Led did not blink after reset");
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Led went on");
+   }
+   wait(500, SC_MS);
+}
+
+void Blinktest::t2(void) {
+   QueueHandle_t q, q2, one;
+   QueueSetHandle_t set;
+   BaseType_t woken;
+   sc_time start;
+   int v, i;
+   const int order[3] = {1, 2, 4};
+
+   SC_REPORT_INFO("TEST", "Running Test T2: queues.");
+
+   q = xQueueCreate(3, sizeof(int));
+   vQueueAddToRegistry(q, "tbq");
+   if (strcmp(pcQueueGetName(q), "tbq") != 0)
+      PRINTF_ERROR("TEST", "Queue registry returned the wrong name");
+
+   /* The items come out in order, except for the one sent to the front. */
+   for(i = 1; i <= 2; i = i + 1) xQueueSend(q, &i, 0);
+   v = 9;
+   xQueueSendToFront(q, &v, 0);
+   if (uxQueueMessagesWaiting(q) != 3 || uxQueueSpacesAvailable(q) != 0)
+      PRINTF_ERROR("TEST", "Queue has %d items and %d spaces, expected 3 and 0",
+         uxQueueMessagesWaiting(q), uxQueueSpacesAvailable(q));
+   xQueuePeek(q, &v, 0);
+   if (v != 9) PRINTF_ERROR("TEST", "Peeked %d, expected 9", v);
+   if (uxQueueMessagesWaiting(q) != 3)
+      PRINTF_ERROR("TEST", "Peek took the item out of the queue");
+
+   /* A send to a full queue times out after its ticks and not before. */
+   start = sc_time_stamp();
+   v = 4;
+   if (xQueueSend(q, &v, 10) != errQUEUE_FULL)
+      PRINTF_ERROR("TEST", "Send to a full queue did not fail");
+   if (sc_time_stamp() - start != sc_time(10, SC_MS))
+      PRINTF_ERROR("TEST", "Send gave up after %s, expected 10 ms",
+         (sc_time_stamp() - start).to_string().c_str());
+
+   /* With a task taking the 9 out 20ms later, the send blocks until then
+    * and goes in at the back.
+    */
+   xTaskCreate(qconsumer, "qconsumer", 2048, q, 1, NULL);
+   start = sc_time_stamp();
+   if (xQueueSend(q, &v, portMAX_DELAY) != pdPASS)
+      PRINTF_ERROR("TEST", "Blocking send failed");
+   if (sc_time_stamp() - start != sc_time(20, SC_MS))
+      PRINTF_ERROR("TEST", "Blocking send took %s, expected 20 ms",
+         (sc_time_stamp() - start).to_string().c_str());
+   for(i = 0; i < 3; i = i + 1) {
+      xQueueReceive(q, &v, 0);
+      if (v != order[i])
+         PRINTF_ERROR("TEST", "Received %d, expected %d", v, order[i]);
+   }
+   if (xQueueReceive(q, &v, 5) != errQUEUE_EMPTY)
+      PRINTF_ERROR("TEST", "Receive from an empty queue did not fail");
+
+   /* A mailbox is a queue of one that is always overwritten. */
+   one = xQueueCreate(1, sizeof(int));
+   for(i = 1; i <= 3; i = i + 1) xQueueOverwrite(one, &i);
+   if (uxQueueMessagesWaiting(one) != 1 || xQueueReceive(one, &v, 0) != pdPASS
+         || v != 3)
+      PRINTF_ERROR("TEST", "Mailbox did not keep only the last value");
+
+   /* From an interrupt nothing blocks, and the task woken flag is set only
+    * if a task is waiting on the other side.
+    */
+   woken = pdFALSE;
+   xQueueSendFromISR(one, &v, &woken);
+   if (xQueueSendFromISR(one, &v, &woken) != errQUEUE_FULL || woken != pdFALSE)
+      PRINTF_ERROR("TEST", "Send from ISR to a full queue went wrong");
+   xQueueReset(one);
+   if (xQueueIsQueueEmptyFromISR(one) != pdTRUE)
+      PRINTF_ERROR("TEST", "Queue not empty after a reset");
+
+   /* A set tells which of its queues got an item. */
+   q2 = xQueueCreate(2, sizeof(int));
+   set = xQueueCreateSet(5);
+   xQueueAddToSet(q, set);
+   xQueueAddToSet(q2, set);
+   if (xQueueSelectFromSet(set, 5) != NULL)
+      PRINTF_ERROR("TEST", "Selected from an empty set");
+   xQueueSend(q2, &v, 0);
+   if (xQueueSelectFromSet(set, 0) != q2)
+      PRINTF_ERROR("TEST", "Set did not select the second queue");
+   xQueueReceive(q2, &v, 0);
+
+   vQueueUnregisterQueue(q);
+   xQueueRemoveFromSet(q, set);
+   xQueueRemoveFromSet(q2, set);
+   vQueueDelete(set);
+   vQueueDelete(q2);
+   vQueueDelete(one);
+   vQueueDelete(q);
+   PRINTF_INFO("TEST", "Queue checks done");
+}
+
+void Blinktest::t3(void) {
+   std::vector<sc_time> autolog, onelog;
+   TimerHandle_t autot, onet;
+   sc_time start;
+   uint32_t pended;
+   const int automs[7] = {10, 20, 30, 40, 50, 55, 60};
+   const int onems[1] = {40};
+
+   SC_REPORT_INFO("TEST", "Running Test T3: software timers.");
+
+   autot = xTimerCreate("auto", 10, pdTRUE, &autolog, tmrlog);
+   onet = xTimerCreate("one", 25, pdFALSE, &onelog, tmrlog);
+   if (xTimerCreate("zero", 0, pdFALSE, NULL, tmrlog) != NULL)
+      PRINTF_ERROR("TEST", "Created a timer with a zero period");
+   if (strcmp(pcTimerGetTimerName(onet), "one") != 0
+         || xTimerGetPeriod(onet) != 25)
+      PRINTF_ERROR("TEST", "Timer name or period is wrong");
+
+   /* The timers count from the tick they are started at. The auto reload one
+    * goes off every 10ms without drifting. The one shot is reset 15ms in, so
+    * it goes off 25ms after that.
+    */
+   start = sc_time(xTaskGetTickCount(), SC_MS);
+   xTimerStart(autot, 0);
+   xTimerStart(onet, 0);
+   wait(start + sc_time(15, SC_MS) - sc_time_stamp());
+   xTimerReset(onet, 0);
+   if (xTimerGetExpiryTime(onet) != xTaskGetTickCount() + 25)
+      PRINTF_ERROR("TEST", "One shot expiry is %d, expected %d",
+         xTimerGetExpiryTime(onet), xTaskGetTickCount() + 25);
+
+   /* At 50ms the period goes down to 5ms, which also restarts the timer. */
+   wait(start + sc_time(50, SC_MS) - sc_time_stamp());
+   wait(SC_ZERO_TIME);
+   xTimerChangePeriod(autot, 5, 0);
+   wait(12, SC_MS);
+   xTimerStop(autot, 0);
+   if (xTimerIsTimerActive(autot) != pdFALSE
+         || xTimerIsTimerActive(onet) != pdFALSE)
+      PRINTF_ERROR("TEST", "Timers still active after they were stopped");
+   wait(30, SC_MS);
+   checkfired("auto", autolog, start, automs, 7);
+   checkfired("one", onelog, start, onems, 1);
+
+   /* A pended call runs on the timer service right away. */
+   pended = 0;
+   xTimerPendFunctionCall(pendedset, &pended, 42, 0);
+   wait(SC_ZERO_TIME);
+   wait(SC_ZERO_TIME);
+   if (pended != 42) PRINTF_ERROR("TEST", "Pended call did not run");
+
+   xTimerDelete(onet, 0);
+   xTimerDelete(autot, 0);
+   PRINTF_INFO("TEST", "Software timer checks done");
+}
+
+void Blinktest::t4(void) {
+   EventGroupHandle_t eg;
+   egtaskarg all = {NULL, 0, 0x3, pdTRUE, pdTRUE, 0, SC_ZERO_TIME};
+   egtaskarg any = {NULL, 0, 0x2, pdFALSE, pdFALSE, 0, SC_ZERO_TIME};
+   egtaskarg sync = {NULL, 0x10, 0x30, pdTRUE, pdTRUE, 0, SC_ZERO_TIME};
+   EventBits_t bits;
+   sc_time start;
+   uint32_t v;
+
+   SC_REPORT_INFO("TEST", "Running Test T4: event groups and notifications.");
+
+   /* One task waits for both bits and clears them, the other only for the
+    * second one. Neither goes with the first bit alone, and both see the
+    * same bits when the second one comes.
+    */
+   eg = xEventGroupCreate();
+   all.eg = eg; any.eg = eg; sync.eg = eg;
+   xTaskCreate(egtask, "egall", 2048, &all, 1, NULL);
+   xTaskCreate(egtask, "egany", 2048, &any, 1, NULL);
+   start = sc_time_stamp();
+   wait(10, SC_MS);
+   xEventGroupSetBits(eg, 0x1);
+   wait(10, SC_MS);
+   if (all.when != SC_ZERO_TIME || any.when != SC_ZERO_TIME)
+      PRINTF_ERROR("TEST", "A task left the event group too early");
+   bits = xEventGroupSetBits(eg, 0x2);
+   if (bits != 0)
+      PRINTF_ERROR("TEST", "Bits left at 0x%x, expected them cleared", bits);
+   wait(SC_ZERO_TIME);
+   if (all.got != 0x3 || any.got != 0x3
+         || all.when != start + sc_time(20, SC_MS)
+         || any.when != start + sc_time(20, SC_MS))
+      PRINTF_ERROR("TEST", "Tasks got 0x%x and 0x%x, expected 0x3 at 20 ms",
+         all.got, any.got);
+
+   /* A wait with a timeout gives up on time and returns the bits it saw. */
+   start = sc_time_stamp();
+   bits = xEventGroupWaitBits(eg, 0x4, pdTRUE, pdFALSE, 10);
+   if ((bits & 0x4) != 0 || sc_time_stamp() - start != sc_time(10, SC_MS))
+      PRINTF_ERROR("TEST", "Wait for bits did not time out after 10 ms");
+
+   /* Two tasks meet at a sync point, the last one in lets both go. */
+   xTaskCreate(egtask, "egsync", 2048, &sync, 1, NULL);
+   wait(5, SC_MS);
+   bits = xEventGroupSync(eg, 0x20, 0x30, 10);
+   wait(SC_ZERO_TIME);
+   if ((bits & 0x30) != 0x30 || (sync.got & 0x30) != 0x30
+         || sync.when != sc_time_stamp())
+      PRINTF_ERROR("TEST", "Sync returned 0x%x and 0x%x, expected both 0x30",
+         bits, sync.got);
+   if (xEventGroupGetBits(eg) != 0)
+      PRINTF_ERROR("TEST", "Sync bits were not cleared");
+   vEventGroupDelete(eg);
+
+   /* A notification sent by another task wakes us up with its bits. */
+   xTaskCreate(notifytask, "notify", 2048, xTaskGetCurrentTaskHandle(), 1,
+      NULL);
+   start = sc_time_stamp();
+   if (xTaskNotifyWait(0, 0xffffffff, &v, 100) != pdTRUE || v != 0x5
+         || sc_time_stamp() - start != sc_time(10, SC_MS))
+      PRINTF_ERROR("TEST", "Notify wait got 0x%x, expected 0x5 at 10 ms", v);
+
+   /* Without overwrite a value not yet taken is kept. */
+   xTaskNotify(xTaskGetCurrentTaskHandle(), 7, eSetValueWithoutOverwrite);
+   if (xTaskNotify(xTaskGetCurrentTaskHandle(), 8, eSetValueWithoutOverwrite)
+         != pdFAIL)
+      PRINTF_ERROR("TEST", "Overwrote a pending notification");
+   xTaskNotifyWait(0, 0xffffffff, &v, 0);
+   if (v != 7) PRINTF_ERROR("TEST", "Notify value %d, expected 7", v);
+
+   /* As a counting semaphore, take counts down or clears. */
+   xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+   xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+   xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+   if (ulTaskNotifyTake(pdFALSE, 0) != 3 || ulTaskNotifyTake(pdTRUE, 0) != 2)
+      PRINTF_ERROR("TEST", "Notify take did not count down");
+   start = sc_time_stamp();
+   if (ulTaskNotifyTake(pdTRUE, 5) != 0
+         || sc_time_stamp() - start != sc_time(5, SC_MS))
+      PRINTF_ERROR("TEST", "Notify take did not time out after 5 ms");
+   PRINTF_INFO("TEST", "Event group and notification checks done");
+}
+
+void Blinktest::t5(void) {
+   worktaskarg low = {0, 30, SC_ZERO_TIME};
+   worktaskarg high = {10, 5, SC_ZERO_TIME};
+   worktaskarg rr1 = {0, 4, SC_ZERO_TIME};
+   worktaskarg rr2 = {0, 4, SC_ZERO_TIME};
+   TaskHandle_t hlow, hhigh, hrr1, hrr2;
+   sc_time start, busy0;
+   char stats[2048];
+
+   SC_REPORT_INFO("TEST", "Running Test T5: scheduler model.");
+
+   /* We start on a tick, so the time slices line up with the test. */
+   start = sc_time(xTaskGetTickCount() + 1, SC_MS);
+   wait(start - sc_time_stamp());
+   rtossetsched(true);
+   busy0 = rtoscorebusy(0);
+
+   /* On core 0 a low priority task computes for 30ms and a high priority
+    * one comes in 10ms later for 5ms. It preempts the low one, which then
+    * finishes 5ms late. On core 1 two tasks of the same priority take turns
+    * at each tick.
+    */
+   xTaskCreatePinnedToCore(worktask, "low", 2048, &low, 1, &hlow, 0);
+   xTaskCreatePinnedToCore(worktask, "high", 2048, &high, 5, &hhigh, 0);
+   xTaskCreatePinnedToCore(worktask, "rr1", 2048, &rr1, 2, &hrr1, 1);
+   xTaskCreatePinnedToCore(worktask, "rr2", 2048, &rr2, 2, &hrr2, 1);
+   wait(12, SC_MS);
+   if (eTaskGetState(hlow) != eReady || eTaskGetState(hhigh) != eRunning)
+      PRINTF_ERROR("TEST", "Low task should be ready and high one running");
+   wait(30, SC_MS);
+
+   if (high.done != start + sc_time(15, SC_MS))
+      PRINTF_ERROR("TEST", "High task done at %s, expected 15 ms in",
+         high.done.to_string().c_str());
+   if (low.done != start + sc_time(35, SC_MS))
+      PRINTF_ERROR("TEST", "Low task done at %s, expected 35 ms in",
+         low.done.to_string().c_str());
+   if (rr1.done != start + sc_time(7, SC_MS)
+         || rr2.done != start + sc_time(8, SC_MS))
+      PRINTF_ERROR("TEST", "Round robin tasks done at %s and %s, expected 7 "
+         "and 8 ms in", rr1.done.to_string().c_str(),
+         rr2.done.to_string().c_str());
+
+   /* The run time is only what each task computed, not the time it was
+    * preempted.
+    */
+   if (taskruntime(hlow) != 30000 || taskruntime(hhigh) != 5000
+         || taskruntime(hrr1) != 4000)
+      PRINTF_ERROR("TEST", "Run times %u, %u and %u us, expected 30000, 5000 "
+         "and 4000", taskruntime(hlow), taskruntime(hhigh), taskruntime(hrr1));
+   if (rtoscorebusy(0) - busy0 < sc_time(35, SC_MS))
+      PRINTF_ERROR("TEST", "Core 0 busy for only %s",
+         (rtoscorebusy(0) - busy0).to_string().c_str());
+   vTaskGetRunTimeStats(stats);
+   PRINTF_INFO("TEST", "Run time stats:\n%s", stats);
+
+   vTaskDelete(hlow);
+   vTaskDelete(hhigh);
+   vTaskDelete(hrr1);
+   vTaskDelete(hrr2);
+   if (eTaskGetState(hlow) != eDeleted || eTaskGetState(hrr2) != eDeleted)
+      PRINTF_ERROR("TEST", "Deleted tasks should read as deleted");
+   rtossetsched(false);
+}
+
+void Blinktest::t6(void) {
+   std::vector<sc_time> perlog, oncelog;
+   esp_timer_create_args_t args;
+   esp_timer_handle_t per, once;
+   hw_timer_t *hw;
+   sc_time start;
+   uint64_t cnt;
+   unsigned int i;
+
+   SC_REPORT_INFO("TEST", "Running Test T6: timer group and esp_timer.");
+
+   /* A periodic esp_timer every 500us and a one shot one at 1200us. They go
+    * off on the dot, and the periodic one does not drift.
+    */
+   args.callback = esptmrlog;
+   args.arg = &perlog;
+   args.dispatch_method = ESP_TIMER_TASK;
+   args.name = "per";
+   esp_timer_create(&args, &per);
+   args.arg = &oncelog;
+   args.name = "once";
+   esp_timer_create(&args, &once);
+   start = sc_time_stamp();
+   esp_timer_start_periodic(per, 500);
+   esp_timer_start_once(once, 1200);
+   if (esp_timer_get_next_alarm() != esp_timer_get_time() + 500)
+      PRINTF_ERROR("TEST", "Next alarm at %lld us, expected %lld",
+         (long long)esp_timer_get_next_alarm(),
+         (long long)esp_timer_get_time() + 500);
+   if (esp_timer_start_once(per, 100) != ESP_ERR_INVALID_STATE
+         || esp_timer_delete(per) != ESP_ERR_INVALID_STATE)
+      PRINTF_ERROR("TEST", "Started or deleted a running timer");
+   wait(5100, SC_US);
+   esp_timer_stop(per);
+   wait(1, SC_MS);
+   if (perlog.size() != 10)
+      PRINTF_ERROR("TEST", "Periodic timer went off %d times, expected 10",
+         (int)perlog.size());
+   for(i = 0; i < perlog.size(); i = i + 1)
+      if (perlog[i] != start + sc_time(500 * (i + 1), SC_US))
+         PRINTF_ERROR("TEST", "Periodic timer went off at %s",
+            perlog[i].to_string().c_str());
+   if (oncelog.size() != 1 || oncelog[0] != start + sc_time(1200, SC_US))
+      PRINTF_ERROR("TEST", "One shot timer did not go off once at 1200 us");
+   esp_timer_delete(per);
+   esp_timer_delete(once);
+
+   /* Timer 0 of group 0 counts microseconds and raises its alarm every
+    * millisecond, reloading each time.
+    */
+   hwtmrlog.clear();
+   hw = timerBegin(0, 80, true);
+   start = sc_time_stamp();
+   timerAttachInterrupt(hw, hwtmrisr, false);
+   timerAlarmWrite(hw, 1000, true);
+   timerAlarmEnable(hw);
+   wait(5500, SC_US);
+   cnt = timerRead(hw);
+   if (cnt < 499 || cnt > 501)
+      PRINTF_ERROR("TEST", "Timer at %llu, expected 500",
+         (unsigned long long)cnt);
+   if (hwtmrlog.size() != 5)
+      PRINTF_ERROR("TEST", "Timer alarm went off %d times, expected 5",
+         (int)hwtmrlog.size());
+   if (hwtmrlog.size() > 0 && (hwtmrlog[0] < start + sc_time(999, SC_US)
+         || hwtmrlog[0] > start + sc_time(1001, SC_US)))
+      PRINTF_ERROR("TEST", "First timer alarm at %s, expected 1 ms in",
+         hwtmrlog[0].to_string().c_str());
+   for(i = 1; i < hwtmrlog.size(); i = i + 1)
+      if (hwtmrlog[i] - hwtmrlog[i-1] != sc_time(1, SC_MS))
+         PRINTF_ERROR("TEST", "Timer alarms %s apart, expected 1 ms",
+            (hwtmrlog[i] - hwtmrlog[i-1]).to_string().c_str());
+
+   /* Once stopped, it holds its count and raises no more alarms. */
+   timerStop(hw);
+   cnt = timerRead(hw);
+   wait(2, SC_MS);
+   if (timerRead(hw) != cnt || hwtmrlog.size() != 5)
+      PRINTF_ERROR("TEST", "Timer kept going after it was stopped");
+   timerEnd(hw);
+}
+
+void Blinktest::t7(void) {
+   worktaskarg napper = {10, 0, SC_ZERO_TIME};
+   std::vector<sc_time> log;
+   esp_timer_create_args_t args;
+   esp_timer_handle_t once;
+   TaskHandle_t h;
+   sc_time start;
+
+   SC_REPORT_INFO("TEST", "Running Test T7: light sleep.");
+
+   PRINTF_INFO("TEST", "Waiting for power-up");
+   wait(led.posedge_event());
+
+   /* A task delay and an esp_timer both run out 10ms into a 50ms sleep.
+    * Neither may go on before the chip wakes up.
+    */
+   xTaskCreate(worktask, "napper", 2048, &napper, 1, &h);
+   args.callback = esptmrlog;
+   args.arg = &log;
+   args.dispatch_method = ESP_TIMER_TASK;
+   args.name = "once";
+   esp_timer_create(&args, &once);
+   esp_timer_start_once(once, 10000);
+   esp_sleep_enable_timer_wakeup(50000);
+   start = sc_time_stamp();
+   esp_light_sleep_start();
+   if (sc_time_stamp() - start != sc_time(50, SC_MS))
+      PRINTF_ERROR("TEST", "Slept for %s, expected 50 ms",
+         (sc_time_stamp() - start).to_string().c_str());
+   if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER)
+      PRINTF_ERROR("TEST", "Wake up cause %d, expected the timer",
+         esp_sleep_get_wakeup_cause());
+   wait(1, SC_US);
+   if (napper.done != start + sc_time(50, SC_MS))
+      PRINTF_ERROR("TEST", "Task came out of its delay at %s, expected at "
+         "the wake up", napper.done.to_string().c_str());
+   if (log.size() != 1 || log[0] != start + sc_time(50, SC_MS))
+      PRINTF_ERROR("TEST", "esp_timer did not go off once at the wake up");
+
+   /* Now the touch pad wakes it up, 20ms in. */
+   esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+   esp_sleep_enable_touchpad_wakeup();
+   touch_ev.notify(20, SC_MS);
+   start = sc_time_stamp();
+   esp_light_sleep_start();
+   if (sc_time_stamp() - start != sc_time(20, SC_MS)
+         || esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TOUCHPAD
+         || esp_sleep_get_touchpad_wakeup_status() != TOUCH_PAD_NUM3)
+      PRINTF_ERROR("TEST", "Touch pad 3 did not wake the chip up at 20 ms");
+   esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TOUCHPAD);
+
+   /* And the firmware goes on blinking. */
+   wait(sc_time(3, SC_SEC), led.value_changed_event());
+   if (sc_time_stamp() - start >= sc_time(3, SC_SEC)) {
+      PRINTF_ERROR("TEST", "Led did not blink after the wake up");
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Led blinks after the wake up");
+   }
+   vTaskDelete(h);
+   esp_timer_delete(once);
+}
+
+void Blinktest::t8(void) {
+   std::vector<sc_time> rtoslog, esplog;
+   esp_timer_create_args_t args;
+   esp_timer_handle_t per;
+   TimerHandle_t tmr;
+   QueueHandle_t q;
+   UBaseType_t ntasks;
+   size_t nrtos, nesp;
+
+   SC_REPORT_INFO("TEST", "Running Test T8: restart.");
+
+   PRINTF_INFO("TEST", "Waiting for power-up");
+   wait(led.posedge_event());
+   wait(100, SC_MS);
+
+   /* When the restart comes we have a task blocked on a queue, since 20ms
+    * in, and a FreeRTOS timer and an esp_timer running. The restart comes
+    * from a task, as it would from the firmware.
+    */
+   ntasks = uxTaskGetNumberOfTasks();
+   q = xQueueCreate(1, sizeof(int));
+   xTaskCreate(qconsumer, "qconsumer", 2048, q, 1, NULL);
+   tmr = xTimerCreate("tmr", 10, pdTRUE, &rtoslog, tmrlog);
+   xTimerStart(tmr, 0);
+   args.callback = esptmrlog;
+   args.arg = &esplog;
+   args.dispatch_method = ESP_TIMER_TASK;
+   args.name = "per";
+   esp_timer_create(&args, &per);
+   esp_timer_start_periodic(per, 1000);
+   xTaskCreate(restarttask, "restarter", 2048, NULL, 1, NULL);
+   wait(40, SC_MS);
+
+   if (esp_reset_reason() != ESP_RST_SW) {
+      PRINTF_ERROR("TEST", "Expected reset reason %d but got %d",
+         ESP_RST_SW, esp_reset_reason());
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Chip restarted from a task");
+   }
+
+   /* The tasks are gone and the timers stopped. */
+   if (uxTaskGetNumberOfTasks() > ntasks)
+      PRINTF_ERROR("TEST", "%d tasks left after the restart, expected %d",
+         uxTaskGetNumberOfTasks(), ntasks);
+   nrtos = rtoslog.size();
+   nesp = esplog.size();
+   if (nrtos > 3 || nesp > 30)
+      PRINTF_ERROR("TEST", "Timers went off %d and %d times, expected at most "
+         "3 and 30 before the restart", (int)nrtos, (int)nesp);
+   wait(50, SC_MS);
+   if (rtoslog.size() != nrtos || xTimerIsTimerActive(tmr) != pdFALSE)
+      PRINTF_ERROR("TEST", "FreeRTOS timer still running after the restart");
+   if (esplog.size() != nesp)
+      PRINTF_ERROR("TEST", "esp_timer still running after the restart");
+
+   /* The queue has no one waiting on it anymore, so it goes right away. */
+   vQueueDelete(q);
+   xTimerDelete(tmr, 0);
+   esp_timer_delete(per);
+
+   /* And setup() ran again, so the LED blinks as before. */
+   wait(sc_time(2100, SC_MS), led.negedge_event());
+   if (!led.negedge()) {
+      PRINTF_ERROR("TEST", "Led did not blink after the restart");
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Led went off");
+   }
+}
+
+void Blinktest::t9(void) {
+   intr_handle_t h;
+   sc_time start;
+
+   SC_REPORT_INFO("TEST", "Running Test T9: interrupt watchdog.");
+
+   PRINTF_INFO("TEST", "Waiting for power-up");
+   wait(led.posedge_event());
+   wait(100, SC_MS);
+
+   if (esp_intr_alloc(ETS_UART0_INTR_SOURCE, ESP_INTR_FLAG_LEVEL1, slowisr,
+         NULL, &h) != ESP_OK) {
+      PRINTF_ERROR("TEST", "Could not allocate the interrupt");
+      return;
+   }
+
+   /* A handler that takes 100ms is well inside the 300ms timeout, so the
+    * watchdog should leave it alone.
+    */
+   slowisrms = 100;
+   slowisrdone = false;
+   i_esp.i_espintr.raise(ETS_UART0_INTR_SOURCE);
+   wait(1, SC_US);
+   i_esp.i_espintr.lower(ETS_UART0_INTR_SOURCE);
+   wait(200, SC_MS);
+   if (!slowisrdone || esp_reset_reason() == ESP_RST_INT_WDT) {
+      PRINTF_ERROR("TEST", "Interrupt watchdog went off on a 100ms handler");
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: 100ms handler ran to the end");
+   }
+
+   /* One that takes a second should have the chip reset at 300ms, and be
+    * taken out before it finishes.
+    */
+   slowisrms = 1000;
+   slowisrdone = false;
+   start = sc_time_stamp();
+   i_esp.i_espintr.raise(ETS_UART0_INTR_SOURCE);
+   wait(1, SC_US);
+   i_esp.i_espintr.lower(ETS_UART0_INTR_SOURCE);
+   wait(start + sc_time(299, SC_MS) - sc_time_stamp());
+   if (esp_reset_reason() == ESP_RST_INT_WDT)
+      PRINTF_ERROR("TEST", "Interrupt watchdog went off before 300ms");
+   wait(2, SC_MS);
+   if (esp_reset_reason() != ESP_RST_INT_WDT) {
+      PRINTF_ERROR("TEST", "Expected reset reason %d but got %d",
+         ESP_RST_INT_WDT, esp_reset_reason());
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Interrupt watchdog reset the chip");
+   }
+   wait(1, SC_SEC);
+   if (slowisrdone)
+      PRINTF_ERROR("TEST", "Stuck handler ran to the end after the reset");
+
+   /* The CPU must take interrupts again after the reset. */
+   slowisrms = 0;
+   i_esp.i_espintr.raise(ETS_UART0_INTR_SOURCE);
+   wait(1, SC_US);
+   i_esp.i_espintr.lower(ETS_UART0_INTR_SOURCE);
+   if (!slowisrdone) {
+      PRINTF_ERROR("TEST", "CPU took no interrupts after the reset");
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: CPU took an interrupt after the reset");
+   }
+   esp_intr_free(h);
+
+   wait(sc_time(2100, SC_MS), led.negedge_event());
+   if (!led.negedge()) {
+      PRINTF_ERROR("TEST", "Led did not blink after the reset");
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Led went off");
+   }
+}
+
 void Blinktest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
+   else if (tn == 2) t2();
+   else if (tn == 3) t3();
+   else if (tn == 4) t4();
+   else if (tn == 5) t5();
+   else if (tn == 6) t6();
+   else if (tn == 7) t7();
+   else if (tn == 8) t8();
+   else if (tn == 9) t9();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
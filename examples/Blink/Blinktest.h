@@ -50,10 +50,21 @@ SC_MODULE(Blinktest) {
    /* Processes */
    void testbench(void);
    void serflush(void);
+   void touchstim(void);
+   sc_event touch_ev;
 
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   void t2();
+   void t3();
+   void t4();
+   void t5();
+   void t6();
+   void t7();
+   void t8();
+   void t9();
 
    // Constructor
    SC_CTOR(Blinktest) {
@@ -91,6 +102,7 @@ SC_MODULE(Blinktest) {
 
       SC_THREAD(testbench);
       SC_THREAD(serflush);
+      SC_THREAD(touchstim);
    }
 
    void trace(sc_trace_file *tf);
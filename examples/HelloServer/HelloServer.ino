@@ -21,11 +21,15 @@
   Modified 31 July 2019 by Glenn Ramalho
      - Added wifi SSID name, and password and added a 1ms delay. Also removed
        the reference to the DNS.
+     - Added the /users routes, used by the route dispatch test.
+     - Added the /stream route, used by the streamed response test.
+     - Added the /mqtt route, used by the MQTT firmware test.
 */
 
 #include <WiFi.h>
 #include <WiFiClient.h>
 #include <WebServer.h>
+#include "mqtt_client.h"
 
 const char* ssid = "awifi";
 const char* password = "apass";
@@ -34,6 +38,59 @@ WebServer server(80);
 
 const int led = 13;
 
+/* The /stream page is 200 numbered lines, written straight into the server
+ * buffer a block at a time.
+ */
+const int streamlines = 200;
+int streamline;
+
+size_t streamWriter(uint8_t* buffer, size_t maxLen) {
+  size_t len = 0;
+  char line[12];
+  while (streamline < streamlines && len + 10 <= maxLen) {
+    snprintf(line, sizeof(line), "line %03d\r\n", streamline);
+    memcpy(buffer + len, line, 10);
+    len += 10;
+    streamline++;
+  }
+  return len;
+}
+
+// Fills the whole buffer but claims more, which the server must not trust.
+size_t overrunWriter(uint8_t* buffer, size_t maxLen) {
+  memset(buffer, 'x', maxLen);
+  return maxLen + 100;
+}
+
+/* The /mqtt page starts an MQTT client to the broker in the testbench. Once
+ * connected it subscribes to led/cmd and publishes four messages at QoS 1 and
+ * four at QoS 2. Whatever comes in led/cmd is sent back in esp/ack.
+ */
+esp_mqtt_client_handle_t mqttclient = NULL;
+
+esp_err_t mqttEvent(esp_mqtt_event_handle_t event) {
+  char payload[8];
+  int i;
+  switch (event->event_id) {
+    case MQTT_EVENT_CONNECTED:
+      esp_mqtt_client_subscribe(event->client, "led/cmd", 2);
+      for (i = 0; i < 4; i++) {
+        snprintf(payload, sizeof(payload), "%d", i);
+        esp_mqtt_client_publish(event->client, "esp/q1", payload, 0, 1, 0);
+        esp_mqtt_client_publish(event->client, "esp/q2", payload, 0, 2, 0);
+      }
+      break;
+    case MQTT_EVENT_DATA:
+      if (event->topic_len == 7 && strncmp(event->topic, "led/cmd", 7) == 0)
+        esp_mqtt_client_publish(event->client, "esp/ack", event->data,
+          event->data_len, 1, 0);
+      break;
+    default:
+      break;
+  }
+  return ESP_OK;
+}
+
 void handleRoot() {
   digitalWrite(led, 1);
   server.send(200, "text/plain", "hello from esp8266!");
@@ -82,6 +139,40 @@ void setup(void) {
     server.send(200, "text/plain", "this works as well");
   });
 
+  server.on("/users", []() {
+    server.send(200, "text/plain", "user list");
+  });
+
+  server.on("/users/{}", []() {
+    server.send(200, "text/plain", "user " + server.pathArg(0));
+  });
+
+  // Chunked unless the length is asked for.
+  server.on("/stream", []() {
+    streamline = 0;
+    if (server.hasArg("length"))
+      server.send(200, "text/plain", streamWriter, streamlines * 10);
+    else
+      server.send(200, "text/plain", streamWriter);
+  });
+
+  server.on("/overrun", []() {
+    server.send(200, "text/plain", overrunWriter);
+  });
+
+  // The client is only started once, the next requests just answer.
+  server.on("/mqtt", []() {
+    if (mqttclient == NULL) {
+      esp_mqtt_client_config_t cfg = {};
+      cfg.uri = "mqtt://192.76.0.1:1883";
+      cfg.client_id = "esp32";
+      cfg.event_handle = mqttEvent;
+      mqttclient = esp_mqtt_client_init(&cfg);
+      esp_mqtt_client_start(mqttclient);
+    }
+    server.send(200, "text/plain", "mqtt started");
+  });
+
   server.onNotFound(handleNotFound);
 
   server.begin();
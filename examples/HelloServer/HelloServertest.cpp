@@ -53,6 +53,20 @@ void HelloServertest::serflush() {
    i_uartclient.dump();
 }
 
+/**********************
+ * checkpage():
+ * inputs: page read, text expected
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Flags an error if the text is not somewhere in the page.
+ */
+void HelloServertest::checkpage(std::string page, const char *text) {
+   if (page.find(text) == std::string::npos)
+      PRINTF_ERROR("TEST", "Did not find \"%s\" in the page", text);
+}
+
 /*******************************************************************************
 ** Testbenches *****************************************************************
 *******************************************************************************/
@@ -97,12 +111,508 @@ void HelloServertest::t0(void) {
    wait(500, SC_MS);
 }
 
+void HelloServertest::t1(void) {
+   SC_REPORT_INFO("TEST", "Running T1: load run.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* We mix mostly root page requests with some others and a few posts to
+    * a page that is not there.
+    */
+   i_webclient.loadclear();
+   i_webclient.loadmix("GET", "/", 0, 6);
+   i_webclient.loadmix("GET", "/inline", 0, 3);
+   i_webclient.loadmix("POST", "/wakanda", 256, 1);
+
+   /* And we run 100 requests at 20 requests per second. */
+   i_webclient.loadrun(IPAddress(192,76,0,100), 80, 20.0, 100);
+
+   /* Only the POST requests should fail as the page is not there. */
+   if (i_webclient.loaderrors() != 10)
+      PRINTF_ERROR("TEST", "Expected 10 errors but got %d",
+         i_webclient.loaderrors());
+}
+
+void HelloServertest::t2(void) {
+   std::string topic;
+   std::string payload;
+
+   SC_REPORT_INFO("TEST", "Running T2: MQTT broker counters.");
+
+   /* This one only uses testbench clients, the firmware is left alone. One
+    * client takes everything, the other only the QoS 2 topic.
+    */
+   i_mqttbroker.connect("tbA");
+   i_mqttbroker.connect("tbB");
+   i_mqttbroker.subscribe("tbA", "led/#", 2);
+   i_mqttbroker.subscribe("tbB", "led/q2", 1);
+
+   /* We send one message at each QoS, the last one retained. */
+   i_mqttbroker.publish("led/q0", "zero", 0);
+   i_mqttbroker.publish("led/q1", "one", 1);
+   i_mqttbroker.publish("led/q2", "two", 2, true);
+   i_mqttbroker.expect("tbA", "led/q0", "zero", sc_time(1, SC_MS));
+   i_mqttbroker.expect("tbA", "led/q1", "one", sc_time(1, SC_MS));
+   i_mqttbroker.expect("tbA", "led/q2", "two", sc_time(1, SC_MS));
+   i_mqttbroker.expect("tbB", "led/q2", "two", sc_time(1, SC_MS));
+   i_mqttbroker.report();
+
+   if (i_mqttbroker.published() != 3)
+      PRINTF_ERROR("TEST", "Expected 3 published but got %d",
+         i_mqttbroker.published());
+   if (i_mqttbroker.delivered() != 4)
+      PRINTF_ERROR("TEST", "Expected 4 delivered but got %d",
+         i_mqttbroker.delivered());
+   if (i_mqttbroker.retained() != 1)
+      PRINTF_ERROR("TEST", "Expected 1 retained but got %d",
+         i_mqttbroker.retained());
+   /* Nothing went to the firmware, so there is nothing in flight. */
+   if (i_mqttbroker.maxinflight() != 0 || i_mqttbroker.maxoutbox() != 0)
+      PRINTF_ERROR("TEST", "Expected no inflight or outbox but got %d/%d",
+         i_mqttbroker.maxinflight(), i_mqttbroker.maxoutbox());
+
+   /* A late subscriber gets the retained one. Clearing the stats starts the
+    * counters again but keeps the retained message.
+    */
+   i_mqttbroker.clearstats();
+   i_mqttbroker.subscribe("tbB", "led/#", 0);
+   i_mqttbroker.expect("tbB", "led/q2", "two", sc_time(1, SC_MS));
+   if (i_mqttbroker.published() != 0 || i_mqttbroker.delivered() != 1)
+      PRINTF_ERROR("TEST", "Expected 0/1 published/delivered but got %d/%d",
+         i_mqttbroker.published(), i_mqttbroker.delivered());
+
+   /* And nothing else should be waiting. */
+   if (i_mqttbroker.receive("tbA", topic, payload, sc_time(1, SC_MS)))
+      PRINTF_ERROR("TEST", "Unexpected message %s", topic.c_str());
+   i_mqttbroker.disconnect("tbA");
+   i_mqttbroker.disconnect("tbB");
+}
+
+void HelloServertest::t3(void) {
+   SC_REPORT_INFO("TEST", "Running T3: route dispatch.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* The plain route and the one with a path argument share the same
+    * prefix. The plain one must still be found for its own URI.
+    */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/users");
+   i_webclient.expectline(80, "HTTP/1.1 200 OK");
+   i_webclient.expecttillline(80, "user list");
+   wait(10, SC_MS);
+
+   /* The path argument is taken from the URI. */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/users/42");
+   i_webclient.expectline(80, "HTTP/1.1 200 OK");
+   i_webclient.expecttillline(80, "user 42");
+   wait(10, SC_MS);
+
+   /* A path argument can not have a slash, so this one is not found. */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/users/42/name");
+   i_webclient.expectline(80, "HTTP/1.1 404 Not Found");
+   wait(led.negedge_event());
+   i_webclient.printpage(80);
+
+   /* And the old routes are still there. */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/inline");
+   i_webclient.expectline(80, "HTTP/1.1 200 OK");
+   i_webclient.expecttillline(80, "this works as well");
+}
+
+void HelloServertest::t4(void) {
+   std::string page;
+
+   SC_REPORT_INFO("TEST", "Running T4: request parsing.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* The not found page lists the URI, the method and the arguments, so we
+    * can see what the server made of the request. The arguments are only
+    * decoded when the handler asks for them.
+    */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/wakanda?name=John%20Smith&id=7");
+   page = i_webclient.readpage(80);
+   checkpage(page, "HTTP/1.1 404 Not Found");
+   checkpage(page, "URI: /wakanda\n");
+   checkpage(page, "Method: GET\n");
+   checkpage(page, "Arguments: 2\n");
+   checkpage(page, " name: John Smith\n");
+   checkpage(page, " id: 7\n");
+
+   /* A POST with the arguments in the URI and no body. */
+   i_webclient.deleteArgs();
+   i_webclient.regArg("color", "dark red");
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.answerpage(80, "/wakanda");
+   page = i_webclient.readpage(80);
+   checkpage(page, "Method: POST\n");
+   checkpage(page, "Arguments: 1\n");
+   checkpage(page, " color: dark red\n");
+
+   /* The buffer is reused, nothing from the last request is left in it. */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/wakanda");
+   page = i_webclient.readpage(80);
+   checkpage(page, "Arguments: 0\n");
+}
+
+void HelloServertest::t5(void) {
+   std::string page;
+   char line[16];
+   size_t pos;
+   int l;
+
+   SC_REPORT_INFO("TEST", "Running T5: streamed responses.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* Without a length the page goes out in chunks. It is bigger than a
+    * block, so there is more than one, and the last one is empty.
+    */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/stream");
+   page = i_webclient.readpage(80);
+   checkpage(page, "HTTP/1.1 200 OK");
+   checkpage(page, "Transfer-Encoding: chunked");
+   checkpage(page, "\n596\n");
+   checkpage(page, "\n0\n");
+
+   /* All the lines should be there and in order. */
+   pos = 0;
+   for(l = 0; l < 200; l = l + 1) {
+      snprintf(line, sizeof(line), "line %03d\n", l);
+      pos = page.find(line, pos);
+      if (pos == std::string::npos) {
+         PRINTF_ERROR("TEST", "Line %d missing or out of order", l);
+         break;
+      }
+   }
+
+   /* With the length there are no chunks. */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/stream?length=1");
+   page = i_webclient.readpage(80);
+   checkpage(page, "Content-Length: 2000");
+   checkpage(page, "line 000\nline 001\n");
+   checkpage(page, "line 199\n");
+   if (page.find("chunked") != std::string::npos)
+      PRINTF_ERROR("TEST", "Page with a length should not be chunked");
+}
+
+void HelloServertest::t6(void) {
+   std::string page;
+
+   SC_REPORT_INFO("TEST", "Running T6: request head bigger than the buffer.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* The header is about twice the size of the request buffer, so it has to
+    * grow twice before the end of the head is found.
+    */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.sendrequest(80, "GET /wakanda?big=1 HTTP/1.1\r\n"
+      "Host: www.webclient.com.br\r\n"
+      "X-Filler: " + std::string(3000, 'x') + "\r\n\r\n");
+   page = i_webclient.readpage(80);
+   checkpage(page, "HTTP/1.1 404 Not Found");
+   checkpage(page, "URI: /wakanda\n");
+   checkpage(page, "Arguments: 1\n");
+   checkpage(page, " big: 1\n");
+
+   /* The next client gets a small buffer again and still works. */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/wakanda?small=1");
+   page = i_webclient.readpage(80);
+   checkpage(page, " small: 1\n");
+}
+
+void HelloServertest::t7(void) {
+   std::string page;
+   std::string uri;
+   char arg[24];
+   int a;
+
+   SC_REPORT_INFO("TEST", "Running T7: more arguments than the array.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* The argument array starts with room for 32, we send 40. None can be
+    * left out.
+    */
+   uri = "/wakanda?";
+   for(a = 0; a < 40; a = a + 1) {
+      snprintf(arg, sizeof(arg), "%sa%d=%d", (a == 0)?"":"&", a, a);
+      uri = uri + arg;
+   }
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, uri);
+   page = i_webclient.readpage(80);
+   checkpage(page, "Arguments: 40\n");
+   for(a = 0; a < 40; a = a + 1) {
+      snprintf(arg, sizeof(arg), " a%d: %d\n", a, a);
+      checkpage(page, arg);
+   }
+}
+
+void HelloServertest::t8(void) {
+   std::string page;
+   std::string body;
+   size_t formpos, urlpos;
+
+   SC_REPORT_INFO("TEST", "Running T8: form bounded to its length.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* The form has an epilogue after the closing boundary. It is part of the
+    * body, so it has to be skipped, and the GET right after it is a
+    * pipelined request.
+    */
+   body = "--XyZ\r\n"
+      "Content-Disposition: form-data; name=\"color\"\r\n"
+      "\r\n"
+      "dark red\r\n"
+      "--XyZ--\r\n"
+      "this is the epilogue\r\n";
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.sendrequest(80, "POST /wakanda?id=7 HTTP/1.1\r\n"
+      "Host: www.webclient.com.br\r\n"
+      "Content-Type: multipart/form-data; boundary=XyZ\r\n"
+      "Content-Length: " + std::to_string(body.length()) + "\r\n\r\n"
+      + body +
+      "GET /wakanda?next=1 HTTP/1.1\r\n"
+      "Host: www.webclient.com.br\r\n\r\n");
+   page = i_webclient.readpage(80);
+   checkpage(page, "Method: POST\n");
+   checkpage(page, "Arguments: 2\n");
+   checkpage(page, "Connection: keep-alive");
+   checkpage(page, " next: 1\n");
+   if (page.find("URI: is\n") != std::string::npos)
+      PRINTF_ERROR("TEST", "The epilogue was taken as a request");
+
+   /* The form arguments come before the ones in the URL. */
+   formpos = page.find(" color: dark red\n");
+   urlpos = page.find(" id: 7\n");
+   if (formpos == std::string::npos || urlpos == std::string::npos) {
+      PRINTF_ERROR("TEST", "Form or URL argument missing");
+   }
+   else if (formpos > urlpos) {
+      PRINTF_ERROR("TEST", "Form argument listed after the URL one");
+   }
+}
+
+void HelloServertest::t9(void) {
+   std::string page;
+   sc_time start;
+
+   SC_REPORT_INFO("TEST", "Running T9: CRLF after a POST body.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* Some clients end the body with a CRLF that is not counted in the
+    * length. It is no pipelined request, so the connection is not kept and
+    * the server does not wait for a request that never comes.
+    */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   start = sc_time_stamp();
+   i_webclient.sendrequest(80, "POST /wakanda HTTP/1.1\r\n"
+      "Host: www.webclient.com.br\r\n"
+      "Content-Type: application/x-www-form-urlencoded\r\n"
+      "Content-Length: 8\r\n\r\n"
+      "a=1&b=22\r\n");
+   page = i_webclient.readpage(80);
+   checkpage(page, "Arguments: 2\n");
+   checkpage(page, " b: 22\n");
+   checkpage(page, "Connection: close");
+   if (page.find("keep-alive") != std::string::npos)
+      PRINTF_ERROR("TEST", "The CRLF was taken as a pipelined request");
+   /* The server waits 5s for a request before it gives up. */
+   if (sc_time_stamp() - start >= sc_time(5, SC_SEC))
+      PRINTF_ERROR("TEST", "Connection took %s to close",
+         (sc_time_stamp() - start).to_string().c_str());
+}
+
+void HelloServertest::t10(void) {
+   std::string topic;
+   std::string payload;
+   int q1, q2;
+   int m;
+
+   SC_REPORT_INFO("TEST", "Running T10: MQTT handshakes with the firmware.");
+
+   /* The broker takes the connection the firmware makes. Its acks are held
+    * back so that the messages pile up in the esp-mqtt outbox.
+    */
+   i_mqttbroker.attach(i_webclient);
+   i_mqttbroker.setackdelay(sc_time(20, SC_MS));
+   i_mqttbroker.connect("tbA");
+   i_mqttbroker.subscribe("tbA", "esp/#", 2);
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* The /mqtt page starts the client in the firmware. */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/mqtt");
+   i_webclient.expectline(80, "HTTP/1.1 200 OK");
+   i_webclient.expecttillline(80, "mqtt started");
+
+   /* Once connected it publishes four messages at QoS 1 and four at QoS 2,
+    * which only leave its outbox when the PUBACK or the PUBCOMP comes.
+    */
+   q1 = 0;
+   q2 = 0;
+   for(m = 0; m < 8; m = m + 1) {
+      if (!i_mqttbroker.receive("tbA", topic, payload, sc_time(2, SC_SEC))) {
+         PRINTF_ERROR("TEST", "Only got %d of 8 messages", m);
+         break;
+      }
+      if (topic == "esp/q1") q1 = q1 + 1;
+      else if (topic == "esp/q2") q2 = q2 + 1;
+   }
+   if (q1 != 4 || q2 != 4)
+      PRINTF_ERROR("TEST", "Expected 4/4 QoS 1/2 messages but got %d/%d",
+         q1, q2);
+   wait(200, SC_MS);
+   if (i_mqttbroker.maxoutbox() < 2)
+      PRINTF_ERROR("TEST", "Expected the outbox to fill up but max was %d",
+         i_mqttbroker.maxoutbox());
+   if (i_mqttbroker.outbox() != 0)
+      PRINTF_ERROR("TEST", "Expected an empty outbox but %d are left",
+         i_mqttbroker.outbox());
+
+   /* Now the other way. The firmware only sends esp/ack once it has the
+    * message, and the broker keeps it until the PUBCOMP.
+    */
+   i_mqttbroker.setackdelay(SC_ZERO_TIME);
+   i_mqttbroker.publish("led/cmd", "on", 2);
+   i_mqttbroker.expect("tbA", "esp/ack", "on", sc_time(2, SC_SEC));
+   wait(200, SC_MS);
+   if (i_mqttbroker.inflight() != 0)
+      PRINTF_ERROR("TEST", "Expected nothing in flight but got %d",
+         i_mqttbroker.inflight());
+   if (i_mqttbroker.retransmissions() != 0)
+      PRINTF_ERROR("TEST", "Expected no retransmissions but got %d",
+         i_mqttbroker.retransmissions());
+
+   /* With a retry time shorter than the firmware takes to answer, the broker
+    * sends the message again. It is QoS 1, so the firmware can see it more
+    * than once, but the handshake still ends.
+    */
+   i_mqttbroker.setretry(i_mqttbroker.acklatency() / 4);
+   i_mqttbroker.publish("led/cmd", "off", 1);
+   i_mqttbroker.expect("tbA", "esp/ack", "off", sc_time(2, SC_SEC));
+   wait(200, SC_MS);
+   i_mqttbroker.setretry(sc_time(5, SC_SEC));
+   if (i_mqttbroker.retransmissions() == 0)
+      PRINTF_ERROR("TEST", "Expected the message to be sent again");
+   if (i_mqttbroker.inflight() != 0)
+      PRINTF_ERROR("TEST", "Expected nothing in flight but got %d",
+         i_mqttbroker.inflight());
+   i_mqttbroker.report();
+}
+
+void HelloServertest::t11(void) {
+   std::string page;
+   size_t pos, n;
+
+   SC_REPORT_INFO("TEST", "Running T11: writer claiming too much.");
+
+   /* We wait for the server to come up. */
+   i_uartclient.expect("");
+   i_uartclient.expect("");
+   i_uartclient.expect("Connected to awifi");
+   i_uartclient.expect("IP address: 192.76.0.100");
+   i_uartclient.expect("HTTP server started");
+
+   /* The writer fills the block and says it wrote 100 bytes more. We should
+    * get one full block of 1436 bytes, its footer and the empty chunk.
+    */
+   i_webclient.connectclient(IPAddress(192,76,0,100), 80);
+   i_webclient.requestpage(80, "/overrun");
+   page = i_webclient.readpage(80);
+   checkpage(page, "HTTP/1.1 200 OK");
+   checkpage(page, "\n59c\n");
+   checkpage(page, "\n0\n");
+   pos = page.find("\n59c\n");
+   if (pos != std::string::npos) pos = pos + 5;
+   n = 0;
+   while (pos != std::string::npos && pos < page.size() && page[pos] == 'x') {
+      n = n + 1;
+      pos = pos + 1;
+   }
+   if (n != 1436)
+      PRINTF_ERROR("TEST", "Expected a block of 1436 bytes but got %d",
+         (int)n);
+   if (pos != std::string::npos && page.find('x', pos) != std::string::npos)
+      PRINTF_ERROR("TEST", "More data came after the clamped block");
+}
+
 void HelloServertest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
+   else if (tn == 2) t2();
+   else if (tn == 3) t3();
+   else if (tn == 4) t4();
+   else if (tn == 5) t5();
+   else if (tn == 6) t6();
+   else if (tn == 7) t7();
+   else if (tn == 8) t8();
+   else if (tn == 9) t9();
+   else if (tn == 10) t10();
+   else if (tn == 11) t11();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
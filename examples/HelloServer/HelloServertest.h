@@ -24,6 +24,7 @@
 #include "doitesp32devkitv1.h"
 #include "uartclient.h"
 #include "webclient.h"
+#include "mqttbroker.h"
 
 SC_MODULE(HelloServertest) {
    /* Signals */
@@ -47,6 +48,7 @@ SC_MODULE(HelloServertest) {
    doitesp32devkitv1 i_esp{"i_esp"};
    webclient i_webclient{"i_webclient"};
    uartclient i_uartclient{"i_uartclient"};
+   mqttbroker i_mqttbroker{"i_mqttbroker"};
    netcon_mixtobool i_netcon{"i_netcon"};
 
    /* Processes */
@@ -56,6 +58,18 @@ SC_MODULE(HelloServertest) {
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   void t2();
+   void t3();
+   void t4();
+   void t5();
+   void t6();
+   void t7();
+   void t8();
+   void t9();
+   void t10();
+   void t11();
+   void checkpage(std::string page, const char *text);
 
    // Constructor
    SC_CTOR(HelloServertest) {
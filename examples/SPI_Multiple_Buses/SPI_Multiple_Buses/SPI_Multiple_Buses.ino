@@ -14,6 +14,8 @@
  *    Sampled the returned value from the VSPI and HSPI and printed them to
  *    STDOUT. Also added prototype declarations for the vspiCommand and
  *    hspiCommand functions.
+ *    Added one long VSPI transfer of 100 and one of 5000 bytes, which go
+ *    through the DMA, and printed a checksum of what came back.
  */
 #include <SPI.h>
 
@@ -25,6 +27,12 @@ SPIClass * hspi = NULL;
 
 void hspiCommand();
 void vspiCommand();
+void vspiBlock(int len);
+
+//buffers for the long transfers
+static uint8_t blockOut[5000];
+static uint8_t blockIn[5000];
+static int pass = 0;
 
 void setup() {
   Serial.begin(115200);
@@ -58,6 +66,10 @@ void loop() {
   //use the SPI buses
   vspiCommand();
   hspiCommand();
+  //on the second and third pass we also send a long buffer
+  if (pass == 1) vspiBlock(100);
+  else if (pass == 2) vspiBlock(5000);
+  pass++;
   delay(100);
 }
 
@@ -85,3 +97,18 @@ void hspiCommand() {
   /* Upon success, we print a message, but only once. */
   if (millis() < 50) Serial.printf("Received %02x @ %lu\r\n", stuff, millis());
 }
+
+void vspiBlock(int len) {
+  uint16_t sum = 0;
+  int i;
+
+  for (i = 0; i < len; i++) blockOut[i] = i & 0xff;
+  vspi->beginTransaction(SPISettings(spiClk, MSBFIRST, SPI_MODE0));
+  digitalWrite(5, LOW);
+  vspi->transferBytes(blockOut, blockIn, len);
+  digitalWrite(5, HIGH);
+  vspi->endTransaction();
+  for (i = 0; i < len; i++) sum += blockIn[i];
+  Serial.printf("Block %d sum %04x first %02x last %02x\r\n", len, sum,
+    blockIn[0], blockIn[len-1]);
+}
@@ -73,11 +73,16 @@ void SPI_Multiple_Busestest::start_of_simulation() {
  * return: none
  * globals: none
  *
- * Dumps everything comming from the serial interface.
+ * Dumps everything comming from the serial interface. The last line is kept
+ * so that the tests can check what the firmware printed.
  */
 void SPI_Multiple_Busestest::serflush() {
    //i_uartclient.i_uart.set_debug(true);
-   i_uartclient.dump();
+   while(true) {
+      lastline = i_uartclient.get();
+      SC_REPORT_INFO("SERIAL", lastline.c_str());
+      serline_ev.notify();
+   }
 }
 
 /*******************************************************************************
@@ -137,12 +142,156 @@ void SPI_Multiple_Busestest::t0(void) {
    wait(1, SC_SEC);
 }
 
+void SPI_Multiple_Busestest::t1(void) {
+   unsigned int got;
+   SC_REPORT_INFO("TEST", "Running Test T1.");
+
+   /* We take the VSPI at the transaction level, so the whole byte comes in
+    * one call to spitransport().
+    */
+   i_esp.i_vspi.attach(this);
+   PRINTF_INFO("TEST", "Waiting for VSPI");
+   wait(sc_time(100, SC_MS), spi_ev);
+   if (!spi_ev.triggered()) {
+      PRINTF_ERROR("TEST", "Timed out while waiting for the VSPI");
+   }
+   else if (lastmosi != 0x55) {
+      PRINTF_ERROR("TEST", "Expected 55 on VSPI and got %02x", lastmosi);
+   }
+
+   /* The firmware then prints what it read, which should be what we sent
+    * back.
+    */
+   do {
+      wait(sc_time(100, SC_MS), serline_ev);
+      if (!serline_ev.triggered()) {
+         PRINTF_ERROR("TEST", "Timed out while waiting for the firmware");
+         break;
+      }
+   } while (lastline.find("Received") != 0);
+   if (serline_ev.triggered()) {
+      if (1 != sscanf(lastline.c_str(), "Received %x", &got) || got != 0x79) {
+         PRINTF_ERROR("TEST", "Expected the firmware to read 79 but got: %s",
+            lastline.c_str());
+      }
+      else {
+         PRINTF_INFO("TEST", "Sent 79 and the firmware read %02x", got);
+      }
+   }
+
+   wait(1, SC_SEC);
+}
+
+void SPI_Multiple_Busestest::t2(void) {
+   const unsigned int sizes[2] = {100, 5000};
+   unsigned int b, i, len, sum, first, last, expsum;
+   sc_time tstart, tlen;
+   bool ok;
+
+   SC_REPORT_INFO("TEST", "Running Test T2.");
+
+   /* The firmware sends a buffer of 100 bytes and then one of 5000. Both
+    * are longer than the data_buf, so they go through the DMA. The second
+    * one also needs two descriptors in each chain.
+    */
+   i_esp.i_vspi.attach(this);
+   for(b = 0; b < 2; b = b + 1) {
+      len = sizes[b];
+      PRINTF_INFO("TEST", "Waiting for the %u byte transfer", len);
+      wait(sc_time(500, SC_MS), blk_ev);
+      if (!blk_ev.triggered()) {
+         PRINTF_ERROR("TEST", "Timed out while waiting for the VSPI");
+         return;
+      }
+      tstart = sc_time_stamp();
+
+      /* It all must come in one transaction, in order. */
+      if (lastblock.size() != len || lastbits != len * 8) {
+         PRINTF_ERROR("TEST", "Expected %u bytes but got %u in %u bits",
+            len, (unsigned int)lastblock.size(), lastbits);
+      }
+      else {
+         ok = true;
+         for(i = 0; i < len && ok; i = i + 1) {
+            if (lastblock[i] != (i & 0xff)) {
+               PRINTF_ERROR("TEST", "Byte %u is %02x instead of %02x", i,
+                  lastblock[i], i & 0xff);
+               ok = false;
+            }
+         }
+      }
+
+      /* At 1MHz each byte takes 8us, and the SS comes back up right after
+       * the transfer.
+       */
+      while (vspi_ss.read() == GN_LOGIC_0)
+         wait(vspi_ss.value_changed_event());
+      tlen = sc_time_stamp() - tstart;
+      if (tlen < sc_time(len * 8, SC_US)
+            || tlen > sc_time(len * 8 * 1.1 + 50, SC_US)) {
+         PRINTF_ERROR("TEST", "%u bytes took %s", len,
+            tlen.to_string().c_str());
+      }
+
+      /* The firmware then adds up what came back over the in chain. */
+      expsum = 0;
+      for(i = 0; i < len; i = i + 1) expsum = expsum + ((i & 0xff) ^ 0xa5);
+      expsum = expsum & 0xffff;
+      do {
+         wait(sc_time(100, SC_MS), serline_ev);
+         if (!serline_ev.triggered()) {
+            PRINTF_ERROR("TEST", "Timed out while waiting for the firmware");
+            return;
+         }
+      } while (lastline.find("Block") != 0);
+      if (4 != sscanf(lastline.c_str(), "Block %u sum %x first %x last %x",
+               &i, &sum, &first, &last)
+            || i != len || sum != expsum || first != 0xa5
+            || last != (((len - 1) & 0xff) ^ 0xa5)) {
+         PRINTF_ERROR("TEST", "Expected sum %04x but the firmware got: %s",
+            expsum, lastline.c_str());
+      }
+      else {
+         PRINTF_INFO("TEST", "The firmware read back %u bytes", len);
+      }
+   }
+}
+
+/**********************
+ * Task: spitransport():
+ * inputs: transaction
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Takes a transaction from the VSPI when the SS is low and answers it. A
+ * single byte gets 79 back, longer ones get each byte xored with a5.
+ */
+void SPI_Multiple_Busestest::spitransport(spitrans_t &t) {
+   unsigned int i;
+
+   if (vspi_ss.read() != GN_LOGIC_0) return;
+   if (t.mosi.size() > 1) {
+      lastblock = t.mosi;
+      lastbits = t.mosibits;
+      for(i = 0; i < t.miso.size() && i < t.mosi.size(); i = i + 1)
+         t.miso[i] = t.mosi[i] ^ 0xa5;
+      blk_ev.notify();
+      return;
+   }
+   if (t.mosi.size() > 0) lastmosi = t.mosi[0];
+   if (t.miso.size() > 0) t.miso[0] = 0x79;
+   spi_ev.notify();
+}
+
 void SPI_Multiple_Busestest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
+   else if (tn == 2) t2();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
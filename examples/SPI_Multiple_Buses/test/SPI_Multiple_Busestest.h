@@ -23,8 +23,10 @@
 #include <Arduino.h>
 #include "doitesp32devkitv1.h"
 #include "uartclient.h"
+#include "spitlm.h"
+#include <vector>
 
-SC_MODULE(SPI_Multiple_Busestest) {
+SC_MODULE(SPI_Multiple_Busestest), public spislave_if {
    /* Signals */
    sc_signal<bool> led {"led"};
    gn_signal_mix d2_a12 {"d2_a12"};
@@ -62,9 +64,26 @@ SC_MODULE(SPI_Multiple_Busestest) {
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   void t2();
+
+   /* Transaction level slave, used by t1 and t2 */
+   void spitransport(spitrans_t &t);
+   sc_event spi_ev;
+   int lastmosi;
+   /* Transfers longer than a byte, kept for t2 */
+   sc_event blk_ev;
+   std::vector<uint8_t> lastblock;
+   unsigned int lastbits;
+
+   /* Last line printed by the firmware */
+   std::string lastline;
+   sc_event serline_ev;
 
    // Constructor
    SC_CTOR(SPI_Multiple_Busestest) {
+      lastmosi = -1;
+      lastbits = 0;
 
       /* UART 0 - we connect the wires to the corresponding tasks. Yes, the
        * RX and TX need to be switched.
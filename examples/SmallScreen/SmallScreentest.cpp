@@ -53,6 +53,74 @@ void SmallScreentest::serflush() {
    i_uartclient.dump();
 }
 
+/**********************
+ * fbrect():
+ * inputs: framebuffer, window corners and colour
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Sends the commands a driver would to fill the window with a 16 bit colour.
+ */
+static void fbrect(tftfb &fb, int x1, int y1, int x2, int y2, uint16_t c) {
+   int p;
+
+   fb.command(0x2a);
+   fb.data(x1 >> 8); fb.data(x1 & 0xff); fb.data(x2 >> 8); fb.data(x2 & 0xff);
+   fb.command(0x2b);
+   fb.data(y1 >> 8); fb.data(y1 & 0xff); fb.data(y2 >> 8); fb.data(y2 & 0xff);
+   fb.command(0x2c);
+   for(p = 0; p < (x2 - x1 + 1) * (y2 - y1 + 1); p = p + 1) {
+      fb.data(c >> 8);
+      fb.data(c & 0xff);
+   }
+   fb.command(0x00);
+}
+
+/**********************
+ * tftsend():
+ * inputs: bytes, count, command or data and path
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Sends bytes to the parallel panel, either strobing them in one at a time
+ * on the pins or handing them all over at once on the bulk interface.
+ */
+void SmallScreentest::tftsend(const uint8_t *b, int len, bool iscmd,
+      bool bulk) {
+   gn_signal_mix *d[8] = {&tft_d0, &tft_d1, &tft_d2, &tft_d3,
+      &tft_d4, &tft_d5, &tft_d6, &tft_d7};
+   spitrans_t t;
+   int i, bit;
+
+   tft_dc.write((iscmd)?GN_LOGIC_0:GN_LOGIC_1);
+   wait(10, SC_NS);
+
+   if (bulk) {
+      t.cs = 0;
+      t.cmdbits = 0; t.cmd = 0;
+      t.addrbits = 0; t.addr = 0;
+      t.dummycycles = 0;
+      t.fullduplex = true;
+      t.mosibits = len * 8;
+      t.mosi.assign(b, b + len);
+      t.misobits = 0;
+      i_tft.spitransport(t);
+      wait(10, SC_NS);
+      return;
+   }
+
+   for(i = 0; i < len; i = i + 1) {
+      for(bit = 0; bit < 8; bit = bit + 1)
+         d[bit]->write(((b[i] >> bit) & 1)?GN_LOGIC_1:GN_LOGIC_0);
+      tft_wr.write(GN_LOGIC_0);
+      wait(10, SC_NS);
+      tft_wr.write(GN_LOGIC_1);
+      wait(10, SC_NS);
+   }
+}
+
 /*******************************************************************************
 ** Testbenches *****************************************************************
 *******************************************************************************/
@@ -72,12 +140,129 @@ void SmallScreentest::t0(void) {
    wait(500, SC_MS);
 }
 
+void SmallScreentest::t1(void) {
+   tftfb fb(128, 160);
+   std::vector<tftrect_t> d;
+
+   SC_REPORT_INFO("TEST", "Running Test T1: framebuffer.");
+
+   /* We drive a framebuffer of the panel size straight from here, in
+    * 16 bit colour.
+    */
+   fb.command(0x01);
+   fb.command(0x3a); fb.data(0x55);
+
+   /* A red square goes where the window says. */
+   fbrect(fb, 10, 20, 19, 29, 0xf800);
+   if (fb.pixel(10, 20) != 0xf800 || fb.pixel(19, 29) != 0xf800
+         || fb.pixel(20, 20) != 0x0000 || fb.pixel(10, 30) != 0x0000)
+      PRINTF_ERROR("TEST", "Red square is not in place");
+   d = fb.dirty();
+   if (d.size() != 1 || d[0].x1 != 10 || d[0].y1 != 20 || d[0].x2 != 19
+         || d[0].y2 != 29)
+      PRINTF_ERROR("TEST", "Expected one dirty rectangle for the square");
+
+   /* A blue one right next to it is merged into the same rectangle. One far
+    * away gets its own.
+    */
+   fbrect(fb, 20, 20, 29, 29, 0x001f);
+   fbrect(fb, 100, 100, 104, 104, 0x001f);
+   d = fb.dirty();
+   if (d.size() != 2 || d[0].x1 != 10 || d[0].x2 != 29)
+      PRINTF_ERROR("TEST", "Expected the squares merged and one more");
+
+   /* Drawing the red square again writes the pixels but changes none. */
+   fb.cleardirty();
+   fb.clearcounters();
+   fbrect(fb, 10, 20, 19, 29, 0xf800);
+   if (fb.pixelswritten() != 100 || fb.pixelschanged() != 0
+         || fb.dirty().size() != 0)
+      PRINTF_ERROR("TEST", "Expected 100 written, none changed, got %u/%u",
+         fb.pixelswritten(), fb.pixelschanged());
+
+   /* With MADCTL MX the columns are mirrored, and with BGR the colour is
+    * swapped back.
+    */
+   fb.command(0x36); fb.data(0x48);
+   fbrect(fb, 0, 0, 0, 0, 0x001f);
+   fb.command(0x36); fb.data(0x00);
+   if (fb.pixel(127, 0) != 0xf800 || fb.pixel(0, 0) != 0x0000)
+      PRINTF_ERROR("TEST", "MADCTL MX/BGR pixel is at the wrong place");
+
+   /* The panel compares the same as its own snapshot, and one pixel off is
+    * caught, unless we allow for it.
+    */
+   if (!fb.saveppm("SmallScreen_t1.ppm"))
+      PRINTF_ERROR("TEST", "Could not save the panel");
+   fb.expectimage("SmallScreen_t1.ppm");
+   fbrect(fb, 64, 64, 64, 64, 0xffff);
+   if (fb.compare("SmallScreen_t1.ppm") != 1)
+      PRINTF_ERROR("TEST", "Expected one pixel off the snapshot");
+   fb.expectimage("SmallScreen_t1.ppm", 0, 1);
+   fb.expectimage("SmallScreen_t1.ppm", 0, 0, 0, 63, 63);
+}
+
+void SmallScreentest::t2(void) {
+   const uint8_t caset[4] = {0x00, 0x00, 0x00, 0x27};
+   const uint8_t raset[4] = {0x00, 0x00, 0x00, 0x01};
+   uint8_t pix[160];
+   uint8_t c;
+   unsigned int sig[2];
+   int run, i;
+
+   SC_REPORT_INFO("TEST", "Running Test T2: panel signature.");
+
+   /* A 40x2 image, wide enough for the signature to take every byte. */
+   for(i = 0; i < 160; i = i + 1) pix[i] = (i * 37) & 0xff;
+
+   /* We send it once on the pins and once in bulk. Both must give the same
+    * signature, and the signals only show it once the write is done.
+    */
+   for(run = 0; run < 2; run = run + 1) {
+      i_tft.fb.clearcounters();
+      c = 0x3a; tftsend(&c, 1, true, run == 1);
+      c = 0x55; tftsend(&c, 1, false, run == 1);
+      c = 0x2a; tftsend(&c, 1, true, run == 1);
+      tftsend(caset, 4, false, run == 1);
+      c = 0x2b; tftsend(&c, 1, true, run == 1);
+      tftsend(raset, 4, false, run == 1);
+      c = 0x2c; tftsend(&c, 1, true, run == 1);
+      tftsend(pix, 80, false, run == 1);
+      if (i_tft.explength.read() != 160)
+         PRINTF_ERROR("TEST", "Signature signals changed in the middle of "
+            "the write");
+      tftsend(pix + 80, 80, false, run == 1);
+
+      sig[run] = i_tft.signature.read();
+      PRINTF_INFO("TEST", "%s signature %08x",
+         (run == 0)?"Pin":"Bulk", sig[run]);
+      if (i_tft.explength.read() != 0 || i_tft.endcol.read() != 39
+            || i_tft.endrow.read() != 1)
+         PRINTF_ERROR("TEST", "Write did not end where expected");
+      if (i_tft.fb.pixelswritten() != 80)
+         PRINTF_ERROR("TEST", "Expected 80 pixels written but got %u",
+            i_tft.fb.pixelswritten());
+   }
+
+   if (sig[0] == 0 || sig[0] != sig[1])
+      PRINTF_ERROR("TEST", "Pin and bulk signatures differ");
+   /* The second time around nothing on the panel changed. */
+   if (i_tft.fb.pixelschanged() != 0)
+      PRINTF_ERROR("TEST", "Bulk write changed %u pixels",
+         i_tft.fb.pixelschanged());
+   if (i_tft.fb.pixel(0, 0) != ((pix[0] << 8) | pix[1])
+         || i_tft.fb.pixel(39, 1) != ((pix[158] << 8) | pix[159]))
+      PRINTF_ERROR("TEST", "Image is not on the panel");
+}
+
 void SmallScreentest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
+   else if (tn == 2) t2();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
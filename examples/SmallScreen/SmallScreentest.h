@@ -23,6 +23,8 @@
 #include <Arduino.h>
 #include "doitesp32devkitv1.h"
 #include "uartclient.h"
+#include "tftfb.h"
+#include "tft.h"
 
 SC_MODULE(SmallScreentest) {
    /* Signals */
@@ -39,6 +41,23 @@ SC_MODULE(SmallScreentest) {
    sc_signal<bool> fromi2c {"fromi2c"};
    sc_signal<bool> toi2c {"toi2c"};
 
+   /* Parallel panel, driven straight from the testbench. The strobes start
+    * inactive so the panel sees no write before the test starts.
+    */
+   gn_signal_mix tft_cs {"tft_cs", GN_LOGIC_0};
+   gn_signal_mix tft_dc {"tft_dc", GN_LOGIC_1};
+   gn_signal_mix tft_rst {"tft_rst", GN_LOGIC_1};
+   gn_signal_mix tft_wr {"tft_wr", GN_LOGIC_1};
+   gn_signal_mix tft_rd {"tft_rd", GN_LOGIC_1};
+   gn_signal_mix tft_d0 {"tft_d0"};
+   gn_signal_mix tft_d1 {"tft_d1"};
+   gn_signal_mix tft_d2 {"tft_d2"};
+   gn_signal_mix tft_d3 {"tft_d3"};
+   gn_signal_mix tft_d4 {"tft_d4"};
+   gn_signal_mix tft_d5 {"tft_d5"};
+   gn_signal_mix tft_d6 {"tft_d6"};
+   gn_signal_mix tft_d7 {"tft_d7"};
+
    /* Unconnected signals */
    gn_signal_mix logic_0 {"logic_0", GN_LOGIC_0};
 
@@ -46,6 +65,7 @@ SC_MODULE(SmallScreentest) {
    doitesp32devkitv1 i_esp{"i_esp"};
    uartclient i_uartclient{"i_uartclient"};
    netcon_mixtobool i_netcon{"i_netcon"};
+   tftmod i_tft{"i_tft"};
 
    /* Processes */
    void testbench(void);
@@ -54,6 +74,9 @@ SC_MODULE(SmallScreentest) {
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   void t2();
+   void tftsend(const uint8_t *b, int len, bool iscmd, bool bulk);
 
    // Constructor
    SC_CTOR(SmallScreentest) {
@@ -69,6 +92,12 @@ SC_MODULE(SmallScreentest) {
       i_netcon.a(d2_a12);
       i_netcon.b(led);
 
+      /* The parallel panel. */
+      i_tft.cs(tft_cs); i_tft.dc(tft_dc); i_tft.rst(tft_rst);
+      i_tft.wr(tft_wr); i_tft.rd(tft_rd);
+      i_tft.d0(tft_d0); i_tft.d1(tft_d1); i_tft.d2(tft_d2); i_tft.d3(tft_d3);
+      i_tft.d4(tft_d4); i_tft.d5(tft_d5); i_tft.d6(tft_d6); i_tft.d7(tft_d7);
+
       /* Other interfaces, none are used so they are just left floating. */
       i_esp.wrx(fromwifi); i_esp.wtx(towifi);
       /* Note: these two will soon be replaced with the real flash and I2C
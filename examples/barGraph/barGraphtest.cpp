@@ -76,12 +76,100 @@ void barGraphtest::t0(void) {
    wait(500, SC_MS);
 }
 
+/**********************
+ * lit():
+ * inputs: none
+ * outputs: none
+ * return: number of LEDs on
+ * globals: none
+ *
+ * Counts the LEDs in the bar that are on.
+ */
+int barGraphtest::lit() {
+   int n = 0;
+   if (led1.read() == SC_LOGIC_1) n = n + 1;
+   if (led2.read() == SC_LOGIC_1) n = n + 1;
+   if (led3.read() == SC_LOGIC_1) n = n + 1;
+   if (led4.read() == SC_LOGIC_1) n = n + 1;
+   if (led5.read() == SC_LOGIC_1) n = n + 1;
+   if (led6.read() == SC_LOGIC_1) n = n + 1;
+   if (led7.read() == SC_LOGIC_1) n = n + 1;
+   if (led8.read() == SC_LOGIC_1) n = n + 1;
+   if (led9.read() == SC_LOGIC_1) n = n + 1;
+   if (led10.read() == SC_LOGIC_1) n = n + 1;
+   return n;
+}
+
+void barGraphtest::t1(void) {
+   FILE *f;
+   int s, n, last;
+   sc_time start;
+   SC_REPORT_INFO("TEST", "Running Test T1: PWL source on A0.");
+
+   /* We drive A0 with a triangle, 0V to 1V and back in one second. It goes
+    * through a file in SPICE notation, like one taken from a circuit
+    * simulator would.
+    */
+   f = fopen("barGraph_t1.pwl", "w");
+   if (f == NULL) {
+      SC_REPORT_ERROR("TEST", "Could not write barGraph_t1.pwl");
+      return;
+   }
+   fprintf(f, "# time voltage\n0 0\n500ms 1.0V\n1s 0\n");
+   fclose(f);
+   if (!tri.load("barGraph_t1.pwl") || tri.points() != 3) {
+      PRINTF_ERROR("TEST", "Loaded %d points from barGraph_t1.pwl, expected 3",
+         tri.points());
+      return;
+   }
+   start = sc_time_stamp();
+   tri.set_offset(start);
+   i_esp.i_adc1.set_source(0, &tri);
+   wait(10, SC_MS);
+   if (lit() != 0) PRINTF_ERROR("TEST", "%d LEDs on at 0V", lit());
+
+   /* The bar must only grow on the way up and only shrink on the way down. */
+   last = 0;
+   for(s = 1; s < 20; s = s + 1) {
+      wait(50, SC_MS);
+      n = lit();
+      PRINTF_INFO("TEST", "A0 at %.3fV, %d LEDs on",
+         tri.level(sc_time_stamp()), n);
+      if (s <= 10 && n < last)
+         PRINTF_ERROR("TEST", "Bar went from %d to %d LEDs while rising",
+            last, n);
+      if (s > 10 && n > last)
+         PRINTF_ERROR("TEST", "Bar went from %d to %d LEDs while falling",
+            last, n);
+      if (s == 10 && n < 9)
+         PRINTF_ERROR("TEST", "Only %d LEDs on at the peak", n);
+      last = n;
+   }
+
+   /* Past the last point the source holds it. With repeat on it should go
+    * around again, so half a period later we are back at the peak.
+    */
+   wait(500, SC_MS);
+   if (lit() != 0) PRINTF_ERROR("TEST", "%d LEDs on after the ramp", lit());
+   tri.set_repeat(true);
+   wait(start + sc_time(2500, SC_MS) - sc_time_stamp());
+   if (lit() < 9) PRINTF_ERROR("TEST", "Only %d LEDs on at the repeated peak",
+      lit());
+
+   /* We give A0 back to the testbench signal. */
+   i_esp.i_adc1.set_source(0, NULL);
+   a_in.write(0.0f);
+   wait(50, SC_MS);
+   if (lit() != 0) PRINTF_ERROR("TEST", "%d LEDs on after detaching", lit());
+}
+
 void barGraphtest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
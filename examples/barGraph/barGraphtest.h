@@ -24,6 +24,7 @@
 #include "doitesp32devkitv1.h"
 #include "uartclient.h"
 #include "gn_mixed.h"
+#include "pwlsrc.h"
 
 SC_MODULE(barGraphtest) {
    /* Signals */
@@ -53,6 +54,7 @@ SC_MODULE(barGraphtest) {
 
    /* blocks */
    doitesp32devkitv1 i_esp{"i_esp"};
+   pwlsrc tri;
 
    /* Processes */
    void testbench(void);
@@ -60,6 +62,8 @@ SC_MODULE(barGraphtest) {
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   int lit();
 
    // Constructor
    SC_CTOR(barGraphtest) {
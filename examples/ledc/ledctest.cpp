@@ -24,6 +24,8 @@
 #include <vector>
 #include "info.h"
 #include "main.h"
+#include "soc/ledc_struct.h"
+#include "update.h"
 
 /**********************
  * Function: trace()
@@ -43,6 +45,10 @@ void ledctest::trace(sc_trace_file *tf) {
    sc_trace(tf, ledc1, ledc1.name());
    sc_trace(tf, ledc2, ledc2.name());
    sc_trace(tf, ledc3, ledc3.name());
+   i_probe0.trace(tf);
+   i_probe1.trace(tf);
+   i_probe2.trace(tf);
+   i_probe3.trace(tf);
    i_esp.trace(tf);
 }
 
@@ -59,6 +65,41 @@ void ledctest::serflush() {
    i_uartclient.dump();
 }
 
+/**********************
+ * Function: fadeduty()
+ * inputs: time since the first rise of the fade up, in ms
+ * outputs: none
+ * return: the duty in percent
+ * globals: none
+ *
+ * Gives the duty the example's fades should have over the 2ms window
+ * starting at the given time. The driver spreads a fade of 4000 over 15000
+ * periods of 200us as one step every three periods, so each fade is over
+ * in 2.4s. The first rise comes with the first step. The fade down is
+ * loaded 3s after the fade up, which was about 2.5 periods before its first
+ * rise.
+ */
+double ledctest::fadeduty(double ms) {
+   const int downat = 15000 - 3;
+   int k, p, steps;
+   double sum;
+
+   p = (int)(ms * 5.0 + 0.5);
+   sum = 0.0;
+   for(k = p; k < p + 10; k = k + 1) {
+      if (k < downat) {
+         steps = 1 + k / 3;
+         if (steps > 4000) steps = 4000;
+      }
+      else {
+         steps = 4000 - (k - downat) / 3;
+         if (steps < 0) steps = 0;
+      }
+      sum = sum + steps;
+   }
+   return 100.0 * sum / 10.0 / 8192.0;
+}
+
 /*******************************************************************************
 ** Testbenches *****************************************************************
 *******************************************************************************/
@@ -71,12 +112,185 @@ void ledctest::t0(void) {
    wait(500, SC_MS);
 }
 
+void ledctest::t1(void) {
+   sc_time start;
+
+   SC_REPORT_INFO("TEST", "Running Test T1.");
+
+   /* The fade up starts from duty 0, so the first rise marks its start. */
+   while (!ledc0.read().ishigh()) wait(ledc0.value_changed_event());
+   start = sc_time_stamp();
+
+   /* With the APB at 12.5ns the divider gives exactly 200us per period, so
+    * the window starts on a period.
+    */
+   wait(start + sc_time(1500, SC_MS) - sc_time_stamp());
+   PRINTF_INFO("TEST", "Checking the fade up");
+   i_probe0.expectduty(fadeduty(1500), 0.1, sc_time(2, SC_MS));
+   i_probe0.expectfreq(5000.0, 0.01, sc_time(2, SC_MS));
+
+   /* Then it fades down and sets the duty to 4000 without fade. */
+   wait(start + sc_time(6500, SC_MS) - sc_time_stamp());
+   PRINTF_INFO("TEST", "Checking the fixed duty");
+   i_probe0.expectduty(100.0 * 4000 / 8192, 0.05, sc_time(10, SC_MS));
+   i_probe0.expectfreq(5000.0, 0.01, sc_time(10, SC_MS));
+
+   /* And last it sets it to 0, so there should be no edges at all. */
+   wait(start + sc_time(7500, SC_MS) - sc_time_stamp());
+   PRINTF_INFO("TEST", "Checking the zero duty");
+   i_probe0.expectedges(0, sc_time(10, SC_MS));
+}
+
+void ledctest::t2(void) {
+   pwmprobe *probes[4] = {&i_probe0, &i_probe1, &i_probe2, &i_probe3};
+   int p;
+
+   SC_REPORT_INFO("TEST", "Running Test T2.");
+
+   /* We go to the fixed duty part of the example and watch all four
+    * channels over the same window. The edges are computed from the timer
+    * settings, so they should stay put over a long window.
+    */
+   wait(6100, SC_MS);
+   PRINTF_INFO("TEST", "Checking the edges on all channels");
+   for(p = 0; p < 4; p = p + 1) probes[p]->start();
+   wait(100, SC_MS);
+   for(p = 0; p < 4; p = p + 1) probes[p]->stop();
+
+   for(p = 0; p < 4; p = p + 1) {
+      if (probes[p]->freq() < 4995.0 || probes[p]->freq() > 5005.0)
+         PRINTF_ERROR("TEST", "%s expected 5000Hz but got %.2fHz",
+            probes[p]->name(), probes[p]->freq());
+      if (probes[p]->duty() < 48.6 || probes[p]->duty() > 49.0)
+         PRINTF_ERROR("TEST", "%s expected duty 48.8%% but got %.2f%%",
+            probes[p]->name(), probes[p]->duty());
+      /* 500 periods, give or take the edges at the window ends. */
+      if (probes[p]->edges() < 998 || probes[p]->edges() > 1002)
+         PRINTF_ERROR("TEST", "%s expected 1000 edges but got %d",
+            probes[p]->name(), probes[p]->edges());
+   }
+
+   /* The channels on the same timer must run in step. */
+   if (i_probe0.period() != i_probe1.period()
+         || i_probe0.edges() != i_probe1.edges())
+      PRINTF_ERROR("TEST", "High speed channels are not in step");
+   if (i_probe2.period() != i_probe3.period()
+         || i_probe2.edges() != i_probe3.edges())
+      PRINTF_ERROR("TEST", "Low speed channels are not in step");
+
+   /* And when the duty goes to 0 they all stop. */
+   wait(900, SC_MS);
+   PRINTF_INFO("TEST", "Checking the zero duty on all channels");
+   for(p = 0; p < 4; p = p + 1) probes[p]->start();
+   wait(10, SC_MS);
+   for(p = 0; p < 4; p = p + 1) {
+      probes[p]->stop();
+      if (probes[p]->edges() != 0)
+         PRINTF_ERROR("TEST", "%s expected no edges but got %d",
+            probes[p]->name(), probes[p]->edges());
+   }
+}
+
+void ledctest::t3(void) {
+   /* Where we sample the fades, from the start of the fade up. */
+   const int at[5] = {750, 1500, 2250, 3750, 5250};
+   sc_time start;
+   double last;
+   int s;
+
+   SC_REPORT_INFO("TEST", "Running Test T3.");
+
+   /* The fade up starts from duty 0, so the first rise marks its start. */
+   while (!ledc0.read().ishigh()) wait(ledc0.value_changed_event());
+   start = sc_time_stamp();
+   PRINTF_INFO("TEST", "Fade started");
+
+   /* The model steps the duty by itself, with no help from the firmware, so
+    * it should follow the line on all channels.
+    */
+   last = 0.0;
+   for(s = 0; s < 5; s = s + 1) {
+      wait(start + sc_time(at[s], SC_MS) - sc_time_stamp());
+      i_probe0.start();
+      i_probe2.start();
+      wait(2, SC_MS);
+      i_probe0.stop();
+      i_probe2.stop();
+      PRINTF_INFO("TEST", "At %dms the duty is %.2f%%", at[s],
+         i_probe0.duty());
+      if (i_probe0.duty() < fadeduty(at[s]) - 0.1
+            || i_probe0.duty() > fadeduty(at[s]) + 0.1)
+         PRINTF_ERROR("TEST", "At %dms expected duty %.2f%% but got %.2f%%",
+            at[s], fadeduty(at[s]), i_probe0.duty());
+      if (i_probe2.duty() < i_probe0.duty() - 1.0
+            || i_probe2.duty() > i_probe0.duty() + 1.0)
+         PRINTF_ERROR("TEST", "At %dms the low speed channel is at %.2f%%",
+            at[s], i_probe2.duty());
+
+      /* Up for the first three, then down. */
+      if (s > 0 && s < 3 && i_probe0.duty() <= last)
+         PRINTF_ERROR("TEST", "The duty did not go up at %dms", at[s]);
+      if (s > 3 && i_probe0.duty() >= last)
+         PRINTF_ERROR("TEST", "The duty did not go down at %dms", at[s]);
+      last = i_probe0.duty();
+   }
+
+   /* And by then the fade down is over. */
+   wait(start + sc_time(5950, SC_MS) - sc_time_stamp());
+   i_probe0.expectduty(fadeduty(5950), 0.1, sc_time(2, SC_MS));
+}
+
+void ledctest::t4(void) {
+   sc_time start;
+
+   SC_REPORT_INFO("TEST", "Running Test T4.");
+
+   /* We wait for the fade up to start. */
+   while (!ledc0.read().ishigh()) wait(ledc0.value_changed_event());
+   start = sc_time_stamp();
+   wait(750, SC_MS);
+
+   /* We write the idle level of channel 0 in the middle of the fade. The
+    * output is enabled, so it changes nothing on the pin, and the fade must
+    * go on as if nothing happened.
+    */
+   PRINTF_INFO("TEST", "Writing conf0 during the fade");
+   LEDC.channel_group[0].channel[0].conf0.idle_lv = 1;
+   update_ledc();
+
+   /* Channel 1 runs the same fade on the same timer and was not touched,
+    * so both should be at the same duty.
+    */
+   wait(start + sc_time(1500, SC_MS) - sc_time_stamp());
+   i_probe0.start();
+   i_probe1.start();
+   wait(2, SC_MS);
+   i_probe0.stop();
+   i_probe1.stop();
+   PRINTF_INFO("TEST", "Duty is %.2f%% and %.2f%%", i_probe0.duty(),
+      i_probe1.duty());
+   if (i_probe0.duty() < i_probe1.duty() - 0.5
+         || i_probe0.duty() > i_probe1.duty() + 0.5)
+      PRINTF_ERROR("TEST", "The conf0 write changed the fade");
+   if (i_probe0.duty() < fadeduty(1500) - 0.1
+         || i_probe0.duty() > fadeduty(1500) + 0.1)
+      PRINTF_ERROR("TEST", "Expected duty %.2f%% but got %.2f%%",
+         fadeduty(1500), i_probe0.duty());
+
+   LEDC.channel_group[0].channel[0].conf0.idle_lv = 0;
+   update_ledc();
+}
+
 void ledctest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
+   else if (tn == 2) t2();
+   else if (tn == 3) t3();
+   else if (tn == 4) t4();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
@@ -23,6 +23,7 @@
 #include <Arduino.h>
 #include "doitesp32devkitv1.h"
 #include "uartclient.h"
+#include "pwmprobe.h"
 
 SC_MODULE(ledctest) {
    /* Signals */
@@ -49,6 +50,10 @@ SC_MODULE(ledctest) {
    /* blocks */
    doitesp32devkitv1 i_esp{"i_esp"};
    uartclient i_uartclient{"i_uartclient"};
+   pwmprobe i_probe0{"i_probe0"};
+   pwmprobe i_probe1{"i_probe1"};
+   pwmprobe i_probe2{"i_probe2"};
+   pwmprobe i_probe3{"i_probe3"};
    netcon_mixtobool i_netcon{"i_netcon"};
 
    /* Processes */
@@ -58,6 +63,11 @@ SC_MODULE(ledctest) {
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   void t2();
+   void t3();
+   void t4();
+   double fadeduty(double ms);
 
    // Constructor
    SC_CTOR(ledctest) {
@@ -73,11 +83,17 @@ SC_MODULE(ledctest) {
       i_netcon.a(d2_a12);
       i_netcon.b(led);
 
-      /* We connect the waveform to these. */
-      i_esp.d12_a15(ledc0);
-      i_esp.d21(ledc1);
-      i_esp.d26_a19(ledc2);
-      i_esp.d27_a17(ledc3);
+      /* We connect the waveform to these. They are the pins the example
+       * uses for the four channels.
+       */
+      i_esp.d18(ledc0);
+      i_esp.d19(ledc1);
+      i_esp.d4_a10(ledc2);
+      i_esp.d5(ledc3);
+      i_probe0.pinmix(ledc0);
+      i_probe1.pinmix(ledc1);
+      i_probe2.pinmix(ledc2);
+      i_probe3.pinmix(ledc3);
 
       /* Other interfaces, none are used so they are just left floating. */
       i_esp.wrx(fromwifi); i_esp.wtx(towifi);
@@ -88,12 +104,12 @@ SC_MODULE(ledctest) {
 
       /* Pins not used in this simulation */
       i_esp.d0_a11(logic_0); /* BOOT pin */
-      i_esp.d4_a10(logic_0); i_esp.d5(logic_0);
+      i_esp.d12_a15(logic_0);
       i_esp.d14_a16(logic_0);
       i_esp.d15_a13(logic_0); i_esp.d16(logic_0);
-      i_esp.d17(logic_0); i_esp.d18(logic_0); i_esp.d19(logic_0);
+      i_esp.d17(logic_0); i_esp.d21(logic_0);
       i_esp.d23(logic_0);
-      i_esp.d25_a18(logic_0);
+      i_esp.d25_a18(logic_0); i_esp.d26_a19(logic_0); i_esp.d27_a17(logic_0);
       i_esp.d33_a5(logic_0); i_esp.d34_a6(logic_0);
       i_esp.d35_a7(logic_0); i_esp.d36_a0(logic_0); i_esp.d37_a1(logic_0);
       i_esp.d38_a2(logic_0); i_esp.d39_a3(logic_0);
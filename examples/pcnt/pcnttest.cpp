@@ -23,6 +23,9 @@
 #include <string>
 #include <vector>
 #include "info.h"
+#include "esp_intr_alloc.h"
+#include "driver/pcnt.h"
+#include "soc/soc.h"
 
 /**********************
  * Function: trace()
@@ -72,11 +75,14 @@ void pcnttest::serflush() {
  */
 void pcnttest::drivewave() {
    int c;
-   pwm0.write(false);
    pwm1.write(false);
    pwm2.write(false);
    pwm3.write(false);
 
+   /* The other tests drive the pins themselves, so we leave them alone. */
+   if (tn >= 1) return;
+   pwm0.write(false);
+
    while(true) {
       ctrl1.write(false);
       for(c = 0; c < 20; c = c + 1) {
@@ -107,6 +113,94 @@ void pcnttest::drivewave() {
    }
 }
 
+/* Interrupt handler for a software source. It adds its tag to the log and
+ * takes the source down, as a handler clears the status of its peripheral,
+ * or it would be taken again as long as the source is up.
+ */
+struct swisrarg {
+   const char *tag;
+   int src;
+};
+static std::string intrlog;
+static void logisr(void *arg) {
+   swisrarg *a = (swisrarg *)arg;
+   intrlog = intrlog + a->tag;
+   espintrptr->lower(a->src);
+}
+
+/* PCNT interrupt handler, it logs when it first ran, which CPU driver ran
+ * it and how many times. It clears the status as the driver does.
+ */
+struct pcntisrlog {
+   sc_time when;
+   std::string by;
+   int n;
+};
+static void pcntisr(void *arg) {
+   pcntisrlog *l = (pcntisrlog *)arg;
+   if (l->n == 0) {
+      l->when = sc_time_stamp();
+      l->by = sc_get_current_process_handle().basename();
+   }
+   l->n = l->n + 1;
+   PCNT.int_clr.val = PCNT.int_st.val;
+   update_pcnt();
+}
+
+/* Pin interrupt handler, it counts the calls and can take itself off the
+ * pin after a number of them.
+ */
+struct pinisrlog {
+   int n;
+   int stopat;
+   sc_time last;
+};
+static void pinisr(void *arg) {
+   pinisrlog *l = (pinisrlog *)arg;
+   l->n = l->n + 1;
+   l->last = sc_time_stamp();
+   if (l->stopat > 0 && l->n >= l->stopat) detachInterrupt(22);
+}
+
+/**********************
+ * pulses():
+ * inputs: number of pulses
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Sends pulses of 1ms high and 1ms low on ctrl1, which is GPIO22.
+ */
+void pcnttest::pulses(int n) {
+   int c;
+   for(c = 0; c < n; c = c + 1) {
+      ctrl1.write(true);
+      wait(1, SC_MS);
+      ctrl1.write(false);
+      wait(1, SC_MS);
+   }
+}
+
+/**********************
+ * fastpulses():
+ * inputs: number of pulses
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Sends pulses of 100ns high and 100ns low on pwm0, which is GPIO12, the
+ * signal of unit 0.
+ */
+void pcnttest::fastpulses(int n) {
+   int c;
+   for(c = 0; c < n; c = c + 1) {
+      pwm0.write(true);
+      wait(100, SC_NS);
+      pwm0.write(false);
+      wait(100, SC_NS);
+   }
+}
+
 /*******************************************************************************
 ** Testbenches *****************************************************************
 *******************************************************************************/
@@ -120,12 +214,204 @@ void pcnttest::t0(void) {
    wait(500, SC_MS);
 }
 
+void pcnttest::t1(void) {
+   int16_t cnt;
+   SC_REPORT_INFO("TEST", "Running Test T1.");
+
+   PRINTF_INFO("TEST", "Waiting for power-up");
+   pwm0.write(false);
+   ctrl0.write(false);
+   ctrl2.write(false);
+   wait(100, SC_MS);
+
+   /* We send a 5MHz burst to unit 0. It counts the rising edges and goes
+    * back to zero when it gets to 25, so halfway, after 505 pulses, it
+    * should be at 5 and after all 1010 at 10, having hit the limit 40 times.
+    */
+   PRINTF_INFO("TEST", "Counting a 5MHz burst");
+   fastpulses(505);
+   wait(1, SC_US);
+   cnt = (int16_t)i_esp.i_pcnt.cnt_unit[0].read();
+   if (cnt != 5) PRINTF_ERROR("TEST", "Expected count 5 halfway, got %d", cnt);
+   fastpulses(505);
+   wait(100, SC_US);
+   cnt = (int16_t)i_esp.i_pcnt.cnt_unit[0].read();
+   if (cnt != 10) PRINTF_ERROR("TEST", "Expected count 10, got %d", cnt);
+   if (i_esp.i_pcnt.int_raw[0].read() == 0)
+      PRINTF_ERROR("TEST", "Limit interrupt did not fire");
+   wait(100, SC_MS);
+}
+
+void pcnttest::t2(void) {
+   intr_handle_t hp, h1, h3;
+   pcntisrlog l;
+   swisrarg a1 = {"a", ETS_UART0_INTR_SOURCE};
+   swisrarg a3 = {"b", ETS_UART1_INTR_SOURCE};
+   sc_time start;
+   SC_REPORT_INFO("TEST", "Running Test T2: interrupt matrix.");
+
+   PRINTF_INFO("TEST", "Waiting for power-up");
+   pwm0.write(false);
+   ctrl0.write(false);
+   ctrl2.write(false);
+   wait(100, SC_MS);
+
+   /* The PCNT limit interrupt goes through the matrix to the CPU the
+    * handler was allocated on. The testbench is not a pinned task, so that
+    * is the APP CPU.
+    */
+   l.when = SC_ZERO_TIME;
+   l.n = 0;
+   if (esp_intr_alloc(ETS_PCNT_INTR_SOURCE, 0, pcntisr, &l, &hp) != ESP_OK) {
+      PRINTF_ERROR("TEST", "Could not allocate the PCNT interrupt");
+      return;
+   }
+   if (esp_intr_get_cpu(hp) != 1)
+      PRINTF_ERROR("TEST", "PCNT interrupt on CPU %d, expected 1",
+         esp_intr_get_cpu(hp));
+   pcnt_intr_enable(PCNT_UNIT_0);
+   start = sc_time_stamp();
+   fastpulses(1010);
+   wait(100, SC_US);
+   if (l.when == SC_ZERO_TIME || l.when - start > sc_time(202, SC_US)) {
+      PRINTF_ERROR("TEST", "PCNT handler did not run during the burst");
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: PCNT handler ran at %s",
+         l.when.to_string().c_str());
+   }
+   if (l.by != "driver_app")
+      PRINTF_ERROR("TEST", "PCNT handler ran in %s, expected driver_app",
+         l.by.c_str());
+
+   /* The handler clears the status each time, so the 1010 rising edges
+    * bring the count to the high limit, and the interrupt up, 40 times.
+    */
+   if (l.n != 40)
+      PRINTF_ERROR("TEST", "PCNT handler ran %d times, expected 40", l.n);
+   update_pcnt();
+   if ((PCNT.int_st.val & 0x1) != 0)
+      PRINTF_ERROR("TEST", "PCNT unit 0 status still set after the handler");
+   pcnt_intr_disable(PCNT_UNIT_0);
+   esp_intr_free(hp);
+
+   /* Sources without a line are raised by software. When two come in
+    * together, the higher level one runs first.
+    */
+   esp_intr_alloc(ETS_UART0_INTR_SOURCE, ESP_INTR_FLAG_LEVEL1, logisr,
+      &a1, &h1);
+   esp_intr_alloc(ETS_UART1_INTR_SOURCE, ESP_INTR_FLAG_LEVEL3, logisr,
+      &a3, &h3);
+   intrlog = "";
+   i_esp.i_espintr.raise(ETS_UART0_INTR_SOURCE);
+   i_esp.i_espintr.raise(ETS_UART1_INTR_SOURCE);
+   wait(1, SC_US);
+   if (intrlog != "ba")
+      PRINTF_ERROR("TEST", "Handlers ran as \"%s\", expected \"ba\"",
+         intrlog.c_str());
+
+   /* A level interrupt the handler does not clear is taken again. */
+   intrlog = "";
+   a1.src = -1;
+   i_esp.i_espintr.raise(ETS_UART0_INTR_SOURCE);
+   wait(1, SC_US);
+   esp_intr_disable(h1);
+   if (intrlog.size() < 2)
+      PRINTF_ERROR("TEST", "Held level interrupt ran %d times, expected more",
+         (int)intrlog.size());
+   i_esp.i_espintr.lower(ETS_UART0_INTR_SOURCE);
+   a1.src = ETS_UART0_INTR_SOURCE;
+   wait(1, SC_US);
+
+   /* A disabled interrupt is taken out of the matrix, and it runs once it
+    * is enabled again if the source is still up.
+    */
+   intrlog = "";
+   esp_intr_disable(h1);
+   i_esp.i_espintr.raise(ETS_UART0_INTR_SOURCE);
+   wait(1, SC_US);
+   if (intrlog != "")
+      PRINTF_ERROR("TEST", "Disabled handler ran");
+   esp_intr_enable(h1);
+   wait(1, SC_US);
+   if (intrlog != "a")
+      PRINTF_ERROR("TEST", "Handler did not run once enabled");
+   esp_intr_free(h1);
+   esp_intr_free(h3);
+   wait(10, SC_MS);
+}
+
+void pcnttest::t3(void) {
+   pinisrlog l = {0, 0, SC_ZERO_TIME};
+   sc_time rise;
+   SC_REPORT_INFO("TEST", "Running Test T3: GPIO interrupts.");
+
+   PRINTF_INFO("TEST", "Waiting for power-up");
+   pwm0.write(false);
+   ctrl0.write(false);
+   ctrl1.write(false);
+   ctrl2.write(false);
+   wait(100, SC_MS);
+   pinMode(22, INPUT);
+
+   /* Each trigger type counts its own edges. */
+   attachInterruptArg(22, pinisr, &l, RISING);
+   pulses(5);
+   if (l.n != 5) PRINTF_ERROR("TEST", "Got %d rising interrupts, expected 5",
+      l.n);
+   detachInterrupt(22);
+   pulses(1);
+   if (l.n != 5) PRINTF_ERROR("TEST", "Interrupt ran after the detach");
+
+   l.n = 0;
+   attachInterruptArg(22, pinisr, &l, CHANGE);
+   pulses(3);
+   detachInterrupt(22);
+   if (l.n != 6) PRINTF_ERROR("TEST", "Got %d change interrupts, expected 6",
+      l.n);
+
+   l.n = 0;
+   attachInterruptArg(22, pinisr, &l, FALLING);
+   pulses(2);
+   detachInterrupt(22);
+   if (l.n != 2) PRINTF_ERROR("TEST", "Got %d falling interrupts, expected 2",
+      l.n);
+
+   /* A level interrupt comes back each time the handler clears it while the
+    * level holds. Each pass takes a few APB clocks, as the handler writes
+    * the registers, so all of them come shortly after the edge. The handler
+    * takes itself off after three.
+    */
+   l.n = 0;
+   l.stopat = 3;
+   attachInterruptArg(22, pinisr, &l, ONHIGH);
+   wait(1, SC_MS);
+   if (l.n != 0) PRINTF_ERROR("TEST", "High level interrupt ran while low");
+   ctrl1.write(true);
+   rise = sc_time_stamp();
+   wait(1, SC_MS);
+   ctrl1.write(false);
+   if (l.n != 3 || l.last < rise || l.last - rise > sc_time(1, SC_US)) {
+      PRINTF_ERROR("TEST", "Got %d level interrupts, the last at %s, expected "
+         "3 within 1us of %s", l.n, l.last.to_string().c_str(),
+         rise.to_string().c_str());
+   }
+   else {
+      PRINTF_INFO("TEST", "SUCCESS: Level interrupt ran 3 times by %s",
+         l.last.to_string().c_str());
+   }
+   wait(10, SC_MS);
+}
+
 void pcnttest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
+   else if (tn == 2) t2();
+   else if (tn == 3) t3();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
@@ -62,6 +62,11 @@ SC_MODULE(pcnttest) {
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   void t2();
+   void t3();
+   void pulses(int n);
+   void fastpulses(int n);
 
    // Constructor
    SC_CTOR(pcnttest) {
@@ -23,6 +23,7 @@
 
 #include <systemc.h>
 #include "readMifaretest.h"
+#include "Wire.h"
 #include <string>
 #include "info.h"
 
@@ -40,6 +41,46 @@ void readMifaretest::serflush() {
    i_uartclient.dump();
 }
 
+/**********************
+ * Task: stretch_th():
+ * inputs: none
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Acts as a slave stretching the clock on the second I2C bus.
+ */
+void readMifaretest::stretch_th() {
+   sc_time start;
+   sc_time step;
+   int warns;
+
+   while(true) {
+      wait(stretch_ev);
+
+      /* We wait for the master to take the clock low and then we hold it. */
+      do { wait(i2c1_scl.value_changed_event()); }
+      while (!i2c1_scl.read().islow());
+      i2c1_scl.write(GN_LOGIC_0);
+      start = sc_time_stamp();
+
+      /* We hold it in small steps so that we can tell when the master gives
+       * up and warns about it.
+       */
+      warns = sc_report_handler::get_count("I2C");
+      stretchwarn = SC_ZERO_TIME;
+      while (sc_time_stamp() - start < stretchfor) {
+         step = stretchfor - (sc_time_stamp() - start);
+         if (step > sc_time(100, SC_US)) step = sc_time(100, SC_US);
+         wait(step);
+         if (stretchwarn == SC_ZERO_TIME
+               && sc_report_handler::get_count("I2C") != warns)
+            stretchwarn = sc_time_stamp() - start;
+      }
+      i2c1_scl.write(GN_LOGIC_Z);
+   }
+}
+
 /*******************************************************************************
 ** Other ***********************************************************************
 *******************************************************************************/
@@ -61,6 +102,10 @@ void readMifaretest::trace(sc_trace_file *tf) {
    sc_trace(tf, i2c_sda, i2c_sda.name());
    sc_trace(tf, i2c_scl, i2c_scl.name());
    sc_trace(tf, pn532_irq, pn532_irq.name());
+   sc_trace(tf, i2c1_sda, i2c1_sda.name());
+   sc_trace(tf, i2c1_scl, i2c1_scl.name());
+   sc_trace(tf, pcf_intr, pcf_intr.name());
+   sc_trace(tf, pcf_p2, pcf_p2.name());
    sc_trace(tf, pn532_reset, pn532_reset.name());
    i_esp.trace(tf);
    i_pn532.trace(tf);
@@ -82,6 +127,100 @@ void readMifaretest::start_of_simulation() {
    i_uartclient.i_uart.set_deadtime(sc_time(5, SC_US));
 }
 
+/*******************************************************************************
+** I2C *************************************************************************
+*******************************************************************************/
+
+/**********************
+ * Function: i2cregs::i2ctransport()
+ * inputs: transaction
+ * outputs: transaction, with the data read and acks filled in
+ * return: none
+ * globals: none
+ *
+ * Answers a transfer from the master.
+ */
+void i2cregs::i2ctransport(i2ctrans_t &t) {
+   unsigned int i;
+
+   t.stretch = stretch;
+   if (t.rd) {
+      for(i = 0; i < t.data.size(); i = i + 1) {
+         t.data[i] = regs[ptr];
+         ptr = (ptr + 1) % 16;
+      }
+      return;
+   }
+   if (ackonly >= 0 && (unsigned int)ackonly < t.data.size())
+      t.acked = ackonly;
+   for(i = 0; i < t.acked; i = i + 1) {
+      if (i == 0) ptr = t.data[0] % 16;
+      else {
+         regs[ptr] = t.data[i];
+         ptr = (ptr + 1) % 16;
+      }
+   }
+}
+
+/**********************
+ * Function: i2cwrite()
+ * inputs: address, bytes, count and stop flag
+ * outputs: none
+ * return: Wire style error code
+ * globals: i2c1ptr
+ *
+ * Writes on the second I2C controller, which the sketch does not use.
+ */
+int readMifaretest::i2cwrite(uint8_t addr, const uint8_t *b, int len,
+      bool stop) {
+   i2ctrans_t t;
+   t.addr = addr;
+   t.rd = false;
+   t.data.assign(b, b + len);
+   t.stop = stop;
+   return i2c1ptr->transport(t);
+}
+
+/**********************
+ * Function: i2cread()
+ * inputs: address and count
+ * outputs: bytes read
+ * return: Wire style error code
+ * globals: i2c1ptr
+ *
+ * Reads from the second I2C controller.
+ */
+int readMifaretest::i2cread(uint8_t addr, uint8_t *b, int len) {
+   i2ctrans_t t;
+   int ret;
+   t.addr = addr;
+   t.rd = true;
+   t.data.assign(len, 0xff);
+   t.stop = true;
+   ret = i2c1ptr->transport(t);
+   memcpy(b, t.data.data(), len);
+   return ret;
+}
+
+/**********************
+ * Function: checktime()
+ * inputs: what was timed, when it started and the expected time in us
+ * outputs: none
+ * return: none
+ * globals: none
+ *
+ * Flags an error if the time since start is off by more than 10ns.
+ */
+void readMifaretest::checktime(const char *what, sc_time start, double us) {
+   double took = (sc_time_stamp() - start).to_seconds() * 1e6;
+   if (took < us - 0.01 || took > us + 0.01) {
+      PRINTF_ERROR("TEST", "%s took %.3fus instead of %.3fus", what, took, us);
+   }
+   else {
+      PRINTF_INFO("TEST", "%s took %.3fus", what, took);
+   }
+}
+
 /*******************************************************************************
 ** Testbenches *****************************************************************
 *******************************************************************************/
@@ -99,12 +238,249 @@ void readMifaretest::t0(void) {
    wait(1, SC_SEC);
 }
 
+void readMifaretest::t1(void) {
+   int ret;
+
+   SC_REPORT_INFO("TEST", "Running Test T1: transaction level I2C.");
+
+   /* We use the second controller, so the sketch and the PN532 are left
+    * alone on the first. We go through Wire1, like a sketch would, to a
+    * PCF8574 and to the register file.
+    */
+   i2c1ptr->attach(0x20, &i_pcf);
+   i2c1ptr->attach(0x50, &i_regs);
+   if (!i2c1ptr->istlm())
+      PRINTF_ERROR("TEST", "I2C1 did not go to the transaction level");
+
+   /* We write 0101 to the port. The 1s are driven weak so that they can be
+    * pulled low and read back.
+    */
+   Wire1.beginTransmission(0x20);
+   Wire1.write(0x05);
+   ret = Wire1.endTransmission();
+   if (ret != 0) PRINTF_ERROR("TEST", "Write returned %d", ret);
+   wait(1, SC_US);
+   if (pcf_p0.read().to_char() != 'h' || !pcf_p1.read().islow()
+         || pcf_p2.read().to_char() != 'h' || !pcf_p3.read().islow())
+      PRINTF_ERROR("TEST", "Port is %c%c%c%c instead of 0h0h",
+         pcf_p3.read().to_char(), pcf_p2.read().to_char(),
+         pcf_p1.read().to_char(), pcf_p0.read().to_char());
+   if (pcf_intr.read().to_char() != 'Z')
+      PRINTF_ERROR("TEST", "Our own write raised the interrupt");
+
+   /* We pull P2 low. That raises the interrupt, and reading the port gives
+    * us the pins and clears it.
+    */
+   pcf_p2.write(GN_LOGIC_0);
+   wait(1, SC_US);
+   if (!pcf_intr.read().islow())
+      PRINTF_ERROR("TEST", "Pin change did not raise the interrupt");
+   ret = Wire1.requestFrom(0x20, 2);
+   if (ret != 2 || Wire1.available() != 2)
+      PRINTF_ERROR("TEST", "Read returned %d with %d available", ret,
+         Wire1.available());
+   ret = Wire1.read();
+   if (ret != 0x01) PRINTF_ERROR("TEST", "Read port as %02x", ret);
+   ret = Wire1.read();
+   if (ret != 0x01) PRINTF_ERROR("TEST", "Read port again as %02x", ret);
+   if (Wire1.read() != -1)
+      PRINTF_ERROR("TEST", "Read more bytes than requested");
+   wait(1, SC_US);
+   if (pcf_intr.read().to_char() != 'Z')
+      PRINTF_ERROR("TEST", "Read did not clear the interrupt");
+   pcf_p2.write(GN_LOGIC_Z);
+
+   /* The register file gets the pointer and three bytes, and we read them
+    * back after a repeated start.
+    */
+   Wire1.beginTransmission(0x50);
+   Wire1.write(0x04); Wire1.write(0x11); Wire1.write(0x22); Wire1.write(0x33);
+   ret = Wire1.endTransmission();
+   if (ret != 0) PRINTF_ERROR("TEST", "Register write returned %d", ret);
+   Wire1.beginTransmission(0x50);
+   Wire1.write(0x04);
+   ret = Wire1.endTransmission(false);
+   if (ret != 0) PRINTF_ERROR("TEST", "Pointer write returned %d", ret);
+   ret = Wire1.requestFrom(0x50, 3);
+   if (ret != 3 || Wire1.read() != 0x11 || Wire1.read() != 0x22
+         || Wire1.read() != 0x33)
+      PRINTF_ERROR("TEST", "Register read back wrong");
+
+   /* The register file takes only the pointer and one byte, so the next one
+    * gets a NACK and the registers after it are left as they were.
+    */
+   i_regs.ackonly = 2;
+   Wire1.beginTransmission(0x50);
+   Wire1.write(0x04); Wire1.write(0xaa); Wire1.write(0xbb); Wire1.write(0xcc);
+   ret = Wire1.endTransmission();
+   i_regs.ackonly = -1;
+   if (ret != 3) PRINTF_ERROR("TEST", "Expected a data NACK, got %d", ret);
+   if (i_regs.regs[4] != 0xaa || i_regs.regs[5] != 0x22)
+      PRINTF_ERROR("TEST", "NACKed byte was written");
+
+   /* Nobody at this address, so the address gets a NACK and a read gets
+    * nothing.
+    */
+   Wire1.beginTransmission(0x21);
+   Wire1.write(0x00);
+   ret = Wire1.endTransmission();
+   if (ret != 2) PRINTF_ERROR("TEST", "Expected an address NACK, got %d", ret);
+   ret = Wire1.requestFrom(0x21, 1);
+   if (ret != 0 || Wire1.available() != 0)
+      PRINTF_ERROR("TEST", "Read from nobody returned %d", ret);
+
+   /* Once detached the PCF8574 is gone from the bus. */
+   i2c1ptr->detach(0x20);
+   Wire1.beginTransmission(0x20);
+   Wire1.write(0x00);
+   ret = Wire1.endTransmission();
+   if (ret != 2) PRINTF_ERROR("TEST", "Expected an address NACK, got %d", ret);
+   i2c1ptr->detach(0x50);
+}
+
+void readMifaretest::t2(void) {
+   const uint8_t wr[2] = {0x00, 0x5a};
+   uint8_t rd[1];
+   sc_time start;
+
+   SC_REPORT_INFO("TEST", "Running Test T2: I2C bus timing.");
+
+   /* We time a one byte write, that is the address and the byte with their
+    * acks, plus the start and the stop, in each of the speed modes.
+    */
+   i2c1ptr->attach(0x50, &i_regs);
+
+   i2c1ptr->setfreq(100000);
+   if (i2c1ptr->getperiod() != sc_time(10, SC_US))
+      PRINTF_ERROR("TEST", "Standard mode period is %s",
+         i2c1ptr->getperiod().to_string().c_str());
+   start = sc_time_stamp();
+   i2cwrite(0x50, wr, 2);
+   checktime("Standard mode write", start, 204.9);
+
+   /* Without the stop the bus is kept, so the stop time is left out. */
+   start = sc_time_stamp();
+   i2cwrite(0x50, wr, 1, false);
+   checktime("Write without stop", start, 191.2);
+   start = sc_time_stamp();
+   i2cread(0x50, rd, 1);
+   checktime("Read after repeated start", start, 204.9);
+   if (rd[0] != 0x5a) PRINTF_ERROR("TEST", "Read back %02x", rd[0]);
+
+   i2c1ptr->setfreq(400000);
+   start = sc_time_stamp();
+   i2cwrite(0x50, wr, 2);
+   checktime("Fast mode write", start, 50.05);
+
+   i2c1ptr->setfreq(1000000);
+   start = sc_time_stamp();
+   i2cwrite(0x50, wr, 2);
+   checktime("Fast mode plus write", start, 20.03);
+
+   /* The time the slave holds the clock low goes on top. */
+   i2c1ptr->setfreq(400000);
+   i_regs.stretch = sc_time(30, SC_US);
+   start = sc_time_stamp();
+   i2cwrite(0x50, wr, 2);
+   checktime("Stretched write", start, 80.05);
+   i_regs.stretch = SC_ZERO_TIME;
+
+   i2c1ptr->detach(0x50);
+}
+
+void readMifaretest::t3(void) {
+   sc_time start;
+   double plain;
+   int warns;
+
+   SC_REPORT_INFO("TEST", "Running Test T3: I2C clock stretching.");
+
+   /* The clock set before the begin goes to the model and the begin keeps
+    * it. After that it goes through the HAL.
+    */
+   Wire1.setClock(400000);
+   if (Wire1.getClock() != 400000)
+      PRINTF_ERROR("TEST", "Clock before begin is %u",
+         (unsigned int)Wire1.getClock());
+   if (!Wire1.begin(16, 17)) PRINTF_ERROR("TEST", "Wire1 did not start");
+   if (Wire1.getClock() != 400000)
+      PRINTF_ERROR("TEST", "Begin changed the clock to %u",
+         (unsigned int)Wire1.getClock());
+   Wire1.setClock(100000);
+   if (Wire1.getClock() != 100000 || i2c1ptr->getperiod() != sc_time(10, SC_US))
+      PRINTF_ERROR("TEST", "Clock is %u with a period of %s",
+         (unsigned int)Wire1.getClock(),
+         i2c1ptr->getperiod().to_string().c_str());
+   wait(1, SC_MS);
+
+   /* We time the address and one byte to the PCF8574 on the bit level. */
+   start = sc_time_stamp();
+   Wire1.beginTransmission(0x20);
+   if (Wire1.write(0x0f) != 1) PRINTF_ERROR("TEST", "PCF8574 did not ACK");
+   plain = (sc_time_stamp() - start).to_seconds() * 1e6;
+   Wire1.endTransmission();
+   PRINTF_INFO("TEST", "Plain write took %.3fus", plain);
+   wait(1, SC_MS);
+
+   /* Now we hold the SCL for 100us after the start. The master lets go of
+    * it 5us in, so the transfer takes 95us longer and nobody complains.
+    */
+   warns = sc_report_handler::get_count("I2C");
+   stretchfor = sc_time(100, SC_US);
+   stretch_ev.notify();
+   start = sc_time_stamp();
+   Wire1.beginTransmission(0x20);
+   if (Wire1.write(0x0f) != 1) PRINTF_ERROR("TEST", "PCF8574 did not ACK");
+   checktime("Stretched write", start, plain + 95.0);
+   Wire1.endTransmission();
+   if (sc_report_handler::get_count("I2C") != warns)
+      PRINTF_ERROR("TEST", "A 100us stretch gave a warning");
+   wait(1, SC_MS);
+
+   /* If we hold it for 60ms, the master gives up after 50ms and goes on.
+    * The PCF8574 then misses the first clock, so the address gets a NACK.
+    */
+   stretchfor = sc_time(60, SC_MS);
+   stretch_ev.notify();
+   start = sc_time_stamp();
+   Wire1.beginTransmission(0x20);
+   if (Wire1.write(0x0f) != 0)
+      PRINTF_ERROR("TEST", "Transfer went through with the SCL held");
+   Wire1.endTransmission();
+   if (sc_time_stamp() - start < stretchfor)
+      PRINTF_ERROR("TEST", "Transfer ended %s in, with the SCL still held",
+         (sc_time_stamp() - start).to_string().c_str());
+   if (sc_report_handler::get_count("I2C") != warns + 1)
+      PRINTF_ERROR("TEST", "Expected one warning, got %d",
+         sc_report_handler::get_count("I2C") - warns);
+   if (stretchwarn <= sc_time(50, SC_MS)
+         || stretchwarn > sc_time(50100, SC_US)) {
+      PRINTF_ERROR("TEST", "Master gave up %s into the stretch",
+         stretchwarn.to_string().c_str());
+   }
+   else {
+      PRINTF_INFO("TEST", "Master gave up %s into the stretch",
+         stretchwarn.to_string().c_str());
+   }
+   wait(1, SC_MS);
+
+   /* And the bus is fine afterwards. */
+   Wire1.beginTransmission(0x20);
+   if (Wire1.write(0x0f) != 1)
+      PRINTF_ERROR("TEST", "PCF8574 did not ACK after the timeout");
+   Wire1.endTransmission();
+   wait(1, SC_MS);
+}
+
 void readMifaretest::testbench(void) {
    /* Now we check the test case and run the correct TB. */
    printf("Starting Testbench Test%d @%s\n", tn,
       sc_time_stamp().to_string().c_str());
 
    if (tn == 0) t0();
+   else if (tn == 1) t1();
+   else if (tn == 2) t2();
+   else if (tn == 3) t3();
    else SC_REPORT_ERROR("TEST", "Test number too large.");
 
    sc_stop();
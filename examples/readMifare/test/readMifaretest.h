@@ -27,6 +27,24 @@
 #include "uartclient.h"
 #include "doitesp32devkitv1_i2c.h"
 #include "pn532.h"
+#include "pcf8574.h"
+#include "i2c.h"
+#include "i2ctlm.h"
+
+/* A small register file answering on the transaction level I2C. The first
+ * byte of a write sets the register pointer, the others are written from
+ * there on, and reads go on from the pointer.
+ */
+struct i2cregs: public i2cslave_if {
+   uint8_t regs[16];
+   int ptr;
+   /* Bytes acknowledged on a write, -1 for all. */
+   int ackonly;
+   /* Time the slave holds the SCL low on each transfer. */
+   sc_time stretch;
+   i2cregs() { ptr = 0; ackonly = -1; memset(regs, 0, sizeof(regs)); }
+   virtual void i2ctransport(i2ctrans_t &t);
+};
 
 SC_MODULE(readMifaretest) {
    /* Signals */
@@ -39,6 +57,14 @@ SC_MODULE(readMifaretest) {
    gn_signal_mix tx {"tx"};
    sc_signal<unsigned int> fromwifi {"fromwifi"};
    sc_signal<unsigned int> towifi {"towifi"};
+   /* Second I2C bus, with only the PCF8574 on it. */
+   gn_signal_mix i2c1_sda {"i2c1_sda"};
+   gn_signal_mix i2c1_scl {"i2c1_scl"};
+   gn_signal_mix pcf_intr {"pcf_intr"};
+   gn_signal_mix pcf_p0 {"pcf_p0"};
+   gn_signal_mix pcf_p1 {"pcf_p1"};
+   gn_signal_mix pcf_p2 {"pcf_p2"};
+   gn_signal_mix pcf_p3 {"pcf_p3"};
 
    /* Note: these will soon be replaced with better interfaces. */
    sc_signal<unsigned int> fromflash {"fromflash"};
@@ -51,14 +77,31 @@ SC_MODULE(readMifaretest) {
    doitesp32devkitv1_i2c i_esp{"i_esp"};
    pn532 i_pn532 {"i_pn532"};
    uartclient i_uartclient{"i_uartclient"};
+   pcf8574 i_pcf {"i_pcf"};
+   i2cregs i_regs;
 
    /* Processes */
    void testbench(void);
    void serflush(void);
+   void stretch_th(void);
+
+   /* Clock stretching on the second bus, used by t3. When stretch_ev is
+    * notified, the next time the master takes the SCL low we hold it for
+    * stretchfor. If the master gave up waiting, stretchwarn has when.
+    */
+   sc_event stretch_ev;
+   sc_time stretchfor;
+   sc_time stretchwarn;
 
    /* Tests */
    unsigned int tn; /* Testcase number */
    void t0();
+   void t1();
+   void t2();
+   void t3();
+   void checktime(const char *what, sc_time start, double us);
+   int i2cwrite(uint8_t addr, const uint8_t *b, int len, bool stop = true);
+   int i2cread(uint8_t addr, uint8_t *b, int len);
 
    // Constructor
    SC_CTOR(readMifaretest) {
@@ -85,13 +128,19 @@ SC_MODULE(readMifaretest) {
       i_pn532.sda(i2c_sda); i_pn532.scl(i2c_scl);
       i_pn532.irq(pn532_irq); i_pn532.reset(pn532_reset);
 
+      /* Second I2C BUS, with a PCF8574 using four of its pins. */
+      i_esp.d16(i2c1_sda); i_esp.d17(i2c1_scl);
+      i_pcf.sda(i2c1_sda); i_pcf.scl(i2c1_scl); i_pcf.intr(pcf_intr);
+      i_pcf.sig(pcf_p0); i_pcf.sig(pcf_p1);
+      i_pcf.sig(pcf_p2); i_pcf.sig(pcf_p3);
+
       /* Pins not used in this simulation */
       i_esp.d0_a11(logic_0); /* BOOT pin */
       i_esp.d26_a19(logic_0); i_esp.d27_a17(logic_0);
       i_esp.d4_a10(logic_0); i_esp.d5(logic_0);
       i_esp.d14_a16(logic_0);
-      i_esp.d15_a13(logic_0); i_esp.d16(logic_0);
-      i_esp.d17(logic_0); i_esp.d18(logic_0); i_esp.d19(logic_0);
+      i_esp.d15_a13(logic_0);
+      i_esp.d18(logic_0); i_esp.d19(logic_0);
       i_esp.d23(logic_0);
       i_esp.d25_a18(logic_0);
       i_esp.d33_a5(logic_0); i_esp.d34_a6(logic_0);
@@ -101,6 +150,7 @@ SC_MODULE(readMifaretest) {
 
       SC_THREAD(testbench);
       SC_THREAD(serflush);
+      SC_THREAD(stretch_th);
    }
 
    void start_of_simulation();
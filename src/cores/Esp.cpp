@@ -34,6 +34,8 @@
 #include "Arduino.h"
 #include "Esp.h"
 #include "esp_spi_flash.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
 #include <memory>
 #include <soc/soc.h>
 #include <systemc.h>
@@ -94,17 +96,7 @@ EspClass ESP;
 
 void EspClass::deepSleep(uint32_t time_us)
 {
-   /* We do not have support now for sleep and deep-sleep, so all we do is
-    * print a notice. We can expand this later.
-    */
-   char buffer[80];
-   snprintf(buffer, 80, "Request to enter Deep Sleep @ %s",
-      sc_time_stamp().to_string().c_str());
-   SC_REPORT_INFO("ESP", buffer);
-   wait(time_us, SC_US);
-   snprintf(buffer, 80, "Wake up from sleep @ %s",
-      sc_time_stamp().to_string().c_str());
-   SC_REPORT_INFO("ESP", buffer);
+   esp_deep_sleep(time_us);
 }
 
 uint32_t EspClass::getCycleCount()
@@ -119,11 +111,7 @@ uint32_t EspClass::getCycleCount()
 
 void EspClass::restart(void)
 {
-   /* For now we still do not support restarting. */
-   char buffer[80];
-   snprintf(buffer, 80, "Request to Restart @ %s",
-      sc_time_stamp().to_string().c_str());
-   SC_REPORT_INFO("ESP", buffer);
+   esp_restart();
 }
 
 uint32_t EspClass::getHeapSize(void)
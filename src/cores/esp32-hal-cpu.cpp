@@ -211,7 +211,7 @@ uint32_t getApbFrequency(){
 */
 
 uint32_t getCpuFrequencyMhz(){
-    uint32_t cpuf = 1000 / clockpacer.get_cpu_period_ns();
+    uint32_t cpuf = 1000000 / clockpacer.get_cpu_period_ps();
     return cpuf * MHZ;
 }
 
@@ -220,6 +220,6 @@ uint32_t getXtalFrequencyMhz(){
 }
 
 uint32_t getApbFrequency(){
-    uint32_t apbf = 1000 / clockpacer.get_apb_period_ns();
+    uint32_t apbf = 1000000 / clockpacer.get_apb_period_ps();
     return apbf * MHZ;
 }
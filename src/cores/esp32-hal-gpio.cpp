@@ -35,6 +35,9 @@
 #include "info.h"
 #include "esp32-hal-gpio.h"
 #include "gpioset.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "update.h"
 
 const int8_t esp32_adc2gpio[20] = {36, 37, 38, 39, 32, 33, 34, 35, -1, -1, 4, 0, 2, 15, 13, 12, 14, 27, 25, 26};
 
@@ -81,16 +84,14 @@ const DRAM_ATTR esp32_gpioMux_t esp32_gpioMux[GPIO_PIN_COUNT]={
     {0x10, 3, 3, -1}
 };
 
-/* TODO add interrupt handling
 typedef void (*voidFuncPtr)(void);
 typedef void (*voidFuncPtrArg)(void*);
 typedef struct {
     voidFuncPtr fn;
     void* arg;
-    bool functional;
 } InterruptHandle_t;
 static InterruptHandle_t __pinInterruptHandlers[GPIO_PIN_COUNT] = {0,};
-*/
+static intr_handle_t gpio_intr_handle = NULL;
 
 // TODO add rtc/io #include "driver/rtc_io.h"
 
@@ -206,3 +207,64 @@ int digitalRead(uint8_t pin) {
    del1cycle();
    return digitalRead_nodel(pin);
 }
+
+/* Single ISR for all the pins. It takes the status of both banks, clears it
+ * and calls the handler of each pin that interrupted.
+ */
+static void __onPinInterrupt(void *arg) {
+   uint32_t gpio_intr_status_l = GPIO.status;
+   uint32_t gpio_intr_status_h = GPIO.status1.intr_st;
+   uint8_t pin;
+
+   if(gpio_intr_status_l) GPIO.status_w1tc = gpio_intr_status_l;
+   if(gpio_intr_status_h) GPIO.status1_w1tc.intr_st = gpio_intr_status_h;
+   update_gpio();
+
+   for(pin = 0; pin < GPIO_PIN_COUNT; pin = pin + 1) {
+      if (pin < 32 && (gpio_intr_status_l & ((uint32_t)1 << pin)) == 0)
+         continue;
+      if (pin >= 32 && (gpio_intr_status_h & ((uint32_t)1 << (pin-32))) == 0)
+         continue;
+      if (__pinInterruptHandlers[pin].fn == NULL) continue;
+      if (__pinInterruptHandlers[pin].arg)
+         ((voidFuncPtrArg)__pinInterruptHandlers[pin].fn)(
+            __pinInterruptHandlers[pin].arg);
+      else __pinInterruptHandlers[pin].fn();
+   }
+}
+
+/* Attaches a handler to a pin. The interrupt goes to the CPU we are running
+ * on.
+ */
+void attachInterruptArg(uint8_t pin, voidFuncPtrArg userFunc, void * arg,
+      int intr_type) {
+   if (!digitalPinIsValid(pin)) {
+      PRINTF_WARN("HALGPIO", "Attempting to attach interrupt to invalid pin %d",
+         pin);
+      return;
+   }
+   if(gpio_intr_handle == NULL) {
+      esp_intr_alloc(ETS_GPIO_INTR_SOURCE, (int)ESP_INTR_FLAG_IRAM,
+         __onPinInterrupt, NULL, &gpio_intr_handle);
+   }
+   __pinInterruptHandlers[pin].fn = (voidFuncPtr)userFunc;
+   __pinInterruptHandlers[pin].arg = arg;
+
+   GPIO.pin[pin].int_type = intr_type & 0x7;
+   if(xPortGetCoreID() == 0) GPIO.pin[pin].int_ena = GPIO_PRO_CPU_INTR_ENA;
+   else GPIO.pin[pin].int_ena = GPIO_APP_CPU_INTR_ENA;
+   update_gpio();
+}
+
+void attachInterrupt(uint8_t pin, voidFuncPtr userFunc, int intr_type) {
+   attachInterruptArg(pin, (voidFuncPtrArg)userFunc, NULL, intr_type);
+}
+
+void detachInterrupt(uint8_t pin) {
+   if (!digitalPinIsValid(pin)) return;
+   __pinInterruptHandlers[pin].fn = NULL;
+   __pinInterruptHandlers[pin].arg = NULL;
+   GPIO.pin[pin].int_ena = 0;
+   GPIO.pin[pin].int_type = 0;
+   update_gpio();
+}
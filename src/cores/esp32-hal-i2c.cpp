@@ -20,6 +20,7 @@
 #include "rom/ets_sys.h"
 #include "esp_attr.h"
 #include "esp32-hal-cpu.h" // cpu clock change support 31DEC2018
+#include "i2c.h"
 //#define I2C_DEV(i)   (volatile i2c_dev_t *)((i)?DR_REG_I2C1_EXT_BASE:DR_REG_I2C_EXT_BASE)
 //#define I2C_DEV(i)   ((i2c_dev_t *)(REG_I2C_BASE(i)))
 #define I2C_SCL_IDX(p)  ((p==0)?I2CEXT0_SCL_OUT_IDX:((p==1)?I2CEXT1_SCL_OUT_IDX:0))
@@ -175,6 +176,10 @@ i2c_t * i2cInit(uint8_t i2c_num, int8_t sda, int8_t scl, uint32_t frequency) {
   //  I2C_MUTEX_UNLOCK();
 
   //  i2cSetFrequency(i2c, frequency);    // reconfigure
+    // a frequency of zero keeps the one already in the model
+    if(frequency != 0) {
+        i2cSetFrequency(i2c, frequency);
+    }
 
   //  if(!i2cCheckLineState(i2c->sda, i2c->scl)){
   //      return NULL;
@@ -220,3 +225,25 @@ void i2cRelease(i2c_t *i2c)  // release all resources, power down peripheral
 
  //   I2C_MUTEX_UNLOCK();
 }
+
+static class i2c *i2cModel(i2c_t *bus)
+{
+    return (bus->num == 0)?i2c0ptr:i2c1ptr;
+}
+
+i2c_err_t i2cSetFrequency(i2c_t * i2c, uint32_t clk_speed)
+{
+    if(i2c == NULL || clk_speed == 0) {
+        return I2C_ERROR_DEV;
+    }
+    i2cModel(i2c)->setfreq(clk_speed);
+    return I2C_ERROR_OK;
+}
+
+uint32_t i2cGetFrequency(i2c_t * i2c)
+{
+    if(i2c == NULL) {
+        return 0;
+    }
+    return i2cModel(i2c)->getfreq();
+}
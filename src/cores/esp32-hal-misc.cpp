@@ -32,6 +32,8 @@
 #include <systemc.h>
 #include "esp32-hal.h"
 #include "clockpacer.h"
+#include "freertos/rtossched.h"
+#include "esp_task_wdt.h"
 
 //Undocumented!!! Get chip temperature in Farenheit
 //Source: https://github.com/pcbreflux/espressif/blob/master/esp32/arduino/sketchbook/ESP32_int_temp_sensor/ESP32_int_temp_sensor.ino
@@ -49,9 +51,13 @@ extern "C" {
 
 void __yield() {
     /* We do a wait, as that hands the control back to the SystemC Scheduler,
-     * which is also handling our FreeRTOS scheduler.
+     * which is also handling our FreeRTOS scheduler. It costs one CPU cycle.
+     * When the scheduler model is on, it is charged to the task and it is
+     * also a point where the task can be preempted. When it is off, this is
+     * on the hot path, so we just wait.
      */
-    wait(clockpacer.get_cpu_period());
+    if (!rtosgetsched()) wait(clockpacer.get_cpu_period());
+    else rtoscomputecycles(1);
 }
 
 void yield() __attribute__ ((weak, alias("__yield")));
@@ -64,7 +70,6 @@ void del1cycle() {
 
 #if CONFIG_AUTOSTART_ARDUINO
 
-/*
 extern TaskHandle_t loopTaskHandle;
 extern bool loopTaskWDTEnabled;
 
@@ -93,10 +98,8 @@ void feedLoopWDT(){
         log_e("Failed to feed WDT! Error: %d", err);
     }
 }
-*/
 #endif
 
-/*
 void enableCore0WDT(){
     TaskHandle_t idle_0 = xTaskGetIdleTaskHandleForCPU(0);
     if(idle_0 == NULL || esp_task_wdt_add(idle_0) != ESP_OK){
@@ -126,7 +129,6 @@ void disableCore1WDT(){
     }
 }
 #endif
-*/
 
 /*
 BaseType_t xTaskCreateUniversal( TaskFunction_t pxTaskCode,
@@ -161,6 +163,7 @@ unsigned long int millis() {
 /* Delay does a SystemC wait. */
 void delay(uint32_t del) {
    wait(del, SC_MS);
+   rtospark();
 }
 
 /* For the delayMicroseconds we do the same thing. We definitely do not want
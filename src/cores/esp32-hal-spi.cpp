@@ -28,6 +28,7 @@
 //    limitations under the License.
 
 #include <systemc.h>
+#include <vector>
 #include "gn_semaphore.h"
 #include "clockpacer.h"
 #include "spimod.h"
@@ -41,6 +42,7 @@
 #include "esp_attr.h"
 //#include "esp_intr.h"
 #include "rom/gpio.h"
+#include "rom/lldesc.h"
 #include "soc/spi_reg.h"
 #include "soc/spi_struct.h"
 #include "soc/io_mux_reg.h"
@@ -287,6 +289,51 @@ void _waitdone(spi_t *spi) {
     else if (spi->num == VSPI) vspiptr->waitdone();
 }
 
+void _dmalinks(spi_t *spi, lldesc_t *out, lldesc_t *in) {
+    if (spi->num == HSPI) hspiptr->dmalinks(out, in);
+    else if (spi->num == VSPI) vspiptr->dmalinks(out, in);
+}
+
+/* Builds a descriptor chain over a buffer, like the IDF spi_master does. */
+static void _builddesc(std::vector<lldesc_t> &desc, uint8_t *buf, uint32_t len) {
+    uint32_t n = (len + LLDESC_MAX_NUM_PER_DESC - 1) / LLDESC_MAX_NUM_PER_DESC;
+    desc.assign(n, lldesc_t());
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t dlen = (len > LLDESC_MAX_NUM_PER_DESC)?LLDESC_MAX_NUM_PER_DESC:len;
+        desc[i].size = dlen;
+        desc[i].length = dlen;
+        desc[i].buf = buf;
+        desc[i].eof = (i == n - 1)?1:0;
+        desc[i].owner = 1;
+        desc[i].qe.stqe_next = (i == n - 1)?NULL:&desc[i+1];
+        buf += dlen;
+        len -= dlen;
+    }
+}
+
+/* Buffers longer than the data_buf go out in one DMA transfer instead of
+ * 64 bytes at a time.
+ */
+static void _transferdma(spi_t * spi, const uint8_t * data, uint8_t * out, uint32_t len)
+{
+    std::vector<lldesc_t> outdesc, indesc;
+    std::vector<uint8_t> ones;
+
+    if (data == NULL) {
+        ones.assign(len, 0xFF);
+        data = ones.data();
+    }
+    _builddesc(outdesc, (uint8_t *)data, len);
+    if (out) _builddesc(indesc, out, len);
+
+    spi->dev->mosi_dlen.usr_mosi_dbitlen = (len*8)-1;
+    spi->dev->miso_dlen.usr_miso_dbitlen = (out)?(len*8)-1:0;
+    _dmalinks(spi, outdesc.data(), (out)?indesc.data():NULL);
+    spi->dev->cmd.usr = 1;
+    _update(spi);
+    _waitdone(spi);
+}
+
 void spiEnableSSPins(spi_t * spi, uint8_t cs_mask)
 {
     if(!spi) {
@@ -1118,6 +1165,10 @@ uint32_t spiTransferLongNL(spi_t * spi, uint32_t data)
 }
 
 void spiWriteNL(spi_t * spi, const void * data_in, uint32_t len){
+    if(len > 64){
+        _transferdma(spi, (const uint8_t *)data_in, NULL, len);
+        return;
+    }
     size_t longs = len >> 2;
     if(len & 3){
         longs++;
@@ -1153,6 +1204,10 @@ void spiTransferBytesNL(spi_t * spi, const void * data_in, uint8_t * data_out, u
            spi->num);
         return;
     }
+    if(len > 64){
+        _transferdma(spi, (const uint8_t *)data_in, data_out, len);
+        return;
+    }
     size_t longs = len >> 2;
     if(len & 3){
         longs++;
@@ -1249,6 +1304,19 @@ void IRAM_ATTR spiWritePixelsNL(spi_t * spi, const void * data_in, uint32_t len)
         longs++;
     }
     bool msb = !spi->dev->ctrl.wr_bit_order;
+    if(len > 64){
+        // The pixels go high byte first, so we swap them before the DMA.
+        const uint8_t * pix = (const uint8_t *)data_in;
+        std::vector<uint8_t> swapped(pix, pix + len);
+        if(msb){
+            for (size_t i=0; i+1<len; i+=2) {
+                swapped[i] = pix[i+1];
+                swapped[i+1] = pix[i];
+            }
+        }
+        _transferdma(spi, swapped.data(), NULL, len);
+        return;
+    }
     uint32_t * data = (uint32_t*)data_in;
     size_t c_len = 0, c_longs = 0, l_bytes = 0;
 
@@ -0,0 +1,284 @@
+/*
+ esp32-hal-timer.cpp - Timer SystemC Interface File
+ Copyright (c) 2020 Glenn Ramalho - RFIDo. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+ This file was based off the work covered by the license below:
+
+    Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+ */
+
+#include <systemc.h>
+#include "esp32-hal-timer.h"
+#include "esp32-hal-cpu.h"
+#include "esp_intr_alloc.h"
+#include "soc/soc.h"
+#include "soc/timer_group_struct.h"
+#include "rom/ets_sys.h"
+#include "update.h"
+#include "info.h"
+
+/* Each timer is kept as its group and its number in the group. After
+ * changing the registers we have to tell the group model.
+ */
+struct hw_timer_s {
+   timg_dev_t *tg;
+   uint8_t num;
+   uint8_t group;
+   uint8_t timer;
+};
+#define TDEV(t) ((t)->tg->hw_timer[(t)->timer])
+
+static hw_timer_t hw_timer[4] = {
+   {&TIMERG0,0,0,0},{&TIMERG0,1,0,1},
+   {&TIMERG1,2,1,0},{&TIMERG1,3,1,1}
+};
+
+typedef void (*voidFuncPtr)(void);
+static voidFuncPtr __timerInterruptHandlers[4] = {0,0,0,0};
+static intr_handle_t intr_handle = NULL;
+
+/* Single ISR for all the timers. It takes the status of both groups,
+ * clears them and calls the handlers of the timers that went off.
+ */
+static void __timerISR(void * arg) {
+   uint32_t s0 = TIMERG0.int_st_timers.val;
+   uint32_t s1 = TIMERG1.int_st_timers.val;
+   uint8_t status = (s1 & 3) << 2 | (s0 & 3);
+   uint8_t i;
+
+   TIMERG0.int_clr_timers.val = s0;
+   TIMERG1.int_clr_timers.val = s1;
+   /* The alarm enable clears itself, so we restart the timers that should
+    * auto reload.
+    */
+   for(i = 0; i < 4; i = i + 1)
+      if((status & (1 << i)) && TDEV(&hw_timer[i]).config.autoreload)
+         TDEV(&hw_timer[i]).config.alarm_en = 1;
+   if (s0 != 0) update_timg(0);
+   if (s1 != 0) update_timg(1);
+
+   for(i = 0; i < 4; i = i + 1)
+      if(__timerInterruptHandlers[i] && (status & (1 << i)))
+         __timerInterruptHandlers[i]();
+}
+
+uint64_t timerRead(hw_timer_t *timer) {
+   uint64_t h, l;
+   TDEV(timer).update = 1;
+   update_timg(timer->group);
+   h = TDEV(timer).cnt_high;
+   l = TDEV(timer).cnt_low;
+   return (h << 32) | l;
+}
+
+uint64_t timerAlarmRead(hw_timer_t *timer) {
+   uint64_t h, l;
+   h = TDEV(timer).alarm_high;
+   l = TDEV(timer).alarm_low;
+   return (h << 32) | l;
+}
+
+void timerWrite(hw_timer_t *timer, uint64_t val) {
+   TDEV(timer).load_high = (uint32_t) (val >> 32);
+   TDEV(timer).load_low = (uint32_t) (val);
+   TDEV(timer).reload = 1;
+   update_timg(timer->group);
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value,
+      bool autoreload) {
+   TDEV(timer).alarm_high = (uint32_t) (alarm_value >> 32);
+   TDEV(timer).alarm_low = (uint32_t) alarm_value;
+   TDEV(timer).config.autoreload = autoreload;
+   update_timg(timer->group);
+}
+
+void timerSetConfig(hw_timer_t *timer, uint32_t config) {
+   TDEV(timer).config.val = config;
+   update_timg(timer->group);
+}
+
+uint32_t timerGetConfig(hw_timer_t *timer) {
+   return TDEV(timer).config.val;
+}
+
+void timerSetCountUp(hw_timer_t *timer, bool countUp) {
+   TDEV(timer).config.increase = countUp;
+   update_timg(timer->group);
+}
+
+bool timerGetCountUp(hw_timer_t *timer) {
+   return TDEV(timer).config.increase;
+}
+
+void timerSetAutoReload(hw_timer_t *timer, bool autoreload) {
+   TDEV(timer).config.autoreload = autoreload;
+   update_timg(timer->group);
+}
+
+bool timerGetAutoReload(hw_timer_t *timer) {
+   return TDEV(timer).config.autoreload;
+}
+
+/* The divider goes from 2 up. Zero becomes the largest one and one becomes
+ * two, as one is not allowed.
+ */
+void timerSetDivider(hw_timer_t *timer, uint16_t divider) {
+   if(!divider) divider = 0xFFFF;
+   else if(divider == 1) divider = 2;
+   TDEV(timer).config.divider = divider;
+   update_timg(timer->group);
+}
+
+uint16_t timerGetDivider(hw_timer_t *timer) {
+   return TDEV(timer).config.divider;
+}
+
+void timerStart(hw_timer_t *timer) {
+   TDEV(timer).config.enable = 1;
+   update_timg(timer->group);
+}
+
+void timerStop(hw_timer_t *timer) {
+   TDEV(timer).config.enable = 0;
+   update_timg(timer->group);
+}
+
+void timerRestart(hw_timer_t *timer) {
+   TDEV(timer).config.enable = 0;
+   TDEV(timer).load_high = 0;
+   TDEV(timer).load_low = 0;
+   TDEV(timer).reload = 1;
+   TDEV(timer).config.enable = 1;
+   update_timg(timer->group);
+}
+
+bool timerStarted(hw_timer_t *timer) {
+   return TDEV(timer).config.enable;
+}
+
+void timerAlarmEnable(hw_timer_t *timer) {
+   TDEV(timer).config.alarm_en = 1;
+   update_timg(timer->group);
+}
+
+void timerAlarmDisable(hw_timer_t *timer) {
+   TDEV(timer).config.alarm_en = 0;
+   update_timg(timer->group);
+}
+
+bool timerAlarmEnabled(hw_timer_t *timer) {
+   return TDEV(timer).config.alarm_en;
+}
+
+hw_timer_t * timerBegin(uint8_t num, uint16_t divider, bool countUp) {
+   hw_timer_t * timer;
+   if(num > 3) {
+      PRINTF_WARN("HALTIMER", "There is no timer %d", num);
+      return NULL;
+   }
+   timer = &hw_timer[num];
+   timer->tg->int_ena.val = timer->tg->int_ena.val & ~(1u << timer->timer);
+   TDEV(timer).config.enable = 0;
+   timerSetDivider(timer, divider);
+   timerSetCountUp(timer, countUp);
+   timerSetAutoReload(timer, false);
+   timerAttachInterrupt(timer, NULL, false);
+   timerWrite(timer, 0);
+   TDEV(timer).config.enable = 1;
+   update_timg(timer->group);
+   return timer;
+}
+
+void timerEnd(hw_timer_t *timer) {
+   TDEV(timer).config.enable = 0;
+   timerAttachInterrupt(timer, NULL, false);
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge) {
+   static bool initialized = false;
+   int intr_source;
+
+   if(intr_handle) esp_intr_disable(intr_handle);
+   if(fn == NULL) {
+      TDEV(timer).config.level_int_en = 0;
+      TDEV(timer).config.edge_int_en = 0;
+      TDEV(timer).config.alarm_en = 0;
+      timer->tg->int_ena.val = timer->tg->int_ena.val & ~(1u<<timer->timer);
+      __timerInterruptHandlers[timer->num] = NULL;
+   }
+   else {
+      __timerInterruptHandlers[timer->num] = fn;
+      TDEV(timer).config.level_int_en = edge?0:1;
+      TDEV(timer).config.edge_int_en = edge?1:0;
+      if(!edge) intr_source = ((timer->group)?ETS_TG1_T0_LEVEL_INTR_SOURCE:
+         ETS_TG0_T0_LEVEL_INTR_SOURCE) + timer->timer;
+      else intr_source = ((timer->group)?ETS_TG1_T0_EDGE_INTR_SOURCE:
+         ETS_TG0_T0_EDGE_INTR_SOURCE) + timer->timer;
+      /* All the timers share the one ISR. The first one allocates it, the
+       * others are routed to the same CPU interrupt.
+       */
+      if(!initialized) {
+         initialized = true;
+         esp_intr_alloc(intr_source, (int)(ESP_INTR_FLAG_IRAM|
+            ESP_INTR_FLAG_LOWMED|ESP_INTR_FLAG_EDGE), __timerISR, NULL,
+            &intr_handle);
+      }
+      else intr_matrix_set(esp_intr_get_cpu(intr_handle), intr_source,
+         esp_intr_get_intno(intr_handle));
+      timer->tg->int_ena.val = timer->tg->int_ena.val | (1u<<timer->timer);
+   }
+   update_timg(timer->group);
+   if(intr_handle) esp_intr_enable(intr_handle);
+}
+
+void timerDetachInterrupt(hw_timer_t *timer) {
+   timerAttachInterrupt(timer, NULL, false);
+}
+
+uint64_t timerReadMicros(hw_timer_t *timer) {
+   uint64_t timer_val = timerRead(timer);
+   uint16_t div = timerGetDivider(timer);
+   return timer_val * div / (getApbFrequency() / 1000000);
+}
+
+double timerReadSeconds(hw_timer_t *timer) {
+   uint64_t timer_val = timerRead(timer);
+   uint16_t div = timerGetDivider(timer);
+   return (double)timer_val * div / getApbFrequency();
+}
+
+uint64_t timerAlarmReadMicros(hw_timer_t *timer) {
+   uint64_t timer_val = timerAlarmRead(timer);
+   uint16_t div = timerGetDivider(timer);
+   return timer_val * div / (getApbFrequency() / 1000000);
+}
+
+double timerAlarmReadSeconds(hw_timer_t *timer) {
+   uint64_t timer_val = timerAlarmRead(timer);
+   uint16_t div = timerGetDivider(timer);
+   return (double)timer_val * div / getApbFrequency();
+}
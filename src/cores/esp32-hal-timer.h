@@ -0,0 +1,84 @@
+/*
+ esp32-hal-timer.h - Timer Interface Functions
+ Copyright (c) 2020 Glenn Ramalho - RFIDo. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+ This file was based off the work covered by the license below:
+
+    Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+ */
+
+#ifndef _ESP32_HAL_TIMER_H
+#define _ESP32_HAL_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct hw_timer_s;
+typedef struct hw_timer_s hw_timer_t;
+
+hw_timer_t * timerBegin(uint8_t timer, uint16_t divider, bool countUp);
+void timerEnd(hw_timer_t *timer);
+
+void timerSetConfig(hw_timer_t *timer, uint32_t config);
+uint32_t timerGetConfig(hw_timer_t *timer);
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge);
+void timerDetachInterrupt(hw_timer_t *timer);
+
+void timerStart(hw_timer_t *timer);
+void timerStop(hw_timer_t *timer);
+void timerRestart(hw_timer_t *timer);
+void timerWrite(hw_timer_t *timer, uint64_t val);
+void timerSetDivider(hw_timer_t *timer, uint16_t divider);
+void timerSetCountUp(hw_timer_t *timer, bool countUp);
+void timerSetAutoReload(hw_timer_t *timer, bool autoreload);
+
+bool timerStarted(hw_timer_t *timer);
+uint64_t timerRead(hw_timer_t *timer);
+uint64_t timerReadMicros(hw_timer_t *timer);
+double timerReadSeconds(hw_timer_t *timer);
+uint16_t timerGetDivider(hw_timer_t *timer);
+bool timerGetCountUp(hw_timer_t *timer);
+bool timerGetAutoReload(hw_timer_t *timer);
+
+void timerAlarmEnable(hw_timer_t *timer);
+void timerAlarmDisable(hw_timer_t *timer);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t interruptAt, bool autoreload);
+
+bool timerAlarmEnabled(hw_timer_t *timer);
+uint64_t timerAlarmRead(hw_timer_t *timer);
+uint64_t timerAlarmReadMicros(hw_timer_t *timer);
+double timerAlarmReadSeconds(hw_timer_t *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
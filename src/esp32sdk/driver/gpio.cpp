@@ -39,6 +39,8 @@
 #include "esp_log.h"
 #include "soc/gpio_struct.h"
 #include "update.h"
+#include "esp_intr_alloc.h"
+#include "freertos/FreeRTOS.h"
 
 static const char* GPIO_TAG = "GPIODRV";
 #define GPIO_CHECK(a, str, ret_val) \
@@ -119,14 +121,12 @@ esp_err_t gpio_config(const gpio_config_t *pGPIOConfig) {
          } else {
              gpio_pulldown_dis(io_num);
          }
-         /* Interrupts is not yet supported
          gpio_set_intr_type(io_num, pGPIOConfig->intr_type);
          if (pGPIOConfig->intr_type) {
             gpio_intr_enable(io_num);
          } else {
             gpio_intr_disable(io_num);
          }
-         */
          /* We always set the function to the GPIO function. */
          PIN_FUNC_SELECT(io_reg, PIN_FUNC_GPIO);
       }
@@ -175,7 +175,10 @@ esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
  *
  */
 esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
+   GPIO_CHECK(GPIO_IS_VALID_GPIO(gpio_num), "GPIO number error", ESP_ERR_INVALID_ARG);
+   GPIO_CHECK(intr_type < GPIO_INTR_MAX, "GPIO interrupt type error", ESP_ERR_INVALID_ARG);
+   GPIO.pin[gpio_num].int_type = intr_type;
+   update_gpio();
    clockpacer.wait_next_apb_clk();
    return ESP_OK;
 }
@@ -195,7 +198,11 @@ esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
  *
  */
 esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
+   GPIO_CHECK(GPIO_IS_VALID_GPIO(gpio_num), "GPIO number error", ESP_ERR_INVALID_ARG);
+   /* The interrupt goes to the CPU we are running on. */
+   if (xPortGetCoreID() == 0) GPIO.pin[gpio_num].int_ena = GPIO_PRO_CPU_INTR_ENA;
+   else GPIO.pin[gpio_num].int_ena = GPIO_APP_CPU_INTR_ENA;
+   update_gpio();
    clockpacer.wait_next_apb_clk();
    return ESP_OK;
 }
@@ -211,7 +218,9 @@ esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
  *
  */
 esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
+   GPIO_CHECK(GPIO_IS_VALID_GPIO(gpio_num), "GPIO number error", ESP_ERR_INVALID_ARG);
+   GPIO.pin[gpio_num].int_ena = 0;
+   update_gpio();
    clockpacer.wait_next_apb_clk();
    return ESP_OK;
 }
@@ -413,7 +422,13 @@ esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull) {
  */
 esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
    GPIO_CHECK(GPIO_IS_VALID_GPIO(gpio_num), "GPIO number error", ESP_ERR_INVALID_ARG);
-   PRINTF_WARN("GPIODRV", "GPIO Wakeups are not yet supported.");
+   if (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL) {
+      PRINTF_ERROR("GPIODRV", "GPIO wakeup only supports level mode, but edge mode set. gpio_num:%u", gpio_num);
+      return ESP_ERR_INVALID_ARG;
+   }
+   GPIO.pin[gpio_num].int_type = intr_type;
+   GPIO.pin[gpio_num].wakeup_enable = 1;
+   update_gpio();
    clockpacer.wait_next_apb_clk();
    return ESP_OK;
 }
@@ -429,7 +444,8 @@ esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
  */
 esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num) {
    GPIO_CHECK(GPIO_IS_VALID_GPIO(gpio_num), "GPIO number error", ESP_ERR_INVALID_ARG);
-   PRINTF_WARN("GPIODRV", "GPIO Wakeups are not yet supported.");
+   GPIO.pin[gpio_num].wakeup_enable = 0;
+   update_gpio();
    clockpacer.wait_next_apb_clk();
    return ESP_OK;
 }
@@ -460,9 +476,8 @@ esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num) {
  */
 esp_err_t gpio_isr_register(void (*fn)(void*), void * arg, int intr_alloc_flags, gpio_isr_handle_t *handle) {
    GPIO_CHECK(fn, "GPIO ISR null", ESP_ERR_INVALID_ARG);
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
    clockpacer.wait_next_apb_clk();
-   return ESP_OK;
+   return esp_intr_alloc(ETS_GPIO_INTR_SOURCE, intr_alloc_flags, fn, arg, handle);
 }
 
 /**
@@ -542,6 +557,47 @@ esp_err_t gpio_pulldown_dis(gpio_num_t gpio_num) {
 }
 
 
+/* ISR service. We keep a handler per pin and a single ISR that goes through
+ * the pins that interrupted this CPU.
+ */
+typedef struct {
+   gpio_isr_t fn;
+   void *args;
+} gpio_isr_func_t;
+
+static gpio_isr_func_t *gpio_isr_func = NULL;
+static gpio_isr_handle_t gpio_isr_handle = NULL;
+
+static void gpio_intr_service(void *arg) {
+   uint32_t st, st1;
+   int g;
+
+   if (gpio_isr_func == NULL) return;
+   if (xPortGetCoreID() == 0) {
+      st = GPIO.pcpu_int;
+      st1 = GPIO.pcpu_int1.intr;
+   }
+   else {
+      st = GPIO.acpu_int;
+      st1 = GPIO.acpu_int1.intr;
+   }
+
+   for(g = 0; g < 32; g = g + 1)
+      if ((st & (1u << g)) != 0 && gpio_isr_func[g].fn != NULL)
+         gpio_isr_func[g].fn(gpio_isr_func[g].args);
+   for(g = 0; g < GPIO_NUM_MAX - 32; g = g + 1)
+      if ((st1 & (1u << g)) != 0 && gpio_isr_func[g+32].fn != NULL)
+         gpio_isr_func[g+32].fn(gpio_isr_func[g+32].args);
+
+   /* Like the IDF, we clear the status after the handlers. If the level of
+    * a level interrupt still holds, the GPIO matrix sets it again and
+    * raises its interrupt line once more, so it comes right back.
+    */
+   GPIO.status_w1tc = st;
+   GPIO.status1_w1tc.intr_st = st1;
+   update_gpio();
+}
+
 /**
   * @brief Install the driver's GPIO ISR handler service, which allows per-pin GPIO interrupt handlers.
   *
@@ -558,16 +614,33 @@ esp_err_t gpio_pulldown_dis(gpio_num_t gpio_num) {
   *     - ESP_ERR_INVALID_ARG GPIO error
   */
 esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
-   clockpacer.wait_next_apb_clk();
-   return ESP_OK;
+   esp_err_t ret;
+   int g;
+
+   GPIO_CHECK(gpio_isr_func == NULL, "GPIO isr service already installed", ESP_ERR_INVALID_STATE);
+   gpio_isr_func = (gpio_isr_func_t *)malloc(sizeof(gpio_isr_func_t) * GPIO_NUM_MAX);
+   if (gpio_isr_func == NULL) return ESP_ERR_NO_MEM;
+   for(g = 0; g < GPIO_NUM_MAX; g = g + 1) {
+      gpio_isr_func[g].fn = NULL;
+      gpio_isr_func[g].args = NULL;
+   }
+   ret = gpio_isr_register(gpio_intr_service, NULL, intr_alloc_flags, &gpio_isr_handle);
+   if (ret != ESP_OK) {
+      free(gpio_isr_func);
+      gpio_isr_func = NULL;
+   }
+   return ret;
 }
 
 /**
   * @brief Uninstall the driver's GPIO ISR service, freeing related resources.
   */
 void gpio_uninstall_isr_service() {
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
+   if (gpio_isr_func == NULL) return;
+   esp_intr_free(gpio_isr_handle);
+   free(gpio_isr_func);
+   gpio_isr_func = NULL;
+   gpio_isr_handle = NULL;
    clockpacer.wait_next_apb_clk();
 }
 
@@ -596,7 +669,10 @@ void gpio_uninstall_isr_service() {
   *     - ESP_ERR_INVALID_ARG Parameter error
   */
 esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void* args) {
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
+   GPIO_CHECK(gpio_isr_func != NULL, "GPIO isr service is not installed, call gpio_install_isr_service() first", ESP_ERR_INVALID_STATE);
+   GPIO_CHECK(GPIO_IS_VALID_GPIO(gpio_num), "GPIO number error", ESP_ERR_INVALID_ARG);
+   gpio_isr_func[gpio_num].fn = isr_handler;
+   gpio_isr_func[gpio_num].args = args;
    clockpacer.wait_next_apb_clk();
    return ESP_OK;
 }
@@ -612,7 +688,10 @@ esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void
   *     - ESP_ERR_INVALID_ARG Parameter error
   */
 esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
-   PRINTF_WARN("GPIODRV", "GPIO Interrupts are not yet supported.");
+   GPIO_CHECK(gpio_isr_func != NULL, "GPIO isr service is not installed, call gpio_install_isr_service() first", ESP_ERR_INVALID_STATE);
+   GPIO_CHECK(GPIO_IS_VALID_GPIO(gpio_num), "GPIO number error", ESP_ERR_INVALID_ARG);
+   gpio_isr_func[gpio_num].fn = NULL;
+   gpio_isr_func[gpio_num].args = NULL;
    clockpacer.wait_next_apb_clk();
    return ESP_OK;
 }
@@ -33,6 +33,8 @@
 #include <systemc.h>
 #include "esp_log.h"
 #include "driver/pcnt.h"
+#include "esp_intr_alloc.h"
+#include "soc/soc.h"
 #include <stdlib.h>
 //#include "driver/periph_ctrl.h"
 #include "adc_types.h"
@@ -155,7 +157,8 @@ esp_err_t pcnt_get_counter_value(pcnt_unit_t pcnt_unit, int16_t* count)
 {
     PCNT_CHECK(pcnt_unit < PCNT_UNIT_MAX, PCNT_UNIT_ERR_STR, ESP_ERR_INVALID_ARG);
     PCNT_CHECK(count != NULL, PCNT_ADDRESS_ERR_STR, ESP_ERR_INVALID_ARG);
-    del1cycle();
+    /* The model needs to refresh counters that are counting a burst. */
+    update_pcnt();
     *count = (int16_t) PCNT.cnt_unit[pcnt_unit].cnt_val;
     return ESP_OK;
 }
@@ -326,8 +329,7 @@ esp_err_t pcnt_filter_disable(pcnt_unit_t unit)
 esp_err_t pcnt_isr_register(void (*fun)(void*), void * arg, int intr_alloc_flags, pcnt_isr_handle_t *handle)
 {
     PCNT_CHECK(fun != NULL, PCNT_ADDRESS_ERR_STR, ESP_ERR_INVALID_ARG);
-    //return esp_intr_alloc(ETS_PCNT_INTR_SOURCE, intr_alloc_flags, fun, arg, handle);
-    return ESP_OK;
+    return esp_intr_alloc(ETS_PCNT_INTR_SOURCE, intr_alloc_flags, fun, arg, handle);
 }
 
 // pcnt interrupt service
@@ -343,6 +345,7 @@ static void IRAM_ATTR pcnt_intr_service(void* arg)
         }
     }
     PCNT.int_clr.val = intr_status;
+    update_pcnt();
 }
 
 esp_err_t pcnt_isr_handler_add(pcnt_unit_t unit, void(*isr_handler)(void *), void *args)
@@ -395,8 +398,8 @@ void pcnt_isr_service_uninstall(void)
         return;
     }
     PCNT_ENTER_CRITICAL(&pcnt_spinlock);
-    //esp_intr_free(pcnt_isr_service);
-    //free(pcnt_isr_func);
+    esp_intr_free(pcnt_isr_service);
+    free(pcnt_isr_func);
     pcnt_isr_func = NULL;
     pcnt_isr_service = NULL;
     PCNT_EXIT_CRITICAL(&pcnt_spinlock);
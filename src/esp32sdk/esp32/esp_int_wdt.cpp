@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * esp_int_wdt.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This file reimplements the interrupt watchdog for the ESPMOD SystemC
+ *   model. We keep, for each CPU, when it started running its interrupt
+ *   handlers. A single thread sleeps on one event, set for the first CPU to
+ *   reach the timeout and cancelled when the handlers are done, so there is
+ *   no polling.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file was based off the work covered by the license below:
+ *    Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+#include <systemc.h>
+#include "sdkconfig.h"
+#include "esp_int_wdt.h"
+#include "esp_system.h"
+#include "esp_err.h"
+#include "reset_reason.h"
+#include "rom/rtc.h"
+#include "ctrlregs.h"
+#include "espintr.h"
+#include "alarms.h"
+#include "info.h"
+
+#ifndef CONFIG_INT_WDT_TIMEOUT_MS
+#define CONFIG_INT_WDT_TIMEOUT_MS 300
+#endif
+
+#ifdef CONFIG_INT_WDT_CHECK_CPU1
+#define IWDT_NUMCPUS 2
+#else
+#define IWDT_NUMCPUS 1
+#endif
+
+struct iwdt_svc {
+   bool initialized;
+   sc_time timeout;
+   /* Whether each CPU is in its handlers and since when. */
+   bool inisr[IWDT_NUMCPUS];
+   sc_time since[IWDT_NUMCPUS];
+   sc_event deadline_ev;
+};
+
+static iwdt_svc *iwdt = NULL;
+
+/* Sets the deadline event for the CPU that has been in its handlers the
+ * longest.
+ */
+static void rearm() {
+   deadline d;
+   int c;
+
+   for(c = 0; c < IWDT_NUMCPUS; c = c + 1)
+      if (iwdt->inisr[c]) d.add(iwdt->since[c] + iwdt->timeout);
+   d.arm(iwdt->deadline_ev);
+}
+
+/*************************
+ * Task: iwdt_th()
+ *************************
+ * The watchdog. It wakes up only when a deadline is reached, reports the
+ * CPU and resets the chip, as the panic handler would. The CPUs are also
+ * taken out of the handlers they are in, or they would never take an
+ * interrupt again.
+ */
+static void iwdt_th() {
+   int c;
+
+   while(true) {
+      wait(iwdt->deadline_ev);
+      if (!iwdt->initialized) continue;
+
+      for(c = 0; c < IWDT_NUMCPUS; c = c + 1)
+         if (iwdt->inisr[c]
+               && iwdt->since[c] + iwdt->timeout <= sc_time_stamp()) break;
+      if (c == IWDT_NUMCPUS) {
+         rearm();
+         continue;
+      }
+
+      PRINTF_WARN("INT_WDT",
+         "Guru Meditation Error: Core  %d panic'ed (Interrupt wdt timeout on CPU%d)",
+         c, c);
+      espm_print_tasks();
+      for(c = 0; c < IWDT_NUMCPUS; c = c + 1) {
+         if (!iwdt->inisr[c]) continue;
+         iwdt->inisr[c] = false;
+         if (espintrptr != NULL) espintrptr->restart(c);
+      }
+      esp_reset_reason_set_hint(ESP_RST_INT_WDT);
+      ctrlregsptr->cpu0_reset_reason = SW_CPU_RESET;
+      ctrlregsptr->cpu1_reset_reason = SW_CPU_RESET;
+      ctrlregsptr->dut.throw_it(espm_restart_ex());
+      rearm();
+   }
+}
+
+void esp_int_wdt_init() {
+   int c;
+
+   if (iwdt == NULL) {
+      iwdt = new iwdt_svc;
+      sc_spawn(&iwdt_th, "int_wdt");
+   }
+   iwdt->timeout = sc_time(CONFIG_INT_WDT_TIMEOUT_MS, SC_MS);
+   for(c = 0; c < IWDT_NUMCPUS; c = c + 1) iwdt->inisr[c] = false;
+   iwdt->initialized = true;
+   iwdt->deadline_ev.cancel();
+}
+
+void espm_int_wdt_enter(int cpu) {
+   if (iwdt == NULL || !iwdt->initialized) return;
+   if (cpu < 0 || cpu >= IWDT_NUMCPUS) return;
+   iwdt->inisr[cpu] = true;
+   iwdt->since[cpu] = sc_time_stamp();
+   rearm();
+}
+
+void espm_int_wdt_exit(int cpu) {
+   if (iwdt == NULL || !iwdt->initialized) return;
+   if (cpu < 0 || cpu >= IWDT_NUMCPUS) return;
+   iwdt->inisr[cpu] = false;
+   rearm();
+}
+
+void espm_int_wdt_reset() {
+   if (iwdt == NULL) return;
+   iwdt->initialized = false;
+   iwdt->deadline_ev.cancel();
+}
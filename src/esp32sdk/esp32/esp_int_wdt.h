@@ -0,0 +1,65 @@
+// Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_INT_WDT_H
+#define __ESP_INT_WDT_H
+
+/**
+ * @file esp_int_wdt.h
+ * @brief Interrupt watchdog
+ *
+ * On the chip the interrupt watchdog is fed by the tick interrupt, so it goes
+ * off when a CPU does not take interrupts for too long. In the ESPMOD model
+ * the interrupt module tells it when a CPU starts and ends running its
+ * interrupt handlers, and it goes off when that takes longer than
+ * CONFIG_INT_WDT_TIMEOUT_MS. The CPU and a task listing are then reported,
+ * the CPU is taken out of its handlers and the chip is reset with
+ * ESP_RST_INT_WDT as the reason.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  * @brief  Initialize the non-CPU-specific parts of interrupt watchdog.
+  *         This is called in the init code if the interrupt watchdog
+  *         is enabled in menuconfig.
+  */
+void esp_int_wdt_init();
+
+/**
+ * @brief Model function: the CPU starts running interrupt handlers
+ *
+ * @param cpu  CPU taking the interrupts
+ */
+void espm_int_wdt_enter(int cpu);
+
+/**
+ * @brief Model function: the CPU is done with its interrupt handlers
+ *
+ * @param cpu  CPU that took the interrupts
+ */
+void espm_int_wdt_exit(int cpu);
+
+/**
+ * @brief Model function: stop the watchdog, as on a chip reset
+ */
+void espm_int_wdt_reset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ESP_INT_WDT_H
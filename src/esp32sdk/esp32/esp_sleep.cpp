@@ -0,0 +1,362 @@
+/*******************************************************************************
+ * esp_sleep.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This file reimplements the light sleep and deep sleep functions for the
+ *   ESPMOD SystemC model. While the chip sleeps the firmware thread is parked
+ *   waiting only on the enabled wake up sources and the APB clock is gated,
+ *   so the peripherals that run off it stop. The other tasks and the
+ *   software timers are parked as they wake up, see rtospark(). The
+ *   simulation then jumps right to the next wake up event, no matter how
+ *   long the sleep is.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file was based off the work covered by the license below:
+ *    Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <systemc.h>
+#include <stdint.h>
+#include "esp_sleep.h"
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "soc/gpio_struct.h"
+#include "rom/rtc.h"
+#include "ctrlregs.h"
+#include "clockpacer.h"
+#include "gpioset.h"
+#include "info.h"
+
+/* The GPIOs that have an RTC function: 0, 2, 4, 12-15, 25-27 and 32-39. */
+#define RTC_GPIO_MASK ((1ULL<<0)|(1ULL<<2)|(1ULL<<4)|(0xfULL<<12)| \
+   (0x7ULL<<25)|(0xffULL<<32))
+#define IS_RTC_GPIO(g) ((g) >= 0 && (g) < 40 && ((RTC_GPIO_MASK >> (g)) & 1))
+
+typedef struct {
+   uint32_t wakeup_triggers;
+   uint64_t sleep_duration;
+   int ext0_gpio_num;
+   int ext0_trigger_level;
+   uint64_t ext1_mask;
+   esp_sleep_ext1_wakeup_mode_t ext1_mode;
+   /* These are what the RTC controller latched on the last wake up. */
+   uint64_t ext1_status;
+   touch_pad_t touch_pad;
+   bool light_sleep_wakeup;
+   bool asleep;
+   sc_event *touch_ev;
+} sleep_config_t;
+
+static sleep_config_t s_config = {
+   0, 0, -1, 0, 0, ESP_EXT1_WAKEUP_ALL_LOW, 0, TOUCH_PAD_MAX, false, false,
+   NULL
+};
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+   if (source == ESP_SLEEP_WAKEUP_ALL) {
+      s_config.wakeup_triggers = 0;
+   }
+   else if (source == ESP_SLEEP_WAKEUP_TIMER
+         && (s_config.wakeup_triggers & TIMER_EXPIRE_EN)) {
+      s_config.wakeup_triggers = s_config.wakeup_triggers & ~TIMER_EXPIRE_EN;
+      s_config.sleep_duration = 0;
+   }
+   else if (source == ESP_SLEEP_WAKEUP_EXT0
+         && (s_config.wakeup_triggers & EXT_EVENT0_TRIG_EN)) {
+      s_config.wakeup_triggers = s_config.wakeup_triggers & ~EXT_EVENT0_TRIG_EN;
+      s_config.ext0_gpio_num = -1;
+   }
+   else if (source == ESP_SLEEP_WAKEUP_EXT1
+         && (s_config.wakeup_triggers & EXT_EVENT1_TRIG_EN)) {
+      s_config.wakeup_triggers = s_config.wakeup_triggers & ~EXT_EVENT1_TRIG_EN;
+      s_config.ext1_mask = 0;
+   }
+   else if (source == ESP_SLEEP_WAKEUP_TOUCHPAD
+         && (s_config.wakeup_triggers & TOUCH_TRIG_EN)) {
+      s_config.wakeup_triggers = s_config.wakeup_triggers & ~TOUCH_TRIG_EN;
+   }
+   else if (source == ESP_SLEEP_WAKEUP_GPIO
+         && (s_config.wakeup_triggers & GPIO_TRIG_EN)) {
+      s_config.wakeup_triggers = s_config.wakeup_triggers & ~GPIO_TRIG_EN;
+   }
+   else {
+      PRINTF_ERROR("SLEEP", "Incorrect wakeup source (%d) to disable.",
+         (int)source);
+      return ESP_ERR_INVALID_STATE;
+   }
+   return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+   s_config.wakeup_triggers = s_config.wakeup_triggers | TIMER_EXPIRE_EN;
+   s_config.sleep_duration = time_in_us;
+   return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_touchpad_wakeup() {
+   if (s_config.wakeup_triggers & EXT_EVENT0_TRIG_EN) {
+      PRINTF_ERROR("SLEEP",
+         "Conflicting wake-up trigger: ext0");
+      return ESP_ERR_INVALID_STATE;
+   }
+   s_config.wakeup_triggers = s_config.wakeup_triggers | TOUCH_TRIG_EN;
+   return ESP_OK;
+}
+
+touch_pad_t esp_sleep_get_touchpad_wakeup_status() {
+   if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TOUCHPAD)
+      return TOUCH_PAD_MAX;
+   return s_config.touch_pad;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level) {
+   if (level < 0 || level > 1) return ESP_ERR_INVALID_ARG;
+   if (!IS_RTC_GPIO((int)gpio_num)) return ESP_ERR_INVALID_ARG;
+   if (s_config.wakeup_triggers & TOUCH_TRIG_EN) {
+      PRINTF_ERROR("SLEEP", "Conflicting wake-up triggers: touch");
+      return ESP_ERR_INVALID_STATE;
+   }
+   s_config.ext0_gpio_num = gpio_num;
+   s_config.ext0_trigger_level = level;
+   s_config.wakeup_triggers = s_config.wakeup_triggers | EXT_EVENT0_TRIG_EN;
+   return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t mask,
+      esp_sleep_ext1_wakeup_mode_t mode) {
+   if (mode > ESP_EXT1_WAKEUP_ANY_HIGH) return ESP_ERR_INVALID_ARG;
+   if ((mask & ~RTC_GPIO_MASK) != 0) {
+      PRINTF_ERROR("SLEEP", "Not an RTC IO in the ext1 mask: %llx",
+         (unsigned long long)(mask & ~RTC_GPIO_MASK));
+      return ESP_ERR_INVALID_ARG;
+   }
+   s_config.ext1_mask = mask;
+   s_config.ext1_mode = mode;
+   s_config.wakeup_triggers = s_config.wakeup_triggers | EXT_EVENT1_TRIG_EN;
+   return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+   if (s_config.wakeup_triggers & TOUCH_TRIG_EN) {
+      PRINTF_ERROR("SLEEP", "Conflicting wake-up triggers: touch");
+      return ESP_ERR_INVALID_STATE;
+   }
+   s_config.wakeup_triggers = s_config.wakeup_triggers | GPIO_TRIG_EN;
+   return ESP_OK;
+}
+
+uint64_t esp_sleep_get_ext1_wakeup_status() {
+   if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT1) return 0;
+   return s_config.ext1_status;
+}
+
+esp_err_t esp_sleep_pd_config(esp_sleep_pd_domain_t domain,
+      esp_sleep_pd_option_t option) {
+   /* We keep every domain powered, so we only check the arguments. */
+   if (domain >= ESP_PD_DOMAIN_MAX || option > ESP_PD_OPTION_AUTO)
+      return ESP_ERR_INVALID_ARG;
+   return ESP_OK;
+}
+
+void espm_sleep_reset() {
+   /* The configuration is kept in RAM, so it is lost. What the RTC latched
+    * stays.
+    */
+   s_config.wakeup_triggers = 0;
+   s_config.sleep_duration = 0;
+   s_config.ext0_gpio_num = -1;
+   s_config.ext1_mask = 0;
+   s_config.light_sleep_wakeup = false;
+}
+
+void espm_touch_wakeup(touch_pad_t touch_num) {
+   if (!s_config.asleep || (s_config.wakeup_triggers & TOUCH_TRIG_EN) == 0
+         || s_config.touch_ev == NULL) return;
+   s_config.touch_pad = touch_num;
+   s_config.touch_ev->notify();
+}
+
+/*************************
+ * Function: pinlvl()
+ *************************
+ * Gets the level on a pin as the RTC IO sees it, so the input enable of the
+ * GPIO does not matter. Pins that are not in the model read as low.
+ */
+static bool pinlvl(int g) {
+   io_mux *gpin = getgpio(g);
+   if (gpin == NULL) return false;
+   switch(gpin->pin.read().logic.to_char()) {
+      case '1': return true;
+      case 'Z': return gpin->get_wpu();
+      default: return false;
+   }
+}
+
+/*************************
+ * Function: pinwake()
+ *************************
+ * Checks the pin wake up sources and returns the WAKEUP_REASON bits of the
+ * ones that are active now. They are all level triggered.
+ */
+static uint32_t pinwake(bool light) {
+   uint32_t cause = 0;
+   uint64_t status;
+   int g;
+
+   if ((s_config.wakeup_triggers & EXT_EVENT0_TRIG_EN)
+         && pinlvl(s_config.ext0_gpio_num) == (s_config.ext0_trigger_level==1))
+      cause = cause | EXT_EVENT0_TRIG;
+
+   if (s_config.wakeup_triggers & EXT_EVENT1_TRIG_EN) {
+      status = 0;
+      for(g = 0; g < GPIO_PIN_COUNT; g = g + 1)
+         if (((s_config.ext1_mask >> g) & 1) && pinlvl(g))
+            status = status | (1ULL << g);
+      if (s_config.ext1_mode == ESP_EXT1_WAKEUP_ANY_HIGH && status != 0) {
+         s_config.ext1_status = status;
+         cause = cause | EXT_EVENT1_TRIG;
+      }
+      else if (s_config.ext1_mode == ESP_EXT1_WAKEUP_ALL_LOW && status == 0
+            && s_config.ext1_mask != 0) {
+         s_config.ext1_status = s_config.ext1_mask;
+         cause = cause | EXT_EVENT1_TRIG;
+      }
+   }
+
+   /* The GPIO wake up is only there in light sleep. */
+   if (light && (s_config.wakeup_triggers & GPIO_TRIG_EN)) {
+      for(g = 0; g < GPIO_PIN_COUNT; g = g + 1) {
+         if (!GPIO.pin[g].wakeup_enable) continue;
+         if ((GPIO.pin[g].int_type == GPIO_INTR_LOW_LEVEL && !pinlvl(g)) ||
+               (GPIO.pin[g].int_type == GPIO_INTR_HIGH_LEVEL && pinlvl(g)))
+            cause = cause | GPIO_TRIG;
+      }
+   }
+   return cause;
+}
+
+/*************************
+ * Function: sleepwait()
+ *************************
+ * Parks the calling thread until one of the enabled wake up sources goes off
+ * and returns its WAKEUP_REASON bits. We only wait on the pins that can wake
+ * us up and on the sleep timer, so nothing else needs to run while asleep.
+ */
+static uint32_t sleepwait(bool light) {
+   sc_event_or_list evs;
+   sc_time wakeat;
+   uint32_t cause;
+   io_mux *gpin;
+   int g;
+   bool watch;
+
+   /* The touch is always in the list, which also keeps it from being empty
+    * when there are no pins to watch.
+    */
+   if (s_config.touch_ev == NULL) s_config.touch_ev = new sc_event;
+   evs |= *s_config.touch_ev;
+   for(g = 0; g < GPIO_PIN_COUNT; g = g + 1) {
+      watch = ((s_config.wakeup_triggers & EXT_EVENT0_TRIG_EN)
+            && g == s_config.ext0_gpio_num)
+         || ((s_config.wakeup_triggers & EXT_EVENT1_TRIG_EN)
+            && ((s_config.ext1_mask >> g) & 1))
+         || (light && (s_config.wakeup_triggers & GPIO_TRIG_EN)
+            && GPIO.pin[g].wakeup_enable);
+      if (!watch) continue;
+      gpin = getgpio(g);
+      if (gpin == NULL) {
+         PRINTF_WARN("SLEEP", "No gpio defined for wake up pin %d", g);
+      }
+      else evs |= gpin->pin.value_changed_event();
+   }
+
+   if (s_config.wakeup_triggers & TIMER_EXPIRE_EN)
+      wakeat = sc_time_stamp() + sc_time((double)s_config.sleep_duration, SC_US);
+   else if ((s_config.wakeup_triggers & ~TIMER_EXPIRE_EN) == 0) {
+      PRINTF_WARN("SLEEP", "No wake up source enabled, sleeping forever.");
+   }
+
+   s_config.touch_pad = TOUCH_PAD_MAX;
+   s_config.ext1_status = 0;
+   s_config.asleep = true;
+   while(true) {
+      cause = pinwake(light);
+      if (cause != 0) break;
+      if (s_config.wakeup_triggers & TIMER_EXPIRE_EN) {
+         if (sc_time_stamp() >= wakeat) { cause = TIMER_EXPIRE; break; }
+         wait(wakeat - sc_time_stamp(), evs);
+      }
+      else wait(evs);
+      if (s_config.touch_pad != TOUCH_PAD_MAX) { cause = TOUCH_TRIG; break; }
+   }
+   s_config.asleep = false;
+   return cause;
+}
+
+esp_err_t esp_light_sleep_start() {
+   PRINTF_INFO("SLEEP", "Entering light sleep");
+   clockpacer.gate_apb(true);
+   ctrlregsptr->wakeup_cause = sleepwait(true);
+   s_config.light_sleep_wakeup = true;
+   clockpacer.gate_apb(false);
+   PRINTF_INFO("SLEEP", "Waking up from light sleep");
+   return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+   PRINTF_INFO("SLEEP", "Entering deep sleep");
+   clockpacer.gate_apb(true);
+   ctrlregsptr->wakeup_cause = sleepwait(false);
+   ctrlregsptr->cpu0_reset_reason = DEEPSLEEP_RESET;
+   ctrlregsptr->cpu1_reset_reason = EXT_CPU_RESET;
+   clockpacer.gate_apb(false);
+   PRINTF_INFO("SLEEP", "Waking up from deep sleep");
+
+   /* The firmware starts over. We were waiting above, so we are in a thread
+    * and it does not come back.
+    */
+   espm_return_to_start();
+   __builtin_unreachable();
+}
+
+void esp_deep_sleep(uint64_t time_in_us) {
+   esp_sleep_enable_timer_wakeup(time_in_us);
+   esp_deep_sleep_start();
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+   uint32_t wakeup_cause;
+
+   if (rtc_get_reset_reason(0) != DEEPSLEEP_RESET
+         && !s_config.light_sleep_wakeup) {
+      return ESP_SLEEP_WAKEUP_UNDEFINED;
+   }
+
+   wakeup_cause = rtc_get_wakeup_cause();
+   if (wakeup_cause & EXT_EVENT0_TRIG) return ESP_SLEEP_WAKEUP_EXT0;
+   else if (wakeup_cause & EXT_EVENT1_TRIG) return ESP_SLEEP_WAKEUP_EXT1;
+   else if (wakeup_cause & TIMER_EXPIRE) return ESP_SLEEP_WAKEUP_TIMER;
+   else if (wakeup_cause & TOUCH_TRIG) return ESP_SLEEP_WAKEUP_TOUCHPAD;
+   else if (wakeup_cause & GPIO_TRIG) return ESP_SLEEP_WAKEUP_GPIO;
+   else return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
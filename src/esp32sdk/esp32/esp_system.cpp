@@ -78,9 +78,8 @@ int esp_gettimeofday(struct timeval *tv, struct timezone *tz) {
 }
 
 void esp_restart() {
-   /* It is difficult to test the ESP restart from inside the model. Therefore,
-    * all we do is end the simulation. The tests will then have to be done
-    * up to the restart and starting from the restart.
+   /* The chip is reset and the firmware starts over from setup(), in the
+    * same simulation. The flash and the RTC memory are kept.
     */
    software_reset();
 }
@@ -0,0 +1,244 @@
+/*******************************************************************************
+ * esp_task_wdt.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This file reimplements the task watchdog for the ESPMOD SystemC model.
+ *   Instead of a hardware timer fed when all tasks have checked in, each
+ *   subscribed task keeps the time it last reset the watchdog. A single
+ *   thread sleeps on one event, set for the earliest deadline and moved
+ *   each time a task resets, so there is no polling. The idle tasks are
+ *   taken to reset the watchdog all the time their core has no work, which
+ *   the FreeRTOS model tells us through the idle hook.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file was based off the work covered by the license below:
+ *    Copyright 2015-2017 Espressif Systems (Shanghai) PTE LTD
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+#include <systemc.h>
+#include <list>
+#include "esp_task_wdt.h"
+#include "esp_system.h"
+#include "esp_err.h"
+#include "reset_reason.h"
+#include "freertos/rtossched.h"
+#include "rom/rtc.h"
+#include "ctrlregs.h"
+#include "alarms.h"
+#include "info.h"
+
+struct twdt_task {
+   TaskHandle_t task;
+   /* We keep the name and the core, the task might be deleted without
+    * leaving the watchdog.
+    */
+   const char *name;
+   BaseType_t core;
+   /* For the idle tasks, the core they belong to and if it is idle now. */
+   int idlecore;
+   bool idling;
+   sc_time last;
+};
+
+struct twdt_svc {
+   bool initialized;
+   sc_time timeout;
+   bool panic;
+   std::list<twdt_task> tasks;
+   sc_event deadline_ev;
+   sc_process_handle th;
+};
+
+static twdt_svc *twdt = NULL;
+
+/*************************
+ * Function: rearm()
+ *************************
+ * Sets the deadline event for the task that is due first. Idle tasks whose
+ * core is idle are never due.
+ */
+static void rearm() {
+   std::list<twdt_task>::iterator it;
+   deadline d;
+
+   for(it = twdt->tasks.begin(); it != twdt->tasks.end(); it++)
+      if (!it->idling) d.add(it->last + twdt->timeout);
+   d.arm(twdt->deadline_ev);
+}
+
+static std::list<twdt_task>::iterator findtask(TaskHandle_t handle) {
+   std::list<twdt_task>::iterator it;
+
+   for(it = twdt->tasks.begin(); it != twdt->tasks.end(); it++)
+      if (it->task == handle) break;
+   return it;
+}
+
+/* Called by the FreeRTOS model when a core starts or stops working. */
+static void twdt_idle(int core, bool idle) {
+   std::list<twdt_task>::iterator it;
+
+   if (twdt == NULL || !twdt->initialized) return;
+   for(it = twdt->tasks.begin(); it != twdt->tasks.end(); it++) {
+      if (it->idlecore != core) continue;
+      it->idling = idle;
+      it->last = sc_time_stamp();
+      rearm();
+   }
+}
+
+/*************************
+ * Task: twdt_th()
+ *************************
+ * The watchdog. It wakes up only when a deadline is reached, reports the
+ * tasks that are late and either resets the chip or, with panic off, gives
+ * them another timeout period, as the hardware timer would restart.
+ */
+static void twdt_th() {
+   std::list<twdt_task>::iterator it;
+   bool late;
+
+   while(true) {
+      wait(twdt->deadline_ev);
+      if (!twdt->initialized) continue;
+
+      late = false;
+      for(it = twdt->tasks.begin(); it != twdt->tasks.end(); it++) {
+         if (it->idling || it->last + twdt->timeout > sc_time_stamp())
+            continue;
+         if (!late) PRINTF_WARN("TASK_WDT", "Task watchdog got triggered. "
+            "The following tasks did not reset the watchdog in time:");
+         late = true;
+         PRINTF_WARN("TASK_WDT", " - %s (%s)", it->name,
+            (it->core == tskNO_AFFINITY)?"CPU 0/1":
+            (it->core == 0)?"CPU 0":"CPU 1");
+         it->last = sc_time_stamp();
+      }
+      if (!late) {
+         rearm();
+         continue;
+      }
+      espm_print_tasks();
+
+      /* On a panic the chip is reset as the panic handler would. We do not
+       * use software_reset(), as that takes down the calling thread, and
+       * this one is kept for the next esp_task_wdt_init().
+       */
+      if (twdt->panic) {
+         PRINTF_WARN("TASK_WDT", "Aborting.");
+         esp_reset_reason_set_hint(ESP_RST_TASK_WDT);
+         ctrlregsptr->cpu0_reset_reason = SW_CPU_RESET;
+         ctrlregsptr->cpu1_reset_reason = SW_CPU_RESET;
+         ctrlregsptr->dut.throw_it(espm_restart_ex());
+      }
+      rearm();
+   }
+}
+
+esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic_en) {
+   if (twdt == NULL) {
+      twdt = new twdt_svc;
+      twdt->initialized = false;
+   }
+   if (!twdt->th.valid())
+      twdt->th = sc_spawn(&twdt_th, "task_wdt");
+
+   twdt->timeout = sc_time((double)timeout, SC_SEC);
+   twdt->panic = panic_en;
+   /* If it was running, the new timeout applies from now on. */
+   if (twdt->initialized) rearm();
+   twdt->initialized = true;
+   rtossetidlehook(&twdt_idle);
+   return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_deinit() {
+   if (twdt == NULL || !twdt->initialized || !twdt->tasks.empty())
+      return ESP_ERR_INVALID_STATE;
+   twdt->initialized = false;
+   twdt->deadline_ev.cancel();
+   return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_add(TaskHandle_t handle) {
+   twdt_task t;
+   int c;
+
+   if (twdt == NULL || !twdt->initialized) return ESP_ERR_INVALID_STATE;
+   if (handle == NULL) handle = xTaskGetCurrentTaskHandle();
+   if (findtask(handle) != twdt->tasks.end()) return ESP_ERR_INVALID_ARG;
+
+   t.task = handle;
+   t.name = pcTaskGetTaskName(handle);
+   t.core = xTaskGetAffinity(handle);
+   t.idlecore = -1;
+   t.idling = false;
+   for(c = 0; c < RTOS_NUMCORES; c = c + 1)
+      if (handle == xTaskGetIdleTaskHandleForCPU(c)) {
+         t.idlecore = c;
+         t.idling = rtosidling(c);
+      }
+   t.last = sc_time_stamp();
+   twdt->tasks.push_back(t);
+   rearm();
+   return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_reset() {
+   std::list<twdt_task>::iterator it;
+
+   if (twdt == NULL || !twdt->initialized) return ESP_ERR_INVALID_STATE;
+   it = findtask(xTaskGetCurrentTaskHandle());
+   if (it == twdt->tasks.end()) return ESP_ERR_NOT_FOUND;
+   it->last = sc_time_stamp();
+   rearm();
+   return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_delete(TaskHandle_t handle) {
+   std::list<twdt_task>::iterator it;
+
+   if (twdt == NULL || !twdt->initialized) return ESP_ERR_INVALID_STATE;
+   if (handle == NULL) handle = xTaskGetCurrentTaskHandle();
+   it = findtask(handle);
+   if (it == twdt->tasks.end()) return ESP_ERR_INVALID_ARG;
+   twdt->tasks.erase(it);
+   rearm();
+   return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_status(TaskHandle_t handle) {
+   if (twdt == NULL || !twdt->initialized) return ESP_ERR_INVALID_STATE;
+   if (handle == NULL) handle = xTaskGetCurrentTaskHandle();
+   if (findtask(handle) == twdt->tasks.end()) return ESP_ERR_NOT_FOUND;
+   return ESP_OK;
+}
+
+void espm_task_wdt_reset() {
+   /* The thread is left waiting, it is used again by the next init. */
+   if (twdt == NULL) return;
+   twdt->tasks.clear();
+   twdt->initialized = false;
+   twdt->deadline_ev.cancel();
+}
@@ -0,0 +1,135 @@
+// Copyright 2015-2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_TASK_WDT_H
+#define __ESP_TASK_WDT_H
+
+/**
+ * @file esp_task_wdt.h
+ * @brief Task watchdog
+ *
+ * In the ESPMOD model each subscribed task has its own deadline, the time
+ * it last reset the watchdog plus the timeout, and the watchdog sleeps until
+ * the earliest one. The idle tasks reset it whenever their core has no work,
+ * and a core only works when the tasks annotate it, see rtossched.h. When
+ * it goes off, the tasks that are late and a task listing are reported and,
+ * with panic on, the chip is reset with ESP_RST_TASK_WDT as the reason.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  * @brief  Initialize the Task Watchdog Timer (TWDT)
+  *
+  * This function configures and initializes the TWDT. If the TWDT is already
+  * initialized when this function is called, this function will update the
+  * TWDT's timeout period and panic configurations instead.
+  *
+  * @param[in]  timeout     Timeout period of TWDT in seconds
+  * @param[in]  panic_en    Flag that controls whether the panic handler will be
+  *                         executed when the TWDT times out
+  *
+  * @return
+  *     - ESP_OK: Initialization was successful
+  */
+esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic_en);
+
+/**
+ * @brief   Deinitialize the Task Watchdog Timer (TWDT)
+ *
+ * This function will deinitialize the TWDT. Calling this function whilst tasks
+ * are still subscribed to the TWDT, or when the TWDT is already deinitialized,
+ * will result in an error code being returned.
+ *
+ * @return
+ *      - ESP_OK: TWDT successfully deinitialized
+ *      - ESP_ERR_INVALID_STATE: Error, tasks are still subscribed to the TWDT
+ *        or the TWDT has already been deinitialized
+ */
+esp_err_t esp_task_wdt_deinit();
+
+/**
+  * @brief  Subscribe a task to the Task Watchdog Timer (TWDT)
+  *
+  * This function subscribes a task to the TWDT. Each subscribed task must
+  * periodically call esp_task_wdt_reset() to prevent the TWDT from elapsing its
+  * timeout period.
+  *
+  * @param[in]  handle  Handle of the task. Input NULL to subscribe the current
+  *                     running task to the TWDT
+  *
+  * @return
+  *     - ESP_OK: Successfully subscribed the task to the TWDT
+  *     - ESP_ERR_INVALID_ARG: Error, the task is already subscribed
+  *     - ESP_ERR_INVALID_STATE: Error, the TWDT has not been initialized yet
+  */
+esp_err_t esp_task_wdt_add(TaskHandle_t handle);
+
+/**
+  * @brief  Reset the Task Watchdog Timer (TWDT) on behalf of the currently
+  *         running task
+  *
+  * @return
+  *     - ESP_OK: Successfully reset the TWDT on behalf of the currently
+  *               running task
+  *     - ESP_ERR_NOT_FOUND: Error, the current running task has not subscribed
+  *                          to the TWDT
+  *     - ESP_ERR_INVALID_STATE: Error, the TWDT has not been initialized yet
+  */
+esp_err_t esp_task_wdt_reset();
+
+/**
+  * @brief  Unsubscribes a task from the Task Watchdog Timer (TWDT)
+  *
+  * @param[in]  handle  Handle of the task. Input NULL to unsubscribe the
+  *                     current running task.
+  *
+  * @return
+  *     - ESP_OK: Successfully unsubscribed the task from the TWDT
+  *     - ESP_ERR_INVALID_ARG: Error, the task is already unsubscribed
+  *     - ESP_ERR_INVALID_STATE: Error, the TWDT has not been initialized yet
+  */
+esp_err_t esp_task_wdt_delete(TaskHandle_t handle);
+
+/**
+  * @brief   Query whether a task is subscribed to the Task Watchdog Timer (TWDT)
+  *
+  * @param[in]  handle  Handle of the task. Input NULL to query the current
+  *                     running task.
+  *
+  * @return:
+  *     - ESP_OK: The task is currently subscribed to the TWDT
+  *     - ESP_ERR_NOT_FOUND: The task is currently not subscribed to the TWDT
+  *     - ESP_ERR_INVALID_STATE: The TWDT is not initialized, therefore no tasks
+  *                              can be subscribed
+  */
+esp_err_t esp_task_wdt_status(TaskHandle_t handle);
+
+/**
+ * @brief Model function: stop the watchdog and drop all the tasks, as on a
+ * chip reset
+ */
+void espm_task_wdt_reset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ESP_TASK_WDT_H
@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * esp_timer.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This file reimplements the esp_timer service for the ESPMOD SystemC
+ *   model. The time base is the simulation time. All timers are run by a
+ *   single thread that keeps them in an alarmheap (alarms.h) and sleeps
+ *   until the first one, so a periodic timer costs one wake up per period
+ *   and not one per tick of the hardware timer it would use.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file was based off the work covered by the license below:
+ *    Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+#include <systemc.h>
+#include <stdint.h>
+#include <list>
+#include "esp_timer.h"
+#include "esp_err.h"
+#include "clockpacer.h"
+#include "alarms.h"
+
+struct esp_timer: alarmtimer {
+   esp_timer_cb_t callback;
+   void *arg;
+   const char *name;
+   uint64_t period;
+};
+
+struct esp_timer_svc {
+   bool initialized;
+   alarmheap alarms;
+   /* All the timers created, for esp_timer_dump(). */
+   std::list<esp_timer_handle_t> timers;
+};
+
+static esp_timer_svc *esptimersvc = NULL;
+
+/*************************
+ * Task: esp_timer_th()
+ *************************
+ * The esp_timer task. It runs the callbacks of the timers that expired and
+ * then sleeps until the next alarm or until a timer is started.
+ */
+static void esp_timer_th() {
+   esp_timer_handle_t t;
+
+   while(true) {
+      /* The timers do not go off while the chip sleeps. The ones that expired
+       * in the meantime run when it wakes up.
+       */
+      while (clockpacer.is_apb_gated()) wait(clockpacer.apb_gate_event());
+
+      while ((t = (esp_timer_handle_t)esptimersvc->alarms.nextdue())
+            != NULL) {
+         /* Periodic timers go again from when they should have gone off, so
+          * they do not drift.
+          */
+         if (t->period > 0) esptimersvc->alarms.again(t,
+            t->alarm + sc_time((double)t->period, SC_US));
+         else t->active = false;
+         t->callback(t->arg);
+      }
+
+      esptimersvc->alarms.waitnext(clockpacer.apb_gate_event());
+   }
+}
+
+esp_err_t esp_timer_init() {
+   if (esptimersvc == NULL) {
+      esptimersvc = new esp_timer_svc;
+      sc_spawn(&esp_timer_th, "esp_timer");
+   }
+   else if (esptimersvc->initialized) return ESP_ERR_INVALID_STATE;
+   esptimersvc->initialized = true;
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_deinit() {
+   /* Like the IDF, it can only be taken down once all the timers were
+    * deleted. The thread stays, idle, for the next esp_timer_init().
+    */
+   if (esptimersvc == NULL || !esptimersvc->initialized
+         || !esptimersvc->timers.empty()) return ESP_ERR_INVALID_STATE;
+   esptimersvc->initialized = false;
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args,
+      esp_timer_handle_t* out_handle) {
+   esp_timer_handle_t t;
+
+   if (create_args == NULL || create_args->callback == NULL
+         || out_handle == NULL) return ESP_ERR_INVALID_ARG;
+   /* The startup code is not run in the model, so we start the service with
+    * the first timer.
+    */
+   if (esptimersvc == NULL || !esptimersvc->initialized) esp_timer_init();
+
+   t = new esp_timer;
+   t->callback = create_args->callback;
+   t->arg = create_args->arg;
+   t->name = create_args->name;
+   t->period = 0;
+   esptimersvc->timers.push_back(t);
+   *out_handle = t;
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+   if (timer == NULL || timer->deleted) return ESP_ERR_INVALID_ARG;
+   if (timer->active) return ESP_ERR_INVALID_STATE;
+   timer->period = 0;
+   esptimersvc->alarms.start(timer,
+      sc_time_stamp() + sc_time((double)timeout_us, SC_US));
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+   if (timer == NULL || timer->deleted || period == 0)
+      return ESP_ERR_INVALID_ARG;
+   if (timer->active) return ESP_ERR_INVALID_STATE;
+   timer->period = period;
+   esptimersvc->alarms.start(timer,
+      sc_time_stamp() + sc_time((double)period, SC_US));
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+   if (timer == NULL || timer->deleted) return ESP_ERR_INVALID_ARG;
+   if (!timer->active) return ESP_ERR_INVALID_STATE;
+   esptimersvc->alarms.stop(timer);
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+   if (timer == NULL || timer->deleted) return ESP_ERR_INVALID_ARG;
+   if (timer->active) return ESP_ERR_INVALID_STATE;
+   esptimersvc->timers.remove(timer);
+   esptimersvc->alarms.release(timer);
+   return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+   return (int64_t)(sc_time_stamp().value() /
+      sc_time(1, SC_US).value());
+}
+
+int64_t esp_timer_get_next_alarm() {
+   std::list<esp_timer_handle_t>::iterator it;
+   deadline d;
+
+   if (esptimersvc == NULL) return INT64_MAX;
+   for(it = esptimersvc->timers.begin(); it != esptimersvc->timers.end();
+         it++)
+      if ((*it)->active) d.add((*it)->alarm);
+   if (!d.found) return INT64_MAX;
+   return (int64_t)(d.next.value() / sc_time(1, SC_US).value());
+}
+
+esp_err_t esp_timer_dump(FILE* stream) {
+   std::list<esp_timer_handle_t>::iterator it;
+   esp_timer_handle_t t;
+
+   if (esptimersvc == NULL) return ESP_OK;
+   for(it = esptimersvc->timers.begin(); it != esptimersvc->timers.end();
+         it++) {
+      t = *it;
+      fprintf(stream, "%-12s  %12llu  %12lld\n",
+         (t->name == NULL)?"timer":t->name, (unsigned long long)t->period,
+         (t->active)?(long long)(t->alarm.value() /
+            sc_time(1, SC_US).value()):0LL);
+   }
+   return ESP_OK;
+}
+
+void espm_timer_reset() {
+   std::list<esp_timer_handle_t>::iterator it;
+
+   /* The timers are only stopped. The heap entries left are skipped as the
+    * generation changed.
+    */
+   if (esptimersvc == NULL) return;
+   for(it = esptimersvc->timers.begin(); it != esptimersvc->timers.end();
+         it++)
+      esptimersvc->alarms.stop(*it);
+}
+
+/* The Arduino CPU frequency change calls this to change the esp_timer
+ * divider. Our time base is the simulation time, so there is nothing to do.
+ */
+void esp_timer_impl_update_apb_freq(uint32_t apb_ticks_per_us) {
+}
@@ -33,6 +33,11 @@ extern "C" {
  */
 void espm_abort();
 
+/* Prints the tasks and what each CPU is running. The model has no stacks to
+ * walk, so this is what the watchdogs give in place of a backtrace.
+ */
+void espm_print_tasks();
+
 #ifdef __cplusplus
 }
 #endif
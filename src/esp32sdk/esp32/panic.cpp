@@ -79,6 +79,22 @@ void espm_abort()
     invoke_abort();
 }
 
+void espm_print_tasks()
+{
+    char *buffer;
+    int c;
+
+    for (c = 0; c < portNUM_PROCESSORS; c = c + 1) {
+        printf("CPU %d: %s\n", c,
+            pcTaskGetTaskName(xTaskGetCurrentTaskHandleForCPU(c)));
+    }
+    /* vTaskList() takes less than 64 bytes per task. */
+    buffer = new char[uxTaskGetNumberOfTasks() * 64 + 1];
+    vTaskList(buffer);
+    printf("Task            \tState\tPrio\tStack\tNum\tCore\n%s", buffer);
+    delete[] buffer;
+}
+
 /*
   This disables all the watchdogs for when we call the gdbstub.
 */
@@ -34,6 +34,7 @@
 #include "info.h"
 #include "rom/rtc.h"
 #include "ctrlregs.h"
+#include "clockpacer.h"
 
 RESET_REASON rtc_get_reset_reason(int cpu_no) {
    switch(cpu_no) {
@@ -47,8 +48,7 @@ RESET_REASON rtc_get_reset_reason(int cpu_no) {
 }
 
 WAKEUP_REASON rtc_get_wakeup_cause(void) {
-   /* Not yet supported by the model. */
-   return NO_SLEEP;
+   return (WAKEUP_REASON)ctrlregsptr->wakeup_cause;
 }
 
 uint32_t calc_rtc_memory_crc(uint32_t start_addr, uint32_t crc_len) {
@@ -63,7 +63,7 @@ void set_rtc_memory_crc() {
 void software_reset() {
    ctrlregsptr->cpu0_reset_reason = SW_RESET;
    ctrlregsptr->cpu1_reset_reason = SW_RESET;
-   ctrlregsptr->return_to_start = true;
+   espm_return_to_start();
 }
 
 void software_reset_cpu(int cpu_no) {
@@ -76,5 +76,18 @@ void software_reset_cpu(int cpu_no) {
       return;
    }
 
-   ctrlregsptr->return_to_start = true;
+   espm_return_to_start();
+}
+
+void espm_return_to_start() {
+   sc_process_handle me = sc_get_current_process_handle();
+
+   /* If we are in the firmware thread, we unwind it back to setup(). */
+   if (me == ctrlregsptr->dut) throw espm_restart_ex();
+
+   /* If not, the firmware thread gets the exception the next time it runs
+    * and the task that called us is done.
+    */
+   ctrlregsptr->dut.throw_it(espm_restart_ex());
+   if (clockpacer.is_thread()) me.kill();
 }
@@ -0,0 +1,303 @@
+/*******************************************************************************
+ * event_groups.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This file reimplements the FreeRTOS event groups for the ESPMOD SystemC
+ *   model. Each group keeps its bits and the list of the tasks waiting on
+ *   it. Setting bits checks each waiting task's condition, so the tasks
+ *   whose bits did not come are not woken up, and clears the bits asked to
+ *   be cleared on exit only after all waiting tasks were checked.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file was based off the work covered by the license below:
+ *    FreeRTOS V8.2.0 - Copyright (C) 2015 Real Time Engineers Ltd.
+ *    All rights reserved
+ *
+ *   FreeRTOS is free software; you can redistribute it and/or modify it under
+ *   the terms of the GNU General Public License (version 2) as published by the
+ *   Free Software Foundation >>!AND MODIFIED BY!<< the FreeRTOS exception.
+ *
+ *   FreeRTOS is distributed in the hope that it will be useful, but WITHOUT ANY
+ *   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *   FOR A PARTICULAR PURPOSE.  Full license text is available on the following
+ *   link: http://www.freertos.org/a00114.html
+ */
+
+#include <systemc.h>
+#include <list>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "event_groups.h"
+#include "rtostime.h"
+#include "rtossched.h"
+
+/* Only the lower 24 bits can be used, like in FreeRTOS. */
+#define EGBITS 0x00ffffffU
+
+struct gn_eventgroup;
+
+struct gn_egwaiter {
+   EventBits_t mask;
+   bool waitall;
+   bool clear;
+   bool done;
+   EventBits_t result;
+   gn_eventgroup *eg;
+};
+
+struct gn_eventgroup {
+   EventBits_t bits;
+   std::list<gn_egwaiter *> waiters;
+   sc_event change_ev;
+   /* Tasks inside egwait(), released or not. */
+   int nwait;
+   bool deleted;
+   UBaseType_t number;
+};
+
+static UBaseType_t egcount = 0;
+
+/*************************
+ * Function: egmatch()
+ *************************
+ * Checks if the bits satisfy what a task is waiting for.
+ */
+static bool egmatch(EventBits_t bits, EventBits_t mask, bool waitall) {
+   if (waitall) return (bits & mask) == mask;
+   else return (bits & mask) != 0;
+}
+
+/*************************
+ * Function: egleave()
+ *************************
+ * Takes a waiter out of the group. If the group was deleted while we waited,
+ * the last one out frees it.
+ */
+static void egleave(gn_eventgroup *eg, gn_egwaiter *w) {
+   if (!w->done) eg->waiters.remove(w);
+   eg->nwait = eg->nwait - 1;
+   if (eg->deleted && eg->nwait == 0) delete eg;
+}
+
+/* The waiter is in the stack of the task, so if the task is killed while it
+ * waits we have to take it out of the group.
+ */
+static void egunlink(void *arg) {
+   gn_egwaiter *w = (gn_egwaiter *)arg;
+   egleave(w->eg, w);
+}
+
+/*************************
+ * Function: egwait()
+ *************************
+ * Blocks the calling task until its condition is met or it times out. It
+ * returns the bits the group had when the task was released, or the current
+ * bits if it timed out.
+ */
+static EventBits_t egwait(gn_eventgroup *eg, gn_egwaiter *w,
+      TickType_t ticks, const sc_time &start) {
+   EventBits_t ret;
+
+   w->eg = eg;
+   eg->waiters.push_back(w);
+   eg->nwait = eg->nwait + 1;
+   rtosblock(&egunlink, w);
+   while (!w->done && rtoswait(eg->change_ev, ticks, start)) {}
+   rtosunblock();
+
+   if (w->done) ret = w->result;
+   else ret = eg->bits;
+   egleave(eg, w);
+   return ret;
+}
+
+EventGroupHandle_t xEventGroupCreate( void ) {
+   gn_eventgroup *eg = new gn_eventgroup;
+   eg->bits = 0;
+   eg->nwait = 0;
+   eg->deleted = false;
+   eg->number = egcount;
+   egcount = egcount + 1;
+   return (EventGroupHandle_t)eg;
+}
+
+void vEventGroupDelete( EventGroupHandle_t xEventGroup ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   std::list<gn_egwaiter *>::iterator it;
+
+   if (eg == NULL) return;
+   if (eg->nwait == 0) {
+      delete eg;
+      return;
+   }
+
+   /* Any tasks still waiting are released with 0. */
+   for(it = eg->waiters.begin(); it != eg->waiters.end(); it++) {
+      (*it)->result = 0;
+      (*it)->done = true;
+   }
+   eg->waiters.clear();
+   eg->deleted = true;
+   eg->change_ev.notify();
+}
+
+EventBits_t xEventGroupWaitBits( EventGroupHandle_t xEventGroup,
+      const EventBits_t uxBitsToWaitFor, const BaseType_t xClearOnExit,
+      const BaseType_t xWaitForAllBits, TickType_t xTicksToWait ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   gn_egwaiter w;
+   EventBits_t ret;
+
+   if (eg == NULL || (uxBitsToWaitFor & EGBITS) == 0) return 0;
+
+   /* If the bits are already there, we do not need to wait. */
+   ret = eg->bits;
+   if (egmatch(ret, uxBitsToWaitFor, xWaitForAllBits != pdFALSE)) {
+      if (xClearOnExit != pdFALSE)
+         eg->bits = eg->bits & ~uxBitsToWaitFor;
+      return ret;
+   }
+   if (xTicksToWait == 0) return ret;
+
+   w.mask = uxBitsToWaitFor & EGBITS;
+   w.waitall = (xWaitForAllBits != pdFALSE);
+   w.clear = (xClearOnExit != pdFALSE);
+   w.done = false;
+   w.result = 0;
+   return egwait(eg, &w, xTicksToWait, sc_time_stamp());
+}
+
+EventBits_t xEventGroupClearBits( EventGroupHandle_t xEventGroup,
+      const EventBits_t uxBitsToClear ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   EventBits_t ret;
+
+   if (eg == NULL) return 0;
+   ret = eg->bits;
+   eg->bits = eg->bits & ~(uxBitsToClear & EGBITS);
+   return ret;
+}
+
+EventBits_t xEventGroupSetBits( EventGroupHandle_t xEventGroup,
+      const EventBits_t uxBitsToSet ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   std::list<gn_egwaiter *>::iterator it;
+   EventBits_t toclear, ret;
+   bool woken;
+
+   if (eg == NULL) return 0;
+   eg->bits = eg->bits | (uxBitsToSet & EGBITS);
+
+   /* We release everyone whose condition is met, and only then clear the
+    * bits they asked to be cleared, so they all see the same bits.
+    */
+   toclear = 0;
+   woken = false;
+   it = eg->waiters.begin();
+   while (it != eg->waiters.end()) {
+      if (egmatch(eg->bits, (*it)->mask, (*it)->waitall)) {
+         (*it)->result = eg->bits;
+         (*it)->done = true;
+         if ((*it)->clear) toclear = toclear | (*it)->mask;
+         it = eg->waiters.erase(it);
+         woken = true;
+      }
+      else it++;
+   }
+   if (woken) eg->change_ev.notify();
+
+   /* The bits returned are the ones left after the waiting tasks cleared
+    * theirs.
+    */
+   eg->bits = eg->bits & ~toclear;
+   ret = eg->bits;
+   return ret;
+}
+
+EventBits_t xEventGroupSync( EventGroupHandle_t xEventGroup,
+      const EventBits_t uxBitsToSet, const EventBits_t uxBitsToWaitFor,
+      TickType_t xTicksToWait ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   gn_egwaiter w;
+   EventBits_t ret;
+
+   if (eg == NULL) return 0;
+
+   /* We set our bits, and if that completes the rendezvous, we clear them
+    * and go.
+    */
+   ret = eg->bits | (uxBitsToSet & EGBITS);
+   xEventGroupSetBits(xEventGroup, uxBitsToSet);
+   if ((ret & uxBitsToWaitFor) == uxBitsToWaitFor) {
+      eg->bits = eg->bits & ~uxBitsToWaitFor;
+      return ret;
+   }
+   if (xTicksToWait == 0) return eg->bits;
+
+   w.mask = uxBitsToWaitFor & EGBITS;
+   w.waitall = true;
+   w.clear = true;
+   w.done = false;
+   w.result = 0;
+   return egwait(eg, &w, xTicksToWait, sc_time_stamp());
+}
+
+EventBits_t xEventGroupGetBitsFromISR( EventGroupHandle_t xEventGroup ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   if (eg == NULL) return 0;
+   return eg->bits;
+}
+
+/*************************
+ * ISR Calls
+ *************************
+ * In FreeRTOS these get deferred to the timer service task. Here we do not
+ * need it, setting the bits never blocks, so we do it right away.
+ */
+BaseType_t xEventGroupSetBitsFromISR( EventGroupHandle_t xEventGroup,
+      const EventBits_t uxBitsToSet, BaseType_t *pxHigherPriorityTaskWoken ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   size_t waiting;
+
+   if (eg == NULL) return pdFAIL;
+   waiting = eg->waiters.size();
+   xEventGroupSetBits(xEventGroup, uxBitsToSet);
+   if (eg->waiters.size() != waiting && pxHigherPriorityTaskWoken != NULL)
+      *pxHigherPriorityTaskWoken = pdTRUE;
+   return pdPASS;
+}
+
+BaseType_t xEventGroupClearBitsFromISR( EventGroupHandle_t xEventGroup,
+      const EventBits_t uxBitsToSet ) {
+   if (xEventGroup == NULL) return pdFAIL;
+   xEventGroupClearBits(xEventGroup, uxBitsToSet);
+   return pdPASS;
+}
+
+void vEventGroupSetBitsCallback( void *pvEventGroup,
+      const uint32_t ulBitsToSet ) {
+   xEventGroupSetBits((EventGroupHandle_t)pvEventGroup, ulBitsToSet);
+}
+
+void vEventGroupClearBitsCallback( void *pvEventGroup,
+      const uint32_t ulBitsToClear ) {
+   xEventGroupClearBits((EventGroupHandle_t)pvEventGroup, ulBitsToClear);
+}
+
+UBaseType_t uxEventGroupGetNumber( void* xEventGroup ) {
+   gn_eventgroup *eg = (gn_eventgroup *)xEventGroup;
+   if (eg == NULL) return 0;
+   return eg->number;
+}
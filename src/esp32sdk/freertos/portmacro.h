@@ -49,6 +49,7 @@ typedef unsigned int UBaseType_t;
 #define portNUM_CONFIGURABLE_REGIONS 1
 #define portTICK_PERIOD_MS (1000/configTICK_RATE_HZ)
 /* This is not quite it but will work for now. */
+#define portYIELD() yield()
 #define portYIELD_FROM_ISR() yield()
 
 /* These were changed to call SystemC semaphores. The semaphore should
@@ -63,11 +64,16 @@ typedef unsigned int UBaseType_t;
 #define portENTER_CRITICAL_ISR(mux) (mux)->trywait()
 #define portEXIT_CRITICAL_ISR(mux) (mux)->post()
 
-/* We do not really have a system to report which is the CPU in the simulation.
- * Therefore for now we just return always cpu zero. Maybe in the future we
- * could set some parameter for spawned processes to carry foreward. So we
- * always return the app cpu.
+/* The core is the one the calling task is running on or is pinned to. Any
+ * other thread is taken to be on the app cpu, where the Arduino loop runs.
+ * See task.cpp.
  */
-static inline uint32_t xPortGetCoreID() { return 1; }
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint32_t xPortGetCoreID();
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,415 @@
+/*******************************************************************************
+ * queue.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is an adaptation of the FreeRTOS queues to SystemC. See queue.h.
+ *******************************************************************************
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * This file was based off the work covered by the license below:
+ *  FreeRTOS V8.2.0 - Copyright (C) 2015 Real Time Engineers Ltd.
+ *  All rights reserved
+ *
+ *  VISIT http://www.FreeRTOS.org TO ENSURE YOU ARE USING THE LATEST VERSION.
+ *
+ *  This file is part of the FreeRTOS distribution.
+ *
+ *  FreeRTOS is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License (version 2) as published by the
+ *  Free Software Foundation >>!AND MODIFIED BY!<< the FreeRTOS exception.
+ *
+ *  ***************************************************************************
+ *  >>!   NOTE: The modification to the GPL is included to allow you to     !<<
+ *  >>!   distribute a combined work that includes FreeRTOS without being   !<<
+ *  >>!   obliged to provide the source code for proprietary components     !<<
+ *  >>!   outside of the FreeRTOS kernel.                                   !<<
+ *  ***************************************************************************
+ *
+ *  FreeRTOS is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  Full license text is available on the following
+ *  link: http://www.freertos.org/a00114.html
+ *
+ *  ***************************************************************************
+ *   *                                                                       *
+ *   *    FreeRTOS provides completely free yet professionally developed,    *
+ *   *    robust, strictly quality controlled, supported, and cross          *
+ *   *    platform software that is more than just the market leader, it     *
+ *   *    is the industry's de facto standard.                               *
+ *   *                                                                       *
+ *   *    Help yourself get started quickly while simultaneously helping     *
+ *   *    to support the FreeRTOS project by purchasing a FreeRTOS           *
+ *   *    tutorial book, reference manual, or both:                          *
+ *   *    http://www.FreeRTOS.org/Documentation                              *
+ *   *                                                                       *
+ *  ***************************************************************************
+ *
+ *  http://www.FreeRTOS.org/FAQHelp.html - Having a problem?  Start by reading
+ *  the FAQ page "My application does not run, what could be wrong?".  Have you
+ *  defined configASSERT()?
+ *
+ *  http://www.FreeRTOS.org/support - In return for receiving this top quality
+ *  embedded software for free we request you assist our global community by
+ *  participating in the support forum.
+ *
+ *  http://www.FreeRTOS.org/training - Investing in training allows your team to
+ *  be as productive as possible as early as possible.  Now you can receive
+ *  FreeRTOS training directly from Richard Barry, CEO of Real Time Engineers
+ *  Ltd, and the world's leading authority on the world's leading RTOS.
+ *
+ *  http://www.FreeRTOS.org/plus - A selection of FreeRTOS ecosystem products,
+ *  including FreeRTOS+Trace - an indispensable productivity tool, a DOS
+ *  compatible FAT file system, and our tiny thread aware UDP/IP stack.
+ *
+ *  http://www.FreeRTOS.org/labs - Where new FreeRTOS products go to incubate.
+ *  Come and try FreeRTOS+TCP, our new open source TCP/IP stack for FreeRTOS.
+ *
+ *  http://www.OpenRTOS.com - Real Time Engineers ltd. license FreeRTOS to High
+ *  Integrity Systems ltd. to sell under the OpenRTOS brand.  Low cost OpenRTOS
+ *  licenses offer ticketed support, indemnification and commercial middleware.
+ *
+ *  http://www.SafeRTOS.com - High Integrity Systems also provide a safety
+ *  engineered and independently SIL3 certified version for use in safety and
+ *  mission critical applications that require provable dependability.
+ */
+
+#include <systemc.h>
+#include <string.h>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/portmacro.h"
+#include "freertos/queue.h"
+#include "freertos/rtostime.h"
+#include "freertos/rtossched.h"
+#include "info.h"
+
+/* The queue is kept in a ring buffer of uxQueueLength slots. Two events tell
+ * the blocked tasks that something changed, one when an item comes in and
+ * the other when one goes out.
+ */
+struct gn_queue {
+   UBaseType_t length;
+   UBaseType_t itemsize;
+   std::vector<uint8_t> buf;
+   UBaseType_t head;
+   UBaseType_t count;
+   sc_event datain_ev;
+   sc_event dataout_ev;
+   /* Number of tasks blocked on each side. */
+   int waitrx;
+   int waittx;
+   /* The set this queue belongs to, if any. */
+   gn_queue *set;
+   const char *name;
+   /* Deleted with tasks blocked on it, the last one out frees it. */
+   bool deleted;
+};
+
+/*************************
+ * Function: put()
+ *************************
+ * Copies an item into the queue. There must be room for it, unless it is an
+ * overwrite.
+ */
+static void put(gn_queue *q, const void *item, BaseType_t pos) {
+   UBaseType_t slot;
+   bool replaced;
+
+   /* An overwrite takes the place of the newest item. */
+   replaced = (pos == queueOVERWRITE && q->count >= q->length);
+   if (replaced) q->count = q->length - 1;
+
+   if (pos == queueSEND_TO_FRONT) {
+      q->head = (q->head + q->length - 1) % q->length;
+      slot = q->head;
+   }
+   else slot = (q->head + q->count) % q->length;
+   if (q->itemsize > 0 && item != NULL)
+      memcpy(&q->buf[slot * q->itemsize], item, q->itemsize);
+   q->count = q->count + 1;
+   q->datain_ev.notify();
+
+   /* If the queue is in a set, we tell the set it has something. An item
+    * that replaced another one is not new, so the set already knows.
+    */
+   if (q->set != NULL && !replaced) {
+      if (q->set->count >= q->set->length) {
+         PRINTF_WARN("QUEUE", "Queue set is full, an event was lost");
+      }
+      else put(q->set, &q, queueSEND_TO_BACK);
+   }
+}
+
+/*************************
+ * Function: get()
+ *************************
+ * Copies the oldest item out of the queue and, unless peeking, removes it.
+ * There must be an item in the queue.
+ */
+static void get(gn_queue *q, void *buffer, bool peek) {
+   if (q->itemsize > 0 && buffer != NULL)
+      memcpy(buffer, &q->buf[q->head * q->itemsize], q->itemsize);
+   if (peek) return;
+   q->head = (q->head + 1) % q->length;
+   q->count = q->count - 1;
+   q->dataout_ev.notify();
+}
+
+/* Frees a deleted queue once no task is blocked on it. */
+static void qdone(gn_queue *q) {
+   if (q->deleted && q->waitrx == 0 && q->waittx == 0) delete q;
+}
+
+/* If a blocked task is killed, it is no longer waiting on the queue. */
+static void unlinktx(void *arg) {
+   gn_queue *q = (gn_queue *)arg;
+   q->waittx = q->waittx - 1;
+   qdone(q);
+}
+
+static void unlinkrx(void *arg) {
+   gn_queue *q = (gn_queue *)arg;
+   q->waitrx = q->waitrx - 1;
+   qdone(q);
+}
+
+QueueHandle_t xQueueGenericCreate( const UBaseType_t uxQueueLength,
+      const UBaseType_t uxItemSize, const uint8_t ucQueueType ) {
+   gn_queue *q;
+
+   if (uxQueueLength == 0) return NULL;
+   q = new gn_queue;
+   q->length = uxQueueLength;
+   q->itemsize = uxItemSize;
+   q->buf.assign(uxQueueLength * uxItemSize, 0);
+   q->head = 0;
+   q->count = 0;
+   q->waitrx = 0;
+   q->waittx = 0;
+   q->set = NULL;
+   q->name = NULL;
+   q->deleted = false;
+   return (QueueHandle_t)q;
+}
+
+void vQueueDelete( QueueHandle_t xQueue ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   if (q == NULL) return;
+   if (q->waitrx == 0 && q->waittx == 0) {
+      delete q;
+      return;
+   }
+
+   /* The tasks blocked on it are woken up and fail. */
+   PRINTF_WARN("QUEUE", "Deleting a queue with tasks blocked on it");
+   q->deleted = true;
+   q->datain_ev.notify();
+   q->dataout_ev.notify();
+}
+
+BaseType_t xQueueGenericReset( QueueHandle_t xQueue, BaseType_t xNewQueue ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   if (q == NULL) return pdFAIL;
+   q->head = 0;
+   q->count = 0;
+   /* Anyone waiting to send can now go. */
+   q->dataout_ev.notify();
+   return pdPASS;
+}
+
+/*************************
+ * Task: xQueueGenericSend()
+ *************************
+ * Puts an item in the queue, blocking while the queue is full.
+ */
+BaseType_t xQueueGenericSend( QueueHandle_t xQueue,
+      const void * const pvItemToQueue, TickType_t xTicksToWait,
+      const BaseType_t xCopyPosition ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   sc_time start;
+   bool ok;
+
+   if (q == NULL) return pdFAIL;
+   start = sc_time_stamp();
+   while (q->count >= q->length && xCopyPosition != queueOVERWRITE) {
+      q->waittx = q->waittx + 1;
+      rtosblock(&unlinktx, q);
+      ok = rtoswait(q->dataout_ev, xTicksToWait, start);
+      rtosunblock();
+      q->waittx = q->waittx - 1;
+      if (q->deleted) {
+         qdone(q);
+         return errQUEUE_FULL;
+      }
+      if (!ok) return errQUEUE_FULL;
+   }
+   put(q, pvItemToQueue, xCopyPosition);
+   return pdPASS;
+}
+
+BaseType_t xQueueGenericSendFromISR( QueueHandle_t xQueue,
+      const void * const pvItemToQueue,
+      BaseType_t * const pxHigherPriorityTaskWoken,
+      const BaseType_t xCopyPosition ) {
+   gn_queue *q = (gn_queue *)xQueue;
+
+   if (q == NULL) return pdFAIL;
+   if (q->count >= q->length && xCopyPosition != queueOVERWRITE)
+      return errQUEUE_FULL;
+   put(q, pvItemToQueue, xCopyPosition);
+   if (pxHigherPriorityTaskWoken != NULL && q->waitrx > 0)
+      *pxHigherPriorityTaskWoken = pdTRUE;
+   return pdPASS;
+}
+
+/*************************
+ * Task: xQueueGenericReceive()
+ *************************
+ * Takes, or just copies if peeking, the oldest item in the queue, blocking
+ * while the queue is empty.
+ */
+BaseType_t xQueueGenericReceive( QueueHandle_t xQueue, void * const pvBuffer,
+      TickType_t xTicksToWait, const BaseType_t xJustPeek ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   sc_time start;
+   bool ok;
+
+   if (q == NULL) return pdFAIL;
+   start = sc_time_stamp();
+   while (q->count == 0) {
+      q->waitrx = q->waitrx + 1;
+      rtosblock(&unlinkrx, q);
+      ok = rtoswait(q->datain_ev, xTicksToWait, start);
+      rtosunblock();
+      q->waitrx = q->waitrx - 1;
+      if (q->deleted) {
+         qdone(q);
+         return errQUEUE_EMPTY;
+      }
+      if (!ok) return errQUEUE_EMPTY;
+   }
+   get(q, pvBuffer, xJustPeek == pdTRUE);
+   return pdPASS;
+}
+
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue, void * const pvBuffer,
+      BaseType_t * const pxHigherPriorityTaskWoken ) {
+   gn_queue *q = (gn_queue *)xQueue;
+
+   if (q == NULL || q->count == 0) return pdFAIL;
+   get(q, pvBuffer, false);
+   if (pxHigherPriorityTaskWoken != NULL && q->waittx > 0)
+      *pxHigherPriorityTaskWoken = pdTRUE;
+   return pdPASS;
+}
+
+BaseType_t xQueuePeekFromISR( QueueHandle_t xQueue, void * const pvBuffer ) {
+   gn_queue *q = (gn_queue *)xQueue;
+
+   if (q == NULL || q->count == 0) return pdFAIL;
+   get(q, pvBuffer, true);
+   return pdPASS;
+}
+
+BaseType_t xQueueIsQueueEmptyFromISR( const QueueHandle_t xQueue ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   if (q == NULL) return pdTRUE;
+   return (q->count == 0)?pdTRUE:pdFALSE;
+}
+
+BaseType_t xQueueIsQueueFullFromISR( const QueueHandle_t xQueue ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   if (q == NULL) return pdFALSE;
+   return (q->count >= q->length)?pdTRUE:pdFALSE;
+}
+
+UBaseType_t uxQueueMessagesWaiting( const QueueHandle_t xQueue ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   if (q == NULL) return 0;
+   return q->count;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR( const QueueHandle_t xQueue ) {
+   return uxQueueMessagesWaiting(xQueue);
+}
+
+UBaseType_t uxQueueSpacesAvailable( const QueueHandle_t xQueue ) {
+   gn_queue *q = (gn_queue *)xQueue;
+   if (q == NULL) return 0;
+   return q->length - q->count;
+}
+
+void vQueueAddToRegistry( QueueHandle_t xQueue, const char *pcName ) {
+   if (xQueue != NULL) ((gn_queue *)xQueue)->name = pcName;
+}
+
+void vQueueUnregisterQueue( QueueHandle_t xQueue ) {
+   if (xQueue != NULL) ((gn_queue *)xQueue)->name = NULL;
+}
+
+const char *pcQueueGetName( QueueHandle_t xQueue ) {
+   if (xQueue == NULL) return NULL;
+   return ((gn_queue *)xQueue)->name;
+}
+
+/*************************
+ * Queue Sets
+ *************************
+ * Like in FreeRTOS, a set is a queue of handles. Each item that goes into a
+ * member queue also puts the member's handle in the set, so selecting is
+ * just a receive on the set.
+ */
+QueueSetHandle_t xQueueCreateSet( const UBaseType_t uxEventQueueLength ) {
+   return xQueueGenericCreate(uxEventQueueLength, sizeof(gn_queue *),
+      queueQUEUE_TYPE_SET);
+}
+
+BaseType_t xQueueAddToSet( QueueSetMemberHandle_t xQueueOrSemaphore,
+      QueueSetHandle_t xQueueSet ) {
+   gn_queue *q = (gn_queue *)xQueueOrSemaphore;
+
+   /* A queue can only be in one set and has to be empty to join it. */
+   if (q == NULL || xQueueSet == NULL) return pdFAIL;
+   if (q->set != NULL || q->count > 0) return pdFAIL;
+   q->set = (gn_queue *)xQueueSet;
+   return pdPASS;
+}
+
+BaseType_t xQueueRemoveFromSet( QueueSetMemberHandle_t xQueueOrSemaphore,
+      QueueSetHandle_t xQueueSet ) {
+   gn_queue *q = (gn_queue *)xQueueOrSemaphore;
+
+   if (q == NULL || q->set != (gn_queue *)xQueueSet) return pdFAIL;
+   if (q->count > 0) return pdFAIL;
+   q->set = NULL;
+   return pdPASS;
+}
+
+QueueSetMemberHandle_t xQueueSelectFromSet( QueueSetHandle_t xQueueSet,
+      const TickType_t xTicksToWait ) {
+   gn_queue *member;
+
+   if (xQueueGenericReceive(xQueueSet, &member, xTicksToWait, pdFALSE)
+         != pdPASS) return NULL;
+   return (QueueSetMemberHandle_t)member;
+}
+
+QueueSetMemberHandle_t xQueueSelectFromSetFromISR(
+      QueueSetHandle_t xQueueSet ) {
+   gn_queue *member;
+
+   if (xQueueReceiveFromISR(xQueueSet, &member, NULL) != pdPASS) return NULL;
+   return (QueueSetMemberHandle_t)member;
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * queue.h -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is an adaptation of the FreeRTOS queue API to SystemC. A task that
+ *   blocks on a queue sleeps on a sc_event until an item or a free slot
+ *   arrives, or until its timeout, so waiting costs no simulation activity.
+ *   This is not a port of FreeRTOS. It just emulates its behavior on the
+ *   ESP32 model.
+ *******************************************************************************
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * This file was based off the work covered by the license below:
+ *  FreeRTOS V8.2.0 - Copyright (C) 2015 Real Time Engineers Ltd.
+ *  All rights reserved
+ *
+ *  VISIT http://www.FreeRTOS.org TO ENSURE YOU ARE USING THE LATEST VERSION.
+ *
+ *  This file is part of the FreeRTOS distribution.
+ *
+ *  FreeRTOS is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License (version 2) as published by the
+ *  Free Software Foundation >>!AND MODIFIED BY!<< the FreeRTOS exception.
+ *
+ *  ***************************************************************************
+ *  >>!   NOTE: The modification to the GPL is included to allow you to     !<<
+ *  >>!   distribute a combined work that includes FreeRTOS without being   !<<
+ *  >>!   obliged to provide the source code for proprietary components     !<<
+ *  >>!   outside of the FreeRTOS kernel.                                   !<<
+ *  ***************************************************************************
+ *
+ *  FreeRTOS is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  Full license text is available on the following
+ *  link: http://www.freertos.org/a00114.html
+ *
+ *  ***************************************************************************
+ *   *                                                                       *
+ *   *    FreeRTOS provides completely free yet professionally developed,    *
+ *   *    robust, strictly quality controlled, supported, and cross          *
+ *   *    platform software that is more than just the market leader, it     *
+ *   *    is the industry's de facto standard.                               *
+ *   *                                                                       *
+ *   *    Help yourself get started quickly while simultaneously helping     *
+ *   *    to support the FreeRTOS project by purchasing a FreeRTOS           *
+ *   *    tutorial book, reference manual, or both:                          *
+ *   *    http://www.FreeRTOS.org/Documentation                              *
+ *   *                                                                       *
+ *  ***************************************************************************
+ *
+ *  http://www.FreeRTOS.org/FAQHelp.html - Having a problem?  Start by reading
+ *  the FAQ page "My application does not run, what could be wrong?".  Have you
+ *  defined configASSERT()?
+ *
+ *  http://www.FreeRTOS.org/support - In return for receiving this top quality
+ *  embedded software for free we request you assist our global community by
+ *  participating in the support forum.
+ *
+ *  http://www.FreeRTOS.org/training - Investing in training allows your team to
+ *  be as productive as possible as early as possible.  Now you can receive
+ *  FreeRTOS training directly from Richard Barry, CEO of Real Time Engineers
+ *  Ltd, and the world's leading authority on the world's leading RTOS.
+ *
+ *  http://www.FreeRTOS.org/plus - A selection of FreeRTOS ecosystem products,
+ *  including FreeRTOS+Trace - an indispensable productivity tool, a DOS
+ *  compatible FAT file system, and our tiny thread aware UDP/IP stack.
+ *
+ *  http://www.FreeRTOS.org/labs - Where new FreeRTOS products go to incubate.
+ *  Come and try FreeRTOS+TCP, our new open source TCP/IP stack for FreeRTOS.
+ *
+ *  http://www.OpenRTOS.com - Real Time Engineers ltd. license FreeRTOS to High
+ *  Integrity Systems ltd. to sell under the OpenRTOS brand.  Low cost OpenRTOS
+ *  licenses offer ticketed support, indemnification and commercial middleware.
+ *
+ *  http://www.SafeRTOS.com - High Integrity Systems also provide a safety
+ *  engineered and independently SIL3 certified version for use in safety and
+ *  mission critical applications that require provable dependability.
+ */
+
+#ifndef INC_QUEUE_H
+#define INC_QUEUE_H
+
+#ifndef INC_FREERTOS_H
+   #error "include FreeRTOS.h" must appear in source files before "include queue.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void * QueueHandle_t;
+typedef void * QueueSetHandle_t;
+typedef void * QueueSetMemberHandle_t;
+
+/* Where xQueueGenericSend() puts the item. */
+#define queueSEND_TO_BACK     ( ( BaseType_t ) 0 )
+#define queueSEND_TO_FRONT    ( ( BaseType_t ) 1 )
+#define queueOVERWRITE        ( ( BaseType_t ) 2 )
+
+/* Queue types */
+#define queueQUEUE_TYPE_BASE                  ( ( uint8_t ) 0U )
+#define queueQUEUE_TYPE_SET                   ( ( uint8_t ) 0U )
+#define queueQUEUE_TYPE_MUTEX                 ( ( uint8_t ) 1U )
+#define queueQUEUE_TYPE_COUNTING_SEMAPHORE    ( ( uint8_t ) 2U )
+#define queueQUEUE_TYPE_BINARY_SEMAPHORE      ( ( uint8_t ) 3U )
+#define queueQUEUE_TYPE_RECURSIVE_MUTEX       ( ( uint8_t ) 4U )
+
+/* Creation and deletion */
+QueueHandle_t xQueueGenericCreate( const UBaseType_t uxQueueLength,
+   const UBaseType_t uxItemSize, const uint8_t ucQueueType );
+#define xQueueCreate( uxQueueLength, uxItemSize ) \
+   xQueueGenericCreate( ( uxQueueLength ), ( uxItemSize ), \
+      ( queueQUEUE_TYPE_BASE ) )
+void vQueueDelete( QueueHandle_t xQueue );
+BaseType_t xQueueGenericReset( QueueHandle_t xQueue, BaseType_t xNewQueue );
+#define xQueueReset( xQueue ) xQueueGenericReset( xQueue, pdFALSE )
+
+/* Sending. These block for up to xTicksToWait if the queue is full. */
+BaseType_t xQueueGenericSend( QueueHandle_t xQueue,
+   const void * const pvItemToQueue, TickType_t xTicksToWait,
+   const BaseType_t xCopyPosition );
+#define xQueueSend( xQueue, pvItemToQueue, xTicksToWait ) \
+   xQueueGenericSend( ( xQueue ), ( pvItemToQueue ), ( xTicksToWait ), \
+      queueSEND_TO_BACK )
+#define xQueueSendToBack( xQueue, pvItemToQueue, xTicksToWait ) \
+   xQueueGenericSend( ( xQueue ), ( pvItemToQueue ), ( xTicksToWait ), \
+      queueSEND_TO_BACK )
+#define xQueueSendToFront( xQueue, pvItemToQueue, xTicksToWait ) \
+   xQueueGenericSend( ( xQueue ), ( pvItemToQueue ), ( xTicksToWait ), \
+      queueSEND_TO_FRONT )
+#define xQueueOverwrite( xQueue, pvItemToQueue ) \
+   xQueueGenericSend( ( xQueue ), ( pvItemToQueue ), 0, queueOVERWRITE )
+
+/* Receiving. These block for up to xTicksToWait if the queue is empty. */
+BaseType_t xQueueGenericReceive( QueueHandle_t xQueue,
+   void * const pvBuffer, TickType_t xTicksToWait,
+   const BaseType_t xJustPeek );
+#define xQueueReceive( xQueue, pvBuffer, xTicksToWait ) \
+   xQueueGenericReceive( ( xQueue ), ( pvBuffer ), ( xTicksToWait ), pdFALSE )
+#define xQueuePeek( xQueue, pvBuffer, xTicksToWait ) \
+   xQueueGenericReceive( ( xQueue ), ( pvBuffer ), ( xTicksToWait ), pdTRUE )
+
+/* Interrupt versions. They never block. */
+BaseType_t xQueueGenericSendFromISR( QueueHandle_t xQueue,
+   const void * const pvItemToQueue,
+   BaseType_t * const pxHigherPriorityTaskWoken,
+   const BaseType_t xCopyPosition );
+#define xQueueSendFromISR( xQueue, pvItemToQueue, pxHigherPriorityTaskWoken ) \
+   xQueueGenericSendFromISR( ( xQueue ), ( pvItemToQueue ), \
+      ( pxHigherPriorityTaskWoken ), queueSEND_TO_BACK )
+#define xQueueSendToBackFromISR( xQueue, pvItemToQueue, \
+      pxHigherPriorityTaskWoken ) \
+   xQueueGenericSendFromISR( ( xQueue ), ( pvItemToQueue ), \
+      ( pxHigherPriorityTaskWoken ), queueSEND_TO_BACK )
+#define xQueueSendToFrontFromISR( xQueue, pvItemToQueue, \
+      pxHigherPriorityTaskWoken ) \
+   xQueueGenericSendFromISR( ( xQueue ), ( pvItemToQueue ), \
+      ( pxHigherPriorityTaskWoken ), queueSEND_TO_FRONT )
+#define xQueueOverwriteFromISR( xQueue, pvItemToQueue, \
+      pxHigherPriorityTaskWoken ) \
+   xQueueGenericSendFromISR( ( xQueue ), ( pvItemToQueue ), \
+      ( pxHigherPriorityTaskWoken ), queueOVERWRITE )
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue, void * const pvBuffer,
+   BaseType_t * const pxHigherPriorityTaskWoken );
+BaseType_t xQueuePeekFromISR( QueueHandle_t xQueue, void * const pvBuffer );
+BaseType_t xQueueIsQueueEmptyFromISR( const QueueHandle_t xQueue );
+BaseType_t xQueueIsQueueFullFromISR( const QueueHandle_t xQueue );
+
+/* Status */
+UBaseType_t uxQueueMessagesWaiting( const QueueHandle_t xQueue );
+UBaseType_t uxQueueMessagesWaitingFromISR( const QueueHandle_t xQueue );
+UBaseType_t uxQueueSpacesAvailable( const QueueHandle_t xQueue );
+
+/* Registry. It only keeps the name, for debug. */
+void vQueueAddToRegistry( QueueHandle_t xQueue, const char *pcName );
+void vQueueUnregisterQueue( QueueHandle_t xQueue );
+const char *pcQueueGetName( QueueHandle_t xQueue );
+
+/* Queue sets. Only queues made with xQueueCreate() can be members. */
+QueueSetHandle_t xQueueCreateSet( const UBaseType_t uxEventQueueLength );
+BaseType_t xQueueAddToSet( QueueSetMemberHandle_t xQueueOrSemaphore,
+   QueueSetHandle_t xQueueSet );
+BaseType_t xQueueRemoveFromSet( QueueSetMemberHandle_t xQueueOrSemaphore,
+   QueueSetHandle_t xQueueSet );
+QueueSetMemberHandle_t xQueueSelectFromSet( QueueSetHandle_t xQueueSet,
+   const TickType_t xTicksToWait );
+QueueSetMemberHandle_t xQueueSelectFromSetFromISR(
+   QueueSetHandle_t xQueueSet );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_QUEUE_H */
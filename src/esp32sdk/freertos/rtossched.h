@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * rtossched.h -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Optional scheduler model for the FreeRTOS tasks. With it off, which is
+ *   the default, every task runs as its own SystemC thread at the same time
+ *   as all others. With it on, the ESP32 is taken to have two cores and a
+ *   task must hold a core to do any work. Work is given by annotating the
+ *   code with rtoscompute(), or by yield() which costs one CPU cycle. The
+ *   highest priority ready task gets the core, preempting a lower priority
+ *   one in the middle of its work, and tasks of the same priority take turns
+ *   at each tick. Waiting on a delay, queue, semaphore or event does not
+ *   use the core.
+ *
+ *   Either way, the work time is charged to the task and to its core, and
+ *   is reported by uxTaskGetSystemState() and vTaskGetRunTimeStats().
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _RTOSSCHED_H
+#define _RTOSSCHED_H
+
+#include <systemc.h>
+
+#define RTOS_NUMCORES 2
+
+/* Turns the scheduler model on or off. It can be changed at any time, a
+ * task already doing work finishes it under the old setting.
+ */
+void rtossetsched(bool on);
+bool rtosgetsched();
+
+/* Work done by the calling task. */
+void rtoscompute(const sc_time &t);
+void rtoscomputecycles(unsigned int cycles);
+
+/* Time each core spent doing work since the start. */
+sc_time rtoscorebusy(int core);
+
+/* The idle task of a core runs whenever the core has no work. The hook,
+ * used by the task watchdog, is called each time a core starts or stops
+ * working, that is when its idle task stops or starts running.
+ */
+typedef void (*rtosidlehook_t)(int core, bool idle);
+void rtossetidlehook(rtosidlehook_t hook);
+bool rtosidling(int core);
+
+/* What the calling task is blocked on. A queue or event group that blocks a
+ * task gives a function that takes it back out, which is called if the task
+ * is killed, by vTaskDelete() or a reset, while it waits.
+ */
+typedef void (*rtosunlink_t)(void *arg);
+void rtosblock(rtosunlink_t unlink, void *arg);
+void rtosunblock();
+
+/* While the chip sleeps the CPUs run nothing. The tasks and the timer
+ * service call this each time they wake up, and wait in it until the chip
+ * wakes up too.
+ */
+void rtospark();
+
+/* Model of a chip reset. The tasks made with xTaskCreate are killed and the
+ * software timers are stopped. The calling thread is left running.
+ */
+void rtosreset();
+void rtostimerreset();
+
+#endif
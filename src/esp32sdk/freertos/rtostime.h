@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * rtostime.h -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Conversions between FreeRTOS ticks and SystemC time and timed waits,
+ *   shared by the FreeRTOS adaptations. This is only for the SystemC side,
+ *   the firmware should not need it.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _RTOSTIME_H
+#define _RTOSTIME_H
+
+#include <systemc.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/rtossched.h"
+
+/* Time taken by a number of ticks. */
+static inline sc_time ticktime(TickType_t ticks) {
+   return sc_time((double)ticks * portTICK_PERIOD_MS, SC_MS);
+}
+
+/* Number of whole ticks in a time. */
+static inline TickType_t timeticks(const sc_time &t) {
+   return (TickType_t)(t / sc_time(portTICK_PERIOD_MS, SC_MS));
+}
+
+/* Waits for the event, but not beyond start plus the ticks. It returns false
+ * if there is no time left to wait, so the caller can loop checking its
+ * condition until it is true or we return false.
+ */
+static inline bool rtoswait(sc_event &ev, TickType_t ticks,
+      const sc_time &start) {
+   if (ticks == 0) return false;
+   if (ticks == portMAX_DELAY) {
+      wait(ev);
+      rtospark();
+      return true;
+   }
+   if (sc_time_stamp() >= start + ticktime(ticks)) return false;
+   wait(start + ticktime(ticks) - sc_time_stamp(), ev);
+   rtospark();
+   return true;
+}
+
+#endif
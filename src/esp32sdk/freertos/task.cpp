@@ -35,13 +35,357 @@
 #define SC_INCLUDE_DYNAMIC_PROCESSES
 #include <systemc.h>
 #include "FreeRTOS.h"
+#include <map>
+#include <list>
 #include "task.h"
+#include "rtostime.h"
+#include "rtossched.h"
+#include "clockpacer.h"
 
+/* Task control block. We keep one for each task created and for any other
+ * thread that asks for its handle, like the Arduino loop.
+ */
+struct gn_tcb {
+   const char *name;
+   UBaseType_t priority;
+   BaseType_t core;
+   uint32_t stackdepth;
+   UBaseType_t number;
+   sc_process_handle proc;
+   /* Made by xTaskCreate, so it goes away on a reset. */
+   bool spawned;
+   /* Deleted. We never free a block, so an old handle still reads as
+    * deleted instead of pointing at freed memory.
+    */
+   bool deleted;
+   /* Scheduler state. The task is ready while it waits for a core, and
+    * running while it holds one.
+    */
+   bool ready;
+   unsigned long long seq;
+   int runningon;
+   int computingon;
+   sc_event preempt_ev;
+   sc_time runtime;
+   /* Notifications */
+   uint32_t notifyval;
+   enum {NOTWAITING, WAITING, RECEIVED} notifystate;
+   sc_event notify_ev;
+   /* What the task is blocked on, see rtosblock(). */
+   rtosunlink_t unlink;
+   void *unlinkarg;
+};
+
+static std::map<sc_object *, gn_tcb *> tcbs;
+static UBaseType_t tcbcount = 0;
+
+/* The cores. A core is working while a task holds it, while a task waits
+ * for it or, with the scheduler off, while a task computes on it. When it
+ * is not working its idle task runs.
+ */
+struct gn_core {
+   gn_tcb *running;
+   sc_time busy;
+   int computing;
+   bool working;
+   gn_tcb *idle;
+};
+
+static gn_core cores[RTOS_NUMCORES];
+static std::list<gn_tcb *> readylist;
+static unsigned long long readyseq = 0;
+static bool schedon = false;
+static sc_event sched_ev;
+static rtosidlehook_t idlehook = NULL;
+
+/*************************
+ * Function: newtcb()
+ *************************
+ * Makes a task control block for a process. Without a process, as for the
+ * idle tasks, it gets no number and is not put in the task list.
+ */
+static gn_tcb *newtcb(sc_process_handle proc, const char *name,
+      UBaseType_t priority, BaseType_t core, uint32_t stackdepth) {
+   gn_tcb *tcb = new gn_tcb;
+   tcb->name = name;
+   tcb->priority = priority;
+   tcb->core = core;
+   tcb->stackdepth = stackdepth;
+   tcb->number = 0;
+   tcb->proc = proc;
+   tcb->spawned = false;
+   tcb->deleted = false;
+   tcb->ready = false;
+   tcb->seq = 0;
+   tcb->runningon = -1;
+   tcb->computingon = -1;
+   tcb->runtime = SC_ZERO_TIME;
+   tcb->notifyval = 0;
+   tcb->notifystate = gn_tcb::NOTWAITING;
+   tcb->unlink = NULL;
+   tcb->unlinkarg = NULL;
+   if (proc.valid()) {
+      tcb->number = tcbcount;
+      tcbcount = tcbcount + 1;
+      tcbs[proc.get_process_object()] = tcb;
+   }
+   return tcb;
+}
+
+/*************************
+ * Function: tcbunlink()
+ *************************
+ * Takes a task out of whatever it is blocked on. This has to be done before
+ * the task is killed, as what it left there lives in its stack.
+ */
+static void tcbunlink(gn_tcb *tcb) {
+   rtosunlink_t unlink = tcb->unlink;
+
+   if (unlink == NULL) return;
+   tcb->unlink = NULL;
+   (*unlink)(tcb->unlinkarg);
+}
+
+static gn_tcb *curtcb() {
+   return (gn_tcb *)xTaskGetCurrentTaskHandle();
+}
+
+/*************************
+ * Function: idletcb()
+ *************************
+ * The idle tasks have no thread, the core is idle when it has no work. So
+ * their control blocks are not in the task list and are only made when
+ * someone asks for their handle.
+ */
+static gn_tcb *idletcb(int c) {
+   static const char *names[RTOS_NUMCORES] = {"IDLE0", "IDLE1"};
+
+   if (cores[c].idle == NULL)
+      cores[c].idle = newtcb(sc_process_handle(), names[c], tskIDLE_PRIORITY,
+         c, configIDLE_TASK_STACK_SIZE);
+   return cores[c].idle;
+}
+
+/*************************
+ * Scheduler
+ *************************
+ */
+
+/* Tells if a task may run on a core. */
+static bool canrun(gn_tcb *tcb, int c) {
+   return tcb->core == tskNO_AFFINITY || tcb->core == c;
+}
+
+/* Finds the ready task that should get a core next. Among the same
+ * priority, the one ready the longest goes first.
+ */
+static gn_tcb *bestready(int c) {
+   std::list<gn_tcb *>::iterator it;
+   gn_tcb *best = NULL;
+
+   for(it = readylist.begin(); it != readylist.end(); it++) {
+      if (!canrun(*it, c)) continue;
+      if (best == NULL || (*it)->priority > best->priority
+            || ((*it)->priority == best->priority && (*it)->seq < best->seq))
+         best = *it;
+   }
+   return best;
+}
+
+/*************************
+ * Function: schedpick()
+ *************************
+ * Returns the core a ready task can take now, or -1 if none. If the task
+ * should preempt a lower priority one, the running task is told to let go.
+ */
+static int schedpick(gn_tcb *tcb) {
+   int c;
+   gn_tcb *r;
+
+   for(c = 0; c < RTOS_NUMCORES; c = c + 1)
+      if (cores[c].running == NULL && canrun(tcb, c) && bestready(c) == tcb)
+         return c;
+
+   for(c = 0; c < RTOS_NUMCORES; c = c + 1) {
+      r = cores[c].running;
+      if (r != NULL && canrun(tcb, c) && r->priority < tcb->priority
+            && bestready(c) == tcb) {
+         r->preempt_ev.notify();
+         break;
+      }
+   }
+   return -1;
+}
+
+/*************************
+ * Function: idlecheck()
+ *************************
+ * Looks at which cores are working and tells the idle hook about the ones
+ * that changed.
+ */
+static void idlecheck() {
+   bool w;
+   int c;
+
+   for(c = 0; c < RTOS_NUMCORES; c = c + 1) {
+      w = cores[c].running != NULL || cores[c].computing > 0
+         || bestready(c) != NULL;
+      if (w == cores[c].working) continue;
+      cores[c].working = w;
+      if (idlehook != NULL) (*idlehook)(c, !w);
+   }
+}
+
+static int schedacquire(gn_tcb *tcb) {
+   int c;
+
+   tcb->ready = true;
+   tcb->seq = readyseq;
+   readyseq = readyseq + 1;
+   readylist.push_back(tcb);
+   while ((c = schedpick(tcb)) < 0) wait(sched_ev);
+
+   readylist.remove(tcb);
+   tcb->ready = false;
+   tcb->runningon = c;
+   cores[c].running = tcb;
+   idlecheck();
+   return c;
+}
+
+static void schedrelease(gn_tcb *tcb) {
+   if (tcb->runningon < 0) return;
+   cores[tcb->runningon].running = NULL;
+   tcb->runningon = -1;
+   idlecheck();
+   sched_ev.notify();
+}
+
+void rtosreset() {
+   std::map<sc_object *, gn_tcb *>::iterator it;
+   std::list<gn_tcb *> dead;
+   std::list<gn_tcb *>::iterator dt;
+   sc_process_handle me = sc_get_current_process_handle();
+   int c;
+
+   rtostimerreset();
+
+   /* Nobody holds or waits for a core anymore. */
+   readylist.clear();
+   for(it = tcbs.begin(); it != tcbs.end(); it++) {
+      it->second->ready = false;
+      schedrelease(it->second);
+      if (it->second->spawned && it->second->proc != me)
+         dead.push_back(it->second);
+      /* The caller was thrown out of whatever it was blocked on. */
+      else if (it->second->proc == me) tcbunlink(it->second);
+   }
+
+   /* And the tasks are killed. The other threads, like the one running the
+    * Arduino loop, are left for the caller.
+    */
+   for(dt = dead.begin(); dt != dead.end(); dt++) {
+      tcbunlink(*dt);
+      tcbs.erase((*dt)->proc.get_process_object());
+      if (!(*dt)->proc.terminated()) (*dt)->proc.kill();
+      (*dt)->deleted = true;
+   }
+   for(c = 0; c < RTOS_NUMCORES; c = c + 1) cores[c].computing = 0;
+   idlecheck();
+   sched_ev.notify();
+}
+
+void rtossetsched(bool on) { schedon = on; }
+bool rtosgetsched() { return schedon; }
+
+void rtossetidlehook(rtosidlehook_t hook) { idlehook = hook; }
+
+void rtosblock(rtosunlink_t unlink, void *arg) {
+   gn_tcb *tcb = curtcb();
+   tcb->unlink = unlink;
+   tcb->unlinkarg = arg;
+}
+
+void rtosunblock() {
+   gn_tcb *tcb = curtcb();
+   tcb->unlink = NULL;
+   tcb->unlinkarg = NULL;
+}
+
+void rtospark() {
+   while (clockpacer.is_apb_gated()) wait(clockpacer.apb_gate_event());
+}
+
+bool rtosidling(int core) {
+   if (core < 0 || core >= RTOS_NUMCORES) return false;
+   return !cores[core].working;
+}
+
+sc_time rtoscorebusy(int core) {
+   if (core < 0 || core >= RTOS_NUMCORES) return SC_ZERO_TIME;
+   return cores[core].busy;
+}
+
+/*************************
+ * Function: rtoscompute()
+ *************************
+ * Charges work to the calling task. With the scheduler on, the task only
+ * advances while it holds a core, and gives it up at each tick so tasks of
+ * the same priority can take turns, or sooner if it gets preempted.
+ */
+void rtoscompute(const sc_time &t) {
+   gn_tcb *tcb = curtcb();
+   sc_time left, slice, start, ran;
+   int c;
+
+   rtospark();
+   if (!schedon) {
+      c = (tcb->core == tskNO_AFFINITY)?1:tcb->core;
+      cores[c].computing = cores[c].computing + 1;
+      tcb->computingon = c;
+      idlecheck();
+      wait(t);
+      cores[c].computing = cores[c].computing - 1;
+      tcb->computingon = -1;
+      idlecheck();
+      tcb->runtime = tcb->runtime + t;
+      cores[c].busy = cores[c].busy + t;
+      return;
+   }
+
+   left = t;
+   while (left > SC_ZERO_TIME) {
+      c = schedacquire(tcb);
+      /* The slice runs to the next tick. We work in whole time units, in
+       * seconds the remainder is off by a hair on many ticks.
+       */
+      slice = ticktime(1) - sc_time::from_value(sc_time_stamp().value()
+         % ticktime(1).value());
+      if (slice > left || slice == SC_ZERO_TIME) slice = left;
+      start = sc_time_stamp();
+      wait(slice, tcb->preempt_ev);
+      ran = sc_time_stamp() - start;
+      left = left - ran;
+      tcb->runtime = tcb->runtime + ran;
+      cores[c].busy = cores[c].busy + ran;
+      schedrelease(tcb);
+   }
+}
+
+void rtoscomputecycles(unsigned int cycles) {
+   rtoscompute(clockpacer.get_cpu_period() * cycles);
+}
+
+/*************************
+ * Tasks
+ *************************
+ */
 void vTaskDelay( const TickType_t xTicksToDelay ) {
    /* We set the portTICK_RATE_MS to 1, so the value should be the
     * number in lilliseconds. Perhaps we should change this later.
     */
    wait(xTicksToDelay, SC_MS);
+   rtospark();
 }
 
 BaseType_t xTaskCreatePinnedToCore(	TaskFunction_t pvTaskCode,
@@ -49,11 +393,311 @@ BaseType_t xTaskCreatePinnedToCore(	TaskFunction_t pvTaskCode,
    void * const pvParameters, UBaseType_t uxPriority,
    TaskHandle_t * const pvCreatedTask, const BaseType_t xCoreID)
 {
-   sc_spawn(sc_bind(pvTaskCode, pvParameters));
+   sc_process_handle proc;
+   gn_tcb *tcb;
+
+   if (xCoreID != tskNO_AFFINITY && (xCoreID < 0 || xCoreID >= RTOS_NUMCORES))
+      return pdFAIL;
+   proc = sc_spawn(sc_bind(pvTaskCode, pvParameters));
+   tcb = newtcb(proc, pcName, uxPriority, xCoreID, usStackDepth);
+   tcb->spawned = true;
+   if (pvCreatedTask != NULL) *pvCreatedTask = (TaskHandle_t)tcb;
    return pdTRUE;
 }
 
+TaskHandle_t xTaskGetCurrentTaskHandle( void ) {
+   sc_process_handle proc = sc_get_current_process_handle();
+   std::map<sc_object *, gn_tcb *>::iterator it;
+
+   /* Threads that were not made with xTaskCreate get their control block
+    * the first time they ask for it.
+    */
+   it = tcbs.find(proc.get_process_object());
+   if (it != tcbs.end()) return (TaskHandle_t)it->second;
+   return (TaskHandle_t)newtcb(proc, proc.basename(), 1, tskNO_AFFINITY, 0);
+}
+
+char *pcTaskGetTaskName( TaskHandle_t xTaskToQuery ) {
+   gn_tcb *tcb = (gn_tcb *)xTaskToQuery;
+   if (tcb == NULL) tcb = curtcb();
+   return (char *)tcb->name;
+}
+
 void vTaskDelete( TaskHandle_t xTaskToDelete ) {
+   gn_tcb *tcb = (gn_tcb *)xTaskToDelete;
+   sc_process_handle proc;
+
+   if (tcb == NULL) tcb = curtcb();
+
+   /* We take it out of the scheduler before we kill it. */
+   if (tcb->ready) readylist.remove(tcb);
+   if (tcb->computingon >= 0)
+      cores[tcb->computingon].computing = cores[tcb->computingon].computing-1;
+   tcbunlink(tcb);
+   schedrelease(tcb);
+   idlecheck();
+   sched_ev.notify();
+   tcbs.erase(tcb->proc.get_process_object());
+   proc = tcb->proc;
+   tcb->deleted = true;
+
+   /* If it is the calling task, this does not return. */
+   if (!proc.terminated()) proc.kill();
+}
+
+UBaseType_t uxTaskPriorityGet( TaskHandle_t xTask ) {
+   gn_tcb *tcb = (gn_tcb *)xTask;
+   if (tcb == NULL) tcb = curtcb();
+   return tcb->priority;
+}
+
+UBaseType_t uxTaskPriorityGetFromISR( TaskHandle_t xTask ) {
+   return uxTaskPriorityGet(xTask);
+}
+
+void vTaskPrioritySet( TaskHandle_t xTask, UBaseType_t uxNewPriority ) {
+   gn_tcb *tcb = (gn_tcb *)xTask;
+   if (tcb == NULL) tcb = curtcb();
+   if (uxNewPriority >= configMAX_PRIORITIES)
+      uxNewPriority = configMAX_PRIORITIES - 1;
+   tcb->priority = uxNewPriority;
+   /* The waiting tasks need to look again, one might now preempt. */
+   sched_ev.notify();
+}
+
+eTaskState eTaskGetState( TaskHandle_t xTask ) {
+   gn_tcb *tcb = (gn_tcb *)xTask;
+   if (tcb != NULL && tcb->deleted) return eDeleted;
+   if (tcb == NULL || tcb == curtcb()) return eRunning;
+   /* A task whose function returned without deleting itself. */
+   if (tcb->proc.terminated()) return eDeleted;
+   if (tcb->runningon >= 0) return eRunning;
+   if (tcb->ready) return eReady;
+   return eBlocked;
+}
+
+BaseType_t xTaskGetAffinity( TaskHandle_t xTask ) {
+   gn_tcb *tcb = (gn_tcb *)xTask;
+   if (tcb == NULL) tcb = curtcb();
+   return tcb->core;
 }
 
+uint32_t xPortGetCoreID() {
+   std::map<sc_object *, gn_tcb *>::iterator it;
 
+   /* We do not make a control block here, this is also called from
+    * outside any task.
+    */
+   it = tcbs.find(sc_get_current_process_handle().get_process_object());
+   if (it == tcbs.end()) return 1;
+   if (it->second->runningon >= 0) return it->second->runningon;
+   if (it->second->core != tskNO_AFFINITY) return it->second->core;
+   return 1;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandle( void ) {
+   return xTaskGetIdleTaskHandleForCPU(xPortGetCoreID());
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCPU( UBaseType_t cpuid ) {
+   if (cpuid >= RTOS_NUMCORES) return NULL;
+   return (TaskHandle_t)idletcb(cpuid);
+}
+
+/* Without the scheduler model no task holds a core, so we give the idle. */
+TaskHandle_t xTaskGetCurrentTaskHandleForCPU( BaseType_t cpuid ) {
+   if (cpuid < 0 || cpuid >= RTOS_NUMCORES) return NULL;
+   if (cores[cpuid].running != NULL) return (TaskHandle_t)cores[cpuid].running;
+   return (TaskHandle_t)idletcb(cpuid);
+}
+
+UBaseType_t uxTaskGetNumberOfTasks( void ) {
+   return tcbs.size();
+}
+
+TickType_t xTaskGetTickCount( void ) {
+   return timeticks(sc_time_stamp());
+}
+
+TickType_t xTaskGetTickCountFromISR( void ) {
+   return timeticks(sc_time_stamp());
+}
+
+/*************************
+ * Run Time Stats
+ *************************
+ * The run time counter is in microseconds. We have no stack to measure,
+ * so the high water mark is given as the whole stack.
+ */
+static uint32_t runtimeus(const sc_time &t) {
+   return (uint32_t)(t.to_seconds() * 1e6);
+}
+
+UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray,
+      const UBaseType_t uxArraySize, uint32_t * const pulTotalRunTime ) {
+   std::map<sc_object *, gn_tcb *>::iterator it;
+   UBaseType_t n;
+   gn_tcb *tcb;
+
+   if (uxArraySize < tcbs.size()) return 0;
+   n = 0;
+   for(it = tcbs.begin(); it != tcbs.end(); it++) {
+      tcb = it->second;
+      pxTaskStatusArray[n].xHandle = (TaskHandle_t)tcb;
+      pxTaskStatusArray[n].pcTaskName = tcb->name;
+      pxTaskStatusArray[n].xTaskNumber = tcb->number;
+      pxTaskStatusArray[n].eCurrentState = eTaskGetState((TaskHandle_t)tcb);
+      pxTaskStatusArray[n].uxCurrentPriority = tcb->priority;
+      pxTaskStatusArray[n].uxBasePriority = tcb->priority;
+      pxTaskStatusArray[n].ulRunTimeCounter = runtimeus(tcb->runtime);
+      pxTaskStatusArray[n].pxStackBase = NULL;
+      pxTaskStatusArray[n].usStackHighWaterMark = tcb->stackdepth;
+#if configTASKLIST_INCLUDE_COREID
+      pxTaskStatusArray[n].xCoreID = tcb->core;
+#endif
+      n = n + 1;
+   }
+   if (pulTotalRunTime != NULL)
+      *pulTotalRunTime = runtimeus(sc_time_stamp());
+   return n;
+}
+
+/* One line per task with its run time and its share of the time of both
+ * cores, then a line per core with the idle time.
+ */
+void vTaskGetRunTimeStats( char *pcWriteBuffer ) {
+   std::map<sc_object *, gn_tcb *>::iterator it;
+   double total;
+   int c;
+
+   total = sc_time_stamp().to_seconds() * RTOS_NUMCORES;
+   *pcWriteBuffer = '\0';
+   for(it = tcbs.begin(); it != tcbs.end(); it++) {
+      pcWriteBuffer = pcWriteBuffer + sprintf(pcWriteBuffer,
+         "%-16s\t%10u\t%3u%%\r\n", it->second->name,
+         runtimeus(it->second->runtime), (total == 0.0)?0:
+         (unsigned int)(it->second->runtime.to_seconds() * 100.0 / total));
+   }
+   for(c = 0; c < RTOS_NUMCORES; c = c + 1) {
+      pcWriteBuffer = pcWriteBuffer + sprintf(pcWriteBuffer,
+         "IDLE%-12d\t%10u\t%3u%%\r\n", c,
+         runtimeus(sc_time_stamp() - cores[c].busy), (total == 0.0)?0:
+         (unsigned int)((sc_time_stamp() - cores[c].busy).to_seconds()
+         * 100.0 / total));
+   }
+}
+
+/* One line per task with its state, priority, stack, number and core. We
+ * do not use eTaskGetState() as the caller might not be a task.
+ */
+void vTaskList( char *pcWriteBuffer ) {
+   std::map<sc_object *, gn_tcb *>::iterator it;
+   gn_tcb *tcb;
+   char state;
+
+   *pcWriteBuffer = '\0';
+   for(it = tcbs.begin(); it != tcbs.end(); it++) {
+      tcb = it->second;
+      if (tcb->proc.terminated()) state = 'D';
+      else if (tcb->runningon >= 0 || tcb->computingon >= 0) state = 'X';
+      else if (tcb->ready) state = 'R';
+      else state = 'B';
+      pcWriteBuffer = pcWriteBuffer + sprintf(pcWriteBuffer,
+         "%-16.16s\t%c\t%u\t%u\t%u\t%d\r\n", tcb->name, state,
+         (unsigned int)tcb->priority, (unsigned int)tcb->stackdepth,
+         (unsigned int)tcb->number, (tcb->core == tskNO_AFFINITY)?-1:
+         (int)tcb->core);
+   }
+}
+
+/*************************
+ * Task Notifications
+ *************************
+ * Each task has a notification value and state. A task waiting for a
+ * notification sleeps on its notify_ev.
+ */
+BaseType_t xTaskNotify( TaskHandle_t xTaskToNotify, uint32_t ulValue,
+      eNotifyAction eAction ) {
+   gn_tcb *tcb = (gn_tcb *)xTaskToNotify;
+
+   if (tcb == NULL) return pdFAIL;
+   switch(eAction) {
+      case eSetBits: tcb->notifyval = tcb->notifyval | ulValue; break;
+      case eIncrement: tcb->notifyval = tcb->notifyval + 1; break;
+      case eSetValueWithOverwrite: tcb->notifyval = ulValue; break;
+      case eSetValueWithoutOverwrite:
+         /* If the last one was not taken yet, this one is lost. */
+         if (tcb->notifystate == gn_tcb::RECEIVED) return pdFAIL;
+         tcb->notifyval = ulValue;
+         break;
+      case eNoAction: break;
+   }
+   tcb->notifystate = gn_tcb::RECEIVED;
+   tcb->notify_ev.notify();
+   return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR( TaskHandle_t xTaskToNotify, uint32_t ulValue,
+      eNotifyAction eAction, BaseType_t *pxHigherPriorityTaskWoken ) {
+   gn_tcb *tcb = (gn_tcb *)xTaskToNotify;
+   bool waiting;
+
+   if (tcb == NULL) return pdFAIL;
+   waiting = (tcb->notifystate == gn_tcb::WAITING);
+   if (xTaskNotify(xTaskToNotify, ulValue, eAction) != pdPASS) return pdFAIL;
+   if (waiting && pxHigherPriorityTaskWoken != NULL)
+      *pxHigherPriorityTaskWoken = pdTRUE;
+   return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR( TaskHandle_t xTaskToNotify,
+      BaseType_t *pxHigherPriorityTaskWoken ) {
+   xTaskNotifyFromISR(xTaskToNotify, 0, eIncrement,
+      pxHigherPriorityTaskWoken);
+}
+
+BaseType_t xTaskNotifyWait( uint32_t ulBitsToClearOnEntry,
+      uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue,
+      TickType_t xTicksToWait ) {
+   gn_tcb *tcb = (gn_tcb *)xTaskGetCurrentTaskHandle();
+   sc_time start = sc_time_stamp();
+   BaseType_t ret;
+
+   /* The bits are only cleared on entry if nothing is pending. */
+   if (tcb->notifystate != gn_tcb::RECEIVED) {
+      tcb->notifyval = tcb->notifyval & ~ulBitsToClearOnEntry;
+      tcb->notifystate = gn_tcb::WAITING;
+      while (tcb->notifystate != gn_tcb::RECEIVED
+            && rtoswait(tcb->notify_ev, xTicksToWait, start)) {}
+   }
+
+   if (pulNotificationValue != NULL) *pulNotificationValue = tcb->notifyval;
+   if (tcb->notifystate != gn_tcb::RECEIVED) ret = pdFALSE;
+   else {
+      tcb->notifyval = tcb->notifyval & ~ulBitsToClearOnExit;
+      ret = pdTRUE;
+   }
+   tcb->notifystate = gn_tcb::NOTWAITING;
+   return ret;
+}
+
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit,
+      TickType_t xTicksToWait ) {
+   gn_tcb *tcb = (gn_tcb *)xTaskGetCurrentTaskHandle();
+   sc_time start = sc_time_stamp();
+   uint32_t ret;
+
+   if (tcb->notifyval == 0) {
+      tcb->notifystate = gn_tcb::WAITING;
+      while (tcb->notifyval == 0
+            && rtoswait(tcb->notify_ev, xTicksToWait, start)) {}
+   }
+
+   ret = tcb->notifyval;
+   if (ret != 0) {
+      if (xClearCountOnExit != pdFALSE) tcb->notifyval = 0;
+      else tcb->notifyval = ret - 1;
+   }
+   tcb->notifystate = gn_tcb::NOTWAITING;
+   return ret;
+}
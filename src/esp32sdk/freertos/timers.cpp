@@ -0,0 +1,242 @@
+/*******************************************************************************
+ * timers.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This file reimplements the FreeRTOS software timers for the ESPMOD
+ *   SystemC model. All timers are run by a single timer service thread that
+ *   keeps them in an alarmheap (alarms.h) and sleeps until the first one, so
+ *   a timer costs one wake up per expiry however many there are. The same
+ *   thread runs the functions given to xTimerPendFunctionCall().
+ *
+ *   Unlike FreeRTOS, the timer commands do not go through a queue. They
+ *   change the timer right away and wake up the service thread, so they
+ *   never block.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file was based off the work covered by the license below:
+ *    FreeRTOS V8.2.0 - Copyright (C) 2015 Real Time Engineers Ltd.
+ *    All rights reserved
+ *
+ *   FreeRTOS is free software; you can redistribute it and/or modify it under
+ *   the terms of the GNU General Public License (version 2) as published by the
+ *   Free Software Foundation >>!AND MODIFIED BY!<< the FreeRTOS exception.
+ *
+ *   FreeRTOS is distributed in the hope that it will be useful, but WITHOUT ANY
+ *   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *   FOR A PARTICULAR PURPOSE.  Full license text is available on the following
+ *   link: http://www.freertos.org/a00114.html
+ */
+
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+#include <systemc.h>
+#include <deque>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "rtostime.h"
+#include "rtossched.h"
+#include "alarms.h"
+#include "clockpacer.h"
+#include "info.h"
+
+/* The alarm is when the timer expires. */
+struct gn_timer: alarmtimer {
+   const char *name;
+   TickType_t period;
+   bool autoreload;
+   void *id;
+   TimerCallbackFunction_t callback;
+};
+
+struct gn_pendedcall {
+   PendedFunction_t func;
+   void *param1;
+   uint32_t param2;
+};
+
+struct gn_timersvc {
+   alarmheap alarms;
+   std::deque<gn_pendedcall> pended;
+};
+
+static gn_timersvc *timersvc = NULL;
+
+/*************************
+ * Task: timer_th()
+ *************************
+ * The timer service thread. It runs any pended function calls, then the
+ * callbacks of the timers that expired, and then sleeps until the next
+ * expiry or until a command wakes it up.
+ */
+static void timer_th() {
+   gn_pendedcall p;
+   gn_timer *t;
+
+   while(true) {
+      /* The timers do not go off while the chip sleeps. The ones that expired
+       * in the meantime run when it wakes up.
+       */
+      rtospark();
+
+      while (!timersvc->pended.empty()) {
+         p = timersvc->pended.front();
+         timersvc->pended.pop_front();
+         p.func(p.param1, p.param2);
+      }
+
+      while ((t = (gn_timer *)timersvc->alarms.nextdue()) != NULL) {
+         /* Auto reload timers go again from when they should have expired,
+          * so they do not drift.
+          */
+         if (t->autoreload)
+            timersvc->alarms.again(t, t->alarm + ticktime(t->period));
+         else t->active = false;
+         t->callback((TimerHandle_t)t);
+      }
+
+      if (!timersvc->pended.empty()) continue;
+      timersvc->alarms.waitnext(clockpacer.apb_gate_event());
+   }
+}
+
+BaseType_t xTimerCreateTimerTask( void ) {
+   if (timersvc != NULL) return pdPASS;
+   timersvc = new gn_timersvc;
+   sc_spawn(&timer_th, "timer_svc");
+   return pdPASS;
+}
+
+TimerHandle_t xTimerCreate( const char * const pcTimerName,
+      const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload,
+      void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) {
+   gn_timer *t;
+
+   if (xTimerPeriodInTicks == 0 || pxCallbackFunction == NULL) return NULL;
+   xTimerCreateTimerTask();
+
+   t = new gn_timer;
+   t->name = pcTimerName;
+   t->period = xTimerPeriodInTicks;
+   t->autoreload = (uxAutoReload != pdFALSE);
+   t->id = pvTimerID;
+   t->callback = pxCallbackFunction;
+   return (TimerHandle_t)t;
+}
+
+BaseType_t xTimerGenericCommand( TimerHandle_t xTimer,
+      const BaseType_t xCommandID, const TickType_t xOptionalValue,
+      BaseType_t * const pxHigherPriorityTaskWoken,
+      const TickType_t xTicksToWait ) {
+   gn_timer *t = (gn_timer *)xTimer;
+
+   if (t == NULL || t->deleted) return pdFAIL;
+   switch(xCommandID) {
+      /* The optional value is the tick the command was given at, and the
+       * timer expires a period after it.
+       */
+      case tmrCOMMAND_START:
+      case tmrCOMMAND_START_DONT_TRACE:
+      case tmrCOMMAND_RESET:
+      case tmrCOMMAND_START_FROM_ISR:
+      case tmrCOMMAND_RESET_FROM_ISR:
+         timersvc->alarms.start(t,
+            ticktime(xOptionalValue) + ticktime(t->period));
+         break;
+      case tmrCOMMAND_STOP:
+      case tmrCOMMAND_STOP_FROM_ISR:
+         timersvc->alarms.stop(t);
+         break;
+      /* Changing the period also starts the timer. */
+      case tmrCOMMAND_CHANGE_PERIOD:
+      case tmrCOMMAND_CHANGE_PERIOD_FROM_ISR:
+         if (xOptionalValue == 0) return pdFAIL;
+         t->period = xOptionalValue;
+         timersvc->alarms.start(t,
+            ticktime(xTaskGetTickCount()) + ticktime(t->period));
+         break;
+      case tmrCOMMAND_DELETE:
+         timersvc->alarms.release(t);
+         break;
+      default:
+         PRINTF_WARN("TIMERS", "Unknown timer command %d", xCommandID);
+         return pdFAIL;
+   }
+   return pdPASS;
+}
+
+BaseType_t xTimerPendFunctionCall( PendedFunction_t xFunctionToPend,
+      void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait ) {
+   gn_pendedcall p;
+
+   if (xFunctionToPend == NULL) return pdFAIL;
+   xTimerCreateTimerTask();
+   p.func = xFunctionToPend;
+   p.param1 = pvParameter1;
+   p.param2 = ulParameter2;
+   timersvc->pended.push_back(p);
+   timersvc->alarms.wake_ev.notify();
+   return pdPASS;
+}
+
+BaseType_t xTimerPendFunctionCallFromISR( PendedFunction_t xFunctionToPend,
+      void *pvParameter1, uint32_t ulParameter2,
+      BaseType_t *pxHigherPriorityTaskWoken ) {
+   return xTimerPendFunctionCall(xFunctionToPend, pvParameter1, ulParameter2,
+      0);
+}
+
+void *pvTimerGetTimerID( TimerHandle_t xTimer ) {
+   if (xTimer == NULL) return NULL;
+   return ((gn_timer *)xTimer)->id;
+}
+
+void vTimerSetTimerID( TimerHandle_t xTimer, void *pvNewID ) {
+   if (xTimer != NULL) ((gn_timer *)xTimer)->id = pvNewID;
+}
+
+BaseType_t xTimerIsTimerActive( TimerHandle_t xTimer ) {
+   if (xTimer == NULL) return pdFALSE;
+   return (((gn_timer *)xTimer)->active)?pdTRUE:pdFALSE;
+}
+
+TaskHandle_t xTimerGetTimerDaemonTaskHandle( void ) {
+   /* The service thread is not a task, but we give something that is not
+    * NULL once it is running.
+    */
+   return (TaskHandle_t)timersvc;
+}
+
+TickType_t xTimerGetPeriod( TimerHandle_t xTimer ) {
+   if (xTimer == NULL) return 0;
+   return ((gn_timer *)xTimer)->period;
+}
+
+TickType_t xTimerGetExpiryTime( TimerHandle_t xTimer ) {
+   if (xTimer == NULL) return 0;
+   return timeticks(((gn_timer *)xTimer)->alarm);
+}
+
+const char * pcTimerGetTimerName( TimerHandle_t xTimer ) {
+   if (xTimer == NULL) return NULL;
+   return ((gn_timer *)xTimer)->name;
+}
+
+void rtostimerreset() {
+   /* We empty the heap, stopping every timer in it. The ones that were
+    * deleted and only waited to come out are freed.
+    */
+   if (timersvc == NULL) return;
+   timersvc->pended.clear();
+   timersvc->alarms.clear();
+}
@@ -5,6 +5,12 @@
  *   This file ports several socket functions of the LwIP TCP/IP stack to the
  *   ESPMOD SystemC model. It was based off the functions from the LwIP
  *   TCP/IP stack from the Swedish Institure of Computer Science.
+ *
+ *   When the testbench closes a connection the descriptor is marked closed
+ *   but kept until the firmware closes it too. Once what was left in it is
+ *   read, recv() returns zero with errno set to ENOTCONN, even on a
+ *   non-blocking socket, as LwIP does, so WiFiClient::connected() sees the
+ *   close at once.
  *******************************************************************************
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -1021,6 +1027,14 @@ int __espm_receive(int s, void *mem, size_t len, int flags) {
       return -1;
    }
 
+   /* If the other side of a file descriptor has been closed we return zero
+    * width, but only if there is nothing else in the stream. Like LwIP we
+    * also set ENOTCONN so that WiFiClient::connected() sees it.
+    */
+   if (_fdlist[ind].closed && _fdlist[ind].buffer.size() == 0) {
+      errno = ENOTCONN;
+      return 0;
+   }
    /* We now check the flags. */
    if (((flags & MSG_DONTWAIT) == MSG_DONTWAIT || 
          _fdlist[ind].flags & O_NONBLOCK)
@@ -1033,11 +1047,6 @@ int __espm_receive(int s, void *mem, size_t len, int flags) {
       errno = EOPNOTSUPP;
       return -1;
    }
-   /* If the other side of a file descriptor has been closed we also return
-    * zero width, but only if there is nothing else in the stream. */
-   if (_fdlist[ind].closed && _fdlist[ind].buffer.size() == 0) {
-      return 0;
-   }
 
    /* If we now read until we take in all chars or, if WAITALL was not present,
     * until we have emptied out the buffer.
@@ -1273,9 +1282,12 @@ void fillbuffers() {
           */
          if (escaped == '!') {
             /* If this was a close, we then flush out until the next newline
-             * and then close the port.
+             * and then close the port. The descriptor stays around until the
+             * firmware reads what is left and closes it too.
              */
             while (WiFiSerial.bl_read() != '\n') {}
+            _fdlist[ind].closed = true;
+            __fifowrite_ev.notify();
          }
          else if (escaped == 'y' || escaped == 'n') {
             /* We got a y or n. We then put it in the correct port and flush
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * alarms.cpp -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Helpers for the software services that sleep until a deadline instead of
+ *   polling. See alarms.h.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <systemc.h>
+#include "alarms.h"
+
+void alarmheap::push(alarmtimer *t) {
+   entry e;
+
+   e.alarm = t->alarm;
+   e.seq = seq;
+   e.t = t;
+   e.gen = t->gen;
+   seq = seq + 1;
+   heap.push(e);
+   t->inheap = t->inheap + 1;
+}
+
+void alarmheap::start(alarmtimer *t, const sc_time &when) {
+   t->gen = t->gen + 1;
+   t->active = true;
+   t->alarm = when;
+   push(t);
+   wake_ev.notify();
+}
+
+void alarmheap::again(alarmtimer *t, const sc_time &when) {
+   t->alarm = when;
+   push(t);
+}
+
+void alarmheap::stop(alarmtimer *t) {
+   t->gen = t->gen + 1;
+   t->active = false;
+}
+
+void alarmheap::release(alarmtimer *t) {
+   stop(t);
+   t->deleted = true;
+   if (t->inheap == 0) delete t;
+}
+
+alarmtimer *alarmheap::nextdue() {
+   entry e;
+
+   while (!heap.empty() && heap.top().alarm <= sc_time_stamp()) {
+      e = heap.top();
+      heap.pop();
+      e.t->inheap = e.t->inheap - 1;
+      if (e.t->deleted) {
+         if (e.t->inheap == 0) delete e.t;
+         continue;
+      }
+      if (e.gen != e.t->gen || !e.t->active) continue;
+      return e.t;
+   }
+   return NULL;
+}
+
+void alarmheap::waitnext() {
+   if (heap.empty()) wait(wake_ev);
+   else wait(heap.top().alarm - sc_time_stamp(), wake_ev);
+}
+
+void alarmheap::waitnext(const sc_event &other) {
+   if (heap.empty()) wait(wake_ev | other);
+   else wait(heap.top().alarm - sc_time_stamp(), wake_ev | other);
+}
+
+void alarmheap::clear() {
+   entry e;
+
+   while (!heap.empty()) {
+      e = heap.top();
+      heap.pop();
+      e.t->inheap = e.t->inheap - 1;
+      if (e.t->deleted) {
+         if (e.t->inheap == 0) delete e.t;
+         continue;
+      }
+      e.t->active = false;
+   }
+}
+
+void deadline::arm(sc_event &ev) {
+   ev.cancel();
+   if (!found) return;
+   if (next <= sc_time_stamp()) ev.notify(SC_ZERO_TIME);
+   else ev.notify(next - sc_time_stamp());
+}
@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * alarms.h -- Copyright 2020 Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Helpers for the software services that sleep until a deadline instead of
+ *   polling: the FreeRTOS timers, the esp_timer and the watchdogs.
+ *
+ *   An alarmheap keeps timers in a heap ordered by alarm time. Starting or
+ *   stopping a timer only changes its generation, so the old entries left in
+ *   the heap are skipped as they come out, and a deleted timer is freed once
+ *   its last entry is out. A deadline simply takes the earliest of a few
+ *   times and sets an event for it.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ALARMS_H
+#define _ALARMS_H
+
+#include <systemc.h>
+#include <queue>
+#include <vector>
+
+/* A timer kept in an alarmheap. The services derive their timers from it. */
+struct alarmtimer {
+   bool active;
+   bool deleted;
+   sc_time alarm;
+   unsigned int gen;
+   int inheap;
+   alarmtimer() { active = false; deleted = false; gen = 0; inheap = 0; }
+   virtual ~alarmtimer() {}
+};
+
+class alarmheap {
+   public:
+   alarmheap() { seq = 0; }
+   /* Starts the timer to go off at the given time, dropping any alarm it
+    * already had, and wakes up the service.
+    */
+   void start(alarmtimer *t, const sc_time &when);
+   /* Sets the next alarm of a timer that just went off. */
+   void again(alarmtimer *t, const sc_time &when);
+   void stop(alarmtimer *t);
+   /* Marks the timer deleted. It is freed now or, if it is still in the
+    * heap, once it comes out.
+    */
+   void release(alarmtimer *t);
+   /* Takes out the next timer due by now, or NULL if there is none. The
+    * timer is left active, the caller either stops it or calls again().
+    */
+   alarmtimer *nextdue();
+   /* Sleeps until the next alarm or until a timer is started. */
+   void waitnext();
+   void waitnext(const sc_event &other);
+   /* Empties the heap, stopping all the timers in it. */
+   void clear();
+
+   sc_event wake_ev;
+
+   private:
+   struct entry {
+      sc_time alarm;
+      unsigned long long seq;
+      alarmtimer *t;
+      unsigned int gen;
+      /* The heap is a max-heap, so we turn the comparison around. Timers
+       * with the same alarm go off in the order they were started.
+       */
+      bool operator<(const entry &o) const {
+         if (alarm != o.alarm) return alarm > o.alarm;
+         return seq > o.seq;
+      }
+   };
+   std::priority_queue<entry> heap;
+   unsigned long long seq;
+   void push(alarmtimer *t);
+};
+
+/* The earliest of a few deadlines. */
+struct deadline {
+   bool found;
+   sc_time next;
+   deadline() { found = false; }
+   void add(const sc_time &t) {
+      if (!found || t < next) next = t;
+      found = true;
+   }
+   /* Sets the event for the deadline, right away if it already passed. With
+    * no deadline the event is only cancelled.
+    */
+   void arm(sc_event &ev);
+};
+
+#endif
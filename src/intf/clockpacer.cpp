@@ -23,30 +23,18 @@
 
 clockpacer_t clockpacer;
 
-void clockpacer_t::wait_next_cpu_clk() {
-   long int nanoseconds;
-   nanoseconds = (long int)floor(sc_time_stamp().to_seconds() * 1e9);
-   long int offset = nanoseconds % cpu_period;
-   wait(sc_time(cpu_period - offset, SC_NS));
+void clockpacer_t::wait_next_clk(int period) {
+   sc_time p = sc_time(period, SC_PS);
+   wait(p - sc_time::from_value(sc_time_stamp().value() % p.value()));
 }
 
-void clockpacer_t::wait_next_apb_clk() {
-   long int nanoseconds;
-   nanoseconds = (long int)floor(sc_time_stamp().to_seconds() * 1e9);
-   long int offset = nanoseconds % apb_period;
-   wait(sc_time(apb_period - offset, SC_NS));
+/* The event is only made when first needed, so that the kernel is up. */
+const sc_event &clockpacer_t::apb_gate_event() {
+   if (apb_gate_ev == NULL) apb_gate_ev = new sc_event;
+   return *apb_gate_ev;
 }
 
-void clockpacer_t::wait_next_ref_clk() {
-   long int nanoseconds;
-   nanoseconds = (long int)floor(sc_time_stamp().to_seconds() * 1e9);
-   long int offset = nanoseconds % ref_period;
-   wait(sc_time(ref_period - offset, SC_NS));
-}
-
-void clockpacer_t::wait_next_rtc8m_clk() {
-   long int nanoseconds;
-   nanoseconds = (long int)floor(sc_time_stamp().to_seconds() * 1e9);
-   long int offset = nanoseconds % rtc8m_period;
-   wait(sc_time(rtc8m_period - offset, SC_NS));
+void clockpacer_t::gate_apb(bool g) {
+   apb_gated = g;
+   if (apb_gate_ev != NULL) apb_gate_ev->notify();
 }
@@ -25,36 +25,54 @@
 
 class clockpacer_t {
    private:
+   /* The periods are kept in picoseconds, so that the 80MHz APB clock is
+    * exactly 12.5ns.
+    */
    int cpu_period;
    int apb_period;
    int ref_period;
    int rtc8m_period;
+   bool apb_gated;
+   sc_event *apb_gate_ev;
+   void wait_next_clk(int period);
 
    public:
-   clockpacer_t(): cpu_period(3), apb_period(12),
-      ref_period(1000), rtc8m_period(125) {};
-   void wait_next_cpu_clk();
-   void wait_next_apb_clk();
-   void wait_next_ref_clk();
-   void wait_next_rtc8m_clk();
-   int get_cpu_period_ns() { return cpu_period; }
-   int get_apb_period_ns() { return apb_period; }
-   int get_ref_period_ns() { return ref_period; }
-   int get_rtc8m_period_ns() { return rtc8m_period; }
-   void set_cpu_period_ns(int &_n) { cpu_period = _n; }
-   void set_apb_period_ns(int &_n) { apb_period = _n; }
-   void set_ref_period_ns(int &_n) { ref_period = _n; }
-   void set_rtc8m_period_ns(int &_n) { rtc8m_period = _n; }
-   sc_time get_cpu_period() { return sc_time(cpu_period, SC_NS); }
-   sc_time get_apb_period() { return sc_time(apb_period, SC_NS); }
-   sc_time get_ref_period() { return sc_time(ref_period, SC_NS); }
-   sc_time get_rtc8m_period() { return sc_time(rtc8m_period, SC_NS); }
-   void set_cpu_period(sc_time &_n) { cpu_period = (int)floor(_n.to_seconds()*1e9); }
-   void set_apb_period(sc_time &_n) { apb_period = (int)floor(_n.to_seconds()*1e9); }
-   void set_ref_period(sc_time &_n) { ref_period = (int)floor(_n.to_seconds()*1e9); }
+   clockpacer_t(): cpu_period(3000), apb_period(12500),
+      ref_period(1000000), rtc8m_period(125000), apb_gated(false),
+      apb_gate_ev(NULL) {};
+   void wait_next_cpu_clk() { wait_next_clk(cpu_period); }
+   void wait_next_apb_clk() { wait_next_clk(apb_period); }
+   void wait_next_ref_clk() { wait_next_clk(ref_period); }
+   void wait_next_rtc8m_clk() { wait_next_clk(rtc8m_period); }
+   int get_cpu_period_ns() { return cpu_period / 1000; }
+   int get_apb_period_ns() { return apb_period / 1000; }
+   int get_ref_period_ns() { return ref_period / 1000; }
+   int get_rtc8m_period_ns() { return rtc8m_period / 1000; }
+   int get_cpu_period_ps() { return cpu_period; }
+   int get_apb_period_ps() { return apb_period; }
+   int get_ref_period_ps() { return ref_period; }
+   int get_rtc8m_period_ps() { return rtc8m_period; }
+   void set_cpu_period_ns(int &_n) { cpu_period = _n * 1000; }
+   void set_apb_period_ns(int &_n) { apb_period = _n * 1000; }
+   void set_ref_period_ns(int &_n) { ref_period = _n * 1000; }
+   void set_rtc8m_period_ns(int &_n) { rtc8m_period = _n * 1000; }
+   sc_time get_cpu_period() { return sc_time(cpu_period, SC_PS); }
+   sc_time get_apb_period() { return sc_time(apb_period, SC_PS); }
+   sc_time get_ref_period() { return sc_time(ref_period, SC_PS); }
+   sc_time get_rtc8m_period() { return sc_time(rtc8m_period, SC_PS); }
+   void set_cpu_period(sc_time &_n) { cpu_period = (int)floor(_n.to_seconds()*1e12); }
+   void set_apb_period(sc_time &_n) { apb_period = (int)floor(_n.to_seconds()*1e12); }
+   void set_ref_period(sc_time &_n) { ref_period = (int)floor(_n.to_seconds()*1e12); }
    void set_rtc8m_period(sc_time &_n) {
-      rtc8m_period = (int)floor(_n.to_seconds()*1e9);
+      rtc8m_period = (int)floor(_n.to_seconds()*1e12);
    }
+   /* While the chip sleeps the APB clock is gated. The peripherals that run
+    * off it should stop and wait for the event, which is notified each time
+    * the gate opens or closes.
+    */
+   void gate_apb(bool g);
+   bool is_apb_gated() { return apb_gated; }
+   const sc_event &apb_gate_event();
    bool is_thread() {
       auto p = sc_get_current_process_handle();
       return p.valid() && p.proc_kind() != SC_METHOD_PROC_;
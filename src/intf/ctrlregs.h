@@ -22,14 +22,29 @@
 #ifndef _CTRLREGS_H
 #define _CTRLREGS_H
 
+#include <systemc.h>
+#include <exception>
 #include "rom/rtc.h"
 
 struct ctrlregs_t {
    RESET_REASON cpu0_reset_reason;
    RESET_REASON cpu1_reset_reason;
-   bool return_to_start;
+   /* The WAKEUP_REASON bits of what woke the chip up from the last sleep. */
+   uint32_t wakeup_cause;
+   /* The thread that runs setup() and loop(). */
+   sc_process_handle dut;
 };
 
 extern ctrlregs_t *ctrlregsptr;
 
+/* This is thrown into the firmware thread to take it back to setup(). */
+struct espm_restart_ex: public std::exception {
+   const char *what() const throw() { return "return to start"; }
+};
+
+/* Resets the chip and sends the firmware back to setup(), as after a wake up
+ * from deep sleep or a software reset. It does not return.
+ */
+void espm_return_to_start();
+
 #endif
@@ -22,6 +22,7 @@
 #include "pcntmod.h"
 #include "ledcmod.h"
 #include "spimod.h"
+#include "timgmod.h"
 #include "btmod.h"
 #include "i2c.h"
 #include "adc_types.h"
@@ -29,6 +30,7 @@
 #include "soc/pcnt_struct.h"
 #include "soc/ledc_struct.h"
 #include "soc/spi_struct.h"
+#include "soc/timer_group_struct.h"
 #include "ctrlregs.h"
 #include "Arduino.h"
 #include "espintr.h"
@@ -41,6 +43,8 @@ pcntmod *pcntptr;
 ledcmod *ledcptr;
 spimod *vspiptr;
 spimod *hspiptr;
+timgmod *timg0ptr;
+timgmod *timg1ptr;
 adc1 *adc1ptr;
 adc2 *adc2ptr;
 espintr *espintrptr;
@@ -53,6 +57,8 @@ pcnt_dev_t PCNT;
 ledc_dev_t LEDC;
 spi_dev_t SPI2;
 spi_dev_t SPI3;
+timg_dev_t TIMERG0;
+timg_dev_t TIMERG1;
 ctrlregs_t *ctrlregsptr;
 
 void update_ledc() {
@@ -74,3 +80,8 @@ void update_gpio_reg() {
 void update_gpio_oe() {
    gpiomatrixptr->updategpiooe();
 }
+
+void update_timg(int group) {
+   if (group == 0) timg0ptr->update();
+   else timg1ptr->update();
+}
@@ -26,14 +26,15 @@
 extern "C" {
 #endif
 
-/* After changing PCNT, LEDC or GPIO struct you must call one of these function
- * to update the model.
+/* After changing PCNT, LEDC, TIMG or GPIO struct you must call one of these
+ * function to update the model.
  */
 void update_pcnt();
 void update_ledc();
 void update_gpio();
 void update_gpio_reg();
 void update_gpio_oe();
+void update_timg(int group);
 
 #ifdef __cplusplus
 }
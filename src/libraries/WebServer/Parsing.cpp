@@ -19,6 +19,7 @@
   Modified 8 May 2015 by Hristo Gochkov (proper post and file upload handling)
 */
 
+#include <algorithm>
 #include <Arduino.h>
 #include <esp32-hal-log.h>
 #include "WiFiServer.h"
@@ -26,270 +27,443 @@
 #include "WebServer.h"
 #include "detail/mimetable.h"
 
-#ifndef WEBSERVER_MAX_POST_ARGS
-#define WEBSERVER_MAX_POST_ARGS 32
-#endif
-
 static const char Content_Type[] PROGMEM = "Content-Type";
 static const char filename[] PROGMEM = "filename";
 
-static char* readBytesWithTimeout(WiFiClient& client, size_t maxLength, size_t& dataLength, int timeout_ms)
+// Compares a piece of the request with a string, ignoring the case.
+static bool viewIs(const char* ptr, size_t len, const char* str)
 {
-  char *buf = nullptr;
-  dataLength = 0;
-  while (dataLength < maxLength) {
-    int tries = timeout_ms;
-    size_t newLength;
-    while (!(newLength = client.available()) && tries--) delay(1);
-    if (!newLength) {
-      break;
-    }
-    if (!buf) {
-      buf = (char *) malloc(newLength + 1);
-      if (!buf) {
-        return nullptr;
+  return strlen(str) == len && strncasecmp(ptr, str, len) == 0;
+}
+
+// Gets the next char of a piece of the request, undoing the url encoding
+// when asked to.
+static char viewChar(const char* ptr, size_t len, size_t& i, bool decode)
+{
+  char c = ptr[i++];
+  if (!decode)
+    return c;
+  if ((c == '%') && (i + 1 < len)) {
+    char temp[] = "0x00";
+    temp[2] = ptr[i++];
+    temp[3] = ptr[i++];
+    return strtol(temp, NULL, 16);
+  }
+  if (c == '+')
+    return ' ';
+  return c;
+}
+
+bool WebServer::_requestFill(WiFiClient& client, int timeout_ms)
+{
+  // We take whatever the client has, as much as fits, in one read.
+  size_t room = _reqSize - _reqLen;
+  if (room == 0)
+    return false;
+  int tries = timeout_ms;
+  int newLength;
+  while (!(newLength = client.available()) && client.connected() && tries--) delay(1);
+  if (newLength <= 0)
+    return false;
+  if ((size_t)newLength > room)
+    newLength = room;
+  newLength = client.read((uint8_t*)_reqBuf + _reqLen, newLength);
+  if (newLength <= 0)
+    return false;
+  _reqLen += newLength;
+  return true;
+}
+
+bool WebServer::_readRequestHead(WiFiClient& client, size_t& headEnd)
+{
+  size_t scan = _reqPos;
+  while (1) {
+    // Look for the blank line at the end of the header.
+    for (; scan + 3 < _reqLen; scan++) {
+      if (_reqBuf[scan] == '\r' && _reqBuf[scan+1] == '\n' &&
+          _reqBuf[scan+2] == '\r' && _reqBuf[scan+3] == '\n') {
+        headEnd = scan;
+        return true;
       }
     }
-    else {
-      char* newBuf = (char *) realloc(buf, dataLength + newLength + 1);
-      if (!newBuf) {
-        free(buf);
-        return nullptr;
+    // If the buffer is full the header is bigger than it, so it grows.
+    // Nothing points into it yet, so it can move.
+    if (_reqLen == _reqSize) {
+      char* grown = (char *) realloc(_reqBuf, 2 * _reqSize);
+      if (!grown) {
+        log_e("No memory for a request header of %d bytes", (int)(2 * _reqSize));
+        return false;
       }
-      buf = newBuf;
+      _reqBuf = grown;
+      _reqSize = 2 * _reqSize;
+    }
+    if (!_requestFill(client, HTTP_MAX_DATA_WAIT))
+      return false;
+  }
+}
+
+bool WebServer::_readRequestBody(WiFiClient& client, size_t contentLength, RequestView& body)
+{
+  // If it fits we read the rest of it in the request buffer, right after the
+  // header.
+  if (_reqPos + contentLength <= _reqSize) {
+    while (_reqLen < _reqPos + contentLength) {
+      if (!_requestFill(client, HTTP_MAX_POST_WAIT))
+        return false;
     }
-    client.readBytes(buf + dataLength, newLength);
+    body.ptr = _reqBuf + _reqPos;
+    body.len = contentLength;
+    _reqPos += contentLength;
+    return true;
+  }
+
+  // If not, it gets a buffer of its own. Whatever we already have we copy
+  // there and the rest we read straight into it.
+  size_t dataLength = _reqLen - _reqPos;
+  _bodyBuf = (char *) malloc(contentLength + 1);
+  if (!_bodyBuf)
+    return false;
+  memcpy(_bodyBuf, _reqBuf + _reqPos, dataLength);
+  _reqPos = _reqLen;
+  while (dataLength < contentLength) {
+    int tries = HTTP_MAX_POST_WAIT;
+    int newLength;
+    while (!(newLength = client.available()) && client.connected() && tries--) delay(1);
+    if (newLength <= 0)
+      return false;
+    if ((size_t)newLength > contentLength - dataLength)
+      newLength = contentLength - dataLength;
+    newLength = client.read((uint8_t*)_bodyBuf + dataLength, newLength);
+    if (newLength <= 0)
+      return false;
     dataLength += newLength;
-    buf[dataLength] = '\0';
   }
-  return buf;
+  _bodyBuf[contentLength] = '\0';
+  body.ptr = _bodyBuf;
+  body.len = contentLength;
+  return true;
+}
+
+String WebServer::_requestReadLine(WiFiClient& client)
+{
+  // Reads a line, with the pipelined bytes first, and drops the "\r\n".
+  String line;
+  int c;
+  while ((c = _uploadReadByte(client)) >= 0 && c != '\r')
+    line += (char)c;
+  if (c == '\r')
+    _uploadReadByte(client);
+  return line;
+}
+
+size_t WebServer::_requestReadBytes(WiFiClient& client, uint8_t* buf, size_t len)
+{
+  size_t i;
+  int c;
+  for (i = 0; i < len; i++) {
+    if ((c = _uploadReadByte(client)) < 0)
+      break;
+    buf[i] = (uint8_t)c;
+  }
+  return i;
+}
+
+String WebServer::_viewString(const RequestView& view, bool decode)
+{
+  String str;
+  size_t i = 0;
+  if (!view.ptr)
+    return str;
+  str.reserve(view.len);
+  while (i < view.len)
+    str += viewChar(view.ptr, view.len, i, decode);
+  return str;
+}
+
+const String& WebServer::_argKey(RequestArgument& arg)
+{
+  if (arg.keyView.ptr) {
+    arg.key = _viewString(arg.keyView, arg.encoded);
+    arg.keyView.ptr = nullptr;
+  }
+  return arg.key;
+}
+
+const String& WebServer::_argValue(RequestArgument& arg)
+{
+  if (arg.valueView.ptr) {
+    arg.value = _viewString(arg.valueView, arg.encoded);
+    arg.valueView.ptr = nullptr;
+  }
+  return arg.value;
+}
+
+bool WebServer::_argKeyIs(RequestArgument& arg, const String& name)
+{
+  // We compare it while we decode it, so no String needs to be made.
+  if (!arg.keyView.ptr)
+    return arg.key == name;
+  size_t i = 0;
+  unsigned int j = 0;
+  while (i < arg.keyView.len) {
+    char c = viewChar(arg.keyView.ptr, arg.keyView.len, i, arg.encoded);
+    if (j >= name.length() || name[j++] != c)
+      return false;
+  }
+  return j == name.length();
+}
+
+void WebServer::_clearArg(RequestArgument& arg)
+{
+  arg.key = String();
+  arg.value = String();
+  arg.keyView.ptr = nullptr;
+  arg.valueView.ptr = nullptr;
+  arg.encoded = false;
 }
 
 bool WebServer::_parseRequest(WiFiClient& client) {
-  // Read the first line of HTTP request
-  String req = client.readStringUntil('\r');
-  client.readStringUntil('\n');
+  size_t headEnd;
+  RequestView body = {nullptr, 0};
+  const char* end;
+  const char* eol;
+
+  // The last request is done with the buffer, so any pipelined bytes that
+  // came after it move to the front.
+  if (_reqPos > 0) {
+    memmove(_reqBuf, _reqBuf + _reqPos, _reqLen - _reqPos);
+    _reqLen -= _reqPos;
+    _reqPos = 0;
+  }
+  if (_bodyBuf) {
+    free(_bodyBuf);
+    _bodyBuf = nullptr;
+  }
+  if (!_reqBuf) {
+    _reqBuf = (char *) malloc(HTTP_REQUEST_BUFLEN);
+    if (!_reqBuf)
+      return false;
+    _reqSize = HTTP_REQUEST_BUFLEN;
+  }
+
   //reset header value
   for (int i = 0; i < _headerKeysCount; ++i) {
-    _currentHeaders[i].value =String();
-   }
+    _currentHeaders[i].value = String();
+    _currentHeaders[i].valueView.ptr = nullptr;
+  }
+  _hostHeader.ptr = nullptr;
+  //reset the arguments, the array is kept for the next request
+  for (int i = 0; i < _currentArgCount; ++i)
+    _clearArg(_currentArgs[i]);
+  _currentArgCount = 0;
+
+  if (!_readRequestHead(client, headEnd)) {
+    log_e("Invalid request: no end of header");
+    return false;
+  }
+  end = _reqBuf + headEnd;
 
   // First line of HTTP request looks like "GET /path HTTP/1.1"
   // Retrieve the "/path" part by finding the spaces
-  int addr_start = req.indexOf(' ');
-  int addr_end = req.indexOf(' ', addr_start + 1);
-  if (addr_start == -1 || addr_end == -1) {
-    log_e("Invalid request: %s", req.c_str());
+  eol = (const char*) memchr(_reqBuf, '\r', end - _reqBuf);
+  if (!eol)
+    eol = end;
+  const char* addr_start = (const char*) memchr(_reqBuf, ' ', eol - _reqBuf);
+  const char* addr_end = addr_start ? (const char*) memchr(addr_start + 1, ' ', eol - addr_start - 1) : nullptr;
+  if (!addr_start || !addr_end) {
+    log_e("Invalid request: %.*s", (int)(eol - _reqBuf), _reqBuf);
     return false;
   }
 
-  String methodStr = req.substring(0, addr_start);
-  String url = req.substring(addr_start + 1, addr_end);
-  String versionEnd = req.substring(addr_end + 8);
-  _currentVersion = atoi(versionEnd.c_str());
-  String searchStr = "";
-  int hasSearch = url.indexOf('?');
-  if (hasSearch != -1){
-    searchStr = url.substring(hasSearch + 1);
-    url = url.substring(0, hasSearch);
+  RequestView methodStr = {_reqBuf, (size_t)(addr_start - _reqBuf)};
+  RequestView url = {addr_start + 1, (size_t)(addr_end - addr_start - 1)};
+  _currentVersion = (addr_end + 8 < eol) ? atoi(addr_end + 8) : 0;
+  RequestView searchStr = {nullptr, 0};
+  const char* hasSearch = (const char*) memchr(url.ptr, '?', url.len);
+  if (hasSearch) {
+    searchStr.ptr = hasSearch + 1;
+    searchStr.len = url.ptr + url.len - hasSearch - 1;
+    url.len = hasSearch - url.ptr;
   }
-  _currentUri = url;
+  _currentUri = _viewString(url, false);
   _chunked = false;
 
   HTTPMethod method = HTTP_GET;
-  if (methodStr == F("POST")) {
+  if (viewIs(methodStr.ptr, methodStr.len, "POST")) {
     method = HTTP_POST;
-  } else if (methodStr == F("DELETE")) {
+  } else if (viewIs(methodStr.ptr, methodStr.len, "DELETE")) {
     method = HTTP_DELETE;
-  } else if (methodStr == F("OPTIONS")) {
+  } else if (viewIs(methodStr.ptr, methodStr.len, "OPTIONS")) {
     method = HTTP_OPTIONS;
-  } else if (methodStr == F("PUT")) {
+  } else if (viewIs(methodStr.ptr, methodStr.len, "PUT")) {
     method = HTTP_PUT;
-  } else if (methodStr == F("PATCH")) {
+  } else if (viewIs(methodStr.ptr, methodStr.len, "PATCH")) {
     method = HTTP_PATCH;
   }
   _currentMethod = method;
 
-  log_v("method: %s url: %s search: %s", methodStr.c_str(), url.c_str(), searchStr.c_str());
+  log_v("method: %.*s url: %s search: %.*s", (int)methodStr.len, methodStr.ptr, _currentUri.c_str(), (int)searchStr.len, searchStr.ptr ? searchStr.ptr : "");
 
   //attach handler
-  RequestHandler* handler;
-  for (handler = _firstHandler; handler; handler = handler->next()) {
-    if (handler->canHandle(_currentMethod, _currentUri))
+  _currentHandler = _routes.find(_currentMethod, _currentUri);
+
+  //parse headers, they stay where they are in the buffer
+  RequestView boundaryStr = {nullptr, 0};
+  bool isForm = false;
+  bool isEncoded = false;
+  size_t contentLength = 0;
+  const char* line = eol + 2;
+  while (line < end) {
+    eol = (const char*) memchr(line, '\r', end - line);
+    if (!eol)
+      eol = end;
+    const char* headerDiv = (const char*) memchr(line, ':', eol - line);
+    if (!headerDiv)
       break;
+    RequestView headerName = {line, (size_t)(headerDiv - line)};
+    const char* value = headerDiv + 1;
+    const char* valueEnd = eol;
+    while (value < valueEnd && (*value == ' ' || *value == '\t')) value++;
+    while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) valueEnd--;
+    RequestView headerValue = {value, (size_t)(valueEnd - value)};
+    _collectHeader(headerName, headerValue);
+
+    log_v("headerName: %.*s", (int)headerName.len, headerName.ptr);
+    log_v("headerValue: %.*s", (int)headerValue.len, headerValue.ptr);
+
+    if (viewIs(headerName.ptr, headerName.len, Content_Type)) {
+      using namespace mime;
+      size_t txtLen = strlen(mimeTable[txt].mimeType);
+      if (headerValue.len >= txtLen && strncmp(headerValue.ptr, mimeTable[txt].mimeType, txtLen) == 0) {
+        isForm = false;
+      } else if (headerValue.len >= 33 && strncmp(headerValue.ptr, "application/x-www-form-urlencoded", 33) == 0) {
+        isForm = false;
+        isEncoded = true;
+      } else if (headerValue.len >= 10 && strncmp(headerValue.ptr, "multipart/", 10) == 0) {
+        const char* equal = (const char*) memchr(headerValue.ptr, '=', headerValue.len);
+        boundaryStr.ptr = equal ? equal + 1 : headerValue.ptr;
+        boundaryStr.len = headerValue.ptr + headerValue.len - boundaryStr.ptr;
+        isForm = true;
+      }
+    } else if (viewIs(headerName.ptr, headerName.len, "Content-Length")) {
+      contentLength = strtoul(headerValue.ptr, NULL, 10);
+    } else if (viewIs(headerName.ptr, headerName.len, "Host")) {
+      _hostHeader = headerValue;
+    }
+    line = eol + 2;
   }
-  _currentHandler = handler;
+  _reqPos = headEnd + 4;
 
-  String formData;
   // below is needed only when POST type request
   if (method == HTTP_POST || method == HTTP_PUT || method == HTTP_PATCH || method == HTTP_DELETE){
-    String boundaryStr;
-    String headerName;
-    String headerValue;
-    bool isForm = false;
-    bool isEncoded = false;
-    uint32_t contentLength = 0;
-    //parse headers
-    while(1){
-      req = client.readStringUntil('\r');
-      client.readStringUntil('\n');
-      if (req == "") break;//no moar headers
-      int headerDiv = req.indexOf(':');
-      if (headerDiv == -1){
-        break;
-      }
-      headerName = req.substring(0, headerDiv);
-      headerValue = req.substring(headerDiv + 1);
-      headerValue.trim();
-       _collectHeader(headerName.c_str(),headerValue.c_str());
-
-      log_v("headerName: %s", headerName.c_str());
-      log_v("headerValue: %s", headerValue.c_str());
-
-      if (headerName.equalsIgnoreCase(FPSTR(Content_Type))){
-        using namespace mime;
-        if (headerValue.startsWith(FPSTR(mimeTable[txt].mimeType))){
-          isForm = false;
-        } else if (headerValue.startsWith(F("application/x-www-form-urlencoded"))){
-          isForm = false;
-          isEncoded = true;
-        } else if (headerValue.startsWith(F("multipart/"))){
-          boundaryStr = headerValue.substring(headerValue.indexOf('=') + 1);
-          boundaryStr.replace("\"","");
-          isForm = true;
-        }
-      } else if (headerName.equalsIgnoreCase(F("Content-Length"))){
-        contentLength = headerValue.toInt();
-      } else if (headerName.equalsIgnoreCase(F("Host"))){
-        _hostHeader = headerValue;
-      }
-    }
-
     if (!isForm){
-      size_t plainLength;
-      char* plainBuf = readBytesWithTimeout(client, contentLength, plainLength, HTTP_MAX_POST_WAIT);
-      if (plainLength < contentLength) {
-      	free(plainBuf);
-      	return false;
-      }
+      if (!_readRequestBody(client, contentLength, body))
+        return false;
+      _parseArguments(searchStr);
       if (contentLength > 0) {
         if(isEncoded){
-          //url encoded form
-          if (searchStr != "") searchStr += '&';
-          searchStr += plainBuf;
+          //url encoded form, the arguments follow the ones in the URL
+          _parseArguments(body);
         }
-        _parseArguments(searchStr);
-        if(!isEncoded){
+        else {
           //plain post json or other data
-          RequestArgument& arg = _currentArgs[_currentArgCount++];
+          RequestArgument& arg = _addArg();
           arg.key = F("plain");
-          arg.value = String(plainBuf);
+          arg.valueView = body;
+          arg.encoded = false;
         }
 
-        log_v("Plain: %s", plainBuf);
-        free(plainBuf);
-      } else {
-        // No content - but we can still have arguments in the URL.
-        _parseArguments(searchStr);
+        log_v("Plain: %.*s", (int)body.len, body.ptr);
       }
     }
 
     if (isForm){
+      String boundary = _viewString(boundaryStr, false);
+      boundary.replace("\"","");
       _parseArguments(searchStr);
-      if (!_parseForm(client, boundaryStr, contentLength)) {
+      if (!_parseForm(client, boundary, contentLength)) {
         return false;
       }
     }
   } else {
-    String headerName;
-    String headerValue;
-    //parse headers
-    while(1){
-      req = client.readStringUntil('\r');
-      client.readStringUntil('\n');
-      if (req == "") break;//no moar headers
-      int headerDiv = req.indexOf(':');
-      if (headerDiv == -1){
-        break;
-      }
-      headerName = req.substring(0, headerDiv);
-      headerValue = req.substring(headerDiv + 2);
-      _collectHeader(headerName.c_str(),headerValue.c_str());
-
-	  log_v("headerName: %s", headerName.c_str());
-	  log_v("headerValue: %s", headerValue.c_str());
-
-	  if (headerName.equalsIgnoreCase("Host")){
-        _hostHeader = headerValue;
-      }
-    }
+    // Other requests should not have a body. If one came anyway we skip it
+    // so that it is not taken for the next request.
+    if (contentLength > 0 && !_readRequestBody(client, contentLength, body))
+      return false;
     _parseArguments(searchStr);
   }
-  client.flush();
 
-  log_v("Request: %s", url.c_str());
-  log_v(" Arguments: %s", searchStr.c_str());
+  // Some clients send a CRLF after the body. It is not the start of a
+  // pipelined request, so we drop it.
+  while (_reqPos < _reqLen && (_reqBuf[_reqPos] == '\r' || _reqBuf[_reqPos] == '\n'))
+    _reqPos++;
+
+  log_v("Request: %s", _currentUri.c_str());
+  log_v(" Arguments: %.*s", (int)searchStr.len, searchStr.ptr ? searchStr.ptr : "");
 
   return true;
 }
 
-bool WebServer::_collectHeader(const char* headerName, const char* headerValue) {
+bool WebServer::_collectHeader(const RequestView& headerName, const RequestView& headerValue) {
   for (int i = 0; i < _headerKeysCount; i++) {
-    if (_currentHeaders[i].key.equalsIgnoreCase(headerName)) {
-            _currentHeaders[i].value=headerValue;
+    if (viewIs(headerName.ptr, headerName.len, _currentHeaders[i].key.c_str())) {
+            _currentHeaders[i].value = String();
+            _currentHeaders[i].valueView = headerValue;
+            _currentHeaders[i].encoded = false;
             return true;
         }
   }
   return false;
 }
 
-void WebServer::_parseArguments(String data) {
-  log_v("args: %s", data.c_str());
-  if (_currentArgs)
-    delete[] _currentArgs;
-  _currentArgs = 0;
-  if (data.length() == 0) {
-    _currentArgCount = 0;
-    _currentArgs = new RequestArgument[1];
+void WebServer::_parseArguments(const RequestView& data) {
+  // The arguments are added after the ones already there, as views into the
+  // request. They are only decoded when asked for.
+  log_v("args: %.*s", (int)data.len, data.ptr ? data.ptr : "");
+  if (!data.ptr || data.len == 0)
     return;
-  }
-  _currentArgCount = 1;
-
-  for (int i = 0; i < (int)data.length(); ) {
-    i = data.indexOf('&', i);
-    if (i == -1)
-      break;
-    ++i;
-    ++_currentArgCount;
-  }
-  log_v("args count: %d", _currentArgCount);
 
-  _currentArgs = new RequestArgument[_currentArgCount+1];
-  int pos = 0;
-  int iarg;
-  for (iarg = 0; iarg < _currentArgCount;) {
-    int equal_sign_index = data.indexOf('=', pos);
-    int next_arg_index = data.indexOf('&', pos);
-    log_v("pos %d =@%d &@%d", pos, equal_sign_index, next_arg_index);
-    if ((equal_sign_index == -1) || ((equal_sign_index > next_arg_index) && (next_arg_index != -1))) {
+  const char* pos = data.ptr;
+  const char* end = data.ptr + data.len;
+  int iarg = 0;
+  while (pos < end) {
+    const char* next_arg = (const char*) memchr(pos, '&', end - pos);
+    if (!next_arg)
+      next_arg = end;
+    const char* equal_sign = (const char*) memchr(pos, '=', next_arg - pos);
+    log_v("pos %d =@%d &@%d", (int)(pos - data.ptr), equal_sign ? (int)(equal_sign - data.ptr) : -1, (int)(next_arg - data.ptr));
+    if (!equal_sign) {
       log_e("arg missing value: %d", iarg);
-      if (next_arg_index == -1)
-        break;
-      pos = next_arg_index + 1;
-      continue;
     }
-    RequestArgument& arg = _currentArgs[iarg];
-    arg.key = urlDecode(data.substring(pos, equal_sign_index));
-    arg.value = urlDecode(data.substring(equal_sign_index + 1, next_arg_index));
-    log_v("arg %d key: %s value: %s", iarg, arg.key.c_str(), arg.value.c_str());
-    ++iarg;
-    if (next_arg_index == -1)
-      break;
-    pos = next_arg_index + 1;
+    else {
+      RequestArgument& arg = _addArg();
+      arg.keyView.ptr = pos;
+      arg.keyView.len = equal_sign - pos;
+      arg.valueView.ptr = equal_sign + 1;
+      arg.valueView.len = next_arg - equal_sign - 1;
+      arg.encoded = true;
+    }
+    iarg++;
+    pos = next_arg + 1;
   }
-  _currentArgCount = iarg;
   log_v("args count: %d", _currentArgCount);
+}
 
+WebServer::RequestArgument& WebServer::_addArg() {
+  // The array starts with room for WEBSERVER_MAX_POST_ARGS arguments and
+  // doubles when a request has more. The views point into the request, so
+  // they stay good when moved.
+  if (_currentArgCount == _currentArgsSize) {
+    int size = _currentArgsSize ? 2 * _currentArgsSize : WEBSERVER_MAX_POST_ARGS;
+    RequestArgument* args = new RequestArgument[size];
+    for (int i = 0; i < _currentArgCount; i++)
+      args[i] = std::move(_currentArgs[i]);
+    if (_currentArgs)
+      delete[] _currentArgs;
+    _currentArgs = args;
+    _currentArgsSize = size;
+  }
+  return _currentArgs[_currentArgCount++];
 }
 
 void WebServer::_uploadWriteByte(uint8_t b){
@@ -303,6 +477,13 @@ void WebServer::_uploadWriteByte(uint8_t b){
 }
 
 int WebServer::_uploadReadByte(WiFiClient& client){
+  // The form ends at its Content-Length, what follows is the next request.
+  if (_formLeft == 0)
+    return -1;
+  _formLeft--;
+  // What is left in the request buffer comes first.
+  if (_reqPos < _reqLen)
+    return (uint8_t)_reqBuf[_reqPos++];
   int res = client.read();
   if(res < 0) {
     // keep trying until you either read a valid byte or timeout
@@ -343,30 +524,30 @@ int WebServer::_uploadReadByte(WiFiClient& client){
 }
 
 bool WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t len){
-  (void) len;
   log_v("Parse Form: Boundary: %s Length: %d", boundary.c_str(), len);
   String line;
   int retry = 0;
+  _formLeft = len;
   do {
-    line = client.readStringUntil('\r');
+    line = _requestReadLine(client);
     ++retry;
   } while (line.length() == 0 && retry < 3);
 
-  client.readStringUntil('\n');
-  //start reading the form
+  //start reading the form, its arguments go after the ones in the URL
   if (line == ("--"+boundary)){
-	 if(_postArgs) delete[] _postArgs;
-	 _postArgs = new RequestArgument[WEBSERVER_MAX_POST_ARGS];
-     _postArgsLen = 0;
+    int urlArgs = _currentArgCount;
     while(1){
+      if (_formLeft == 0) {
+        log_e("Form ended without the closing boundary");
+        return false;
+      }
       String argName;
       String argValue;
       String argType;
       String argFilename;
       bool argIsFile = false;
 
-      line = client.readStringUntil('\r');
-      client.readStringUntil('\n');
+      line = _requestReadLine(client);
       if (line.length() > 19 && line.substring(0, 19).equalsIgnoreCase(F("Content-Disposition"))){
         int nameStart = line.indexOf('=');
         if (nameStart != -1){
@@ -386,26 +567,27 @@ bool WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t len){
           log_v("PostArg Name: %s", argName.c_str());
           using namespace mime;
           argType = FPSTR(mimeTable[txt].mimeType);
-          line = client.readStringUntil('\r');
-          client.readStringUntil('\n');
+          line = _requestReadLine(client);
           if (line.length() > 12 && line.substring(0, 12).equalsIgnoreCase(FPSTR(Content_Type))){
             argType = line.substring(line.indexOf(':')+2);
             //skip next line
-            client.readStringUntil('\r');
-            client.readStringUntil('\n');
+            _requestReadLine(client);
           }
           log_v("PostArg Type: %s", argType.c_str());
           if (!argIsFile){
             while(1){
-              line = client.readStringUntil('\r');
-              client.readStringUntil('\n');
+              line = _requestReadLine(client);
               if (line.startsWith("--"+boundary)) break;
+              if (_formLeft == 0) {
+                log_e("Form ended inside argument %s", argName.c_str());
+                return false;
+              }
               if (argValue.length() > 0) argValue += "\n";
               argValue += line;
             }
             log_v("PostArg Value: %s", argValue.c_str());
 
-            RequestArgument& arg = _postArgs[_postArgsLen++];
+            RequestArgument& arg = _addArg();
             arg.key = argName;
             arg.value = argValue;
 
@@ -457,7 +639,7 @@ readfile:
               }
 
               uint8_t endBuf[boundary.length()];
-              client.readBytes(endBuf, boundary.length());
+              _requestReadBytes(client, endBuf, boundary.length());
 
               if (strstr((const char*)endBuf, boundary.c_str()) != NULL){
                 if(_currentHandler && _currentHandler->canUpload(_currentUri))
@@ -467,8 +649,7 @@ readfile:
                 if(_currentHandler && _currentHandler->canUpload(_currentUri))
                   _currentHandler->upload(*this, _currentUri, *_currentUpload);
                 log_v("End File: %s Type: %s Size: %d", _currentUpload->filename.c_str(), _currentUpload->type.c_str(), _currentUpload->totalSize);
-                line = client.readStringUntil(0x0D);
-                client.readStringUntil(0x0A);
+                line = _requestReadLine(client);
                 if (line == "--"){
                   log_v("Done Parsing POST");
                   break;
@@ -496,26 +677,12 @@ readfile:
       }
     }
 
-    int iarg;
-    int totalArgs = ((WEBSERVER_MAX_POST_ARGS - _postArgsLen) < _currentArgCount)?(WEBSERVER_MAX_POST_ARGS - _postArgsLen):_currentArgCount;
-    for (iarg = 0; iarg < totalArgs; iarg++){
-      RequestArgument& arg = _postArgs[_postArgsLen++];
-      arg.key = _currentArgs[iarg].key;
-      arg.value = _currentArgs[iarg].value;
-    }
-    if (_currentArgs) delete[] _currentArgs;
-    _currentArgs = new RequestArgument[_postArgsLen];
-    for (iarg = 0; iarg < _postArgsLen; iarg++){
-      RequestArgument& arg = _currentArgs[iarg];
-      arg.key = _postArgs[iarg].key;
-      arg.value = _postArgs[iarg].value;
-    }
-    _currentArgCount = iarg;
-    if (_postArgs) {
-      delete[] _postArgs;
-      _postArgs=nullptr;
-      _postArgsLen = 0;
-    }
+    // The form arguments are listed before the URL ones.
+    std::rotate(_currentArgs, _currentArgs + urlArgs, _currentArgs + _currentArgCount);
+
+    // Anything after the closing boundary is still part of the body, so we
+    // skip it.
+    while (_uploadReadByte(client) >= 0);
     return true;
   }
   log_e("Error: line: %s", line.c_str());
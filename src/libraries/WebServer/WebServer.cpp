@@ -51,13 +51,19 @@ WebServer::WebServer(IPAddress addr, int port)
 , _firstHandler(nullptr)
 , _lastHandler(nullptr)
 , _currentArgCount(0)
+, _currentArgsSize(0)
 , _currentArgs(nullptr)
-, _postArgsLen(0)
-, _postArgs(nullptr)
 , _headerKeysCount(0)
 , _currentHeaders(nullptr)
 , _contentLength(0)
+, _hostHeader({nullptr, 0})
 , _chunked(false)
+, _reqBuf(nullptr)
+, _reqSize(0)
+, _reqLen(0)
+, _reqPos(0)
+, _bodyBuf(nullptr)
+, _formLeft(0)
 {
 }
 
@@ -71,13 +77,19 @@ WebServer::WebServer(int port)
 , _firstHandler(nullptr)
 , _lastHandler(nullptr)
 , _currentArgCount(0)
+, _currentArgsSize(0)
 , _currentArgs(nullptr)
-, _postArgsLen(0)
-, _postArgs(nullptr)
 , _headerKeysCount(0)
 , _currentHeaders(nullptr)
 , _contentLength(0)
+, _hostHeader({nullptr, 0})
 , _chunked(false)
+, _reqBuf(nullptr)
+, _reqSize(0)
+, _reqLen(0)
+, _reqPos(0)
+, _bodyBuf(nullptr)
+, _formLeft(0)
 {
 }
 
@@ -85,6 +97,12 @@ WebServer::~WebServer() {
   _server.close();
   if (_currentHeaders)
     delete[]_currentHeaders;
+  if (_currentArgs)
+    delete[]_currentArgs;
+  if (_reqBuf)
+    free(_reqBuf);
+  if (_bodyBuf)
+    free(_bodyBuf);
   RequestHandler* handler = _firstHandler;
   while (handler) {
     RequestHandler* next = handler->next();
@@ -258,6 +276,7 @@ void WebServer::_addRequestHandler(RequestHandler* handler) {
       _lastHandler->next(handler);
       _lastHandler = handler;
     }
+    _routes.add(handler);
 }
 
 /*
@@ -278,6 +297,15 @@ void WebServer::handleClient() {
     _currentClient = client;
     _currentStatus = HC_WAIT_READ;
     _statusChange = millis();
+    _reqLen = 0;
+    _reqPos = 0;
+    // If the last client had a big request the buffer grew, this one starts
+    // small again.
+    if (_reqSize > HTTP_REQUEST_BUFLEN) {
+      free(_reqBuf);
+      _reqBuf = nullptr;
+      _reqSize = 0;
+    }
   }
 
   bool keepCurrentClient = false;
@@ -289,15 +317,17 @@ void WebServer::handleClient() {
       // No-op to avoid C++ compiler warning
       break;
     case HC_WAIT_READ:
-      // Wait for data from client to become available
-      if (_currentClient.available()) {
+      // Wait for data from client to become available. A pipelined request
+      // might already be waiting in the request buffer.
+      if (_reqPos < _reqLen || _currentClient.available()) {
         if (_parseRequest(_currentClient)) {
+          bool pipelined = _reqPos < _reqLen;
           _currentClient.setTimeout(HTTP_MAX_SEND_WAIT);
           _contentLength = CONTENT_LENGTH_NOT_SET;
           _handleRequest();
 
           if (_currentClient.connected()) {
-            _currentStatus = HC_WAIT_CLOSE;
+            _currentStatus = pipelined ? HC_WAIT_READ : HC_WAIT_CLOSE;
             _statusChange = millis();
             keepCurrentClient = true;
           }
@@ -380,7 +410,11 @@ void WebServer::_prepareHeader(String& response, int code, const char* content_t
       sendHeader(String(F("Accept-Ranges")),String(F("none")));
       sendHeader(String(F("Transfer-Encoding")),String(F("chunked")));
     }
-    sendHeader(String(F("Connection")), String(F("close")));
+    // If the next request is already here we keep the connection for it.
+    if (_reqPos < _reqLen)
+      sendHeader(String(F("Connection")), String(F("keep-alive")));
+    else
+      sendHeader(String(F("Connection")), String(F("close")));
 
     response += _responseHeaders;
     response += "\r\n";
@@ -430,24 +464,21 @@ void WebServer::send(int code, const String& content_type, const String& content
   send(code, (const char*)content_type.c_str(), content);
 }
 
+void WebServer::send(int code, const char* content_type, TWriterFunction writer, size_t contentLength) {
+    String header;
+    if (_contentLength == CONTENT_LENGTH_NOT_SET)
+      _contentLength = contentLength;
+    _prepareHeader(header, code, content_type, contentLength);
+    _currentClientWrite(header.c_str(), header.length());
+    sendContent(writer);
+}
+
 void WebServer::sendContent(const String& content) {
-  const char * footer = "\r\n";
-  size_t len = content.length();
-  if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%lx%s", len, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
-    }
-  }
-  _currentClientWrite(content.c_str(), len);
-  if(_chunked){
-    _currentClient.write(footer, 2);
-    if (len == 0) {
-      _chunked = false;
-    }
-  }
+  _sendContentBlocks(content.c_str(), content.length(), false);
+}
+
+void WebServer::sendContent(const char* content, size_t size) {
+  _sendContentBlocks(content, size, false);
 }
 
 void WebServer::sendContent_P(PGM_P content) {
@@ -455,22 +486,77 @@ void WebServer::sendContent_P(PGM_P content) {
 }
 
 void WebServer::sendContent_P(PGM_P content, size_t size) {
-  const char * footer = "\r\n";
-  if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%lx%s", size, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
-    }
+  _sendContentBlocks(content, size, true);
+}
+
+size_t WebServer::sendContent(TWriterFunction writer) {
+  // The writer fills the block buffer directly, so nothing is copied on the
+  // way to the socket.
+  // A writer that claims more than it was given gets its block clamped and
+  // the stream ends there.
+  size_t total = 0;
+  size_t len, sent;
+  while ((len = writer((uint8_t*)_respBuf + HTTP_CHUNK_HEADROOM, HTTP_DOWNLOAD_UNIT_SIZE)) > 0) {
+    sent = _writeBlock(len);
+    total += sent;
+    if (sent != len)
+      break;
+  }
+  return total;
+}
+
+void WebServer::_sendContentBlocks(const char* content, size_t size, bool progmem) {
+  // Without chunks there is nothing to add, so it goes out from where it is.
+  if (!_chunked) {
+    if (progmem)
+      _currentClientWrite_P(content, size);
+    else
+      _currentClientWrite(content, size);
+    return;
   }
-  _currentClientWrite_P(content, size);
-  if(_chunked){
-    _currentClient.write(footer, 2);
-    if (size == 0) {
+  // An empty chunk ends the response.
+  if (size == 0) {
+    _writeBlock(0);
+    return;
+  }
+  while (size > 0) {
+    size_t len = (size < HTTP_DOWNLOAD_UNIT_SIZE)?size:HTTP_DOWNLOAD_UNIT_SIZE;
+    if (progmem)
+      memcpy_P(_respBuf + HTTP_CHUNK_HEADROOM, content, len);
+    else
+      memcpy(_respBuf + HTTP_CHUNK_HEADROOM, content, len);
+    _writeBlock(len);
+    content += len;
+    size -= len;
+  }
+}
+
+size_t WebServer::_writeBlock(size_t len) {
+  // The block is already in the buffer after the headroom. For chunked
+  // responses the size line goes right before it and the footer right after
+  // it. The return is the number of content bytes sent. The block can never
+  // be longer than the space after the headroom, so we clamp it before the
+  // footer goes in.
+  if (len > HTTP_DOWNLOAD_UNIT_SIZE)
+    len = HTTP_DOWNLOAD_UNIT_SIZE;
+  char* start = _respBuf + HTTP_CHUNK_HEADROOM;
+  size_t total = len;
+  size_t head = 0;
+  if (_chunked) {
+    char sizeLine[HTTP_CHUNK_HEADROOM + 1];
+    head = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned int)len);
+    start -= head;
+    memcpy(start, sizeLine, head);
+    memcpy(start + head + len, "\r\n", 2);
+    total += head + 2;
+    if (len == 0) {
       _chunked = false;
     }
   }
+  size_t sent = _currentClientWrite(start, total);
+  if (sent < head)
+    return 0;
+  return (sent - head > len)?len:sent - head;
 }
 
 
@@ -493,26 +579,22 @@ String WebServer::pathArg(unsigned int i) {
 }
 
 String WebServer::arg(String name) {
-  for (int j = 0; j < _postArgsLen; ++j) {
-	    if ( _postArgs[j].key == name )
-	      return _postArgs[j].value;
-	  }
   for (int i = 0; i < _currentArgCount; ++i) {
-    if ( _currentArgs[i].key == name )
-      return _currentArgs[i].value;
+    if ( _argKeyIs(_currentArgs[i], name) )
+      return _argValue(_currentArgs[i]);
   }
   return "";
 }
 
 String WebServer::arg(int i) {
   if (i < _currentArgCount)
-    return _currentArgs[i].value;
+    return _argValue(_currentArgs[i]);
   return "";
 }
 
 String WebServer::argName(int i) {
   if (i < _currentArgCount)
-    return _currentArgs[i].key;
+    return _argKey(_currentArgs[i]);
   return "";
 }
 
@@ -521,12 +603,8 @@ int WebServer::args() {
 }
 
 bool WebServer::hasArg(String  name) {
-  for (int j = 0; j < _postArgsLen; ++j) {
-	    if (_postArgs[j].key == name)
-	      return true;
-	  }
   for (int i = 0; i < _currentArgCount; ++i) {
-    if (_currentArgs[i].key == name)
+    if (_argKeyIs(_currentArgs[i], name))
       return true;
   }
   return false;
@@ -536,7 +614,7 @@ bool WebServer::hasArg(String  name) {
 String WebServer::header(String name) {
   for (int i = 0; i < _headerKeysCount; ++i) {
     if (_currentHeaders[i].key.equalsIgnoreCase(name))
-      return _currentHeaders[i].value;
+      return _argValue(_currentHeaders[i]);
   }
   return "";
 }
@@ -554,7 +632,7 @@ void WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeys
 
 String WebServer::header(int i) {
   if (i < _headerKeysCount)
-    return _currentHeaders[i].value;
+    return _argValue(_currentHeaders[i]);
   return "";
 }
 
@@ -570,14 +648,14 @@ int WebServer::headers() {
 
 bool WebServer::hasHeader(String name) {
   for (int i = 0; i < _headerKeysCount; ++i) {
-    if ((_currentHeaders[i].key.equalsIgnoreCase(name)) &&  (_currentHeaders[i].value.length() > 0))
+    if ((_currentHeaders[i].key.equalsIgnoreCase(name)) &&  (_argValue(_currentHeaders[i]).length() > 0))
       return true;
   }
   return false;
 }
 
 String WebServer::hostHeader() {
-  return _hostHeader;
+  return _viewString(_hostHeader, false);
 }
 
 void WebServer::onFileUpload(THandlerFunction fn) {
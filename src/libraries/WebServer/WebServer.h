@@ -38,11 +38,20 @@ enum HTTPClientStatus { HC_NONE, HC_WAIT_READ, HC_WAIT_CLOSE };
 enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
 
 #define HTTP_DOWNLOAD_UNIT_SIZE 1436
+#define HTTP_CHUNK_HEADROOM 8 //room for the chunk size line before a block
 
 #ifndef HTTP_UPLOAD_BUFLEN
 #define HTTP_UPLOAD_BUFLEN 1436
 #endif
 
+#ifndef HTTP_REQUEST_BUFLEN
+#define HTTP_REQUEST_BUFLEN 1460 //starting size of the request buffer
+#endif
+
+#ifndef WEBSERVER_MAX_POST_ARGS
+#define WEBSERVER_MAX_POST_ARGS 32 //starting size of the argument array
+#endif
+
 #define HTTP_MAX_DATA_WAIT 5000 //ms to wait for the client to send the request
 #define HTTP_MAX_POST_WAIT 5000 //ms to wait for POST data to arrive
 #define HTTP_MAX_SEND_WAIT 5000 //ms to wait for data chunk to be ACKed
@@ -64,6 +73,7 @@ typedef struct {
 } HTTPUpload;
 
 #include "detail/RequestHandler.h"
+#include "detail/RouteIndex.h"
 
 namespace fs {
 class FS;
@@ -87,6 +97,8 @@ public:
   void requestAuthentication(HTTPAuthMethod mode = BASIC_AUTH, const char* realm = NULL, const String& authFailMsg = String("") );
 
   typedef std::function<void(void)> THandlerFunction;
+  // fills up to maxLen bytes of the response and returns how many, 0 when done
+  typedef std::function<size_t(uint8_t* buffer, size_t maxLen)> TWriterFunction;
   void on(const String &uri, THandlerFunction handler);
   void on(const String &uri, HTTPMethod method, THandlerFunction fn);
   void on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
@@ -124,36 +136,73 @@ public:
   void send(int code, const String& content_type, const String& content);
   void send_P(int code, PGM_P content_type, PGM_P content);
   void send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength);
+  // content comes from the writer in blocks, chunked if the length is unknown
+  void send(int code, const char* content_type, TWriterFunction writer, size_t contentLength = CONTENT_LENGTH_UNKNOWN);
 
   void setContentLength(const size_t contentLength);
   void sendHeader(const String& name, const String& value, bool first = false);
   void sendContent(const String& content);
   void sendContent_P(PGM_P content);
   void sendContent_P(PGM_P content, size_t size);
+  void sendContent(const char* content, size_t size);
+  size_t sendContent(TWriterFunction writer);
 
   static String urlDecode(const String& text);
 
   template<typename T> 
   size_t streamFile(T &file, const String& contentType) {
     _streamFileCore(file.size(), file.name(), contentType);
-    return _currentClient.write(file);
+    return sendContent([&file](uint8_t* buffer, size_t maxLen) -> size_t {
+      int got = file.read(buffer, maxLen);
+      return (got > 0)?got:0;
+    });
   }
   
 protected:
+  // A piece of the request still sitting in the request buffer.
+  struct RequestView {
+    const char* ptr;
+    size_t len;
+  };
+
+  // Arguments and headers. While a view is set, the key or value is still
+  // only in the request buffer, and it is turned into the String the first
+  // time someone asks for it.
+  struct RequestArgument {
+    String key;
+    String value;
+    RequestView keyView = {nullptr, 0};
+    RequestView valueView = {nullptr, 0};
+    bool encoded = false;
+  };
+
   virtual size_t _currentClientWrite(const char* b, size_t l) { return _currentClient.write( b, l ); }
   virtual size_t _currentClientWrite_P(PGM_P b, size_t l) { return _currentClient.write_P( b, l ); }
   void _addRequestHandler(RequestHandler* handler);
   void _handleRequest();
   void _finalizeResponse();
   bool _parseRequest(WiFiClient& client);
-  void _parseArguments(String data);
+  bool _requestFill(WiFiClient& client, int timeout_ms);
+  bool _readRequestHead(WiFiClient& client, size_t& headEnd);
+  bool _readRequestBody(WiFiClient& client, size_t contentLength, RequestView& body);
+  String _requestReadLine(WiFiClient& client);
+  size_t _requestReadBytes(WiFiClient& client, uint8_t* buf, size_t len);
+  void _parseArguments(const RequestView& data);
+  RequestArgument& _addArg();
+  static String _viewString(const RequestView& view, bool decode);
+  const String& _argKey(RequestArgument& arg);
+  const String& _argValue(RequestArgument& arg);
+  bool _argKeyIs(RequestArgument& arg, const String& name);
+  void _clearArg(RequestArgument& arg);
   static String _responseCodeToString(int code);
   bool _parseForm(WiFiClient& client, String boundary, uint32_t len);
   bool _parseFormUploadAborted();
   void _uploadWriteByte(uint8_t b);
   int _uploadReadByte(WiFiClient& client);
   void _prepareHeader(String& response, int code, const char* content_type, size_t contentLength);
-  bool _collectHeader(const char* headerName, const char* headerValue);
+  void _sendContentBlocks(const char* content, size_t size, bool progmem);
+  size_t _writeBlock(size_t len);
+  bool _collectHeader(const RequestView& headerName, const RequestView& headerValue);
  
   void _streamFileCore(const size_t fileSize, const String & fileName, const String & contentType);
 
@@ -161,11 +210,6 @@ protected:
   // for extracting Auth parameters
   String _extractParam(String& authReq,const String& param,const char delimit = '"');
 
-  struct RequestArgument {
-    String key;
-    String value;
-  };
-
   WiFiServer  _server;
 
   WiFiClient  _currentClient;
@@ -178,13 +222,13 @@ protected:
   RequestHandler*  _currentHandler;
   RequestHandler*  _firstHandler;
   RequestHandler*  _lastHandler;
+  RouteIndex       _routes;
   THandlerFunction _notFoundHandler;
   THandlerFunction _fileUploadHandler;
 
   int              _currentArgCount;
+  int              _currentArgsSize;
   RequestArgument* _currentArgs;
-  int              _postArgsLen;
-  RequestArgument* _postArgs;
 
   std::unique_ptr<HTTPUpload> _currentUpload;
 
@@ -193,9 +237,23 @@ protected:
   size_t           _contentLength;
   String           _responseHeaders;
 
-  String           _hostHeader;
+  RequestView      _hostHeader;
   bool             _chunked;
 
+  // The request is read in bulk into this buffer. Anything after the end of
+  // the current request is kept for the next one. It starts with
+  // HTTP_REQUEST_BUFLEN bytes and grows when a request head does not fit.
+  char*            _reqBuf;
+  size_t           _reqSize;
+  size_t           _reqLen;
+  size_t           _reqPos;
+  char*            _bodyBuf;
+  size_t           _formLeft; //bytes of the form body not read yet
+
+  // Response blocks are put together here, with room around them for the
+  // chunk framing, so that each chunk leaves in a single write.
+  char             _respBuf[HTTP_CHUNK_HEADROOM + HTTP_DOWNLOAD_UNIT_SIZE + 2];
+
   String           _snonce;  // Store noance and opaque for future comparison
   String           _sopaque;
   String           _srealm;  // Store the Auth realm between Calls
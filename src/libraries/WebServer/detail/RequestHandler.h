@@ -32,6 +32,14 @@ public:
     virtual bool handle(WebServer& server, HTTPMethod requestMethod, String requestUri) { (void) server; (void) requestMethod; (void) requestUri; return false; }
     virtual void upload(WebServer& server, String requestUri, HTTPUpload& upload) { (void) server; (void) requestUri; (void) upload; }
 
+    // Route index support. A handler that answers only one URI, or only URIs
+    // starting with a fixed prefix, can say so and the server will find it
+    // without asking every handler. The default keeps the handler in the
+    // list that is checked one by one.
+    enum RouteKind { ROUTE_ANY, ROUTE_EXACT, ROUTE_PREFIX };
+    virtual RouteKind routeKind() { return ROUTE_ANY; }
+    virtual String routeUri() { return String(); }
+
     RequestHandler* next() { return _next; }
     void next(RequestHandler* r) { _next = r; }
 
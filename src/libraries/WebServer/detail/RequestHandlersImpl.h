@@ -86,6 +86,17 @@ public:
         return requestUriIndex >= requestUri.length();
     }
 
+    // Plain URIs go in the exact table. With path arguments we can only
+    // index the part before the first one.
+    RouteKind routeKind() override {
+        return (_uri.indexOf('{') < 0) ? ROUTE_EXACT : ROUTE_PREFIX;
+    }
+
+    String routeUri() override {
+        int brace = _uri.indexOf('{');
+        return (brace < 0) ? _uri : _uri.substring(0, brace);
+    }
+
     bool canUpload(String requestUri) override  {
         if (!_ufn || !canHandle(HTTP_POST, requestUri))
             return false;
@@ -140,6 +151,14 @@ public:
         return true;
     }
 
+    RouteKind routeKind() override {
+        return _isFile ? ROUTE_EXACT : ROUTE_PREFIX;
+    }
+
+    String routeUri() override {
+        return _uri;
+    }
+
     bool handle(WebServer& server, HTTPMethod requestMethod, String requestUri) override {
         if (!canHandle(requestMethod, requestUri))
             return false;
@@ -0,0 +1,95 @@
+/*
+  RouteIndex.cpp - Finds the request handler for a URI without walking them all.
+
+  Copyright (c) 2020 Glenn Ramalho - RFIDo Design. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include <algorithm>
+#include "WebServer.h"
+#include "RouteIndex.h"
+
+void RouteIndex::add(RequestHandler* handler) {
+  Entry entry;
+  entry.order = _count++;
+  entry.handler = handler;
+
+  switch (handler->routeKind()) {
+  case RequestHandler::ROUTE_EXACT:
+    _exact[std::string(handler->routeUri().c_str())].push_back(entry);
+    break;
+  case RequestHandler::ROUTE_PREFIX: {
+    // We walk down the trie, making the nodes we need, and leave the handler
+    // at the node for the last char of the prefix.
+    String prefix = handler->routeUri();
+    TrieNode* node = &_root;
+    for (unsigned int i = 0; i < prefix.length(); i++) {
+      TrieNode*& next = node->child[prefix[i]];
+      if (!next)
+        next = new TrieNode;
+      node = next;
+    }
+    node->handlers.push_back(entry);
+    break;
+  }
+  default:
+    _other.push_back(entry);
+    break;
+  }
+}
+
+RequestHandler* RouteIndex::find(HTTPMethod method, const String& uri) {
+  _candidates.clear();
+
+  // Handlers for exactly this URI.
+  std::unordered_map<std::string, std::vector<Entry> >::iterator exact =
+    _exact.find(std::string(uri.c_str()));
+  if (exact != _exact.end())
+    _candidates.insert(_candidates.end(), exact->second.begin(), exact->second.end());
+
+  // Handlers for every prefix of the URI, down the trie.
+  TrieNode* node = &_root;
+  _candidates.insert(_candidates.end(), node->handlers.begin(), node->handlers.end());
+  for (unsigned int i = 0; i < uri.length(); i++) {
+    std::map<char, TrieNode*>::iterator next = node->child.find(uri[i]);
+    if (next == node->child.end())
+      break;
+    node = next->second;
+    _candidates.insert(_candidates.end(), node->handlers.begin(), node->handlers.end());
+  }
+
+  // And the ones we know nothing about.
+  _candidates.insert(_candidates.end(), _other.begin(), _other.end());
+
+  // The first one registered that takes it wins, like in the chain.
+  if (_candidates.size() > 1)
+    std::sort(_candidates.begin(), _candidates.end(), _before);
+  for (std::vector<Entry>::iterator it = _candidates.begin(); it != _candidates.end(); ++it) {
+    if (it->handler->canHandle(method, uri))
+      return it->handler;
+  }
+  return nullptr;
+}
+
+void RouteIndex::_clear(TrieNode* node) {
+  // The handlers belong to the server, we only free the nodes.
+  for (std::map<char, TrieNode*>::iterator it = node->child.begin(); it != node->child.end(); ++it) {
+    _clear(it->second);
+    delete it->second;
+  }
+  node->child.clear();
+}
@@ -0,0 +1,66 @@
+/*
+  RouteIndex.h - Finds the request handler for a URI without walking them all.
+
+  Copyright (c) 2020 Glenn Ramalho - RFIDo Design. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+  Handlers for a single URI go in a hash table, handlers for everything under
+  a prefix go in a trie and the rest stay in a list. A lookup only asks the
+  handlers that could match, and it still returns the first one registered,
+  so the result is the same as walking the whole chain.
+*/
+
+#ifndef ROUTEINDEX_H
+#define ROUTEINDEX_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "WString.h"
+#include "HTTP_Method.h"
+
+class RequestHandler;
+
+class RouteIndex {
+public:
+  RouteIndex() : _count(0) { }
+  ~RouteIndex() { _clear(&_root); }
+
+  void add(RequestHandler* handler);
+  RequestHandler* find(HTTPMethod method, const String& uri);
+
+protected:
+  struct Entry {
+    unsigned int order;
+    RequestHandler* handler;
+  };
+  struct TrieNode {
+    std::map<char, TrieNode*> child;
+    std::vector<Entry> handlers;
+  };
+
+  void _clear(TrieNode* node);
+  static bool _before(const Entry& a, const Entry& b) { return a.order < b.order; }
+
+  std::unordered_map<std::string, std::vector<Entry> > _exact;
+  TrieNode _root;
+  std::vector<Entry> _other;
+  std::vector<Entry> _candidates;
+  unsigned int _count;
+};
+
+#endif //ROUTEINDEX_H
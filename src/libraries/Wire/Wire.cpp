@@ -44,6 +44,7 @@ extern "C" {
 #include "Wire.h"
 #include <systemc.h>
 #include "info.h"
+#include "i2c.h"
 
 //Some boards don't have these pins available, and hence don't support Wire.
 //Check here for compile-time error.
@@ -51,6 +52,11 @@ extern "C" {
 #error Wire library is not supported on this board
 #endif
 
+/* The I2C model driving each bus. */
+static i2c *wirebus(uint8_t num) {
+   return (num == 0)?i2c0ptr:i2c1ptr;
+}
+
 // Constructors ////////////////////////////////////////////////////////////////
 
 TwoWire::TwoWire(uint8_t bus_num)
@@ -62,6 +68,11 @@ TwoWire::TwoWire(uint8_t bus_num)
     ,_timeOutMillis(50)
 {
    transmitting = false;
+   tlm = false;
+   txAddress = 0;
+   txLength = 0;
+   rxIndex = 0;
+   rxLength = 0;
 }
 
 TwoWire::~TwoWire() {
@@ -132,7 +143,15 @@ bool TwoWire::begin(int sdaPin, int sclPin, uint32_t frequency)
 }
 
 void TwoWire::setClock(uint32_t frequency){
-   printf("Setting Frequency to %u\n", frequency);
+   PRINTF_INFO("WIRE", "Setting I2C %d Frequency to %u", num, frequency);
+   /* If we have not been initialized yet, we set the model directly. */
+   if (i2c != NULL) i2cSetFrequency(i2c, frequency);
+   else if (wirebus(num) != NULL) wirebus(num)->setfreq(frequency);
+}
+
+size_t TwoWire::getClock(){
+   if (wirebus(num) == NULL) return 0;
+   return wirebus(num)->getfreq();
 }
 
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop)
@@ -169,6 +188,26 @@ uint8_t TwoWire::requestFrom(uint16_t address, uint8_t quantity, int sendStop)
 
 uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool sendStop){
    unsigned int i, bit;
+
+   /* If the bus has slaves attached, we do the read as a single transaction
+    * and keep the data in the rxBuffer.
+    */
+   rxIndex = 0;
+   rxLength = 0;
+   tlm = wirebus(num) != NULL && wirebus(num)->istlm();
+   if (tlm) {
+      i2ctrans_t t;
+      if (size > I2C_BUFFER_LENGTH) size = I2C_BUFFER_LENGTH;
+      t.addr = address;
+      t.rd = true;
+      t.data.assign(size, 0xff);
+      t.stop = sendStop;
+      if (wirebus(num)->transport(t) != 0) return 0;
+      for(i = 0; i < size; i = i + 1) rxBuffer[i] = t.data[i];
+      rxLength = size;
+      return size;
+   }
+
    /* We are starting a new command, so we dump anything in the fifo from the
     * previous command.
     */
@@ -207,6 +246,17 @@ uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool sendStop){
 }
 
 void TwoWire::beginTransmission(uint8_t address){
+   /* In transaction level mode we just collect the bytes until the
+    * endTransmission.
+    */
+   tlm = wirebus(num) != NULL && wirebus(num)->istlm();
+   if (tlm) {
+      txAddress = address;
+      txLength = 0;
+      transmitting = true;
+      return;
+   }
+
    /* We are starting a new command, so we dump anything in the fifo from the
     * previous command.
     */
@@ -232,6 +282,19 @@ void TwoWire::beginTransmission(int address){
 }
 
 uint8_t TwoWire::endTransmission(bool sendStop){
+  /* In transaction level mode, this is where the transfer happens. */
+  if (tlm) {
+     i2ctrans_t t;
+     if (!transmitting) return 4;
+     t.addr = txAddress;
+     t.rd = false;
+     t.data.assign(txBuffer, txBuffer + txLength);
+     t.stop = sendStop;
+     transmitting = false;
+     txLength = 0;
+     return wirebus(num)->transport(t);
+  }
+
   /* We send the stop bit. */
   if (sendStop) to->write('P');
   transmitting = false;
@@ -244,6 +307,12 @@ uint8_t TwoWire::endTransmission(void){
 
 size_t TwoWire::write(uint8_t data) {
    if (!transmitting) return 0;
+   if (tlm) {
+      if (txLength >= I2C_BUFFER_LENGTH) return 0;
+      txBuffer[txLength] = data;
+      txLength = txLength + 1;
+      return 1;
+   }
    if (to->num_free() < 9 || from->num_free() < 1) {
       SC_REPORT_ERROR("WIRE", "write err: I2C Fifo Full");
       return 0;
@@ -275,13 +344,27 @@ bool TwoWire::writebin(uint8_t data, int bits) {
 
 size_t TwoWire::write(const uint8_t *data, size_t size) {
    unsigned int i;
+   if (tlm) {
+      for(i = 0; i < size; i = i + 1) if (write(data[i]) == 0) return i;
+      return size;
+   }
    for(i = 0; i < size; i = i + 1) {
       writebin(data[i], 8);
    }
    return size;
 }
 
+int TwoWire::available() {
+   if (tlm) return rxLength - rxIndex;
+   return TestSerial::available();
+}
+
 int TwoWire::read() {
+   if (tlm) {
+      if (rxIndex >= rxLength) return -1;
+      rxIndex = rxIndex + 1;
+      return rxBuffer[rxIndex - 1];
+   }
    if (taken) {
       taken = false;
       return waiting;
@@ -300,6 +383,10 @@ int TwoWire::read() {
 }
 
 int TwoWire::peek() {
+   if (tlm) {
+      if (rxIndex >= rxLength) return -1;
+      return rxBuffer[rxIndex];
+   }
    if (taken) return waiting;
    else if (from->num_available() < 8) return -1;
    else {
@@ -40,6 +40,8 @@
 #include "TestSerial.h"
 #include "esp32-hal-i2c.h"
 
+#define I2C_BUFFER_LENGTH 128
+
 class TwoWire : public TestSerial
 {
 protected:
@@ -49,6 +51,14 @@ protected:
     i2c_t * i2c;
 
     bool transmitting;
+    /* Buffers for when the I2C is in transaction level mode. */
+    bool tlm;
+    uint16_t txAddress;
+    uint8_t txBuffer[I2C_BUFFER_LENGTH];
+    uint16_t txLength;
+    uint8_t rxBuffer[I2C_BUFFER_LENGTH];
+    uint16_t rxIndex;
+    uint16_t rxLength;
     i2c_err_t last_error; // @stickBreaker from esp32-hal-i2c.h
     uint16_t _timeOutMillis;
 
@@ -90,7 +100,7 @@ public:
     size_t write(const uint8_t *, size_t);
     size_t send(uint8_t i) { return write(i); }
     int receive(void) { return read(); }
-    //int available(void);
+    int available(void);
     int read(void);
     int peek(void);
     void flush(void);
@@ -0,0 +1,36 @@
+/*******************************************************************************
+ * adcsrc.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Interface for a stimulus source connected straight to an ADC channel.
+ *   When a channel has a source, the ADC asks it for the voltage when it
+ *   takes a sample instead of reading the analog net, so the source does
+ *   not need to generate any events between samples.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _ADCSRC_H
+#define _ADCSRC_H
+
+#include <systemc.h>
+
+class adcsrc_if {
+   public:
+   /* Returns the voltage at the time t. */
+   virtual float adclevel(const sc_time &t) = 0;
+   virtual ~adcsrc_if() {}
+};
+
+#endif
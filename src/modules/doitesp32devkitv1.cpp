@@ -30,6 +30,18 @@
 #include "reset_reason.h"
 #include "soc/spi_struct.h"
 #include "nvs_flash.h"
+#include "freertos/rtossched.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_task_wdt.h"
+#include "esp_int_wdt.h"
+#include "soc/pcnt_struct.h"
+
+/* The loop task handle and the loop watchdog flag used by the Arduino
+ * enableLoopWDT(). In the model the loop task is the dut thread.
+ */
+TaskHandle_t loopTaskHandle = NULL;
+bool loopTaskWDTEnabled;
 
 /* For lack of a better place, this goes here. The ESP32 has a temperature
  * sensor which returns the internal temperature in Farenheight. It seems
@@ -56,20 +68,46 @@ void doitesp32devkitv1::dut(void) {
       wait(50, SC_MS);
    }
 
-   /* We start running the Arduino Setup Function. */
-   setup();
-
-   /* Now we run repeatedly the Arduino loop function. */
    for (;;) {
-      loop();
-
-      /* For now we have no way to restart the simulation, so we stop it and
-       * a new simulation needs to be ran with the post-software reset flow.
+      /* Anything that sends the firmware back to the start, like a wake up
+       * from deep sleep or a software reset, throws it out of setup() or
+       * loop() and we begin again from here. All the globals are kept, as is
+       * the RTC memory.
        */
-      if (ctrlregs.return_to_start) {
-         ctrlregs.return_to_start = false;
-         PRINTF_INFO("DUT", "Software reset was called.");
-         sc_stop();
+      /* The startup code starts the watchdogs as set in the sdkconfig. */
+#if CONFIG_INT_WDT
+      esp_int_wdt_init();
+#endif
+#if CONFIG_TASK_WDT
+#if CONFIG_TASK_WDT_PANIC
+      esp_task_wdt_init(CONFIG_TASK_WDT_TIMEOUT_S, true);
+#else
+      esp_task_wdt_init(CONFIG_TASK_WDT_TIMEOUT_S, false);
+#endif
+#if CONFIG_TASK_WDT_CHECK_IDLE_TASK_CPU0
+      esp_task_wdt_add(xTaskGetIdleTaskHandleForCPU(0));
+#endif
+#if CONFIG_TASK_WDT_CHECK_IDLE_TASK_CPU1
+      esp_task_wdt_add(xTaskGetIdleTaskHandleForCPU(1));
+#endif
+#endif
+      loopTaskHandle = xTaskGetCurrentTaskHandle();
+      loopTaskWDTEnabled = false;
+
+      try {
+         /* We start running the Arduino Setup Function. */
+         setup();
+
+         /* Now we run repeatedly the Arduino loop function. */
+         for (;;) {
+            if (loopTaskWDTEnabled) esp_task_wdt_reset();
+            loop();
+         }
+      }
+      catch (espm_restart_ex &) {
+         PRINTF_INFO("DUT", "Chip reset, returning to setup().");
+         chipreset();
+         esp_reset_reason_init();
       }
    }
 }
@@ -94,10 +132,42 @@ void doitesp32devkitv1::start_of_simulation() {
    /* We initialize the reset reason to the state after the boot loader. */
    ctrlregs.cpu0_reset_reason = RTCWDT_RTC_RESET;
    ctrlregs.cpu1_reset_reason = EXT_CPU_RESET;
-   ctrlregs.return_to_start = false;
+   ctrlregs.wakeup_cause = NO_SLEEP;
    esp_reset_reason_init();
 }
 
+void doitesp32devkitv1::chipreset() {
+   /* The tasks, the timers and the watchdogs of the firmware go away. */
+   espm_task_wdt_reset();
+   espm_int_wdt_reset();
+   rtosreset();
+   espm_timer_reset();
+   espm_sleep_reset();
+
+   /* The peripheral registers go back to their reset values and the models
+    * take them in as if the firmware had written them. The PCNT counters
+    * are cleared by holding them in reset, all the reset bits of the ctrl
+    * register, for a moment.
+    */
+   i_ledc.initstruct();
+   i_ledc.update();
+   i_pcnt.initstruct();
+   PCNT.ctrl.val = 0x5555;
+   i_pcnt.update();
+   i_pcnt.initstruct();
+   i_pcnt.update();
+   i_gpio_matrix.initstruct();
+   i_gpio_matrix.update();
+   i_hspi.configure(&SPI2);
+   i_hspi.update();
+   i_vspi.configure(&SPI3);
+   i_vspi.update();
+   i_timg0.configure(&TIMERG0);
+   i_timg0.update();
+   i_timg1.configure(&TIMERG1);
+   i_timg1.update();
+}
+
 void doitesp32devkitv1::pininit() {
    /* We set each GPIO to be connected to a pin number in the ESPMOD library. */
    pinset(0, &i_gpio_matrix.i_mux_d0);
@@ -149,6 +219,10 @@ void doitesp32devkitv1::pininit() {
    vspiptr = &i_vspi;
    i_hspi.configure(&SPI2);
    i_vspi.configure(&SPI3);
+   timg0ptr = &i_timg0;
+   timg1ptr = &i_timg1;
+   i_timg0.configure(&TIMERG0);
+   i_timg1.configure(&TIMERG1);
 
    /* We configure the serial protocols. Each TestSerial needs to be connected
     * to the channel it controls.
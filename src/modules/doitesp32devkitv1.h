@@ -35,6 +35,7 @@
 #include "ctrlregs.h"
 #include "spimod.h"
 #include "i2c.h"
+#include "timgmod.h"
 
 SC_MODULE(doitesp32devkitv1) {
    /* Pins */
@@ -87,6 +88,8 @@ SC_MODULE(doitesp32devkitv1) {
    cchan i_uflash {"i_uflash", 256*4, 256*4}; /* Actually this is a QSPI */
    i2c i_i2c0 {"i_i2c0"};
    i2c i_i2c1 {"i_i2c1"};
+   timgmod i_timg0{"i_timg0"};
+   timgmod i_timg1{"i_timg1"};
    espintr i_espintr{"i_espintr"};
 
    /* Not sure what is the real interface, but this one works as it is not
@@ -126,6 +129,18 @@ SC_MODULE(doitesp32devkitv1) {
    sc_signal<bool> ledc_sig_ls_6{"ledc_sig_ls_6"};
    sc_signal<bool> ledc_sig_ls_7{"ledc_sig_ls_7"};
    sc_signal<bool> ledc_intr{"ledc_intr"};
+   sc_signal<bool> pcnt_intr{"pcnt_intr"};
+   sc_signal<bool> hspi_intr{"hspi_intr"};
+   sc_signal<bool> vspi_intr{"vspi_intr"};
+   sc_signal<bool> gpio_intr{"gpio_intr"};
+   sc_signal<bool> tg0_t0_intr{"tg0_t0_intr"};
+   sc_signal<bool> tg0_t1_intr{"tg0_t1_intr"};
+   sc_signal<bool> tg0_t0_edge{"tg0_t0_edge"};
+   sc_signal<bool> tg0_t1_edge{"tg0_t1_edge"};
+   sc_signal<bool> tg1_t0_intr{"tg1_t0_intr"};
+   sc_signal<bool> tg1_t1_intr{"tg1_t1_intr"};
+   sc_signal<bool> tg1_t0_edge{"tg1_t0_edge"};
+   sc_signal<bool> tg1_t1_edge{"tg1_t1_edge"};
    sc_signal<bool> hspi_d_out{"hspi_d_out"};
    sc_signal<bool> hspi_d_in{"hspi_d_in"};
    sc_signal<bool> hspi_d_oe{"hspi_d_oe"};
@@ -206,6 +221,9 @@ SC_MODULE(doitesp32devkitv1) {
       i_uart0.rx(uart0rx); i_uart0.tx(uart0tx);
       i_uart1.rx(uart1rx); i_uart1.tx(uart1tx);
       i_uart2.rx(uart2rx); i_uart2.tx(uart2tx);
+      i_uart0.set_gated(true);
+      i_uart1.set_gated(true);
+      i_uart2.set_gated(true);
       i_uflash.rx(frx);
       i_uflash.tx(ftx);
       i_uwifi.rx(wrx);
@@ -364,12 +382,39 @@ SC_MODULE(doitesp32devkitv1) {
       i_ledc.sig_out_ls_o(ledc_sig_ls_6); i_ledc.sig_out_ls_o(ledc_sig_ls_7);
       i_ledc.intr_o(ledc_intr);
 
-      i_espintr.ledc_intr_i(ledc_intr);
+      i_pcnt.intr_o(pcnt_intr);
+      i_hspi.intr_o(hspi_intr);
+      i_vspi.intr_o(vspi_intr);
+      i_gpio_matrix.intr_o(gpio_intr);
+      i_timg0.t0_intr_o(tg0_t0_intr); i_timg0.t1_intr_o(tg0_t1_intr);
+      i_timg0.t0_edge_o(tg0_t0_edge); i_timg0.t1_edge_o(tg0_t1_edge);
+      i_timg1.t0_intr_o(tg1_t0_intr); i_timg1.t1_intr_o(tg1_t1_intr);
+      i_timg1.t0_edge_o(tg1_t0_edge); i_timg1.t1_edge_o(tg1_t1_edge);
+
+      /* The interrupt lines go to the interrupt matrix by source number. */
+      i_espintr.connect(ETS_LEDC_INTR_SOURCE, ledc_intr);
+      i_espintr.connect(ETS_PCNT_INTR_SOURCE, pcnt_intr);
+      i_espintr.connect(ETS_SPI2_INTR_SOURCE, hspi_intr);
+      i_espintr.connect(ETS_SPI3_INTR_SOURCE, vspi_intr);
+      i_espintr.connect(ETS_GPIO_INTR_SOURCE, gpio_intr);
+      i_espintr.connect(ETS_TG0_T0_LEVEL_INTR_SOURCE, tg0_t0_intr);
+      i_espintr.connect(ETS_TG0_T1_LEVEL_INTR_SOURCE, tg0_t1_intr);
+      i_espintr.connect(ETS_TG0_T0_EDGE_INTR_SOURCE, tg0_t0_edge);
+      i_espintr.connect(ETS_TG0_T1_EDGE_INTR_SOURCE, tg0_t1_edge);
+      i_espintr.connect(ETS_TG1_T0_LEVEL_INTR_SOURCE, tg1_t0_intr);
+      i_espintr.connect(ETS_TG1_T1_LEVEL_INTR_SOURCE, tg1_t1_intr);
+      i_espintr.connect(ETS_TG1_T0_EDGE_INTR_SOURCE, tg1_t0_edge);
+      i_espintr.connect(ETS_TG1_T1_EDGE_INTR_SOURCE, tg1_t1_edge);
 
       SC_THREAD(dut);
+      ctrlregs.dut = sc_get_last_created_process_handle();
    }
 
    void pininit();
+   /* Puts the chip back as it is after a reset, all but the flash and the
+    * RTC memory.
+    */
+   void chipreset();
    void start_of_simulation();
    void trace(sc_trace_file *tf);
 };
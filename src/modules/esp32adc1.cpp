@@ -59,7 +59,10 @@ int esp32adc1::getraw() {
    if (busy()) return -1;
    if (corrupted) return -1;
    if (!power_on) return false;
-   switch(runningonchannel) {
+   if (runningonchannel >= 0 && runningonchannel < 8
+         && src[runningonchannel] != NULL)
+      sample = src[runningonchannel]->adclevel(sc_time_stamp());
+   else switch(runningonchannel) {
       case 0: sample = channel_0->read().lvl; break;
       case 1: sample = channel_1->read().lvl; break;
       case 2: sample = channel_2->read().lvl; break;
@@ -138,6 +141,15 @@ void esp32adc1::set_atten(int channel, adc_atten_t _a) {
    atten[channel] = _a;
 }
 
+void esp32adc1::set_source(int channel, adcsrc_if *s) {
+   if (channel < 0 || channel > 7) {
+      PRINTF_WARN("ADC1",
+         "Attempting to set the source of illegal channel %d", channel);
+      return;
+   }
+   src[channel] = s;
+}
+
 void esp32adc1::switchon(bool on) {
    corrupted = true;
    endtime = SC_ZERO_TIME;
@@ -24,6 +24,7 @@
 #include <systemc.h>
 #include "driver/adc.h"
 #include "gn_mixed.h"
+#include "adcsrc.h"
 
 SC_MODULE(esp32adc1) {
    public:
@@ -43,6 +44,7 @@ SC_MODULE(esp32adc1) {
    int runningonchannel;
    bool power_on;
    bool corrupted;
+   adcsrc_if *src[8];
 
    public:
    void soc(int channel);
@@ -54,6 +56,10 @@ SC_MODULE(esp32adc1) {
    void set_atten(int channel, adc_atten_t atten);
    adc_atten_t get_atten(int channel);
    void switchon(bool on);
+   /* Takes the channel from a stimulus source instead of its pin. Passing
+    * NULL goes back to the pin.
+    */
+   void set_source(int channel, adcsrc_if *s);
 
    SC_CTOR(esp32adc1) {
       atten[0] = ADC_ATTEN_DB_0;
@@ -64,6 +70,7 @@ SC_MODULE(esp32adc1) {
       atten[5] = ADC_ATTEN_DB_0;
       atten[6] = ADC_ATTEN_DB_0;
       atten[7] = ADC_ATTEN_DB_0;
+      for(int ch = 0; ch < 8; ch = ch + 1) src[ch] = NULL;
       runningonchannel = -1;
       endtime = SC_ZERO_TIME;
       corrupted = true;
@@ -64,7 +64,10 @@ int esp32adc2::getraw() {
    if (!power_on) return false;
    /* If the wifi is on nothing can be measured. */
    if (wifistat.initialized) return -1;
-   switch(runningonchannel) {
+   if (runningonchannel >= 0 && runningonchannel < 10
+         && src[runningonchannel] != NULL)
+      sample = src[runningonchannel]->adclevel(sc_time_stamp());
+   else switch(runningonchannel) {
       case 0: sample = channel_0->read().lvl; break;
       case 1: sample = channel_1->read().lvl; break;
       case 2: sample = channel_2->read().lvl; break;
@@ -145,6 +148,15 @@ void esp32adc2::set_atten(int channel, adc_atten_t _a) {
    atten[channel] = _a;
 }
 
+void esp32adc2::set_source(int channel, adcsrc_if *s) {
+   if (channel < 0 || channel > 9) {
+      PRINTF_WARN("ADC2",
+         "Attempting to set the source of illegal channel %d", channel);
+      return;
+   }
+   src[channel] = s;
+}
+
 void esp32adc2::switchon(bool on) {
    corrupted = true;
    endtime = SC_ZERO_TIME;
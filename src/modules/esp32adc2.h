@@ -24,6 +24,7 @@
 #include <systemc.h>
 #include "driver/adc.h"
 #include "gn_mixed.h"
+#include "adcsrc.h"
 
 class esp32adc2 : public sc_module {
    public:
@@ -45,6 +46,7 @@ class esp32adc2 : public sc_module {
    int runningonchannel;
    bool power_on;
    bool corrupted;
+   adcsrc_if *src[10];
 
    public:
    void soc(int channel);
@@ -56,6 +58,10 @@ class esp32adc2 : public sc_module {
    void set_atten(int channel, adc_atten_t atten);
    adc_atten_t get_atten(int channel);
    void switchon(bool on);
+   /* Takes the channel from a stimulus source instead of its pin. Passing
+    * NULL goes back to the pin.
+    */
+   void set_source(int channel, adcsrc_if *s);
 
    SC_CTOR(esp32adc2) {
       atten[0] = ADC_ATTEN_DB_0;
@@ -68,6 +74,7 @@ class esp32adc2 : public sc_module {
       atten[7] = ADC_ATTEN_DB_0;
       atten[8] = ADC_ATTEN_DB_0;
       atten[9] = ADC_ATTEN_DB_0;
+      for(int ch = 0; ch < 10; ch = ch + 1) src[ch] = NULL;
       runningonchannel = -1;
       endtime = SC_ZERO_TIME;
       corrupted = true;
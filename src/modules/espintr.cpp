@@ -23,6 +23,8 @@
 #include "espintr.h"
 #include "soc/soc.h"
 #include "esp_intr_alloc.h"
+#include "esp_int_wdt.h"
+#include "clockpacer.h"
 #include "Arduino.h"
 
 void espintr::initialize() {
@@ -30,6 +32,11 @@ void espintr::initialize() {
    for (i = 0; i < ESPM_INTR_TABLE; i = i + 1) {
       table_pro[i] = -1;
       table_app[i] = -1;
+      swsrc[i] = false;
+   }
+   for (i = 0; i < 2; i = i + 1) {
+      maskset[i] = 0;
+      maskclr[i] = 0;
    }
    for (i = 0; i < XCHAL_NUM_INTERRUPTS; i = i + 1) {
       handler_pro[i].fn = NULL;
@@ -41,100 +48,147 @@ void espintr::initialize() {
 
 void espintr::catcher() {
    uint32_t pro_lvl, app_lvl;
+   bool lvl[ESPM_INTR_TABLE];
+   int src, p;
    while(true) {
       wait();
-      /* We collect all signals into one set of busses. */
+      /* We collect all sources, from the ports and the ones raised by
+       * software.
+       */
+      for (src = 0; src < ESPM_INTR_TABLE; src = src + 1) lvl[src] = swsrc[src];
+      for (p = 0; p < intr_i.size(); p = p + 1)
+         if (intr_i[p]->read()) lvl[srcno[p]] = true;
+
+      /* And we route them to the CPU interrupts they were allocated to. */
       pro_lvl = 0;
       app_lvl = 0;
-
-      if (ledc_intr_i.read() && table_pro[ETS_LEDC_INTR_SOURCE] != -1)
-         pro_lvl = pro_lvl | (1<<table_pro[ETS_LEDC_INTR_SOURCE]);
-      if (ledc_intr_i.read() && table_app[ETS_LEDC_INTR_SOURCE] != -1)
-         app_lvl = app_lvl | (1<<table_app[ETS_LEDC_INTR_SOURCE]);
+      for (src = 0; src < ESPM_INTR_TABLE; src = src + 1) {
+         if (!lvl[src]) continue;
+         if (table_pro[src] != -1) pro_lvl = pro_lvl | (1u<<table_pro[src]);
+         if (table_app[src] != -1) app_lvl = app_lvl | (1u<<table_app[src]);
+      }
 
       /* Once we are done we set the new values for raw and intr. */
       raw_pro.write(pro_lvl);
       intr_pro.write(mask_pro.read() & pro_lvl);
       raw_app.write(app_lvl);
-      intr_app.write(mask_pro.read() & app_lvl);
+      intr_app.write(mask_app.read() & app_lvl);
    }
 }
 
-int espintr::get_next(uint32_t edgemask, uint32_t now, uint32_t last) {
-   /* Any bits that are edge triggered, we take the value for last. Any that
-    * are not, we take the inverse of now forcing an edge trigger.
+/* CPU interrupts in each priority level, from the NMI down to level 1. */
+static const uint32_t levelmask[] = {
+   (1u<<14),
+   (1u<<16) | (1u<<26) | (1u<<31),
+   (1u<<24) | (1u<<25) | (1u<<28) | (1u<<30),
+   (1u<<11) | (1u<<15) | (1u<<22) | (1u<<23) | (1u<<27) | (1u<<29),
+   (1u<<19) | (1u<<20) | (1u<<21),
+   0x000637ffu
+};
+
+int espintr::get_next(uint32_t pending) {
+   unsigned int l;
+   uint32_t m;
+   /* We take the highest level with something pending, and in it the
+    * highest numbered interrupt.
     */
-   uint32_t lm = last & edgemask | ~now & ~edgemask;
-   /* Priority NMI */
-   if ((now & (1<<14))>0) return 14;
-   /* Priority 5 */
-   if ((now & ~last & (1<<16))>0) return 16; /* Timer style */
-   if ((now & ~lm & (1<<26))>0) return 26;
-   if ((now & ~lm & (1<<31))>0) return 31;
-   /* Priority 4 */
-   if ((now & ~lm & (1<<24))>0) return 24;
-   if ((now & ~lm & (1<<25))>0) return 25;
-   if ((now & ~lm & (1<<28))>0) return 28;
-   if ((now & ~lm & (1<<30))>0) return 30;
-   /* Priority 3 */
-   if ((now & ~last & (1<<11))>0) return 11; /* Profiling */
-   if ((now & ~last & (1<<15))>0) return 15; /* Timer */
-   if ((now & ~lm & (1<<22))>0) return 22;
-   if ((now & ~lm & (1<<23))>0) return 23;
-   if ((now & ~lm & (1<<27))>0) return 27;
-   if ((now & ~last & (1<<29))>0) return 29; /* Software */
-   /* Priority 2 */
-   if ((now & ~lm & (1<<19))>0) return 19;
-   if ((now & ~lm & (1<<20))>0) return 20;
-   if ((now & ~lm & (1<<21))>0) return 21;
-   /* Priority 1 */
-   if ((now & ~lm & (1<<0))>0) return 0;
-   if ((now & ~lm & (1<<1))>0) return 1;
-   if ((now & ~lm & (1<<2))>0) return 2;
-   if ((now & ~lm & (1<<3))>0) return 3;
-   if ((now & ~lm & (1<<4))>0) return 4;
-   if ((now & ~lm & (1<<5))>0) return 5;
-   if ((now & ~last & (1<<6))>0) return 6; /* Timer */
-   if ((now & ~last & (1<<7))>0) return 7; /* Software */
-   if ((now & ~lm & (1<<8))>0) return 8;
-   if ((now & ~lm & (1<<9))>0) return 9;
-   if ((now & ~lm & (1<<10))>0) return 10;
-   if ((now & ~lm & (1<<12))>0) return 12;
-   if ((now & ~lm & (1<<13))>0) return 13;
-   if ((now & ~lm & (1<<17))>0) return 17;
-   if ((now & ~lm & (1<<18))>0) return 18;
+   for (l = 0; l < sizeof(levelmask)/sizeof(levelmask[0]); l = l + 1) {
+      m = pending & levelmask[l];
+      if (m != 0) return 31 - __builtin_clz(m);
+   }
    return -1;
 }
 
-void espintr::driver_app() {
-   uint32_t last = 0;
+uint32_t espintr::get_pending(int cpu, uint32_t now, uint32_t last) {
+   uint32_t edgemask;
+
+   if (cpu == 0) edgemask = edge_interrupt_pro.read() | ESPM_INTR_INTERNAL;
+   else edgemask = edge_interrupt_app.read() | ESPM_INTR_INTERNAL;
+
+   /* Edge triggered interrupts are only pending if they just rose, level
+    * ones whenever they are high.
+    */
+   return now & ~(last & edgemask);
+}
+
+void espintr::service(int cpu, uint32_t pending) {
+   espm_intr_handler_t *h;
    int nextintr;
-   while(true) {
-      wait();
-      nextintr = get_next(edge_interrupt_app.read(), intr_app.read(), last);
-      last = intr_app.read();
-      if (nextintr >= 0 && handler_app[nextintr].fn != NULL)
-         (*handler_pro[nextintr].fn)(handler_pro[nextintr].arg);
+
+   if (cpu == 0) h = handler_pro;
+   else h = handler_app;
+
+   /* We run them all, in priority order. */
+   while ((nextintr = get_next(pending)) >= 0) {
+      pending = pending & ~(1u<<nextintr);
+      if (h[nextintr].fn != NULL) (*h[nextintr].fn)(h[nextintr].arg);
    }
 }
 
-void espintr::driver_pro() {
+/*************************
+ * Task: driver()
+ *************************
+ * Runs the handlers of one CPU. The handlers usually take some time, as
+ * they wait for the APB to write the registers, and the line can change
+ * while they run, so once they return we look at it again instead of waiting
+ * for it to change. Otherwise a clear and a new rise during the handlers
+ * would both be missed and the edge interrupt would never be taken again.
+ * Level interrupts still high are taken again too, after an APB clock, which
+ * also gives the clear the handler did time to reach the line.
+ */
+void espintr::driver(int cpu, sc_signal<uint32_t> &line) {
    uint32_t last = 0;
-   int nextintr;
+   uint32_t now, pending;
    while(true) {
       wait();
-      nextintr = get_next(edge_interrupt_pro.read(), intr_pro.read(), last);
-      last = intr_pro.read();
-      if (nextintr >= 0 && handler_pro[nextintr].fn != NULL)
-         (*handler_pro[nextintr].fn)(handler_pro[nextintr].arg);
+      now = line.read();
+      pending = get_pending(cpu, now, last);
+      if (pending == 0) {
+         last = now;
+         continue;
+      }
+
+      /* While the handlers run the CPU takes no other interrupts, which is
+       * what the interrupt watchdog checks. A level interrupt that is never
+       * cleared keeps the CPU here, so it is caught too.
+       */
+      espm_int_wdt_enter(cpu);
+      while (pending != 0) {
+         service(cpu, pending);
+         last = now;
+         now = line.read();
+         if (now == last && get_pending(cpu, now, last) != 0) {
+            clockpacer.wait_next_apb_clk();
+            now = line.read();
+         }
+         pending = get_pending(cpu, now, last);
+      }
+      last = now;
+      espm_int_wdt_exit(cpu);
    }
 }
 
+void espintr::driver_app() {
+   driver(1, intr_app);
+}
+
+void espintr::driver_pro() {
+   driver(0, intr_pro);
+}
+
+void espintr::restart(int cpu) {
+   if (cpu < 0 || cpu > 1 || !driver_h[cpu].valid()) return;
+   /* The reset unwinds the handler and starts the driver over, so it also
+    * forgets the interrupts it had seen.
+    */
+   driver_h[cpu].reset();
+}
+
 void espintr::maskupdate() {
-   if (setunset) mask_pro.write(mask_pro.read() | newmask);
-   else mask_pro.write(mask_pro.read() & ~newmask);
-   if (setunset) mask_app.write(mask_app.read() | newmask);
-   else mask_app.write(mask_app.read() & ~newmask);
+   mask_pro.write((mask_pro.read() | maskset[0]) & ~maskclr[0]);
+   mask_app.write((mask_app.read() | maskset[1]) & ~maskclr[1]);
+   maskset[0] = 0; maskclr[0] = 0;
+   maskset[1] = 0; maskclr[1] = 0;
 }
 
 void espintr::trace(sc_trace_file *tf) {
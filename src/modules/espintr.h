@@ -2,7 +2,10 @@
  * espintr.h -- Copyright 2019 (c) Glenn Ramalho - RFIDo Design
  *******************************************************************************
  * Description:
- * Implements a SystemC module for the ESP32 Interrupt Module
+ * Implements a SystemC module for the ESP32 Interrupt Module. Peripheral
+ * interrupt lines come in by source number and are routed, per CPU, to the
+ * CPU interrupt they were allocated to. Pending interrupts are run by level,
+ * highest first.
  *******************************************************************************
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +25,7 @@
 #define _ESPINTR_H
 
 #include <systemc.h>
+#include <vector>
 #include "soc/soc.h"
 
 typedef struct {
@@ -31,10 +35,16 @@ typedef struct {
 
 #define XCHAL_NUM_INTERRUPTS 32
 #define ESPM_INTR_TABLE ETS_CACHE_IA_INTR_SOURCE+1
+/* CPU interrupts that are not wired to the matrix, the timers, software and
+ * profiling ones. They always trigger on the edge.
+ */
+#define ESPM_INTR_INTERNAL ((1u<<6)|(1u<<7)|(1u<<11)|(1u<<15)|(1u<<16)|(1u<<29))
 SC_MODULE(espintr) {
    public:
-   /* Ports */
-   sc_in<bool> ledc_intr_i{"ledc_intr_i"};
+   /* Ports. Each peripheral interrupt line is bound with connect(), which
+    * records its source number.
+    */
+   sc_port<sc_signal_in_if<bool>,0,SC_ZERO_OR_MORE_BOUND> intr_i{"intr_i"};
 
    sc_signal<uint32_t> raw_app{"raw_app", 0};
    sc_signal<uint32_t> raw_pro{"raw_pro", 0};
@@ -50,6 +60,10 @@ SC_MODULE(espintr) {
    void driver_pro();
    void driver_app();
    void maskupdate();
+   /* Takes the CPU out of the handlers it is running, as a chip reset does.
+    * Its driver then waits for the next interrupt.
+    */
+   void restart(int cpu);
 
    /* Variables */
    int table_pro[ESPM_INTR_TABLE];
@@ -58,11 +72,21 @@ SC_MODULE(espintr) {
    espm_intr_handler_t handler_app[XCHAL_NUM_INTERRUPTS];
    sc_event recapture_ev;
 
-   /* Mask update variables */
+   /* Source number for each binding of intr_i, and the sources raised with
+    * raise() instead of a port.
+    */
    private:
-   uint32_t newmask;
-   bool procpu;
-   bool setunset;
+   std::vector<int> srcno;
+   bool swsrc[ESPM_INTR_TABLE];
+
+   /* Mask update variables. Changes are kept per CPU until maskupdate()
+    * takes them in, so a set and a clear in the same delta both count.
+    */
+   uint32_t maskset[2];
+   uint32_t maskclr[2];
+
+   /* Driver thread of each CPU, APP and PRO. */
+   sc_process_handle driver_h[2];
    public:
    sc_event maskupdate_ev;
 
@@ -80,26 +104,44 @@ SC_MODULE(espintr) {
          edge_interrupt_app.write(edge_interrupt_app.read() & ~edgemask);
    }
    void setintrmask(unsigned int mask, int cpu) {
-      newmask = mask;
-      setunset = true;
-      procpu = (cpu == 0);
+      if (cpu < 0 || cpu > 1) return;
+      maskset[cpu] = maskset[cpu] | mask;
+      maskclr[cpu] = maskclr[cpu] & ~mask;
       maskupdate_ev.notify();
    }
    void clrintrmask(unsigned int mask, int cpu) {
-      newmask = mask;
-      setunset = false;
-      procpu = (cpu == 0);
+      if (cpu < 0 || cpu > 1) return;
+      maskclr[cpu] = maskclr[cpu] | mask;
+      maskset[cpu] = maskset[cpu] & ~mask;
       maskupdate_ev.notify();
    }
    unsigned int getintrmask(int cpu) {
-      if (cpu == 0) return mask_pro.read();
-      else return mask_app.read();
+      /* We include the changes not yet taken in. */
+      if (cpu == 0) return (mask_pro.read() | maskset[0]) & ~maskclr[0];
+      else return (mask_app.read() | maskset[1]) & ~maskclr[1];
+   }
+   /* Peripheral interrupt lines. */
+   void connect(int src, sc_signal_in_if<bool> &s) {
+      intr_i(s);
+      srcno.push_back(src);
+   }
+   void raise(int src) {
+      if (src < 0 || src >= ESPM_INTR_TABLE) return;
+      swsrc[src] = true;
+      recapture_ev.notify();
+   }
+   void lower(int src) {
+      if (src < 0 || src >= ESPM_INTR_TABLE) return;
+      swsrc[src] = false;
+      recapture_ev.notify();
    }
    int alloc(int cpu, int _ets, int _no) {
       if (_ets < 0 || _ets >= ESPM_INTR_TABLE) return -1;
       if (cpu < 0 || cpu > 1) return -1;
       if (cpu == 0) table_pro[_ets] = _no;
       else table_app[_ets] = _no;
+      /* The source might already be raised. */
+      recapture_ev.notify();
       return 0;
    }
    int dealloc(int cpu, int _ets) {
@@ -137,6 +179,7 @@ SC_MODULE(espintr) {
          handler_app[_no].fn = NULL;
          handler_app[_no].arg = NULL;
       }
+      return 0;
    }
    bool has_handler(int cpu, int _no) {
       if (_no < 0 || _no > 31) return -1;
@@ -146,7 +189,10 @@ SC_MODULE(espintr) {
    }
    private:
    void initialize();
-   int get_next(uint32_t edgemask, uint32_t now, uint32_t last);
+   int get_next(uint32_t pending);
+   uint32_t get_pending(int cpu, uint32_t now, uint32_t last);
+   void service(int cpu, uint32_t pending);
+   void driver(int cpu, sc_signal<uint32_t> &line);
    public:
    
    SC_CTOR(espintr) {
@@ -156,13 +202,15 @@ SC_MODULE(espintr) {
       initialize();
       /* Then we can set the interrupts. We watch every signal plus the mask. */
       SC_THREAD(catcher);
-      sensitive << ledc_intr_i << mask_app << mask_pro << recapture_ev;
+      sensitive << intr_i << mask_app << mask_pro << recapture_ev;
 
       /* The driver is sensitive only to the interrupts. */
       SC_THREAD(driver_app);
       sensitive << intr_app;
+      driver_h[1] = sc_get_last_created_process_handle();
       SC_THREAD(driver_pro);
       sensitive << intr_pro;
+      driver_h[0] = sc_get_last_created_process_handle();
       SC_METHOD(maskupdate);
       sensitive << maskupdate_ev;
    }
@@ -23,6 +23,7 @@
 #include "gpio_matrix.h"
 #include "setfield.h"
 #include "soc/gpio_reg.h"
+#include "driver/gpio.h"
 #include "gpioset.h"
 #include "soc/gpio_sig_map.h"
 #include "clockpacer.h"
@@ -165,6 +166,80 @@ void gpio_matrix::applyoecsbits() {
    GPIO.enable1_w1ts.data = 0; GPIO.enable1_w1tc.data = 0;
 }
 
+void gpio_matrix::applystbits() {
+   intrst = intrst & ~((uint64_t)GPIO.status1_w1tc.intr_st << 32
+      | GPIO.status_w1tc);
+   intrst = intrst | ((uint64_t)GPIO.status1_w1ts.intr_st << 32
+      | GPIO.status_w1ts);
+   GPIO.status_w1ts = 0; GPIO.status_w1tc = 0;
+   GPIO.status1_w1ts.intr_st = 0; GPIO.status1_w1tc.intr_st = 0;
+}
+
+void gpio_matrix::intrth() {
+   int bit;
+   bool lvl, hit;
+   uint64_t app, pro, watched;
+   sc_event_or_list watch;
+
+   for(bit = 0; bit < GPIOMATRIX_CNT; bit = bit + 1)
+      lastlvl[bit] = min_s[bit].read();
+
+   while(true) {
+      /* We only watch the pins that have a trigger set. If none has, we only
+       * wake up when the registers change.
+       */
+      watch = update_ev;
+      watched = 0;
+      for(bit = 0; bit < GPIOMATRIX_CNT; bit = bit + 1) {
+         if (GPIO.pin[bit].int_type == 0) continue;
+         watch |= min_s[bit].value_changed_event();
+         watched = watched | ((uint64_t)1 << bit);
+      }
+      wait(watch);
+
+      /* We take in any status set or clear done by the firmware. */
+      applystbits();
+
+      /* Then we check each pin for its trigger. Level ones stay set while
+       * the level holds, even if the firmware clears them. A pin we were
+       * not watching has no edge, it only just got its trigger.
+       */
+      for(bit = 0; bit < GPIOMATRIX_CNT; bit = bit + 1) {
+         lvl = min_s[bit].read();
+         if ((watched & ((uint64_t)1 << bit)) == 0) lastlvl[bit] = lvl;
+         switch(GPIO.pin[bit].int_type) {
+            case 1: hit = lvl && !lastlvl[bit]; break;
+            case 2: hit = !lvl && lastlvl[bit]; break;
+            case 3: hit = lvl != lastlvl[bit]; break;
+            case 4: hit = !lvl; break;
+            case 5: hit = lvl; break;
+            default: hit = false; break;
+         }
+         if (hit) intrst = intrst | ((uint64_t)1 << bit);
+         lastlvl[bit] = lvl;
+      }
+
+      /* And we return the status to the registers. Each pin goes to the
+       * CPUs it is enabled for.
+       */
+      app = 0;
+      pro = 0;
+      for(bit = 0; bit < GPIOMATRIX_CNT; bit = bit + 1) {
+         if ((GPIO.pin[bit].int_ena & GPIO_APP_CPU_INTR_ENA) > 0)
+            app = app | (intrst & ((uint64_t)1 << bit));
+         if ((GPIO.pin[bit].int_ena & GPIO_PRO_CPU_INTR_ENA) > 0)
+            pro = pro | (intrst & ((uint64_t)1 << bit));
+      }
+      GPIO.status = (uint32_t)intrst;
+      GPIO.status1.intr_st = (uint32_t)(intrst >> 32);
+      GPIO.acpu_int = (uint32_t)app;
+      GPIO.acpu_int1.intr = (uint32_t)(app >> 32);
+      GPIO.pcpu_int = (uint32_t)pro;
+      GPIO.pcpu_int1.intr = (uint32_t)(pro >> 32);
+      intr_o.write((app | pro) != 0);
+   }
+}
+
 void gpio_matrix::updateth() {
    int bit;
    mux_out *gmux;
@@ -191,7 +266,7 @@ void gpio_matrix::updateth() {
       setoebits(GPIO.enable1.data, GPIO.enable);
       /* IN is handled by the return thread. */
       /* Strapping not yet implemented. */
-      /* Interrupts not yet implemented. */
+      /* Interrupts are handled by the interrupt thread. */
       /* RTC Out not yet implemented. */
       io_mux *gpin;
       i_mux_uart0.mux(GPIO.func_in_sel_cfg[U0RXD_IN_IDX].func_sel);
@@ -265,6 +340,11 @@ void gpio_matrix::update() {
    if(clockpacer.is_thread()) clockpacer.wait_next_apb_clk();
 }
 
+void gpio_matrix::initstruct() {
+   memset(&GPIO, 0, sizeof(gpio_dev_t));
+   intrst = 0;
+}
+
 void gpio_matrix::updategpioreg() {
    updategpioreg_ev.notify();
    if(clockpacer.is_thread()) clockpacer.wait_next_apb_clk();
@@ -196,6 +196,9 @@ SC_MODULE(gpio_matrix) {
    sc_out<bool> scl1_o {"scl1_o"};
    sc_out<bool> sda1_o {"sda1_o"};
 
+   /* Interrupt */
+   sc_out<bool> intr_o {"intr_o"};
+
    /* Submodules */
    mux_pcnt i_mux_pcnt {"i_mux_pcnt"};
    mux_in i_mux_hspi_d {"i_mux_hspi_d", GPIOMATRIX_LOGIC1};
@@ -415,6 +418,8 @@ SC_MODULE(gpio_matrix) {
    /* Checks only OE bits. Call only if you are sure only the OE bits
     * were changed.  */
    void updategpiooe();
+   /* Puts the GPIO struct back to its reset values. Call update() after. */
+   void initstruct();
    mux_out *getmux(int pin);
    void initptr();
 
@@ -423,6 +428,12 @@ SC_MODULE(gpio_matrix) {
    sc_event updategpiooe_ev;
    sc_event update_ev;
    void updateth(void);
+   void intrth(void);
+
+   /* Interrupt state, one bit per GPIO. */
+   uint64_t intrst;
+   bool lastlvl[GPIOMATRIX_CNT];
+   void applystbits();
 
    // Constructor
    SC_CTOR(gpio_matrix) {
@@ -696,6 +707,10 @@ SC_MODULE(gpio_matrix) {
 
       SC_THREAD(updateth);
       sensitive << updategpioreg_ev << updategpiooe_ev << update_ev;
+
+      /* The interrupts pick the inputs they watch as they go. */
+      intrst = 0;
+      SC_THREAD(intrth);
    }
 
    void start_of_simulation();
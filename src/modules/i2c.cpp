@@ -38,39 +38,38 @@ void i2c::transfer_th() {
        */
       if (p == 'S') {
          sda_en_o.write(false);
-         scl_en_o.write(false);
-         wait(625, SC_NS); sda_en_o.write(true);
-         wait(625, SC_NS); scl_en_o.write(true);
-         wait(1250, SC_NS);
+         wait(tsudat); scl_en_o.write(false); waitscl();
+         wait(tsusta); sda_en_o.write(true);
+         wait(thdsta); scl_en_o.write(true);
          state = DEVID;
       }
       else if (p == 'P') {
          /* If the SDA is high, we need to take it low first. If not, we cam
           * go straight into the stop bit.
           */
-         wait(625, SC_NS); sda_en_o.write(true);
-         wait(625, SC_NS); scl_en_o.write(false);
-         wait(625, SC_NS); sda_en_o.write(false);
-         wait(1250, SC_NS);
+         wait(thddat); sda_en_o.write(true);
+         wait(tsudat); scl_en_o.write(false); waitscl();
+         wait(tsusto); sda_en_o.write(false);
+         wait(tbuf);
          state = IDLE;
       }
       else if (state == DEVID || state == WRITING) {
          if (p == '1') {
-            wait(625, SC_NS); sda_en_o.write(false);
-            wait(625, SC_NS); scl_en_o.write(false);
-            wait(1250, SC_NS); scl_en_o.write(true);
+            wait(thddat); sda_en_o.write(false);
+            wait(tsudat); scl_en_o.write(false); waitscl();
+            wait(thigh); scl_en_o.write(true);
             rwbit = true;
          }
          else if (p == '0') {
-            wait(625, SC_NS); sda_en_o.write(true);
-            wait(625, SC_NS); scl_en_o.write(false);
-            wait(1250, SC_NS); scl_en_o.write(true);
+            wait(thddat); sda_en_o.write(true);
+            wait(tsudat); scl_en_o.write(false); waitscl();
+            wait(thigh); scl_en_o.write(true);
             rwbit = false;
          }
          else if (p == 'Z') {
             sda_en_o.write(false);
             /* Then we tick the clock. */
-            wait(1250, SC_NS); scl_en_o.write(false);
+            wait(tlow); scl_en_o.write(false); waitscl();
             /* After the clock, we sample it. */
             if (sda_i.read()) {
                snd.write('N');
@@ -87,25 +86,25 @@ void i2c::transfer_th() {
                if (state == DEVID && !rwbit || state == WRITING) state= WRITING;
                else state = READING;
             }
-            wait(1250, SC_NS); scl_en_o.write(true);
+            wait(thigh); scl_en_o.write(true);
          }
-         else wait(2500, SC_NS);
+         else wait(tlow + thigh);
       }
       else if (state == READING) {
          if (p == 'N') {
-            wait(625, SC_NS); sda_en_o.write(false);
-            wait(625, SC_NS); scl_en_o.write(false);
-            wait(1250, SC_NS); scl_en_o.write(true);
+            wait(thddat); sda_en_o.write(false);
+            wait(tsudat); scl_en_o.write(false); waitscl();
+            wait(thigh); scl_en_o.write(true);
             state = IDLE;
          }
          else if (p == 'A') {
-            wait(625, SC_NS); sda_en_o.write(true);
-            wait(625, SC_NS); scl_en_o.write(false);
-            wait(1250, SC_NS); scl_en_o.write(true);
+            wait(thddat); sda_en_o.write(true);
+            wait(tsudat); scl_en_o.write(false); waitscl();
+            wait(thigh); scl_en_o.write(true);
          }
          else if (p == 'Z') {
             sda_en_o.write(false);
-            wait(1250, SC_NS); scl_en_o.write(false);
+            wait(tlow); scl_en_o.write(false); waitscl();
             if (sda_i.read()) {
                from.write('1');
                snd.write('1');
@@ -114,13 +113,136 @@ void i2c::transfer_th() {
                from.write('0');
                snd.write('0');
             }
-            wait(1250, SC_NS); scl_en_o.write(true);
+            wait(thigh); scl_en_o.write(true);
          }
-         else wait(2500, SC_NS);
+         else wait(tlow + thigh);
       }
    }
 }
 
+void i2c::setfreq(uint32_t hz) {
+   sc_time period;
+
+   if (hz == 0) {
+      PRINTF_WARN("I2C", "%s: ignoring a bus frequency of 0Hz", name());
+      return;
+   }
+   if (hz > 1000000) {
+      PRINTF_WARN("I2C", "%s: %uHz is above fast mode plus", name(), hz);
+   }
+   freq = hz;
+   period = sc_time(1.0 / hz, SC_SEC);
+
+   /* We take the minimum times for the mode and stretch the SCL low and high
+    * times to fill the period.
+    */
+   if (hz <= 100000) {
+      tlow = sc_time(4700, SC_NS); thigh = sc_time(4000, SC_NS);
+      tsusta = sc_time(4700, SC_NS); thdsta = sc_time(4000, SC_NS);
+      tsusto = sc_time(4000, SC_NS); tbuf = sc_time(4700, SC_NS);
+   }
+   else if (hz <= 400000) {
+      tlow = sc_time(1300, SC_NS); thigh = sc_time(600, SC_NS);
+      tsusta = sc_time(600, SC_NS); thdsta = sc_time(600, SC_NS);
+      tsusto = sc_time(600, SC_NS); tbuf = sc_time(1300, SC_NS);
+   }
+   else {
+      tlow = sc_time(500, SC_NS); thigh = sc_time(260, SC_NS);
+      tsusta = sc_time(260, SC_NS); thdsta = sc_time(260, SC_NS);
+      tsusto = sc_time(260, SC_NS); tbuf = sc_time(500, SC_NS);
+   }
+   if (tlow < period / 2) tlow = period / 2;
+   if (thigh < period - tlow) thigh = period - tlow;
+
+   /* The data changes in the middle of the SCL low time. */
+   thddat = tlow / 2;
+   tsudat = tlow - thddat;
+}
+
+void i2c::waitscl() {
+   sc_time start = sc_time_stamp();
+
+   /* After we let go of the SCL, a slave can still hold it low to stretch
+    * the clock. We wait for it, but not forever.
+    */
+   wait(SC_ZERO_TIME);
+   while (!scl_i.read()) {
+      wait(stretchtmout - (sc_time_stamp() - start),
+         scl_i.value_changed_event());
+      if (sc_time_stamp() - start >= stretchtmout) {
+         PRINTF_WARN("I2C", "%s: SCL held low for more than %s", name(),
+            stretchtmout.to_string().c_str());
+         break;
+      }
+   }
+}
+
+void i2c::attach(uint8_t addr, i2cslave_if *s) {
+   if (slaves.find(addr & 0x7f) != slaves.end()) {
+      PRINTF_WARN("I2C", "%s: replacing the slave at address %02x", name(),
+         addr & 0x7f);
+   }
+   slaves[addr & 0x7f] = s;
+}
+
+void i2c::detach(uint8_t addr) {
+   slaves.erase(addr & 0x7f);
+}
+
+int i2c::transport(i2ctrans_t &t) {
+   std::map<uint8_t, i2cslave_if *>::iterator it;
+   unsigned int bytes;
+   int ret;
+
+   /* The bus is ours from the start until the stop. After a repeated start
+    * we still have it, so we do not lock it again.
+    */
+   if (busowner != sc_get_current_process_handle()) {
+      buslock.lock();
+      busowner = sc_get_current_process_handle();
+   }
+
+   t.stretch = SC_ZERO_TIME;
+   t.acked = (t.rd)?0:t.data.size();
+
+   /* If nobody answers the address we get a NACK and the master stops. */
+   it = slaves.find(t.addr & 0x7f);
+   if (it == slaves.end()) {
+      bytes = 0;
+      ret = 2;
+   }
+   else {
+      it->second->i2ctransport(t);
+      /* On a write the master stops at the first byte with a NACK. */
+      if (!t.rd && t.acked < t.data.size()) {
+         bytes = t.acked + 1;
+         ret = 3;
+      }
+      else {
+         bytes = t.data.size();
+         ret = 0;
+      }
+   }
+
+   /* The address and each byte take nine clocks, with the ack. Then we add
+    * the start and any time the slave stretched the clock.
+    */
+   wait((tlow + thigh) * (9 * (bytes + 1)) + tsudat + tsusta + thdsta
+      + t.stretch);
+
+   /* If the master asked for a repeated start, it keeps the bus and the next
+    * transfer begins with its start bit. Otherwise we send the stop, wait
+    * for the bus free time and let the others in. A NACK always ends in a
+    * stop.
+    */
+   if (t.stop || ret != 0) {
+      wait(tlow + tsusto + tbuf);
+      busowner = sc_process_handle();
+      buslock.unlock();
+   }
+   return ret;
+}
+
 void i2c::trace(sc_trace_file *tf) {
    sc_trace(tf, snd, snd.name());
 }
@@ -3,6 +3,12 @@
  *******************************************************************************
  * Description:
  *   Models a single ESP32 I2C
+ *
+ *   The I2C has two modes. If no slave is attached, the Wire library sends
+ *   each bit as a character through the to/from fifos and the I2C toggles
+ *   the SDA and SCL. If slaves are attached with attach(), the Wire library
+ *   instead calls transport() with each transfer as a whole. The bit level
+ *   mode can be forced with set_bitlevel() to look at the waveforms.
  *******************************************************************************
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +28,8 @@
 #define _I2C_H
 
 #include <systemc.h>
+#include <map>
+#include "i2ctlm.h"
 
 SC_MODULE(i2c) {
    public:
@@ -39,10 +47,48 @@ SC_MODULE(i2c) {
    void transfer_th();
    void trace(sc_trace_file *tf);
 
+   /* Bus speed. The timing follows the I2C standard mode up to 100kHz,
+    * fast mode up to 400kHz and fast mode plus above that.
+    */
+   void setfreq(uint32_t hz);
+   uint32_t getfreq() { return freq; }
+   sc_time getperiod() { return tlow + thigh; }
+   /* Longest time we let a slave hold the SCL low. */
+   void set_stretchtimeout(sc_time t) { stretchtmout = t; }
+
+   /* Transaction level interface */
+   void attach(uint8_t addr, i2cslave_if *s);
+   void detach(uint8_t addr);
+   void set_bitlevel(bool on) { bitlevel = on; }
+   bool istlm() { return !bitlevel && !slaves.empty(); }
+   /* Does the transfer and waits for the time it takes on the bus. It
+    * returns 0 on success, 2 if the address got a NACK and 3 if a data byte
+    * got a NACK, like Wire.endTransmission(). Callers are served one at a
+    * time, and a transfer without a stop keeps the bus for the next one.
+    */
+   int transport(i2ctrans_t &t);
+
    // Constructor
    SC_CTOR(i2c) {
+      bitlevel = false;
+      stretchtmout = sc_time(50, SC_MS);
+      setfreq(400000);
       SC_THREAD(transfer_th);
    }
+
+   private:
+   std::map<uint8_t, i2cslave_if *> slaves;
+   bool bitlevel;
+   sc_mutex buslock;
+   sc_process_handle busowner;
+   uint32_t freq;
+   sc_time stretchtmout;
+
+   /* Bus timing */
+   sc_time tlow, thigh;
+   sc_time thddat, tsudat;
+   sc_time tsusta, thdsta, tsusto, tbuf;
+   void waitscl();
 };
 extern i2c *i2c0ptr;
 extern i2c *i2c1ptr;
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * i2ctlm.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Transaction level interface for the I2C. A slave model that implements
+ *   i2cslave_if can be registered on an i2c by its 7-bit address. Once a
+ *   slave is registered, the Wire library sends each transfer, from the
+ *   start to the stop or repeated start, as a single transaction and waits
+ *   once for the time it would take on the bus, instead of sending each bit
+ *   through the i2c fifos.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _I2CTLM_H
+#define _I2CTLM_H
+
+#include <systemc.h>
+#include <stdint.h>
+#include <vector>
+
+struct i2ctrans_t {
+   uint8_t addr;
+   bool rd;
+   /* On writes this has the bytes sent by the master. On reads it has the
+    * size asked for and the slave fills it in. Bytes not filled in read as
+    * 0xff, as the bus is pulled up.
+    */
+   std::vector<uint8_t> data;
+   /* Number of data bytes the slave acknowledged on a write. It starts out
+    * with all of them, the slave lowers it to NACK a byte.
+    */
+   unsigned int acked;
+   /* Time the slave held SCL low, on top of the bus time. */
+   sc_time stretch;
+   /* If false, the master will send a repeated start instead of a stop. */
+   bool stop;
+};
+
+class i2cslave_if {
+   public:
+   /* Called once the address has been sent. The time is still at the start
+    * bit.
+    */
+   virtual void i2ctransport(i2ctrans_t &t) = 0;
+   virtual ~i2cslave_if() {}
+};
+
+#endif
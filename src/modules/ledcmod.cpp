@@ -58,26 +58,31 @@ void ledcmod::updateth() {
       for(tim = 0; tim < (LEDC_TIMERS/2); tim = tim + 1) {
          /* HSTIMER */
          timer_conf[tim].write(LEDC.timer_group[0].timer[tim].conf.val);
+         timer_lim[tim].write(
+            1 << LEDC.timer_group[0].timer[tim].conf.duty_resolution);
          if (LEDC.timer_group[0].timer[tim].conf.tick_sel == 0)
             base_period = clockpacer.get_ref_period();
          else base_period = clockpacer.get_apb_period();
 
-         /* TODO -- do the decimal part */
+         /* The divider has eight bits of fraction. The chip gets it by
+          * stretching some of the ticks, we simply use the average tick.
+          */
          timerinc[tim].write(
             sc_time(base_period
-               * (LEDC.timer_group[0].timer[tim].conf.clock_divider>>8)));
+               * (LEDC.timer_group[0].timer[tim].conf.clock_divider/256.0)));
 
          /* LSTIMER */
          timer_conf[tim+LEDC_TIMERS/2].write(
             LEDC.timer_group[1].timer[tim].conf.val);
+         timer_lim[tim+LEDC_TIMERS/2].write(
+            1 << LEDC.timer_group[1].timer[tim].conf.duty_resolution);
          if (LEDC.timer_group[1].timer[tim].conf.tick_sel == 0)
             base_period = clockpacer.get_ref_period();
          else base_period = clockpacer.get_rtc8m_period();
-         /* TODO -- do the decimal part */
          /* TODO -- do the pause */
          if (LEDC.timer_group[1].timer[tim].conf.low_speed_update) {
             timerinc[tim+LEDC_TIMERS/2].write(sc_time(base_period
-               * (LEDC.timer_group[1].timer[tim].conf.clock_divider>>8)));
+               * (LEDC.timer_group[1].timer[tim].conf.clock_divider/256.0)));
          }
       }
 
@@ -98,10 +103,6 @@ void ledcmod::returnth() {
     */
    while (true) {
       wait(
-         timer_cnt[0].value_changed_event()| timer_cnt[1].value_changed_event() |
-         timer_cnt[2].value_changed_event()| timer_cnt[3].value_changed_event() |
-         timer_cnt[4].value_changed_event()| timer_cnt[5].value_changed_event() |
-         timer_cnt[6].value_changed_event()| timer_cnt[7].value_changed_event() |
          duty_r[0].value_changed_event()| duty_r[1].value_changed_event() |
          duty_r[2].value_changed_event()| duty_r[3].value_changed_event() |
          duty_r[4].value_changed_event()| duty_r[5].value_changed_event() |
@@ -117,11 +118,11 @@ void ledcmod::returnth() {
          int_ev[18]| int_ev[19]| int_ev[20]| int_ev[21]| int_ev[22]| int_ev[23]);
 
       for (un = 0; un < LEDC_CHANNELS; un = un + 1) {
-         LEDC.int_raw.val = 0x0;
-         /* If we hit the maximum dither times, we have an interrupt and
-          * clear the duty_start. */
+         /* If a fade is done, we have an interrupt and clear the
+          * duty_start. */
          if (int_ev[un+LEDC_DUTYEND_TIMER_INTR].triggered()) {
-            LEDC.int_raw.val = LEDC.int_raw.val | (1<<un);
+            LEDC.int_raw.val = LEDC.int_raw.val
+               | (1<<(un+LEDC_DUTYEND_TIMER_INTR));
             if (un < LEDC_CHANNELS/2)
                LEDC.channel_group[0].channel[un].conf1.duty_start = false;
             else LEDC.channel_group[1].channel[un-8].conf1.duty_start = false;
@@ -131,16 +132,19 @@ void ledcmod::returnth() {
                LEDC.channel_group[0].channel[un].duty_rd.duty_read =
             duty_r[un].read();
          else LEDC.channel_group[1].channel[un-8].duty_rd.duty_read =
-            duty_r[un-8].read();
+            duty_r[un].read();
       }
-      /* We also copy over the timer values and interrupts. */
+      /* We also copy over the timer values and interrupts. The counters
+       * are calculated as of now.
+       */
       for(un = 0; un < (LEDC_TIMERS/2); un = un + 1) {
          if (int_ev[un+LEDC_OVF_TIMER_INTR].triggered())
             LEDC.int_raw.val = LEDC.int_raw.val | (1<<un);
-         LEDC.timer_group[0].timer[un].value.timer_cnt = timer_cnt[un].read();
+         LEDC.timer_group[0].timer[un].value.timer_cnt = get_timer_cnt(un);
          if (int_ev[un+LEDC_OVF_TIMER_INTR+LEDC_TIMERS/2].triggered())
             LEDC.int_raw.val = LEDC.int_raw.val | (1<<un+LEDC_TIMERS/2);
-         LEDC.timer_group[1].timer[un].value.timer_cnt = timer_cnt[un].read();
+         LEDC.timer_group[1].timer[un].value.timer_cnt =
+            get_timer_cnt(un+LEDC_TIMERS/2);
       }
 
       /* If we have a clear event we take it too. */
@@ -157,6 +161,15 @@ void ledcmod::returnth() {
 }
 
 void ledcmod::update() {
+   int un;
+   /* As the counters do not tick, we refresh them here, so that anyone that
+    * calls update before reading them gets the current value.
+    */
+   for(un = 0; un < (LEDC_TIMERS/2); un = un + 1) {
+      LEDC.timer_group[0].timer[un].value.timer_cnt = get_timer_cnt(un);
+      LEDC.timer_group[1].timer[un].value.timer_cnt =
+         get_timer_cnt(un+LEDC_TIMERS/2);
+   }
    update_ev.notify();
    clockpacer.wait_next_apb_clk();
 }
@@ -182,6 +195,8 @@ void ledcmod::start_of_simulation() {
       conf1[un].write(0);
       hpoint[un].write(0);
       duty[un].write(0);
+      curduty[un] = 0;
+      fading[un] = false;
    }
    for(un = 0; un < sig_out_hs_o.size(); un = un + 1) {
       sc_spawn(sc_bind(&ledcmod::channel, this, un));
@@ -198,6 +213,11 @@ void ledcmod::start_of_simulation() {
       timer_cnt[un].write(0);
       timer_lim[un].write(0);
       timerinc[un].write(sc_time(0, SC_NS));
+      tstart[un] = SC_ZERO_TIME;
+      tinc[un] = SC_ZERO_TIME;
+      tlim[un] = 0;
+      tcnt[un] = 0;
+      trunning[un] = false;
    }
    int_ena.write(0);
 }
@@ -222,9 +242,9 @@ void ledcmod::calc_points(int un, bool start_dither) {
       duty_cycle =
         RDFIELD(conf1[un],LEDC_DUTY_CYCLE_HSCH0_M,LEDC_DUTY_CYCLE_HSCH0_S);
       duty_inc =
-        (RDFIELD(conf1[un],LEDC_DUTY_CYCLE_HSCH0_M,LEDC_DUTY_INC_HSCH0_S)>0);
+        (RDFIELD(conf1[un],LEDC_DUTY_INC_HSCH0_M,LEDC_DUTY_INC_HSCH0_S)>0);
       duty_scale =
-        RDFIELD(conf1[un],LEDC_DUTY_CYCLE_HSCH0_M,LEDC_DUTY_SCALE_HSCH0_S);
+        RDFIELD(conf1[un],LEDC_DUTY_SCALE_HSCH0_M,LEDC_DUTY_SCALE_HSCH0_S);
    }
    else {
       duty_start =
@@ -234,66 +254,86 @@ void ledcmod::calc_points(int un, bool start_dither) {
       duty_cycle =
         RDFIELD(conf1[un],LEDC_DUTY_CYCLE_LSCH0_M,LEDC_DUTY_CYCLE_LSCH0_S);
       duty_inc =
-        (RDFIELD(conf1[un],LEDC_DUTY_CYCLE_LSCH0_M,LEDC_DUTY_INC_LSCH0_S)>0);
+        (RDFIELD(conf1[un],LEDC_DUTY_INC_LSCH0_M,LEDC_DUTY_INC_LSCH0_S)>0);
       duty_scale =
-        RDFIELD(conf1[un],LEDC_DUTY_CYCLE_LSCH0_M,LEDC_DUTY_SCALE_LSCH0_S);
+        RDFIELD(conf1[un],LEDC_DUTY_SCALE_LSCH0_M,LEDC_DUTY_SCALE_LSCH0_S);
    }
 
-   /* We get the lpoint and frac. */
-   lp = (duty[un].read() >> 4);
-   lpoint_frac = duty[un].read() & 0x0f;
-
-   /* We adjust the lpoint according to the fraction */
-   if (lpoint_frac > thiscyc[un]) lp = lp + 1;
-
-   /* And we adjust the lpoint according to the dither. */
-   if (duty_start) {
-      if (start_dither) {
-         /* If this is the first time, dithcycles will be zero. We then
-          * start by loading the settings of the dither and go on.
-          */
-         dithtimes[un] = duty_num;
-         dithcycles[un] = duty_cycle;
+   if (start_dither) {
+      /* On a new duty we load it, and if the duty_start is set, we also
+       * load the fade settings and start stepping.
+       */
+      curduty[un] = duty[un].read();
+      fading[un] = duty_start;
+      dithtimes[un] = duty_num;
+      dithcycles[un] = (duty_cycle > 0)?duty_cycle:1;
+      /* With no steps to take the fade is already over. */
+      if (fading[un] && dithtimes[un] == 0) {
+         fading[un] = false;
+         int_ev[un+LEDC_DUTYEND_TIMER_INTR].notify();
       }
-      else {
-         /* Other times we count the cycles and process it. */
-         dithcycles[un] = dithcycles[un] - 1;
-
-         /* If we hit the target, we are done. */
-         if (dithcycles == 0 && duty_inc) {
-            lp = lp + duty_scale;
-            dithcycles[un] = duty_cycle;
-            dithtimes[un] = dithtimes[un] - 1;
-         }
-         else if (dithcycles[un] == 0) {
-            lp = lp - duty_scale;
-            dithcycles[un] = duty_cycle;
-            dithtimes[un] = dithtimes[un] - 1;
+   }
+   else if (fading[un]) {
+      /* Other times we count the cycles and, every duty_cycle periods, we
+       * step the duty by the scale.
+       */
+      dithcycles[un] = dithcycles[un] - 1;
+      if (dithcycles[un] <= 0) {
+         if (duty_inc) curduty[un] = curduty[un] + (duty_scale << 4);
+         else curduty[un] = curduty[un] - (duty_scale << 4);
+         if (curduty[un] < 0) curduty[un] = 0;
+         else if (curduty[un] > LEDC_DUTY_HSCH0) curduty[un] = LEDC_DUTY_HSCH0;
+         dithcycles[un] = (duty_cycle > 0)?duty_cycle:1;
+         dithtimes[un] = dithtimes[un] - 1;
+
+         /* If we did all the steps, we are done and raise the interrupt. */
+         if (dithtimes[un] <= 0) {
+            fading[un] = false;
+            int_ev[un+LEDC_DUTYEND_TIMER_INTR].notify();
          }
-
-         int_ev[un+LEDC_DUTYEND_TIMER_INTR].notify();
       }
    }
 
-   /* We put the lp value in the read/only register. */
-   duty_r[un].write(lp & LEDC_DUTY_HSCH0);
+   /* We get the lpoint and frac. */
+   lp = (curduty[un] >> 4);
+   lpoint_frac = curduty[un] & 0x0f;
+
+   /* We adjust the lpoint according to the fraction */
+   if (lpoint_frac > thiscyc[un]) lp = lp + 1;
+
+   /* We put the current duty in the read/only register. */
+   duty_r[un].write(curduty[un] & LEDC_DUTY_HSCH0);
    thislp[un] = lp & LEDC_DUTY_HSCH0;
 }
 
+uint32_t ledcmod::get_timer_cnt(int tim) {
+   uint64_t ticks;
+   /* If the timer is stopped, we have the value. If not, we calculate how
+    * many ticks went by since it was last zero.
+    */
+   if (!trunning[tim] || tinc[tim] == SC_ZERO_TIME) return tcnt[tim];
+   ticks = (sc_time_stamp() - tstart[tim]).value() / tinc[tim].value();
+   if (tlim[tim] > 0 && ticks >= tlim[tim]) ticks = ticks % tlim[tim];
+   return (uint32_t)ticks;
+}
+
 void ledcmod::channel(int ch) {
    bool outen;
-   bool recheckpoints;
+   uint32_t cnt;
+   uint32_t lpoint;
+   uint32_t next;
    /* Sel begins with -1 and it then is switched to the correct value. */
    int sel = -1;
    while(1) {
       /* If there is no selected timer, all we do is wait for a configuration
-       * change. If there is a timer specified, we wait for a timer trigger
-       * or a configuration change.
+       * or duty change. If there is a timer specified, we also wait for the
+       * start of a period and the next edge we scheduled.
        */
-      if (sel < 0) wait(conf0[ch].value_changed_event());
+      if (sel < 0) wait(conf0[ch].value_changed_event()
+         | conf1[ch].value_changed_event() | duty[ch].value_changed_event());
       else wait(conf0[ch].value_changed_event() | conf1[ch].value_changed_event()
          | hpoint[ch].value_changed_event() | duty[ch].value_changed_event()
-         | timer_cnt[sel].value_changed_event());
+         | period_ev[sel] | tstate_ev[sel] | edge_ev[ch]);
 
       /* We go ahead and grab the output enable as we use it quite often. */
       if (ch < LEDC_CHANNELS/2) {
@@ -320,52 +360,70 @@ void ledcmod::channel(int ch) {
             RDFIELD(conf0[ch], LEDC_IDLE_LV_LSCH0_M, LEDC_IDLE_LV_LSCH0_S));
       }
 
-      /* If we see a change in the hpoint or the duty we need to recalculate
-       * the lpoint. We also need to do this when the timer is switched or when
-       * we start a new cycle.
+      /* If we see a change in the duty or the duty_start gets set, we need to
+       * load the new duty and recalculate the lpoint. Other configuration
+       * changes must not reload it, or they would cancel a running fade. The
+       * edges are recalculated below on any wake up, so a new timer or
+       * hpoint is still taken. We also step the fade when we start a new
+       * cycle.
        */
-      if (duty[ch].event() || conf0[ch].event()) {
+      if (duty[ch].event()
+            || (conf1[ch].event() && (conf1[ch].read()
+            & ((ch < LEDC_CHANNELS/2)?LEDC_DUTY_START_HSCH0_M
+            :LEDC_DUTY_START_LSCH0_M)) != 0)) {
          calc_points(ch, true);
          /* We restart the cycle calculation. */
          thiscyc[ch] = 0;
-         /* And we will need to recheck the hpoint and lpoint. */
-         recheckpoints = true;
       }
       /* Anytime the cycle restarts (timer returns to zero) we need to
        * increment the cycle counter and adjust the jitter, if any.
        */
-      else if (timer_cnt[sel].read() == 0) {
+      else if (period_ev[sel].triggered()) {
          /* We start adjusting the cycle number for the dither. */
          thiscyc[ch] = thiscyc[ch] + 1;
          if (thiscyc[ch] == LEDC_CYCLES) thiscyc[ch] = 0;
          /* We also calculate the lpoint. */
          calc_points(ch, false);
-         /* And we will need to recheck the hpoint and lpoint. */
-         recheckpoints = true;
-      }
-      else recheckpoints = false;
-
-      /* If it was a timer tick, we need to see if it affects us. */
-      if (outen && (timer_cnt[sel].event() || recheckpoints)) {
-         /* And we check where we are in the flow. */
-         bool nv;
-         if (timer_cnt[sel].read() >= thislp[ch] + hpoint[ch].read()) nv = false;
-         else if (timer_cnt[sel].read() >= hpoint[ch]) nv = true;
-         else nv = false;
-         if (ch < LEDC_CHANNELS/2) sig_out_hs_o[ch]->write(nv);
-         else sig_out_ls_o[ch-LEDC_CHANNELS/2]->write(nv);
       }
+
+      /* Any edge we had scheduled might be wrong now, so we drop it. */
+      edge_ev[ch].cancel();
+      if (!outen) continue;
+
+      /* We then check where we are in the flow. */
+      cnt = get_timer_cnt(sel);
+      lpoint = thislp[ch] + hpoint[ch].read();
+      bool nv;
+      if (cnt >= lpoint) nv = false;
+      else if (cnt >= hpoint[ch]) nv = true;
+      else nv = false;
+      if (ch < LEDC_CHANNELS/2) sig_out_hs_o[ch]->write(nv);
+      else sig_out_ls_o[ch-LEDC_CHANNELS/2]->write(nv);
+
+      /* And we sleep until the next edge. If there is none left in this
+       * period, the next period start wakes us up.
+       */
+      if (!trunning[sel]) continue;
+      if (cnt < hpoint[ch].read()) next = hpoint[ch].read();
+      else if (cnt < lpoint) next = lpoint;
+      else continue;
+      if (next < tlim[sel])
+         edge_ev[ch].notify(tstart[sel] + tinc[sel] * (double)next
+            - sc_time_stamp());
    }
 }
 
 void ledcmod::timer(int tim) {
    bool rst;
    bool pause;
-   bool wasstoped = true;
    while(1) {
-      /* We wait for a timer tick or a change to the configuration register. */
+      /* We wait for the end of a period or a change to the configuration.
+       * The APB clock getting gated, when the chip sleeps, counts as one.
+       */
       wait(timer_ev[tim] | timer_conf[tim].value_changed_event() |
-         timerinc[tim].value_changed_event());
+         timerinc[tim].value_changed_event() |
+         timer_lim[tim].value_changed_event() |
+         clockpacer.apb_gate_event());
 
       /* We get the parameters first. */
       if (tim < LEDC_TIMERS/2) {
@@ -378,47 +436,57 @@ void ledcmod::timer(int tim) {
          pause = RDFIELD(timer_conf[tim], LEDC_LSTIMER0_PAUSE_M,
             LEDC_LSTIMER0_PAUSE_S)>0;
       }
+      /* While asleep the timer is held as if paused, so it does not keep the
+       * simulation busy with periods nobody sees.
+       */
+      if (clockpacer.is_apb_gated()) pause = true;
 
-      /* If we are in reset, we clear any future time events and wait. The next
-       * event should be then a configuration change.
+      /* We only count on the end of a period. Configuration events should
+       * not change the timer value.
        */
-      if (rst) {
+      if (timer_ev[tim].triggered() && trunning[tim]) {
+         /* We hit the end, the counter goes back to zero and we raise the
+          * interrupt.
+          */
+         tstart[tim] = sc_time_stamp();
          timer_cnt[tim].write(0);
-         timer_ev[tim].cancel();
-         wasstoped = true;
+         int_ev[tim+LEDC_OVF_TIMER_INTR].notify();
+         period_ev[tim].notify();
       }
-      /* If we are paused, we just cancel any future events, but we do not
-       * touch the counter value.
-       */
-      else if (pause) {
+      if (timer_conf[tim].event() || timerinc[tim].event()
+            || timer_lim[tim].event()
+            || clockpacer.apb_gate_event().triggered()) {
+         /* On a configuration change we first freeze the counter with the
+          * old settings.
+          */
+         tcnt[tim] = get_timer_cnt(tim);
+         trunning[tim] = false;
          timer_ev[tim].cancel();
-         wasstoped = true;
-      }
-      /* If the timer increment is zero, we do the same. */
-      else if (timerinc[tim].read() == sc_time(0, SC_NS))
-         { timer_ev[tim].cancel(); }
-      /* If we are comming out of reset or pause, we need to get the counter
-       * going.
-       */
-      else if (wasstoped) {
-         timer_ev[tim].notify(timerinc[tim]);
-         wasstoped = false;
-      }
-      /* We only count on timer event triggers. Configuration events should
-       * not change the timer value.
-       */
-      else if (timer_ev[tim].triggered()) {
-         /* We calculate the next value, whichever it is. */
-         if (timer_cnt[tim].read() < timer_lim[tim].read() - 1)
-            timer_cnt[tim].write(timer_cnt[tim].read() + 1);
+         tinc[tim] = timerinc[tim].read();
+         tlim[tim] = timer_lim[tim].read();
+
+         /* If we are in reset, we clear the counter and wait. The next
+          * event should be then a configuration change.
+          */
+         if (rst) tcnt[tim] = 0;
+         /* If we are paused or the timer has no clock or no length, we just
+          * stay stopped, but we do not touch the counter value.
+          */
+         else if (pause || tinc[tim] == SC_ZERO_TIME || tlim[tim] == 0) { }
+         /* If not, we get the counter going from where it is. */
          else {
-            /* We hit the end we write a zero and raise the interrupt. */
-            timer_cnt[tim].write(0);
-            int_ev[tim+LEDC_OVF_TIMER_INTR].notify();
+            if (tcnt[tim] >= tlim[tim]) tcnt[tim] = 0;
+            tstart[tim] = sc_time_stamp() - tinc[tim] * (double)tcnt[tim];
+            trunning[tim] = true;
          }
-         /* And we sleep until the next event. */
-         timer_ev[tim].notify(timerinc[tim]);
+         timer_cnt[tim].write(tcnt[tim]);
+         tstate_ev[tim].notify();
       }
+
+      /* And we sleep until the end of the period. */
+      if (trunning[tim])
+         timer_ev[tim].notify(tstart[tim] + tinc[tim] * (double)tlim[tim]
+            - sc_time_stamp());
    }
 }
 
@@ -51,6 +51,10 @@ SC_MODULE(ledcmod) {
    void update();
    void initstruct();
    void calc_points(int un, bool start_dither);
+   /* The timers are not counted tick by tick, the counter value is
+    * calculated from the current time when someone needs it.
+    */
+   uint32_t get_timer_cnt(int tim);
 
    /* Threads */
    void channel(int ch);
@@ -63,8 +67,18 @@ SC_MODULE(ledcmod) {
    int dithcycles[LEDC_CHANNELS];
    int thislp[LEDC_CHANNELS];
    int thiscyc[LEDC_CHANNELS];
+   int curduty[LEDC_CHANNELS];
+   bool fading[LEDC_CHANNELS];
    sc_event update_ev;
    sc_event timer_ev[LEDC_TIMERS];
+   sc_event period_ev[LEDC_TIMERS];
+   sc_event tstate_ev[LEDC_TIMERS];
+   sc_event edge_ev[LEDC_CHANNELS];
+   sc_time tstart[LEDC_TIMERS];
+   sc_time tinc[LEDC_TIMERS];
+   uint32_t tlim[LEDC_TIMERS];
+   uint32_t tcnt[LEDC_TIMERS];
+   bool trunning[LEDC_TIMERS];
    sc_event int_ev[LEDC_INTR];
    sc_event int_clr_ev;
 
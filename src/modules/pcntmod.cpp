@@ -26,6 +26,7 @@
 #include "soc/pcnt_struct.h"
 #include "soc/pcnt_reg.h"
 #include "clockpacer.h"
+#include "info.h"
 
 void pcntmod::updateth() {
    int un;
@@ -50,6 +51,12 @@ void pcntmod::updateth() {
       if ((PCNT_PLUS_CNT_RST_U5_M & PCNT.ctrl.val)>0) reset_un[5].notify();
       if ((PCNT_PLUS_CNT_RST_U6_M & PCNT.ctrl.val)>0) reset_un[6].notify();
       if ((PCNT_PLUS_CNT_RST_U7_M & PCNT.ctrl.val)>0) reset_un[7].notify();
+      /* The interrupt clear bits work the same way. The register reads as
+       * zero, so we take them away once they are handled.
+       */
+      for(un = 0; un < 8; un = un + 1)
+         if ((PCNT.int_clr.val & (1u<<un)) > 0) intclr_un[un].notify();
+      PCNT.int_clr.val = 0;
    }
 }
 
@@ -68,7 +75,8 @@ void pcntmod::returnth() {
          int_raw[0].value_changed_event() | int_raw[1].value_changed_event() |
          int_raw[2].value_changed_event() | int_raw[3].value_changed_event() |
          int_raw[4].value_changed_event() | int_raw[5].value_changed_event() |
-         int_raw[6].value_changed_event() | int_raw[7].value_changed_event());
+         int_raw[6].value_changed_event() | int_raw[7].value_changed_event() |
+         int_ena.value_changed_event());
 
       PCNT.int_raw.val =
          ((int_raw[7].read())?0x80:0x0) |
@@ -80,6 +88,8 @@ void pcntmod::returnth() {
          ((int_raw[1].read())?0x02:0x0) |
          ((int_raw[0].read())?0x01:0x0);
       PCNT.int_st.val = PCNT.int_raw.val & int_ena.read();
+      /* We also drive the interrupt line */
+      intr_o.write(PCNT.int_st.val != 0);
       for(un = 0; un < 8; un = un + 1) {
          PCNT.cnt_unit[un].val = cnt_unit[un].read();
          PCNT.status_unit[un].thres0_lat =
@@ -104,8 +114,14 @@ void pcntmod::returnth() {
 }
 
 void pcntmod::update() {
+   int un;
    update_ev.notify();
    clockpacer.wait_next_apb_clk();
+   /* Counters in a burst are only written when something happens, so we
+    * work out where they are now.
+    */
+   for(un = 0; un < 8; un = un + 1)
+      if (bleft[un] > 0) PCNT.cnt_unit[un].val = (uint16_t)get_cnt(un);
 }
 
 void pcntmod::initstruct() {
@@ -137,6 +153,14 @@ void pcntmod::capture(int un) {
       /* We wait until an input changed. */
       wait(pcntbus_i[un]->default_event());
 
+      /* While the chip sleeps there is no clock to sample the inputs, so the
+       * edges are lost. We only keep track of the levels.
+       */
+      if (clockpacer.is_apb_gated()) {
+         lastlvl = pcntbus_i[un]->read();
+         continue;
+      }
+
       /* We wait until the next clock edge. */
       clockpacer.wait_next_apb_clk();
 
@@ -214,35 +238,38 @@ void pcntmod::capture(int un) {
 }
 
 void pcntmod::count(int un) {
-   pcntbus_t p;
    while(true) {
-      wait(filtered_sig0[un] | filtered_sig1[un] | reset_un[un]);
-      p = pcntbus_i[un]->read();
-      /* If there was a reset notice, we reset the block and do nothing else.*/
-      if (reset_un[un].triggered()) { cnt_unit[un].write(0); }
-      /* Assuming it was not in reset, we can look at the other triggers. */
-      else {
-         if (filtered_sig0[un].triggered()) {
-            if (sc_time_stamp() < fctrl0[un]) 
-               docnt(un, p.sig_ch0, !p.ctrl_ch0, 0);
-            else docnt(un, p.sig_ch0, p.ctrl_ch0, 0);
-         }
-         else {
-            if (sc_time_stamp() < fctrl1[un]) 
-               docnt(un, p.sig_ch1, !p.ctrl_ch1, 1);
-            else docnt(un, p.sig_ch1, p.ctrl_ch1, 1);
-         }
-      }
+      wait(filtered_sig0[un] | filtered_sig1[un] | reset_un[un] |
+         burst_ev[un] | intclr_un[un]);
+      if (intclr_un[un].triggered()) int_raw[un].write(false);
+      if (burst_ev[un].triggered()) runburst(un);
+      else if (filtered_sig0[un].triggered() || filtered_sig1[un].triggered()
+            || reset_un[un].triggered())
+         doedge(un, cnt_unit[un].read(), reset_un[un].triggered(),
+            filtered_sig0[un].triggered());
    }
 }
 
-void pcntmod::docnt(int un, bool siglvl, bool ctrllvl, int ch) {
-   int mode, lctrl, hctrl;
-   int16_t nc;
+int16_t pcntmod::doedge(int un, int16_t cur, bool rst, bool sig0) {
+   pcntbus_t p;
+   p = pcntbus_i[un]->read();
+   /* If there was a reset notice, we reset the block and do nothing else.*/
+   if (rst) { cnt_unit[un].write(0); return 0; }
+   /* Assuming it was not in reset, we can look at the other triggers. */
+   else if (sig0) {
+      if (sc_time_stamp() < fctrl0[un]) 
+         return docnt(un, cur, p.sig_ch0, !p.ctrl_ch0, 0);
+      else return docnt(un, cur, p.sig_ch0, p.ctrl_ch0, 0);
+   }
+   else {
+      if (sc_time_stamp() < fctrl1[un]) 
+         return docnt(un, cur, p.sig_ch1, !p.ctrl_ch1, 1);
+      else return docnt(un, cur, p.sig_ch1, p.ctrl_ch1, 1);
+   }
+}
 
-   /* If it is paused or in reset, we do nothing. */
-   if ((ctrl.read() & ((PCNT_PLUS_CNT_RST_U0_M|PCNT_CNT_PAUSE_U0_M)<<un*2))!=0)
-      return;
+int pcntmod::delta(int un, bool siglvl, bool ctrllvl, int ch) {
+   int mode, lctrl, hctrl;
 
    if (ch == 0) {
       if (siglvl) mode =
@@ -265,23 +292,34 @@ void pcntmod::docnt(int un, bool siglvl, bool ctrllvl, int ch) {
          RDFIELD(conf0[un], PCNT_CH1_HCTRL_MODE_U0_M, PCNT_CH1_HCTRL_MODE_U0_S);
    }
 
-   /* If not we keep going. */
    if (ctrllvl == true) {
-      if (hctrl == 0 && mode == 1) nc = cnt_unit[un].read() + 1;
-      else if (hctrl == 1 && mode == 2) nc = cnt_unit[un].read() + 1;
-      else if (hctrl == 0 && mode == 2) nc = cnt_unit[un].read() - 1;
-      else if (hctrl == 1 && mode == 1) nc = cnt_unit[un].read() - 1;
+      if (hctrl == 0 && mode == 1) return 1;
+      else if (hctrl == 1 && mode == 2) return 1;
+      else if (hctrl == 0 && mode == 2) return -1;
+      else if (hctrl == 1 && mode == 1) return -1;
       /* disable and mode 0 we ignore */
-      else nc = cnt_unit[un].read();
+      else return 0;
    }
    else {
-      if (lctrl == 0 && mode == 1) nc = cnt_unit[un].read() + 1;
-      else if (lctrl == 1 && mode == 2) nc = cnt_unit[un].read() + 1;
-      else if (lctrl == 0 && mode == 2) nc = cnt_unit[un].read() - 1;
-      else if (lctrl == 1 && mode == 1) nc = cnt_unit[un].read() - 1;
+      if (lctrl == 0 && mode == 1) return 1;
+      else if (lctrl == 1 && mode == 2) return 1;
+      else if (lctrl == 0 && mode == 2) return -1;
+      else if (lctrl == 1 && mode == 1) return -1;
       /* disable and mode 0 we ignore */
-      else nc = cnt_unit[un].read();
+      else return 0;
    }
+}
+
+int16_t pcntmod::docnt(int un, int16_t cur, bool siglvl, bool ctrllvl,
+      int ch) {
+   int16_t nc;
+
+   /* If it is paused or in reset, we do nothing. */
+   if ((ctrl.read() & ((PCNT_PLUS_CNT_RST_U0_M|PCNT_CNT_PAUSE_U0_M)<<un*2))!=0)
+      return cur;
+
+   /* If not we keep going. */
+   nc = cur + delta(un, siglvl, ctrllvl, ch);
 
    /* We now check the thresholds, limits and zero comparator. */
    /* First we look at the limit comparators. */
@@ -313,6 +351,217 @@ void pcntmod::docnt(int un, bool siglvl, bool ctrllvl, int ch) {
 
    /* And we commit the new value. */
    cnt_unit[un].write(nc);
+   return nc;
+}
+
+void pcntmod::burst(int un, int ch, unsigned int edges, sc_time dur) {
+   pcntbus_t p;
+   if (un < 0 || un >= pcntbus_i.size()) {
+      PRINTF_ERROR("PCNT", "Burst on invalid unit %d", un);
+      return;
+   }
+   if (bleft[un] > 0) {
+      PRINTF_ERROR("PCNT", "Unit %d is already counting a burst", un);
+      return;
+   }
+   if (edges == 0) return;
+   bstep[un] = sc_time::from_value(dur.value() / edges);
+   if (bstep[un] == SC_ZERO_TIME) {
+      PRINTF_ERROR("PCNT", "Burst on unit %d is faster than the time resolution",
+         un);
+      return;
+   }
+   /* The real block samples the input with the APB clock, so anything faster
+    * than that would lose edges.
+    */
+   if (bstep[un] < clockpacer.get_apb_period())
+      PRINTF_WARN("PCNT", "Burst on unit %d is faster than the APB clock", un);
+
+   /* The first edge goes the other way from where the pin is now. */
+   p = pcntbus_i[un]->read();
+   bch[un] = ch;
+   blvl[un] = (ch == 0)?!p.sig_ch0:!p.sig_ch1;
+   bleft[un] = edges;
+   bnext[un] = sc_time_stamp() + bstep[un];
+   bcnt[un] = cnt_unit[un].read();
+   bda[un] = 0;
+   bdb[un] = 0;
+   bstop[un] = edges + 1;
+   burst_ev[un].notify();
+}
+
+/* Count after the first edges of the burst, if none of them fires anything.
+ * The edges alternate between going to blvl and going away from it.
+ */
+int16_t pcntmod::burstcnt(int un, unsigned int edges) {
+   return bcnt[un] + (int)((edges + 1) / 2) * bda[un] +
+      (int)(edges / 2) * bdb[un];
+}
+
+/* Number of edges already gone by. */
+unsigned int pcntmod::burstpassed(int un) {
+   uint64_t passed;
+   if (sc_time_stamp() < bnext[un]) return 0;
+   passed = (sc_time_stamp().value() - bnext[un].value()) /
+      bstep[un].value() + 1;
+   if (passed > bleft[un]) return bleft[un];
+   return (unsigned int)passed;
+}
+
+/* Finds the first edge in the burst that makes one of the comparators fire,
+ * or that takes the counter out of range. Each edge direction is a line, so
+ * we can solve for each of the comparators instead of stepping.
+ */
+static int64_t firsthit(int64_t base, int64_t s, int64_t jmin, int cmp,
+      int64_t v) {
+   int64_t d;
+   /* cmp: 0 is ==, 1 is >= and -1 is <= */
+   d = v - base;
+   if (cmp == 0) {
+      if (s == 0) return (d == 0)?jmin:-1;
+      if (d % s != 0 || d / s < jmin) return -1;
+      return d / s;
+   }
+   if (cmp < 0) { d = -d; s = -s; }
+   if (jmin * s >= d) return jmin;
+   if (s <= 0) return -1;
+   return (d + s - 1) / s;
+}
+
+void pcntmod::burstsetup(int un) {
+   pcntbus_t p;
+   bool ctrllvl;
+   unsigned int filter_thres;
+   int64_t s, base, j, k, best;
+   int64_t vals[6];
+   int cmps[6];
+   int nv, par, i;
+
+   bda[un] = 0;
+   bdb[un] = 0;
+   bstop[un] = bleft[un] + 1;
+
+   /* If the unit is paused or in reset, nothing gets counted. */
+   if ((ctrl.read() & ((PCNT_PLUS_CNT_RST_U0_M|PCNT_CNT_PAUSE_U0_M)<<un*2))!=0)
+      return;
+   /* If the filter is longer than the pulses, they all get filtered out. */
+   if (RDFIELD(conf0[un], PCNT_FILTER_EN_U0_M, PCNT_FILTER_EN_U0_S)>0) {
+      filter_thres = RDFIELD(conf0[un], PCNT_FILTER_THRES_U0_M,
+          PCNT_FILTER_THRES_U0_S);
+      if (bstep[un] < clockpacer.get_apb_period() * filter_thres) return;
+   }
+
+   p = pcntbus_i[un]->read();
+   ctrllvl = (bch[un] == 0)?p.ctrl_ch0:p.ctrl_ch1;
+   bda[un] = delta(un, blvl[un], ctrllvl, bch[un]);
+   bdb[un] = delta(un, !blvl[un], ctrllvl, bch[un]);
+
+   /* We collect the comparators that are on. Going out of the counter range
+    * is always there too, so that the wrap is done by docnt().
+    */
+   nv = 0;
+   vals[nv] = 32768; cmps[nv] = 1; nv = nv + 1;
+   vals[nv] = -32769; cmps[nv] = -1; nv = nv + 1;
+   if (RDFIELD(conf0[un], PCNT_THR_H_LIM_EN_U0_M, PCNT_THR_H_LIM_EN_U0_S)) {
+      vals[nv] = (int16_t)RDFIELD(conf2[un], PCNT_CNT_H_LIM_U0_M,
+         PCNT_CNT_H_LIM_U0_S);
+      cmps[nv] = 1; nv = nv + 1;
+   }
+   if (RDFIELD(conf0[un], PCNT_THR_L_LIM_EN_U0_M, PCNT_THR_L_LIM_EN_U0_S)) {
+      vals[nv] = (int16_t)RDFIELD(conf2[un], PCNT_CNT_L_LIM_U0_M,
+         PCNT_CNT_L_LIM_U0_S);
+      cmps[nv] = -1; nv = nv + 1;
+   }
+   if (RDFIELD(conf0[un], PCNT_THR_THRES0_EN_U0_M, PCNT_THR_THRES0_EN_U0_S)) {
+      vals[nv] = (int16_t)RDFIELD(conf1[un], PCNT_CNT_THRES0_U0_M,
+         PCNT_CNT_THRES0_U0_S);
+      cmps[nv] = 0; nv = nv + 1;
+   }
+   if (RDFIELD(conf0[un], PCNT_THR_THRES1_EN_U0_M, PCNT_THR_THRES1_EN_U0_S)) {
+      vals[nv] = (int16_t)RDFIELD(conf1[un], PCNT_CNT_THRES1_U0_M,
+         PCNT_CNT_THRES1_U0_S);
+      cmps[nv] = 0; nv = nv + 1;
+   }
+   if (RDFIELD(conf0[un], PCNT_THR_ZERO_EN_U0_M, PCNT_THR_ZERO_EN_U0_S)) {
+      vals[nv] = 0; cmps[nv] = 0; nv = nv + 1;
+   }
+
+   /* After the edge 2j+1 the count is bcnt+bda+j*s and after the edge 2j it
+    * is bcnt+j*s. We look for the first j for each of them.
+    */
+   s = bda[un] + bdb[un];
+   best = (int64_t)bleft[un] + 1;
+   for(par = 0; par < 2; par = par + 1) {
+      base = (par == 0)?bcnt[un]:bcnt[un]+bda[un];
+      for(i = 0; i < nv; i = i + 1) {
+         j = firsthit(base, s, (par == 0)?1:0, cmps[i], vals[i]);
+         if (j < 0) continue;
+         k = (par == 0)?2*j:2*j+1;
+         if (k < best) best = k;
+      }
+   }
+   bstop[un] = (unsigned int)best;
+}
+
+void pcntmod::runburst(int un) {
+   int16_t c;
+   unsigned int passed, last;
+   bool rst, sig0, sig1;
+   pcntbus_t p;
+
+   c = cnt_unit[un].read();
+   while(bleft[un] > 0) {
+      /* We work out when the next event is, with the current setup, and
+       * sleep until then. Anything that could change the count has us redo
+       * the calculation.
+       */
+      bcnt[un] = c;
+      burstsetup(un);
+      last = (bstop[un] <= bleft[un])?bstop[un]:bleft[un];
+      wait(sc_time::from_value(bnext[un].value() +
+            (uint64_t)(last - 1) * bstep[un].value()) - sc_time_stamp(),
+         filtered_sig0[un] | filtered_sig1[un] | reset_un[un] |
+         conf0[un].value_changed_event() | conf1[un].value_changed_event() |
+         conf2[un].value_changed_event() | ctrl.value_changed_event() |
+         pcntbus_i[un]->default_event() | intclr_un[un]);
+      if (intclr_un[un].triggered()) int_raw[un].write(false);
+      rst = reset_un[un].triggered();
+      sig0 = filtered_sig0[un].triggered();
+      sig1 = filtered_sig1[un].triggered();
+
+      /* We catch up with the edges that went by. The one that fires an event
+       * is counted like a normal edge.
+       */
+      passed = burstpassed(un);
+      if (passed == bstop[un]) {
+         c = burstcnt(un, passed - 1);
+         p = pcntbus_i[un]->read();
+         c = docnt(un, c, (passed % 2 == 1)?blvl[un]:!blvl[un],
+            (bch[un] == 0)?p.ctrl_ch0:p.ctrl_ch1, bch[un]);
+      }
+      else {
+         c = burstcnt(un, passed);
+         cnt_unit[un].write(c);
+      }
+      bnext[un] = sc_time::from_value(bnext[un].value() +
+         (uint64_t)passed * bstep[un].value());
+      bleft[un] = bleft[un] - passed;
+      if (passed % 2 == 1) blvl[un] = !blvl[un];
+
+      /* And we handle whatever else woke us up. */
+      if (rst || sig0 || sig1) c = doedge(un, c, rst, sig0);
+   }
+}
+
+int16_t pcntmod::get_cnt(int un) {
+   unsigned int passed;
+   if (bleft[un] == 0) return cnt_unit[un].read();
+   /* The edge that fires an event is not counted until the burst thread
+    * gets to it.
+    */
+   passed = burstpassed(un);
+   if (passed >= bstop[un]) passed = bstop[un] - 1;
+   return burstcnt(un, passed);
 }
 
 void pcntmod::trace(sc_trace_file *tf) {
@@ -39,17 +39,37 @@ SC_MODULE(pcntmod) {
    pcnt_dev_t sv;
    
    sc_port<sc_signal_in_if<pcntbus_t>,0> pcntbus_i;
+   sc_out<bool> intr_o{"intr_o"};
 
    /* Functions */
-   void docnt(int un, bool siglvl, bool ctrllvl, int ch);
+   int delta(int un, bool siglvl, bool ctrllvl, int ch);
+   int16_t docnt(int un, int16_t cur, bool siglvl, bool ctrllvl, int ch);
+   int16_t doedge(int un, int16_t cur, bool rst, bool sig0);
    void update();
    void initstruct();
 
+   /* Frequency source interface. Instead of toggling the pin, a stimulus
+    * generator can tell the counter that the signal of a channel toggles
+    * edges times, evenly spaced, over the next dur. The counter then works
+    * the count out arithmetically and only wakes up when a threshold, limit
+    * or zero event happens, or when the last edge is done. The pin should
+    * be left alone during the burst and, once it is over, it should be at
+    * the level it would be after the edges, or the next real edge will be
+    * miscounted.
+    */
+   void burst(int un, int ch, unsigned int edges, sc_time dur);
+   bool inburst(int un) { return bleft[un] > 0; }
+   int16_t get_cnt(int un);
+
    /* Threads */
    void capture(int un);
    void count(int un);
    void updateth(void);
    void returnth(void);
+   void runburst(int un);
+   void burstsetup(int un);
+   unsigned int burstpassed(int un);
+   int16_t burstcnt(int un, unsigned int edges);
 
    /* Variables */
    sc_time fctrl0[8];
@@ -57,11 +77,29 @@ SC_MODULE(pcntmod) {
    sc_event filtered_sig0[8];
    sc_event filtered_sig1[8];
    sc_event reset_un[8];
+   sc_event intclr_un[8];
    sc_event update_ev;
+   sc_event burst_ev[8];
+
+   /* Burst state. bnext is the time of the next edge, blvl the level the
+    * signal goes to on it and bstop the first edge that has to be counted
+    * one by one, as it fires some event.
+    */
+   int bch[8];
+   bool blvl[8];
+   unsigned int bleft[8];
+   sc_time bnext[8];
+   sc_time bstep[8];
+   int16_t bcnt[8];
+   int bda[8];
+   int bdb[8];
+   unsigned int bstop[8];
 
    /* Sets initial drive condition. */
    SC_CTOR(pcntmod) {
+      int un;
       initstruct();
+      for(un = 0; un < 8; un = un + 1) bleft[un] = 0;
 
       SC_THREAD(updateth);
       sensitive << update_ev;
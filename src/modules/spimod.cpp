@@ -70,6 +70,12 @@ void spimod::update_th() {
          if (spistruct->cmd.usr) start_ev.notify();
          if (spistruct->slave.sync_reset) reset_ev.notify();
       }
+
+      /* A finished transfer raises the done bit. */
+      if (transdone_ev.triggered()) spistruct->slave.trans_done = 1;
+
+      /* And the interrupt line follows the done bit and its enable. */
+      intr_o.write(spistruct->slave.trans_done && spistruct->slave.trans_inten);
    }
 }
 
@@ -346,9 +352,18 @@ void spimod::transfer_th() {
          clockpacer.wait_next_apb_clk();
          if (master.read()) setupmaster();
          else setupslave();
+         loaddma();
          bit = startbit;
          bitrd = startbitrd;
          if (master.read()) activatecs(true);
+
+         /* If there are slaves attached, we do the whole transfer at once. */
+         if (master.read() && !slaves.empty()) {
+            tlmtransfer();
+            bit = -1;
+            bitrd = -1;
+            continue;
+         }
       }
 
       /******************** DELAY 0 *******************************************/
@@ -359,7 +374,7 @@ void spimod::transfer_th() {
        * then give him zeroes.
        */
       if (precycwr > 0 || bit == -1) bittosend = false;
-      else bittosend = ((spistruct->data_buf[bit >> 5] & (1<<(bit & 0x1f)))>0);
+      else bittosend = ((wrbuf[bit >> 5] & (1<<(bit & 0x1f)))>0);
 
       /* The clock could be wrong, so we go ahead and drive it. This should be
        * redundant, but it is nice to do.
@@ -418,12 +433,10 @@ void spimod::transfer_th() {
        * valid range.
        */
       if (bitrd != -1 && precycrd == 0 && bitreceived == true) {
-         spistruct->data_buf[bitrd >> 5] =
-            spistruct->data_buf[bitrd >> 5] | (1<<(bitrd & 0x1f));
+         rdbuf[bitrd >> 5] = rdbuf[bitrd >> 5] | (1<<(bitrd & 0x1f));
       }
       else if (bitrd != -1 && precycrd == 0 && bitreceived == false) {
-         spistruct->data_buf[bitrd >> 5] =
-            spistruct->data_buf[bitrd >> 5] & ~(1<<(bitrd & 0x1f));
+         rdbuf[bitrd >> 5] = rdbuf[bitrd >> 5] & ~(1<<(bitrd & 0x1f));
       }
 
       /* Now we prepare for the next cycle. This depends on the settings. */
@@ -440,7 +453,9 @@ void spimod::transfer_th() {
        * do not have the keepactive, we also deactivate the CS lines.
        */
       if (bit == -1 && bitrd == -1) {
+         storedma();
          lowerusrbit_ev.notify();
+         transdone_ev.notify();
          if (!RDFIELD(pin, SPI_CS_KEEP_ACTIVE_M, SPI_CS_KEEP_ACTIVE_S))
             deactivatecs(true);
       }
@@ -451,6 +466,195 @@ void spimod::transfer_th() {
    }
 }
 
+void spimod::attach(spislave_if *s) {
+   slaves.push_back(s);
+}
+
+void spimod::dmalinks(lldesc_t *out, lldesc_t *in) {
+   outlink = out;
+   inlink = in;
+}
+
+void spimod::loaddma() {
+   lldesc_t *d;
+   uint8_t *b;
+   unsigned int bytes;
+
+   wrbuf = spistruct->data_buf;
+   rdbuf = spistruct->data_buf;
+
+   /* If there is an out chain, we gather it into a buffer that works like
+    * the data_buf, only bigger. The DMA always starts at the beginning of it.
+    */
+   if (outlink != NULL && startbit != -1) {
+      bytes = RDFIELD(mosi_dlen, SPI_USR_MOSI_DBITLEN_M,
+         SPI_USR_MOSI_DBITLEN_S) / 8 + 1;
+      dmawr.assign(bytes / 4 + 1, 0);
+      b = (uint8_t *)dmawr.data();
+      for(d = outlink; d != NULL && bytes > 0; d = d->qe.stqe_next) {
+         unsigned int len = (d->length < bytes)?d->length:bytes;
+         memcpy(b, (const void *)d->buf, len);
+         b = b + len;
+         bytes = bytes - len;
+         if (d->eof) break;
+      }
+      if (bytes > 0)
+         PRINTF_WARN("SPIMOD", "DMA out chain is shorter than mosi_dlen");
+      wrbuf = dmawr.data();
+      lastbit = converttoendian(wrlittleendian, wrmsbfirst,
+         mosi_dlen.read());
+      startbit = converttoendian(wrlittleendian, wrmsbfirst, 0);
+   }
+   if (inlink != NULL && startbitrd != -1) {
+      bytes = RDFIELD(miso_dlen, SPI_USR_MISO_DBITLEN_M,
+         SPI_USR_MISO_DBITLEN_S) / 8 + 1;
+      dmard.assign(bytes / 4 + 1, 0);
+      rdbuf = dmard.data();
+      lastbitrd = converttoendian(rdlittleendian, rdmsbfirst,
+         miso_dlen.read());
+      startbitrd = converttoendian(rdlittleendian, rdmsbfirst, 0);
+   }
+}
+
+void spimod::storedma() {
+   lldesc_t *d;
+   uint8_t *b;
+   unsigned int bytes;
+
+   /* We scatter what came in over the in chain. */
+   if (inlink != NULL && rdbuf == dmard.data()) {
+      bytes = RDFIELD(miso_dlen, SPI_USR_MISO_DBITLEN_M,
+         SPI_USR_MISO_DBITLEN_S) / 8 + 1;
+      b = (uint8_t *)dmard.data();
+      for(d = inlink; d != NULL && bytes > 0; d = d->qe.stqe_next) {
+         unsigned int len = (d->size < bytes)?d->size:bytes;
+         memcpy((void *)d->buf, b, len);
+         d->length = len;
+         b = b + len;
+         bytes = bytes - len;
+         if (d->eof) break;
+      }
+   }
+
+   /* The chains are used only once. */
+   outlink = NULL;
+   inlink = NULL;
+   wrbuf = spistruct->data_buf;
+   rdbuf = spistruct->data_buf;
+}
+
+/* Bytes are numbered in the order they go on the wire. */
+uint8_t spimod::getwirebyte(uint32_t *buf, int pos, bool littleendian,
+      bool msbfirst) {
+   int lane = (littleendian)?(pos & 0x3):(3 - (pos & 0x3));
+   uint8_t v = (buf[pos >> 2] >> (8 * lane)) & 0xff;
+   uint8_t r;
+   int i;
+
+   if (msbfirst) return v;
+   /* If the LSB goes first, we flip it so that the first bit is the MSB. */
+   r = 0;
+   for(i = 0; i < 8; i = i + 1) if (v & (1 << i)) r = r | (0x80 >> i);
+   return r;
+}
+
+void spimod::putwirebyte(uint32_t *buf, int pos, bool littleendian,
+      bool msbfirst, uint8_t v) {
+   int lane = (littleendian)?(pos & 0x3):(3 - (pos & 0x3));
+   uint8_t r;
+   int i;
+
+   if (msbfirst) r = v;
+   else {
+      r = 0;
+      for(i = 0; i < 8; i = i + 1) if (v & (1 << i)) r = r | (0x80 >> i);
+   }
+   buf[pos >> 2] = (buf[pos >> 2] & ~(0xff << (8 * lane))) | (r << (8 * lane));
+}
+
+bool spimod::tlmtransfer() {
+   spitrans_t t;
+   unsigned int i, wroff, rdoff;
+   uint64_t cycles;
+
+   /* We collect the transaction from the registers. */
+   t.cs = 0;
+   if (!RDFIELD(pin, SPI_CS0_DIS_M, SPI_CS0_DIS_S)) t.cs = t.cs | 0x1;
+   if (!RDFIELD(pin, SPI_CS1_DIS_M, SPI_CS1_DIS_S)) t.cs = t.cs | 0x2;
+   if (!RDFIELD(pin, SPI_CS2_DIS_M, SPI_CS2_DIS_S)) t.cs = t.cs | 0x4;
+   if (RDFIELD(user, SPI_USR_COMMAND_M, SPI_USR_COMMAND_S)) {
+      t.cmdbits = RDFIELD(user2, SPI_USR_COMMAND_BITLEN_M,
+         SPI_USR_COMMAND_BITLEN_S) + 1;
+      t.cmd = RDFIELD(user2, SPI_USR_COMMAND_VALUE_M,
+         SPI_USR_COMMAND_VALUE_S);
+   }
+   else { t.cmdbits = 0; t.cmd = 0; }
+   if (RDFIELD(user, SPI_USR_ADDR_M, SPI_USR_ADDR_S)) {
+      t.addrbits = RDFIELD(user1, SPI_USR_ADDR_BITLEN_M,
+         SPI_USR_ADDR_BITLEN_S) + 1;
+      t.addr = addr.read();
+   }
+   else { t.addrbits = 0; t.addr = 0; }
+   if (RDFIELD(user, SPI_USR_DUMMY_M, SPI_USR_DUMMY_S))
+      t.dummycycles = RDFIELD(user1, SPI_USR_DUMMY_CYCLELEN_M,
+         SPI_USR_DUMMY_CYCLELEN_S) + 1;
+   else t.dummycycles = 0;
+   t.fullduplex = RDFIELD(user, SPI_DOUTDIN_M, SPI_DOUTDIN_S) == 1;
+
+   /* The data comes from the DMA buffer or from the data_buf. The data_buf
+    * can only take 512 bits, less if the high part is used.
+    */
+   if (startbit == -1) t.mosibits = 0;
+   else {
+      t.mosibits = RDFIELD(mosi_dlen, SPI_USR_MOSI_DBITLEN_M,
+         SPI_USR_MOSI_DBITLEN_S) + 1;
+      wroff = (wrbuf == dmawr.data() || !RDFIELD(user,
+         SPI_USR_MOSI_HIGHPART_M, SPI_USR_MOSI_HIGHPART_S))?0:32;
+      if (wrbuf != dmawr.data() && t.mosibits > 512 - wroff * 8) {
+         PRINTF_WARN("SPIMOD", "MOSI length goes past the data buffer");
+         t.mosibits = 512 - wroff * 8;
+      }
+      for(i = 0; i < (t.mosibits + 7) / 8; i = i + 1)
+         t.mosi.push_back(getwirebyte(wrbuf, wroff + i, wrlittleendian,
+            wrmsbfirst));
+   }
+   if (startbitrd == -1) { t.misobits = 0; rdoff = 0; }
+   else {
+      t.misobits = RDFIELD(miso_dlen, SPI_USR_MISO_DBITLEN_M,
+         SPI_USR_MISO_DBITLEN_S) + 1;
+      rdoff = (rdbuf == dmard.data() || !RDFIELD(user,
+         SPI_USR_MISO_HIGHPART_M, SPI_USR_MISO_HIGHPART_S))?0:32;
+      if (rdbuf != dmard.data() && t.misobits > 512 - rdoff * 8) {
+         PRINTF_WARN("SPIMOD", "MISO length goes past the data buffer");
+         t.misobits = 512 - rdoff * 8;
+      }
+      t.miso.assign((t.misobits + 7) / 8, 0);
+   }
+
+   /* We hand it to the slaves and wait for the time it would take. */
+   for(i = 0; i < slaves.size(); i = i + 1) slaves[i]->spitransport(t);
+   cycles = t.cmdbits + t.addrbits + t.dummycycles;
+   if (t.fullduplex)
+      cycles = cycles + ((t.mosibits > t.misobits)?t.mosibits:t.misobits);
+   else cycles = cycles + t.mosibits + t.misobits;
+   wait(period * (double)cycles, master.value_changed_event() | reset_ev);
+   if (master.event() || reset_ev.triggered()) {
+      setupmasterslave();
+      storedma();
+      return false;
+   }
+
+   /* And we store what came back. */
+   for(i = 0; i < t.miso.size(); i = i + 1)
+      putwirebyte(rdbuf, rdoff + i, rdlittleendian, rdmsbfirst, t.miso[i]);
+   storedma();
+   lowerusrbit_ev.notify();
+   transdone_ev.notify();
+   if (!RDFIELD(pin, SPI_CS_KEEP_ACTIVE_M, SPI_CS_KEEP_ACTIVE_S))
+      deactivatecs(true);
+   return true;
+}
+
 /*****************
  * Method: configure_meth()
  * Inputs: none
@@ -22,7 +22,10 @@
 #define _SPIMOD_H
 
 #include <systemc.h>
+#include <vector>
 #include "soc/spi_struct.h"
+#include "rom/lldesc.h"
+#include "spitlm.h"
 
 SC_MODULE(spimod) {
    public:
@@ -50,6 +53,7 @@ SC_MODULE(spimod) {
    sc_out<bool> hd_oen_o {"hd_oen_o"};
    sc_out<bool> hd_o {"hd_o"};
    sc_in<bool> hd_i {"hd_i"};
+   sc_out<bool> intr_o {"intr_o"};
 
    /* Registers */
    sc_signal<uint32_t> ctrl {"ctrl"};
@@ -83,7 +87,7 @@ SC_MODULE(spimod) {
    int lastbit, lastbitrd;
    bool wrlittleendian, rdlittleendian;
    bool wrmsbfirst, rdmsbfirst;
-   sc_event update_ev, start_ev, reset_ev, lowerusrbit_ev;
+   sc_event update_ev, start_ev, reset_ev, lowerusrbit_ev, transdone_ev;
    sc_time period, hightime, lowtime;
 
    /* Simulation Interface Functions */
@@ -92,6 +96,17 @@ SC_MODULE(spimod) {
    void configure(spi_dev_t *_spistruct);
    void trace(sc_trace_file *tf);
 
+   /* Transaction level interface. Once a slave is attached, transfers are
+    * handed to the slaves as a whole and the SCK, MOSI and MISO pins are no
+    * longer driven or sampled. The CS pins still are.
+    */
+   void attach(spislave_if *s);
+   /* DMA descriptor chains for the next transfer. The link registers are too
+    * narrow for a pointer in the model, so the firmware passes them here.
+    * They are used once and dropped at the end of the transfer.
+    */
+   void dmalinks(lldesc_t *out, lldesc_t *in);
+
    /* Internal Functions */
    private:
    void start_of_simulation();
@@ -103,6 +118,18 @@ SC_MODULE(spimod) {
    void setupmasterslave();
    void setupmaster();
    void setupslave();
+   void loaddma();
+   void storedma();
+   bool tlmtransfer();
+   uint8_t getwirebyte(uint32_t *buf, int pos, bool littleendian,
+      bool msbfirst);
+   void putwirebyte(uint32_t *buf, int pos, bool littleendian, bool msbfirst,
+      uint8_t v);
+
+   std::vector<spislave_if *> slaves;
+   lldesc_t *outlink, *inlink;
+   std::vector<uint32_t> dmawr, dmard;
+   uint32_t *wrbuf, *rdbuf;
 
    /* Threads */
    public:
@@ -115,9 +142,13 @@ SC_MODULE(spimod) {
    SC_CTOR(spimod) {
       spistruct = NULL;
       actclk = false;
+      outlink = NULL;
+      inlink = NULL;
+      wrbuf = NULL;
+      rdbuf = NULL;
 
       SC_THREAD(update_th);
-      sensitive << update_ev << lowerusrbit_ev;
+      sensitive << update_ev << lowerusrbit_ev << transdone_ev;
 
       SC_THREAD(return_th);
       sensitive << slv_wr_status;
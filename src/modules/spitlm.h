@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * spitlm.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Transaction level interface for the SPI. A slave model that implements
+ *   spislave_if can be attached to a spimod. The spimod then hands it each
+ *   transaction as a whole, with the command, address and data already
+ *   taken out of the registers or the DMA descriptors, and waits once for
+ *   the time the transfer would take instead of clocking every bit.
+ *
+ *   Data goes in the order it would go on the wire, one byte per entry and
+ *   with the first bit sent in the MSB, no matter the bit and byte order
+ *   settings. If the number of bits is not a multiple of eight, the last
+ *   byte only has its upper bits used.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _SPITLM_H
+#define _SPITLM_H
+
+#include <stdint.h>
+#include <vector>
+
+struct spitrans_t {
+   /* CS lines the SPI is driving low, one bit per line. Slaves selected by a
+    * GPIO should look at their own pin instead.
+    */
+   unsigned int cs;
+   unsigned int cmdbits;
+   uint16_t cmd;
+   unsigned int addrbits;
+   uint32_t addr;
+   unsigned int dummycycles;
+   /* If set, MOSI and MISO go at the same time, if not MISO comes after. */
+   bool fullduplex;
+   unsigned int mosibits;
+   std::vector<uint8_t> mosi;
+   /* The slave fills this one in. It starts out with zeroes. */
+   unsigned int misobits;
+   std::vector<uint8_t> miso;
+};
+
+class spislave_if {
+   public:
+   /* Called at the start of the transaction, with the time still at the
+    * point the CS went active.
+    */
+   virtual void spitransport(spitrans_t &t) = 0;
+   virtual ~spislave_if() {}
+};
+
+#endif
@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * timgmod.cpp -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Implements a SystemC module for an ESP32 timer group. See timgmod.h.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#include <systemc.h>
+#include <string.h>
+#include "timgmod.h"
+#include "clockpacer.h"
+#include "alarms.h"
+#include "info.h"
+
+/* Fields of the timer config register. */
+#define TIMG_ALARM_EN_M (1u<<10)
+#define TIMG_DIVIDER_M (0xffffu<<13)
+#define TIMG_DIVIDER_S 13
+#define TIMG_AUTORELOAD_M (1u<<29)
+#define TIMG_INCREASE_M (1u<<30)
+#define TIMG_EN_M (1u<<31)
+/* Reset value: counting up, with auto reload and the smallest divider. */
+#define TIMG_CONFIG_RST 0x60002000
+
+#define TIMG_ALARM(t) (((uint64_t)tgstruct->hw_timer[t].alarm_high << 32) \
+   | tgstruct->hw_timer[t].alarm_low)
+#define TIMG_LOAD(t) (((uint64_t)tgstruct->hw_timer[t].load_high << 32) \
+   | tgstruct->hw_timer[t].load_low)
+
+void timgmod::update() {
+   update_ev.notify();
+   if(clockpacer.is_thread()) clockpacer.wait_next_apb_clk();
+}
+
+void timgmod::configure(timg_dev_t *_tgstruct) {
+   int t;
+   tgstruct = _tgstruct;
+   if (tgstruct == NULL)
+      SC_REPORT_FATAL("TIMGMOD", "failed to set TIMG to struct NULL");
+   memset(tgstruct, 0, sizeof(timg_dev_t));
+   for(t = 0; t < TIMG_TIMERS; t = t + 1) {
+      tgstruct->hw_timer[t].config.val = TIMG_CONFIG_RST;
+      lastcfg[t] = TIMG_CONFIG_RST;
+      lastalarm[t] = 0;
+      cbase[t] = 0;
+      cstart[t] = SC_ZERO_TIME;
+      edgeend[t] = SC_ZERO_TIME;
+      ctick[t] = tickof((TIMG_CONFIG_RST & TIMG_DIVIDER_M) >> TIMG_DIVIDER_S);
+   }
+}
+
+void timgmod::start_of_simulation() {
+   int t;
+   for(t = 0; t < TIMG_TIMERS; t = t + 1)
+      ctick[t] = tickof((lastcfg[t] & TIMG_DIVIDER_M) >> TIMG_DIVIDER_S);
+   t0_intr_o.write(false);
+   t1_intr_o.write(false);
+   t0_edge_o.write(false);
+   t1_edge_o.write(false);
+}
+
+sc_time timgmod::tickof(uint32_t divider) {
+   /* The prescaler divides the APB clock by 2 to 65536. Zero means 65536
+    * and one works as two.
+    */
+   if (divider == 0) divider = 65536;
+   else if (divider == 1) divider = 2;
+   return clockpacer.get_apb_period() * (double)divider;
+}
+
+uint64_t timgmod::get_cnt(int t) {
+   uint64_t ticks;
+   /* If the timer is stopped, we have the value. If not, we calculate how
+    * many ticks went by since the start time.
+    */
+   if ((lastcfg[t] & TIMG_EN_M) == 0 || ctick[t] == SC_ZERO_TIME)
+      return cbase[t];
+   ticks = (sc_time_stamp() - cstart[t]).value() / ctick[t].value();
+   if ((lastcfg[t] & TIMG_INCREASE_M) != 0) return cbase[t] + ticks;
+   else return cbase[t] - ticks;
+}
+
+/* Moves the start time up to the last tick, so the counting can be changed
+ * without losing the part of the tick that already went by.
+ */
+void timgmod::rebase(int t) {
+   uint64_t ticks;
+   if ((lastcfg[t] & TIMG_EN_M) == 0 || ctick[t] == SC_ZERO_TIME) return;
+   ticks = (sc_time_stamp() - cstart[t]).value() / ctick[t].value();
+   cbase[t] = get_cnt(t);
+   cstart[t] = cstart[t] + sc_time::from_value(ticks * ctick[t].value());
+}
+
+void timgmod::schedule(int t) {
+   uint64_t cur, ticks;
+
+   alarm_ev[t].cancel();
+   if ((lastcfg[t] & (TIMG_EN_M|TIMG_ALARM_EN_M)) != (TIMG_EN_M|TIMG_ALARM_EN_M)
+         || ctick[t] == SC_ZERO_TIME) return;
+
+   /* We work out in how many ticks from the start time the counter gets to
+    * the alarm. If it is already past it, the alarm goes off right away,
+    * instead of waiting for the counter to wrap around.
+    */
+   cur = get_cnt(t);
+   if ((lastcfg[t] & TIMG_INCREASE_M) != 0) {
+      if (lastalarm[t] <= cur) { alarm_ev[t].notify(SC_ZERO_TIME); return; }
+      ticks = lastalarm[t] - cbase[t];
+   }
+   else {
+      if (lastalarm[t] >= cur) { alarm_ev[t].notify(SC_ZERO_TIME); return; }
+      ticks = cbase[t] - lastalarm[t];
+   }
+
+   /* An alarm further than we can represent never goes off. */
+   if (ticks > (~(uint64_t)0 - cstart[t].value()) / ctick[t].value()) return;
+   alarm_ev[t].notify(cstart[t] + sc_time::from_value(ticks * ctick[t].value())
+      - sc_time_stamp());
+}
+
+void timgmod::doalarm(int t) {
+   tgstruct->int_raw.val = tgstruct->int_raw.val | (1u << t);
+   /* The alarm enable clears itself. */
+   tgstruct->hw_timer[t].config.alarm_en = 0;
+   lastcfg[t] = lastcfg[t] & ~TIMG_ALARM_EN_M;
+   /* With auto reload the counter takes the load value. As the alarm goes off
+    * on a tick, the next one is a full tick away.
+    */
+   if ((lastcfg[t] & TIMG_AUTORELOAD_M) != 0) {
+      cbase[t] = TIMG_LOAD(t);
+      cstart[t] = sc_time_stamp();
+   }
+}
+
+void timgmod::updateth() {
+   int t;
+   uint32_t cfg;
+   bool st0, st1;
+   deadline d;
+
+   while(true) {
+      wait();
+
+      /* First the alarms that went off. */
+      for(t = 0; t < TIMG_TIMERS; t = t + 1)
+         if (alarm_ev[t].triggered()) doalarm(t);
+
+      /* Then we take in what the firmware changed. */
+      for(t = 0; t < TIMG_TIMERS; t = t + 1) {
+         cfg = tgstruct->hw_timer[t].config.val;
+         if (cfg != lastcfg[t]) {
+            /* We bring the counter up to now with the old settings. If it
+             * was just enabled or the divider changed, the ticks start over
+             * from now.
+             */
+            rebase(t);
+            if ((lastcfg[t] & TIMG_EN_M) == 0 ||
+                  (cfg & TIMG_DIVIDER_M) != (lastcfg[t] & TIMG_DIVIDER_M)) {
+               cstart[t] = sc_time_stamp();
+               ctick[t] = tickof((cfg & TIMG_DIVIDER_M) >> TIMG_DIVIDER_S);
+            }
+            lastcfg[t] = cfg;
+         }
+         lastalarm[t] = TIMG_ALARM(t);
+         /* Writing any value to reload loads the counter and any value to
+          * update latches it.
+          */
+         if (tgstruct->hw_timer[t].reload != 0) {
+            cbase[t] = TIMG_LOAD(t);
+            cstart[t] = sc_time_stamp();
+            tgstruct->hw_timer[t].reload = 0;
+         }
+         if (tgstruct->hw_timer[t].update != 0) {
+            tgstruct->hw_timer[t].cnt_low = (uint32_t)get_cnt(t);
+            tgstruct->hw_timer[t].cnt_high = (uint32_t)(get_cnt(t) >> 32);
+            tgstruct->hw_timer[t].update = 0;
+         }
+         schedule(t);
+      }
+
+      /* Interrupt clears. */
+      if (tgstruct->int_clr_timers.val != 0) {
+         tgstruct->int_raw.val =
+            tgstruct->int_raw.val & ~tgstruct->int_clr_timers.val;
+         tgstruct->int_clr_timers.val = 0;
+      }
+      tgstruct->int_st_timers.val =
+         tgstruct->int_raw.val & tgstruct->int_ena.val;
+
+      /* And we drive the interrupt lines. The level ones follow the status.
+       * The edge ones pulse for an APB clock on each alarm, so an alarm
+       * still gives an edge when the CPU interrupt is shared with the other
+       * timer and its status is still set.
+       */
+      st0 = tgstruct->int_st_timers.t0;
+      st1 = tgstruct->int_st_timers.t1;
+      t0_intr_o.write(st0 && tgstruct->hw_timer[0].config.level_int_en);
+      t1_intr_o.write(st1 && tgstruct->hw_timer[1].config.level_int_en);
+      for(t = 0; t < TIMG_TIMERS; t = t + 1)
+         if (alarm_ev[t].triggered()
+               && (tgstruct->int_ena.val & (1u << t)) != 0
+               && tgstruct->hw_timer[t].config.edge_int_en)
+            edgeend[t] = sc_time_stamp() + clockpacer.get_apb_period();
+      t0_edge_o.write(sc_time_stamp() < edgeend[0]);
+      t1_edge_o.write(sc_time_stamp() < edgeend[1]);
+      d = deadline();
+      for(t = 0; t < TIMG_TIMERS; t = t + 1)
+         if (sc_time_stamp() < edgeend[t]) d.add(edgeend[t]);
+      d.arm(edgeend_ev);
+   }
+}
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * timgmod.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   Models one ESP32 timer group, with its two 64-bit general purpose
+ *   timers. The counters do not tick. Each one keeps the value it had at a
+ *   start time and its value is calculated from the simulation time and the
+ *   prescaler when it is latched, so the only events scheduled are the
+ *   alarms.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _TIMGMOD_H
+#define _TIMGMOD_H
+
+#include <systemc.h>
+#include "soc/timer_group_struct.h"
+
+#define TIMG_TIMERS 2
+
+SC_MODULE(timgmod) {
+   public:
+   /* Ports. Each timer has a level and an edge interrupt source. */
+   sc_out<bool> t0_intr_o {"t0_intr_o"};
+   sc_out<bool> t1_intr_o {"t1_intr_o"};
+   sc_out<bool> t0_edge_o {"t0_edge_o"};
+   sc_out<bool> t1_edge_o {"t1_edge_o"};
+
+   /* Functions */
+   void update();
+   void configure(timg_dev_t *_tgstruct);
+   uint64_t get_cnt(int t);
+
+   /* Threads */
+   void updateth(void);
+
+   /* Variables */
+   timg_dev_t *tgstruct;
+   sc_event update_ev;
+   sc_event alarm_ev[TIMG_TIMERS];
+   sc_event edgeend_ev;
+
+   /* Counter state. The counter was at cbase at the time cstart and moves
+    * one every ctick from then on, while it is enabled. The lastcfg, lastalarm
+    * and lastload keep what we last took in from the struct, so we can tell
+    * what the firmware changed.
+    */
+   uint64_t cbase[TIMG_TIMERS];
+   sc_time cstart[TIMG_TIMERS];
+   sc_time ctick[TIMG_TIMERS];
+   uint32_t lastcfg[TIMG_TIMERS];
+   uint64_t lastalarm[TIMG_TIMERS];
+   /* When the pulse on each edge interrupt source ends. */
+   sc_time edgeend[TIMG_TIMERS];
+
+   private:
+   sc_time tickof(uint32_t divider);
+   void rebase(int t);
+   void schedule(int t);
+   void doalarm(int t);
+   public:
+
+   SC_CTOR(timgmod) {
+      tgstruct = NULL;
+
+      SC_THREAD(updateth);
+      sensitive << update_ev << alarm_ev[0] << alarm_ev[1] << edgeend_ev;
+   }
+
+   void start_of_simulation();
+};
+extern timgmod *timg0ptr;
+extern timgmod *timg1ptr;
+
+#endif
@@ -20,6 +20,7 @@
 
 #include <systemc.h>
 #include "uart.h"
+#include "clockpacer.h"
 #include "info.h"
 
 void uart::intake() {
@@ -124,6 +125,9 @@ void uart::outtake() {
    while(true) {
       /* We block until we receive something to send. */
       msg = to.read();
+      /* If the chip is asleep, we hold it until it wakes up. */
+      while (gated && clockpacer.is_apb_gated())
+         wait(clockpacer.apb_gate_event());
       if (debug && isprint(msg)) {
          PRINTF_INFO("UART","[%s] sending-'%c'/%02x", name(), msg, msg);
       }
@@ -40,6 +40,7 @@ SC_MODULE(uart) {
    bool autodetect;
    int stopbits; /* 0: invalid, 1: one bit, 2: 1.5 bits, 3: 2 bits */
    sc_time deadtime;
+   bool gated;
 
    public:
    void set_baud(unsigned int baudrate);
@@ -49,6 +50,10 @@ SC_MODULE(uart) {
    void set_stop(int _sp) { stopbits = _sp; }
    int get_stop() { return stopbits; }
    void set_deadtime(sc_time _dt) { deadtime = _dt; }
+   /* The UARTs in the chip run off the APB clock, so they stop sending while
+    * it is gated. The ones in the testbench do not.
+    */
+   void set_gated(bool on) { gated = on; }
 
    /* This enables the autodetect. It will take the first message and discard
     * it. Only the start bit will be used.
@@ -69,6 +74,7 @@ SC_MODULE(uart) {
       autodetect = false;
       debug = false;
       stopbits = 1;
+      gated = false;
    }
    SC_HAS_PROCESS(uart);
 };
@@ -0,0 +1,740 @@
+/*******************************************************************************
+ * mqttbroker.cpp -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a model for a MQTT 3.1.1 broker. See the header for details.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+#include <systemc.h>
+#include <algorithm>
+#include "mqttbroker.h"
+#include "info.h"
+
+/*******************************************************************************
+** Packet Fields ***************************************************************
+*******************************************************************************/
+
+/* Integers are two bytes, big-endian. If we run out of packet we return -1. */
+static int getshort(const std::string &body, size_t &pos) {
+   int val;
+   if (pos + 2 > body.size()) return -1;
+   val = ((int)(unsigned char)body[pos] << 8) | (unsigned char)body[pos+1];
+   pos = pos + 2;
+   return val;
+}
+
+/* Strings have a two byte length followed by the characters. */
+static std::string getstring(const std::string &body, size_t &pos) {
+   std::string str;
+   int len = getshort(body, pos);
+   if (len < 0 || pos + len > body.size()) {
+      pos = body.size();
+      return str;
+   }
+   str = body.substr(pos, len);
+   pos = pos + len;
+   return str;
+}
+
+static void putshort(std::string &body, int val) {
+   body.push_back((char)((val >> 8) & 0xff));
+   body.push_back((char)(val & 0xff));
+}
+
+static void putstring(std::string &body, const std::string &str) {
+   putshort(body, (int)str.length());
+   body.append(str);
+}
+
+/* Splits a topic or filter into its levels. */
+static std::vector<std::string> splitlevels(const std::string &topic) {
+   std::vector<std::string> levels;
+   size_t start = 0;
+   size_t end;
+   while(1) {
+      end = topic.find('/', start);
+      if (end == std::string::npos) {
+         levels.push_back(topic.substr(start));
+         return levels;
+      }
+      levels.push_back(topic.substr(start, end - start));
+      start = end + 1;
+   }
+}
+
+/*******************************************************************************
+** Setup ***********************************************************************
+*******************************************************************************/
+
+void mqttbroker::attach(webclient &link, unsigned int port) {
+   _link = &link;
+   _link->listen(port);
+   sc_spawn(sc_bind(&mqttbroker::listener, this, port));
+}
+
+void mqttbroker::listener(unsigned int port) {
+   /* We take one connection at a time. When it ends we wait for the next. */
+   while(1) session(_link->accept(port));
+}
+
+/*******************************************************************************
+** Firmware Sessions ***********************************************************
+*******************************************************************************/
+
+bool mqttbroker::readpacket(int port, int &type, int &flags,
+      std::string &body) {
+   int recv;
+   int length;
+   int mult;
+   int cnt;
+
+   /* We first get the fixed header. A -1 means the port closed. */
+   recv = _link->read(port);
+   if (recv < 0) return false;
+   type = (recv & 0xf0) >> 4;
+   flags = recv & 0x0f;
+
+   /* The remaining length takes up to four bytes, seven bits each. */
+   length = 0;
+   mult = 1;
+   cnt = 0;
+   do {
+      recv = _link->read(port);
+      if (recv < 0) return false;
+      length = length + (recv & 0x7f) * mult;
+      mult = mult * 128;
+      cnt = cnt + 1;
+   } while ((recv & 0x80) != 0 && cnt < 4);
+
+   /* And now the rest of the packet. */
+   body.clear();
+   body.reserve(length);
+   for(cnt = 0; cnt < length; cnt = cnt + 1) {
+      recv = _link->read(port);
+      if (recv < 0) return false;
+      body.push_back((char)recv);
+   }
+   return true;
+}
+
+void mqttbroker::sendpacket(int port, int type, int flags, std::string body) {
+   std::string msg;
+   int length = (int)body.length();
+   int digit;
+
+   msg.push_back((char)((type << 4) | flags));
+   do {
+      digit = length % 128;
+      length = length / 128;
+      if (length > 0) digit = digit | 0x80;
+      msg.push_back((char)digit);
+   } while (length > 0);
+   msg.append(body);
+
+   /* We send it all in one go so other sessions do not get in the middle. The
+    * packet is binary, so any 0xff needs to be escaped.
+    */
+   _link->send(port, (void *)msg.data(), (int)msg.length(), true);
+}
+
+void mqttbroker::sendack(int port, int type, int packetid, bool release) {
+   /* Without a delay we simply send it. If there is a delay we spawn a thread
+    * to do it so that the session can go on taking packets.
+    */
+   if (_ackdelay == SC_ZERO_TIME) delayedack(port, type, packetid, release);
+   else sc_spawn(sc_bind(&mqttbroker::delayedack, this, port, type,
+      packetid, release));
+}
+
+void mqttbroker::delayedack(int port, int type, int packetid, bool release) {
+   std::string body;
+   if (_ackdelay != SC_ZERO_TIME) wait(_ackdelay);
+
+   /* The client might have gone away while we waited. */
+   if (!_link->willclose(port)) {
+      putshort(body, packetid);
+      sendpacket(port, type, 0, body);
+   }
+
+   /* Once the last ack goes out, the message can leave the DUT outbox. Acks
+    * to retransmissions do not release anything.
+    */
+   if (release) _outbox = _outbox - 1;
+}
+
+void mqttbroker::closeport(int port) {
+   /* We tell the DUT we are closing it. */
+   _link->sendf(-1, false, "\xff%d!\r\n", port);
+
+   /* Then we drop whatever comes until the DUT closes its side too. If it
+    * does not we give up and close it here.
+    */
+   while(!_link->isclosed(port)) {
+      if (!_link->waitdata(port, sc_time(1, SC_SEC))) _link->dropport(port);
+      _link->flush(port);
+   }
+}
+
+sc_time mqttbroker::retransmit(mqttsession_t *s) {
+   std::string body;
+   sc_time next = SC_ZERO_TIME;
+   sc_time left;
+   int i;
+
+   if (_retry == SC_ZERO_TIME) return SC_ZERO_TIME;
+
+   /* Sending can block and other threads can add messages meanwhile, so we go
+    * by index. Only this session takes them out.
+    */
+   for(i = 0; i < (int)s->inflight.size(); i = i + 1) {
+      /* Once the client sent the PUBREC only the PUBREL goes again, before
+       * that it is the whole PUBLISH with the DUP flag.
+       */
+      if (sc_time_stamp() >= s->inflight[i].resent + _retry) {
+         body.clear();
+         if (s->inflight[i].released) {
+            putshort(body, s->inflight[i].packetid);
+            sendpacket(s->port, MQTT_TYPE_PUBREL, 0x2, body);
+         }
+         else {
+            putstring(body, s->inflight[i].msg.topic);
+            putshort(body, s->inflight[i].packetid);
+            body.append(s->inflight[i].msg.payload);
+            sendpacket(s->port, MQTT_TYPE_PUBLISH, 0x8
+               | (s->inflight[i].qos << 1)
+               | (s->inflight[i].msg.retain ? 1 : 0), body);
+         }
+         s->inflight[i].resent = sc_time_stamp();
+         _resent = _resent + 1;
+      }
+
+      /* And we see when the next one is due. */
+      left = s->inflight[i].resent + _retry - sc_time_stamp();
+      if (next == SC_ZERO_TIME || left < next) next = left;
+   }
+   return next;
+}
+
+void mqttbroker::session(int port) {
+   mqttsession_t *s;
+   std::string body;
+   std::string str;
+   std::vector<mqttinflight_t>::iterator inf;
+   std::vector<int>::iterator q2;
+   std::vector<mqttsub_t> added;
+   std::vector<mqttsub_t>::iterator sub;
+   mqttmsg_t msg;
+   sc_time lastin;
+   sc_time kadeadline;
+   sc_time tmout;
+   size_t pos;
+   int type;
+   int flags;
+   int cflags;
+   int packetid;
+   int qos;
+   bool clean;
+   bool running;
+   bool expired;
+
+   /* The first packet has to be a CONNECT. */
+   if (!readpacket(port, type, flags, body)) return;
+   if (type != MQTT_TYPE_CONNECT) {
+      PRINTF_ERROR("MQTTB", "Port %d did not start with a CONNECT", port);
+      closeport(port);
+      return;
+   }
+
+   /* We get the protocol name, level, flags and keep-alive. We take both
+    * the 3.1 and the 3.1.1 names, as they are the same for what we do.
+    */
+   pos = 0;
+   str = getstring(body, pos);
+   pos = pos + 1; /* level */
+   cflags = (pos < body.size()) ? (unsigned char)body[pos] : 0;
+   pos = pos + 1;
+   packetid = getshort(body, pos); /* keep-alive */
+   if (packetid < 0 || (str != "MQTT" && str != "MQIsdp")) {
+      PRINTF_ERROR("MQTTB", "Got an illegal CONNECT on port %d", port);
+      closeport(port);
+      return;
+   }
+   s = new mqttsession_t(port, getstring(body, pos));
+   s->keepalive = packetid;
+   if (cflags & 0x04) {
+      s->haswill = true;
+      s->will.topic = getstring(body, pos);
+      s->will.payload = getstring(body, pos);
+      s->will.qos = (cflags >> 3) & 0x3;
+      s->will.retain = (cflags & 0x20) != 0;
+   }
+   /* Any user name and password we simply accept. */
+   _sessions.push_back(s);
+   PRINTF_INFO("MQTTB", "Client %s connected on port %d, keep-alive %ds",
+      s->clientid.c_str(), port, s->keepalive);
+   sendpacket(port, MQTT_TYPE_CONNACK, 0, std::string("\0\0", 2));
+
+   clean = false;
+   running = true;
+   lastin = sc_time_stamp();
+   while(running) {
+      /* While we wait for the next packet, anything not answered in time is
+       * sent again. If nothing comes in one and a half times the keep-alive,
+       * the client is considered gone. Messages can be added while we wait,
+       * so with nothing to time we still look again after the retry time.
+       */
+      expired = false;
+      while(1) {
+         tmout = retransmit(s);
+         if (tmout == SC_ZERO_TIME) tmout = _retry;
+         if (s->keepalive > 0) {
+            kadeadline = lastin + sc_time(s->keepalive * 1.5, SC_SEC);
+            if (sc_time_stamp() >= kadeadline) {
+               expired = true;
+               break;
+            }
+            if (tmout == SC_ZERO_TIME || kadeadline - sc_time_stamp() < tmout)
+               tmout = kadeadline - sc_time_stamp();
+         }
+         if (tmout == SC_ZERO_TIME || _link->waitdata(port, tmout)) break;
+      }
+      if (expired) {
+         PRINTF_WARN("MQTTB", "Client %s keep-alive expired",
+            s->clientid.c_str());
+         _timeouts = _timeouts + 1;
+         closeport(port);
+         break;
+      }
+      if (!readpacket(port, type, flags, body)) break;
+      lastin = sc_time_stamp();
+
+      pos = 0;
+      switch(type) {
+         case MQTT_TYPE_PUBLISH:
+            qos = (flags >> 1) & 0x3;
+            msg.topic = getstring(body, pos);
+            packetid = (qos > 0) ? getshort(body, pos) : 0;
+            if (qos > 2 || packetid < 0) {
+               PRINTF_ERROR("MQTTB", "Client %s sent an illegal PUBLISH",
+                  s->clientid.c_str());
+               closeport(port);
+               running = false;
+               break;
+            }
+            msg.payload = body.substr(pos);
+            msg.qos = qos;
+            msg.retain = (flags & 0x1) != 0;
+            if (flags & 0x8) _dups = _dups + 1;
+            countpub(qos);
+
+            /* A QoS 2 message we already have we only acknowledge again. */
+            q2 = std::find(s->qos2in.begin(), s->qos2in.end(), packetid);
+            if (qos == 2 && q2 != s->qos2in.end()) {
+               sendack(port, MQTT_TYPE_PUBREC, packetid, false);
+               break;
+            }
+            if (qos > 0) {
+               _outbox = _outbox + 1;
+               if (_outbox > _maxoutbox) _maxoutbox = _outbox;
+            }
+            if (qos == 2) s->qos2in.push_back(packetid);
+            route(msg);
+            if (qos == 1) sendack(port, MQTT_TYPE_PUBACK, packetid, true);
+            else if (qos == 2) sendack(port, MQTT_TYPE_PUBREC, packetid, false);
+            break;
+         case MQTT_TYPE_PUBREL:
+            /* Only the first PUBREL for a message takes it out of the outbox,
+             * a retransmitted one only gets its PUBCOMP again.
+             */
+            packetid = getshort(body, pos);
+            q2 = std::find(s->qos2in.begin(), s->qos2in.end(), packetid);
+            if (q2 != s->qos2in.end()) {
+               s->qos2in.erase(q2);
+               sendack(port, MQTT_TYPE_PUBCOMP, packetid, true);
+            }
+            else sendack(port, MQTT_TYPE_PUBCOMP, packetid, false);
+            break;
+         case MQTT_TYPE_PUBACK:
+         case MQTT_TYPE_PUBREC:
+         case MQTT_TYPE_PUBCOMP:
+            /* These are answers to the messages we sent. */
+            packetid = getshort(body, pos);
+            for(inf = s->inflight.begin(); inf != s->inflight.end(); inf++)
+               if (inf->packetid == packetid) break;
+            if (inf == s->inflight.end()) {
+               PRINTF_WARN("MQTTB", "Client %s sent %s for unknown ID %d",
+                  s->clientid.c_str(),
+                  _link->packetname((mqtt_type_t)type, "").c_str(), packetid);
+               break;
+            }
+            /* A PUBREC we answer with a PUBREL and wait for the PUBCOMP. */
+            if (type == MQTT_TYPE_PUBREC) {
+               inf->released = true;
+               inf->resent = sc_time_stamp();
+               body.clear();
+               putshort(body, packetid);
+               sendpacket(port, MQTT_TYPE_PUBREL, 0x2, body);
+               break;
+            }
+            _acks = _acks + 1;
+            _acklat = _acklat + (sc_time_stamp() - inf->sent);
+            if (sc_time_stamp() - inf->sent > _acklatmax)
+               _acklatmax = sc_time_stamp() - inf->sent;
+            s->inflight.erase(inf);
+            _inflight = _inflight - 1;
+            break;
+         case MQTT_TYPE_SUBSCRIBE:
+            packetid = getshort(body, pos);
+            str.clear();
+            putshort(str, packetid);
+            added.clear();
+            while(pos < body.size()) {
+               std::string filter = getstring(body, pos);
+               qos = (pos < body.size()) ? (body[pos] & 0x3) : 0;
+               pos = pos + 1;
+               if (qos > 2) qos = 2;
+               addsub(s, filter, qos);
+               added.push_back(mqttsub_t(filter, qos));
+               str.push_back((char)qos);
+            }
+            sendpacket(port, MQTT_TYPE_SUBACK, 0, str);
+            /* The retained messages go after the SUBACK. */
+            for(sub = added.begin(); sub != added.end(); sub++)
+               sendretained(s, sub->filter, sub->qos);
+            break;
+         case MQTT_TYPE_UNSUBSCRIBE:
+            packetid = getshort(body, pos);
+            while(pos < body.size()) removesub(s, getstring(body, pos));
+            str.clear();
+            putshort(str, packetid);
+            sendpacket(port, MQTT_TYPE_UNSUBACK, 0, str);
+            break;
+         case MQTT_TYPE_PINGREQ:
+            sendpacket(port, MQTT_TYPE_PINGRESP, 0, std::string());
+            break;
+         case MQTT_TYPE_DISCONNECT:
+            /* The client should now close the socket, so we just wait for
+             * it. A clean disconnect does not send the will.
+             */
+            clean = true;
+            break;
+         default:
+            PRINTF_ERROR("MQTTB", "Client %s sent unexpected %s",
+               s->clientid.c_str(),
+               _link->packetname((mqtt_type_t)type, "").c_str());
+            closeport(port);
+            running = false;
+            break;
+      }
+   }
+
+   PRINTF_INFO("MQTTB", "Client %s on port %d went away",
+      s->clientid.c_str(), port);
+   endsession(s, clean);
+}
+
+/*******************************************************************************
+** Routing *********************************************************************
+*******************************************************************************/
+
+bool mqttbroker::topicmatch(std::string filter, std::string topic) {
+   std::vector<std::string> fl;
+   std::vector<std::string> tl;
+   int lev;
+
+   /* Topics starting with a $ are not matched by a wildcard at the top. */
+   if (topic.length() > 0 && topic[0] == '$'
+         && filter.length() > 0 && (filter[0] == '+' || filter[0] == '#'))
+      return false;
+
+   fl = splitlevels(filter);
+   tl = splitlevels(topic);
+   for(lev = 0; lev < (int)fl.size(); lev = lev + 1) {
+      /* A # takes this level and all below it, including none. */
+      if (fl[lev] == "#") return true;
+      if (lev >= (int)tl.size()) return false;
+      if (fl[lev] != "+" && fl[lev] != tl[lev]) return false;
+   }
+   return fl.size() == tl.size();
+}
+
+void mqttbroker::route(mqttmsg_t msg) {
+   std::vector<mqttsession_t *>::iterator it;
+   std::vector<mqttsub_t>::iterator sub;
+   std::vector<std::pair<mqttsession_t *, int> > targets;
+   std::vector<std::pair<mqttsession_t *, int> >::iterator tgt;
+   int qos;
+
+   /* A retained message replaces the one for this topic. An empty one simply
+    * removes it.
+    */
+   if (msg.retain) {
+      if (msg.payload.length() == 0) _retained.erase(msg.topic);
+      else _retained[msg.topic] = msg;
+   }
+   /* Messages going to existing subscriptions never have the retain flag. */
+   msg.retain = false;
+
+   /* Each client gets the message once, with the highest QoS of the
+    * subscriptions that match, but never more than the message QoS. We first
+    * make the list as sending can block and the sessions can change.
+    */
+   for(it = _sessions.begin(); it != _sessions.end(); it++) {
+      qos = -1;
+      for(sub = (*it)->subs.begin(); sub != (*it)->subs.end(); sub++) {
+         if (sub->qos > qos && topicmatch(sub->filter, msg.topic))
+            qos = sub->qos;
+      }
+      if (qos > msg.qos) qos = msg.qos;
+      if (qos >= 0) targets.push_back(std::make_pair(*it, qos));
+   }
+   for(tgt = targets.begin(); tgt != targets.end(); tgt++) {
+      if (std::find(_sessions.begin(), _sessions.end(), tgt->first)
+            == _sessions.end()) continue;
+      deliver(tgt->first, msg, tgt->second);
+   }
+}
+
+void mqttbroker::deliver(mqttsession_t *s, mqttmsg_t msg, int qos) {
+   std::string body;
+   int packetid;
+
+   _delivered = _delivered + 1;
+   msg.qos = qos;
+
+   /* Testbench clients simply get it in their inbox. */
+   if (s->port < 0) {
+      s->inbox.push_back(msg);
+      _inbox_ev.notify();
+      return;
+   }
+
+   /* Firmware clients get a PUBLISH. QoS 1 and 2 need a packet ID and are
+    * kept until the client finishes the handshake.
+    */
+   putstring(body, msg.topic);
+   if (qos > 0) {
+      packetid = s->nextid;
+      s->nextid = (s->nextid % 65535) + 1;
+      putshort(body, packetid);
+      s->inflight.push_back(mqttinflight_t(packetid, msg, sc_time_stamp()));
+      _inflight = _inflight + 1;
+      if (_inflight > _maxinflight) _maxinflight = _inflight;
+   }
+   body.append(msg.payload);
+   sendpacket(s->port, MQTT_TYPE_PUBLISH, (qos << 1) | (msg.retain ? 1 : 0),
+      body);
+}
+
+void mqttbroker::sendretained(mqttsession_t *s, std::string filter, int qos) {
+   std::map<std::string, mqttmsg_t>::iterator it;
+   std::vector<mqttmsg_t> msgs;
+   std::vector<mqttmsg_t>::iterator msg;
+
+   for(it = _retained.begin(); it != _retained.end(); it++)
+      if (topicmatch(filter, it->first)) msgs.push_back(it->second);
+   for(msg = msgs.begin(); msg != msgs.end(); msg++) {
+      if (std::find(_sessions.begin(), _sessions.end(), s) == _sessions.end())
+         return;
+      deliver(s, *msg, (msg->qos < qos) ? msg->qos : qos);
+   }
+}
+
+void mqttbroker::addsub(mqttsession_t *s, std::string filter, int qos) {
+   std::vector<mqttsub_t>::iterator sub;
+
+   /* The same filter again only replaces the QoS. */
+   for(sub = s->subs.begin(); sub != s->subs.end(); sub++) {
+      if (sub->filter == filter) {
+         sub->qos = qos;
+         return;
+      }
+   }
+   s->subs.push_back(mqttsub_t(filter, qos));
+}
+
+void mqttbroker::removesub(mqttsession_t *s, std::string filter) {
+   std::vector<mqttsub_t>::iterator sub;
+   for(sub = s->subs.begin(); sub != s->subs.end(); sub++) {
+      if (sub->filter == filter) {
+         s->subs.erase(sub);
+         return;
+      }
+   }
+}
+
+void mqttbroker::endsession(mqttsession_t *s, bool clean) {
+   std::vector<mqttsession_t *>::iterator it;
+
+   it = std::find(_sessions.begin(), _sessions.end(), s);
+   if (it == _sessions.end()) return;
+   _sessions.erase(it);
+   _inflight = _inflight - (int)s->inflight.size();
+
+   /* If the client did not say goodbye, we send its will. */
+   if (!clean && s->haswill) route(s->will);
+   delete s;
+}
+
+mqttsession_t *mqttbroker::getsession(const char *clientid) {
+   std::vector<mqttsession_t *>::iterator it;
+   for(it = _sessions.begin(); it != _sessions.end(); it++) {
+      if ((*it)->clientid == clientid) return *it;
+   }
+   return NULL;
+}
+
+/*******************************************************************************
+** Testbench Clients ***********************************************************
+*******************************************************************************/
+
+void mqttbroker::connect(const char *clientid) {
+   if (getsession(clientid) != NULL) {
+      PRINTF_ERROR("MQTTB", "Client %s is already connected", clientid);
+      return;
+   }
+   _sessions.push_back(new mqttsession_t(-1, clientid));
+}
+
+void mqttbroker::disconnect(const char *clientid) {
+   mqttsession_t *s = getsession(clientid);
+   if (s == NULL) {
+      PRINTF_ERROR("MQTTB", "Client %s is not connected", clientid);
+      return;
+   }
+   endsession(s, true);
+}
+
+void mqttbroker::subscribe(const char *clientid, const char *filter,
+      int qos) {
+   mqttsession_t *s = getsession(clientid);
+   if (s == NULL) {
+      PRINTF_ERROR("MQTTB", "Client %s is not connected", clientid);
+      return;
+   }
+   addsub(s, filter, qos);
+   sendretained(s, filter, qos);
+}
+
+void mqttbroker::unsubscribe(const char *clientid, const char *filter) {
+   mqttsession_t *s = getsession(clientid);
+   if (s == NULL) {
+      PRINTF_ERROR("MQTTB", "Client %s is not connected", clientid);
+      return;
+   }
+   removesub(s, filter);
+}
+
+void mqttbroker::publish(const char *topic, std::string payload, int qos,
+      bool retain) {
+   if (qos < 0 || qos > 2) {
+      PRINTF_ERROR("MQTTB", "Illegal QoS %d publishing %s", qos, topic);
+      return;
+   }
+   countpub(qos);
+   route(mqttmsg_t(topic, payload, qos, retain));
+}
+
+bool mqttbroker::receive(const char *clientid, std::string &topic,
+      std::string &payload, sc_time tmout) {
+   sc_time deadline = sc_time_stamp() + tmout;
+   mqttsession_t *s;
+
+   /* We wait until something comes in or we run out of time. */
+   while(1) {
+      s = getsession(clientid);
+      if (s == NULL) {
+         PRINTF_ERROR("MQTTB", "Client %s is not connected", clientid);
+         return false;
+      }
+      if (s->inbox.size() > 0) break;
+      if (sc_time_stamp() >= deadline) return false;
+      wait(deadline - sc_time_stamp(), _inbox_ev);
+   }
+   topic = s->inbox.front().topic;
+   payload = s->inbox.front().payload;
+   s->inbox.pop_front();
+   return true;
+}
+
+bool mqttbroker::expect(const char *clientid, const char *topic,
+      std::string payload, sc_time tmout) {
+   std::string gottopic;
+   std::string gotpayload;
+
+   if (!receive(clientid, gottopic, gotpayload, tmout)) {
+      PRINTF_ERROR("MQTTB", "Client %s did not get %s", clientid, topic);
+      return false;
+   }
+   if (gottopic != topic || gotpayload != payload) {
+      PRINTF_ERROR("MQTTB", "Client %s expected %s but got %s: %s",
+         clientid, topic, gottopic.c_str(), gotpayload.c_str());
+      return false;
+   }
+   PRINTF_INFO("MQTTB", "Client %s got %s: %s", clientid, topic,
+      payload.c_str());
+   return true;
+}
+
+/*******************************************************************************
+** Statistics ******************************************************************
+*******************************************************************************/
+
+void mqttbroker::countpub(int qos) {
+   if (qos < 0 || qos > 2) return;
+   if (published() == 0) _firstpub = sc_time_stamp();
+   _lastpub = sc_time_stamp();
+   _pubin[qos] = _pubin[qos] + 1;
+}
+
+void mqttbroker::clearstats() {
+   _pubin[0] = 0;
+   _pubin[1] = 0;
+   _pubin[2] = 0;
+   _delivered = 0;
+   _dups = 0;
+   _resent = 0;
+   _maxinflight = _inflight;
+   _maxoutbox = _outbox;
+   _timeouts = 0;
+   _acks = 0;
+   _acklat = SC_ZERO_TIME;
+   _acklatmax = SC_ZERO_TIME;
+   _firstpub = SC_ZERO_TIME;
+   _lastpub = SC_ZERO_TIME;
+}
+
+void mqttbroker::report() {
+   sc_time elapsed = _lastpub - _firstpub;
+
+   PRINTF_INFO("MQTTB",
+      "%d clients, %d retained, %d published (QoS %d/%d/%d), %d delivered",
+      clients(), retained(), published(), _pubin[0], _pubin[1], _pubin[2],
+      _delivered);
+   if (elapsed > SC_ZERO_TIME) {
+      PRINTF_INFO("MQTTB", "Publish rate %.1f msg/s over %s",
+         published() / elapsed.to_seconds(), elapsed.to_string().c_str());
+   }
+   PRINTF_INFO("MQTTB",
+      "%d duplicates, %d retransmitted, max %d in the DUT outbox, "
+      "%d keep-alive timeouts", _dups, _resent, _maxoutbox, _timeouts);
+   if (_acks > 0) {
+      PRINTF_INFO("MQTTB", "%d DUT acks, mean %s, max %s, max %d in flight",
+         _acks, (_acklat / _acks).to_string().c_str(),
+         _acklatmax.to_string().c_str(), _maxinflight);
+   }
+}
@@ -0,0 +1,193 @@
+/*******************************************************************************
+ * mqttbroker.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a model for a MQTT 3.1.1 broker. It sits on top of the webclient,
+ *   taking the connections the DUT makes to the listened ports, and it can
+ *   also have clients in the testbench itself. It handles subscriptions with
+ *   wildcards, QoS 1 and 2 handshakes with retransmission, retained messages,
+ *   last will and the keep-alive timeout. It also keeps a few counters so
+ *   that the message rates and the outbox in the firmware can be measured.
+ *
+ *   The link identifies connections only by the port number, so each listened
+ *   port can have only one firmware connection at a time. To have several
+ *   firmware clients, listen on several ports. Sessions are always clean, we
+ *   do not keep subscriptions or messages for clients that went away.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _MQTTBROKER_H
+#define _MQTTBROKER_H
+#include <systemc.h>
+#include <map>
+#include "webclient.h"
+
+/* A message going through the broker. */
+struct mqttmsg_t {
+   std::string topic;
+   std::string payload;
+   int qos;
+   bool retain;
+   mqttmsg_t() { qos = 0; retain = false; }
+   mqttmsg_t(std::string _t, std::string _p, int _q, bool _r):
+      topic(_t), payload(_p) {
+      qos = _q;
+      retain = _r;
+   }
+};
+
+/* A subscription. */
+struct mqttsub_t {
+   std::string filter;
+   int qos;
+   mqttsub_t(std::string _f, int _q): filter(_f) { qos = _q; }
+};
+
+/* A QoS 1 or 2 message sent to a client still waiting for its handshake.
+ * The message is kept so that it can be sent again.
+ */
+struct mqttinflight_t {
+   int packetid;
+   int qos;
+   bool released;
+   mqttmsg_t msg;
+   sc_time sent;
+   sc_time resent;
+   mqttinflight_t(int _id, mqttmsg_t _m, sc_time _s):
+         msg(_m), sent(_s), resent(_s) {
+      packetid = _id;
+      qos = _m.qos;
+      released = false;
+   }
+};
+
+/* A client connected to the broker. Testbench clients have port -1. */
+struct mqttsession_t {
+   int port;
+   std::string clientid;
+   int keepalive;
+   std::vector<mqttsub_t> subs;
+   std::vector<int> qos2in;
+   std::vector<mqttinflight_t> inflight;
+   int nextid;
+   std::deque<mqttmsg_t> inbox;
+   bool haswill;
+   mqttmsg_t will;
+   mqttsession_t(int _p, std::string _c): clientid(_c) {
+      port = _p;
+      keepalive = 0;
+      nextid = 1;
+      haswill = false;
+   }
+};
+
+SC_MODULE(mqttbroker) {
+   /* Setup. The broker takes the connections the DUT makes to the port. It
+    * can be called more than once to listen on several ports.
+    */
+   void attach(webclient &link, unsigned int port = 1883);
+   /* Delays all acks sent to the DUT, to make its outbox fill up. */
+   void setackdelay(sc_time d) { _ackdelay = d; }
+   /* Messages sent to the DUT that are not answered in this time are sent
+    * again. Zero turns the retransmissions off.
+    */
+   void setretry(sc_time r) { _retry = r; }
+
+   /* Testbench clients */
+   void connect(const char *clientid);
+   void disconnect(const char *clientid);
+   void subscribe(const char *clientid, const char *filter, int qos = 0);
+   void unsubscribe(const char *clientid, const char *filter);
+   void publish(const char *topic, std::string payload, int qos = 0,
+      bool retain = false);
+   bool receive(const char *clientid, std::string &topic,
+      std::string &payload, sc_time tmout);
+   bool expect(const char *clientid, const char *topic, std::string payload,
+      sc_time tmout);
+
+   /* Statistics */
+   void report();
+   void clearstats();
+   int clients() { return (int)_sessions.size(); }
+   int retained() { return (int)_retained.size(); }
+   int published() { return _pubin[0] + _pubin[1] + _pubin[2]; }
+   int delivered() { return _delivered; }
+   int duplicates() { return _dups; }
+   int retransmissions() { return _resent; }
+   int inflight() { return _inflight; }
+   int maxinflight() { return _maxinflight; }
+   int outbox() { return _outbox; }
+   int maxoutbox() { return _maxoutbox; }
+   int timeouts() { return _timeouts; }
+   sc_time acklatency() {
+      return (_acks > 0) ? _acklat / _acks : SC_ZERO_TIME;
+   }
+
+   SC_CTOR(mqttbroker) {
+      _link = NULL;
+      _ackdelay = SC_ZERO_TIME;
+      _retry = sc_time(5, SC_SEC);
+      _inflight = 0;
+      _outbox = 0;
+      clearstats();
+   }
+
+   private:
+   webclient *_link;
+   sc_time _ackdelay;
+   sc_time _retry;
+   std::vector<mqttsession_t *> _sessions;
+   std::map<std::string, mqttmsg_t> _retained;
+   sc_event _inbox_ev;
+
+   /* Firmware connections */
+   void listener(unsigned int port);
+   void session(int port);
+   bool readpacket(int port, int &type, int &flags, std::string &body);
+   void sendpacket(int port, int type, int flags, std::string body);
+   void sendack(int port, int type, int packetid, bool release);
+   void delayedack(int port, int type, int packetid, bool release);
+   void closeport(int port);
+   sc_time retransmit(mqttsession_t *s);
+
+   /* Routing */
+   void route(mqttmsg_t msg);
+   void deliver(mqttsession_t *s, mqttmsg_t msg, int qos);
+   void sendretained(mqttsession_t *s, std::string filter, int qos);
+   void addsub(mqttsession_t *s, std::string filter, int qos);
+   void removesub(mqttsession_t *s, std::string filter);
+   void endsession(mqttsession_t *s, bool clean);
+   mqttsession_t *getsession(const char *clientid);
+   bool topicmatch(std::string filter, std::string topic);
+
+   /* Statistics */
+   void countpub(int qos);
+   int _pubin[3];
+   int _delivered;
+   int _dups;
+   int _resent;
+   int _inflight;
+   int _maxinflight;
+   int _outbox;
+   int _maxoutbox;
+   int _timeouts;
+   int _acks;
+   sc_time _acklat;
+   sc_time _acklatmax;
+   sc_time _firstpub;
+   sc_time _lastpub;
+};
+
+#endif
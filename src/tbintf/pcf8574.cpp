@@ -274,6 +274,32 @@ void pcf8574::i2c_th(void) {
    }
 }
 
+void pcf8574::i2ctransport(i2ctrans_t &t) {
+   unsigned int i;
+   int cnt;
+
+   /* On reads we return the pins. They are all sampled at the start of the
+    * transfer.
+    */
+   if (t.rd) {
+      for(i = 0; i < t.data.size(); i = i + 1) t.data[i] = sampleport();
+   }
+   /* On writes only the last byte stays on the pins. The 1s are driven weak
+    * so that they can be read, like after the ACK on the bit level model.
+    */
+   else if (t.data.size() > 0) {
+      drive = t.data[t.data.size() - 1];
+      for (cnt = 0; cnt < sig.size(); cnt = cnt + 1) {
+         sig[cnt]->write(((drive & (1<<cnt))>0)?GN_LOGIC_W1:GN_LOGIC_0);
+      }
+   }
+
+   /* Any access clears the interrupt. We do it on the next delta so that it
+    * comes with the pin changes and these do not raise it again.
+    */
+   clearintr_ev.notify(SC_ZERO_TIME);
+}
+
 void pcf8574::trace(sc_trace_file *tf) {
    sc_trace(tf, state, state.name());
 }
@@ -20,9 +20,10 @@
 
 #include <systemc.h>
 #include "gn_mixed.h"
+#include "i2ctlm.h"
 
 #define PCF8574_PINS 8
-SC_MODULE(pcf8574) {
+SC_MODULE(pcf8574), public i2cslave_if {
    /* Signals */
    sc_inout<gn_mixed> sda {"sda"};
    sc_inout<gn_mixed> scl {"scl"};
@@ -42,6 +43,10 @@ SC_MODULE(pcf8574) {
     * value is 20h.
     */
    void set_addr(unsigned char _ad) { device_id = _ad; }
+   unsigned char get_addr() { return device_id; }
+
+   /* Transaction level interface, used when attached to an i2c. */
+   virtual void i2ctransport(i2ctrans_t &t);
 
    // Constructor
    SC_CTOR(pcf8574) {
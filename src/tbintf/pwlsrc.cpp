@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * pwlsrc.cpp -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a piecewise linear voltage source for the ADC channels. See
+ *   pwlsrc.h.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#include <systemc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <strings.h>
+#include "pwlsrc.h"
+#include "info.h"
+
+void pwlsrc::clear() {
+   _t.clear();
+   _v.clear();
+   _offset = SC_ZERO_TIME;
+   _repeat = false;
+   _seg = 0;
+}
+
+void pwlsrc::addpoint(const sc_time &t, float v) {
+   if (_t.size() > 0 && t < _t.back()) {
+      PRINTF_WARN("PWLSRC", "Point at %s is before the one at %s, ignored",
+         t.to_string().c_str(), _t.back().to_string().c_str());
+      return;
+   }
+   _t.push_back(t);
+   _v.push_back(v);
+}
+
+/* Reads a number with an optional SPICE suffix and moves s past it. */
+bool pwlsrc::getnum(const char *&s, double &v) {
+   char *e;
+
+   while (*s == ' ' || *s == '\t' || *s == ',') s = s + 1;
+   v = strtod(s, &e);
+   if (e == s) return false;
+   s = e;
+   if (strncasecmp(s, "meg", 3) == 0) { v = v * 1e6; s = s + 3; }
+   else switch(tolower(*s)) {
+      case 'f': v = v * 1e-15; s = s + 1; break;
+      case 'p': v = v * 1e-12; s = s + 1; break;
+      case 'n': v = v * 1e-9; s = s + 1; break;
+      case 'u': v = v * 1e-6; s = s + 1; break;
+      case 'm': v = v * 1e-3; s = s + 1; break;
+      case 'k': v = v * 1e3; s = s + 1; break;
+      case 'g': v = v * 1e9; s = s + 1; break;
+      default: break;
+   }
+   /* Anything else up to the separator is a unit, like s or V. */
+   while (isalpha(*s)) s = s + 1;
+   return true;
+}
+
+bool pwlsrc::load(const char *fn) {
+   FILE *f;
+   char line[256];
+   const char *s;
+   double t, v;
+   int lineno;
+
+   f = fopen(fn, "r");
+   if (f == NULL) {
+      PRINTF_ERROR("PWLSRC", "Could not open %s", fn);
+      return false;
+   }
+
+   lineno = 0;
+   while (fgets(line, sizeof(line), f) != NULL) {
+      lineno = lineno + 1;
+      s = line;
+      while (*s == ' ' || *s == '\t') s = s + 1;
+      if (*s == '#' || *s == '*' || *s == ';' || *s == '\n' || *s == '\r'
+            || *s == '\0') continue;
+      if (!getnum(s, t) || !getnum(s, v)) {
+         /* The first line can be a CSV header. */
+         if (lineno == 1) continue;
+         PRINTF_WARN("PWLSRC", "%s:%d: could not read the point", fn, lineno);
+         continue;
+      }
+      addpoint(sc_time(t, SC_SEC), v);
+   }
+   fclose(f);
+
+   if (_t.size() == 0) {
+      PRINTF_WARN("PWLSRC", "No points in %s", fn);
+      return false;
+   }
+   return true;
+}
+
+float pwlsrc::level(const sc_time &now) {
+   sc_time t, span;
+   unsigned int last;
+   double frac;
+
+   if (_t.size() == 0) return 0.0;
+   if (now < _offset) return _v.front();
+   t = now - _offset;
+
+   /* If it repeats we fold the time back into the waveform. */
+   last = _t.size() - 1;
+   if (_repeat && t > _t[last] && _t[last] > SC_ZERO_TIME) {
+      t = sc_time::from_value(t.value() % _t[last].value());
+   }
+
+   if (t <= _t[0]) return _v[0];
+   if (t >= _t[last]) return _v[last];
+
+   /* We look for the segment with t in it, going back to the start if the
+    * time went back.
+    */
+   if (_seg >= last || t < _t[_seg]) _seg = 0;
+   while (t >= _t[_seg + 1]) _seg = _seg + 1;
+
+   span = _t[_seg + 1] - _t[_seg];
+   if (span == SC_ZERO_TIME) return _v[_seg + 1];
+   frac = (t - _t[_seg]) / span;
+   return _v[_seg] + (_v[_seg + 1] - _v[_seg]) * frac;
+}
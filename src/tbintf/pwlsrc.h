@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * pwlsrc.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a piecewise linear voltage source for the ADC channels. The
+ *   points come from a PWL or CSV file, or are added one by one, and the
+ *   ADC gets the voltage interpolated at the time it samples. Nothing
+ *   happens between samples, so a slow waveform costs nothing however long
+ *   the test runs.
+ *
+ *   Each line of the file has a time in seconds and a voltage, separated by
+ *   spaces, tabs or a comma. Numbers can use the SPICE suffixes (f, p, n, u,
+ *   m, k, meg, g) and a time can end in s. Lines starting with #, * or ; are
+ *   comments, and a first line that is not a number is taken as a CSV
+ *   header. The times must go up.
+ *
+ *   Before the first point we return the first voltage and after the last
+ *   point the last voltage, unless it is set to repeat.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _PWLSRC_H
+#define _PWLSRC_H
+
+#include <systemc.h>
+#include <vector>
+#include "adcsrc.h"
+
+class pwlsrc : public adcsrc_if {
+   public:
+   pwlsrc() { clear(); }
+   pwlsrc(const char *fn) { clear(); load(fn); }
+
+   /* Points */
+   bool load(const char *fn);
+   void addpoint(const sc_time &t, float v);
+   void clear();
+   int points() { return _t.size(); }
+
+   /* The waveform can be moved in time, so a file starting at zero can be
+    * used later in the test, and it can repeat from the start after the last
+    * point.
+    */
+   void set_offset(const sc_time &t) { _offset = t; }
+   void set_repeat(bool r) { _repeat = r; }
+
+   /* Voltage at a given time */
+   float level(const sc_time &t);
+   virtual float adclevel(const sc_time &t) { return level(t); }
+
+   private:
+   std::vector<sc_time> _t;
+   std::vector<float> _v;
+   sc_time _offset;
+   bool _repeat;
+   /* Segment used last. Samples normally go forward in time, so we start
+    * looking from it.
+    */
+   unsigned int _seg;
+
+   static bool getnum(const char *&s, double &v);
+};
+
+#endif
@@ -0,0 +1,210 @@
+/*******************************************************************************
+ * pwmprobe.cpp -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a testbench probe that measures the period, duty cycle, frequency
+ *   and edge counts of a digital signal using only the edge times.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#include <systemc.h>
+#include "pwmprobe.h"
+#include "info.h"
+
+bool pwmprobe::readlevel() {
+   if (pin.size() > 0) return pin->read();
+   /* For mixed signals anything that is not a high or low keeps the last
+    * level, so a Z between two drivers is not taken as an edge.
+    */
+   if (pinmix->read().ishigh()) return true;
+   if (pinmix->read().islow()) return false;
+   return _level;
+}
+
+void pwmprobe::watcher() {
+   bool nl;
+
+   if (pin.size() == 0 && pinmix.size() == 0) {
+      PRINTF_WARN("PROBE", "%s is not connected to any signal", name());
+      return;
+   }
+   _level = readlevel();
+   while(true) {
+      if (pin.size() > 0) wait(pin->value_changed_event());
+      else wait(pinmix->value_changed_event());
+      nl = readlevel();
+      if (nl != _level) edge(nl);
+   }
+}
+
+void pwmprobe::edge(bool nl) {
+   sc_time now = sc_time_stamp();
+
+   /* If the window is open, we count the edge and the time it was high. */
+   if (_open) {
+      if (_level) _high = _high + (now - _lastedge);
+      if (nl) {
+         if (_rises == 0) _firstrise = now;
+         _lastrise = now;
+         _rises = _rises + 1;
+      }
+      else _falls = _falls + 1;
+   }
+
+   /* For the stability check we keep the last few cycles. */
+   if (nl) {
+      if (_hasrise) {
+         _histper.push_back(now - _histrise);
+         if (_histper.size() > PWMPROBE_HIST) _histper.pop_front();
+      }
+      _histrise = now;
+      _hasrise = true;
+   }
+   else if (_hasrise) {
+      _histhigh.push_back(now - _histrise);
+      if (_histhigh.size() > PWMPROBE_HIST) _histhigh.pop_front();
+   }
+
+   _lastedge = now;
+   _level = nl;
+   _edge_ev.notify();
+}
+
+void pwmprobe::start() {
+   _open = true;
+   _rises = 0;
+   _falls = 0;
+   _high = SC_ZERO_TIME;
+   _start = sc_time_stamp();
+   _end = _start;
+   _lastedge = _start;
+}
+
+void pwmprobe::stop() {
+   if (!_open) return;
+   _end = sc_time_stamp();
+   if (_level) _high = _high + (_end - _lastedge);
+   _open = false;
+}
+
+void pwmprobe::measure(sc_time window) {
+   start();
+   wait(window);
+   stop();
+}
+
+sc_time pwmprobe::period() {
+   /* The period is the average over the full cycles we saw, so we need at
+    * least two rising edges.
+    */
+   if (_rises < 2) return SC_ZERO_TIME;
+   return (_lastrise - _firstrise) / (double)(_rises - 1);
+}
+
+double pwmprobe::freq() {
+   sc_time p = period();
+   if (p == SC_ZERO_TIME) return 0.0;
+   return 1.0 / p.to_seconds();
+}
+
+double pwmprobe::duty() {
+   sc_time w = window();
+   if (w == SC_ZERO_TIME) return (_level)?100.0:0.0;
+   return 100.0 * _high.to_seconds() / w.to_seconds();
+}
+
+bool pwmprobe::stable(double tol, int periods) {
+   sc_time pmin, pmax, hmin, hmax;
+   int i;
+
+   if (periods > PWMPROBE_HIST) periods = PWMPROBE_HIST;
+   if ((int)_histper.size() < periods || (int)_histhigh.size() < periods)
+      return false;
+
+   /* We look at the spread of the last periods and high times. */
+   pmin = pmax = _histper.back();
+   hmin = hmax = _histhigh.back();
+   for (i = 1; i <= periods; i = i + 1) {
+      sc_time p = _histper[_histper.size()-i];
+      sc_time h = _histhigh[_histhigh.size()-i];
+      if (p < pmin) pmin = p;
+      if (p > pmax) pmax = p;
+      if (h < hmin) hmin = h;
+      if (h > hmax) hmax = h;
+   }
+   return (pmax - pmin).to_seconds() <= tol * pmax.to_seconds()
+      && (hmax - hmin).to_seconds() <= tol * pmax.to_seconds();
+}
+
+bool pwmprobe::wait_until_stable(sc_time tmout, double tol, int periods) {
+   sc_time end = sc_time_stamp() + tmout;
+
+   /* We drop what we saw so far, as it is probably from the old settings. */
+   _histper.clear();
+   _histhigh.clear();
+   _hasrise = false;
+
+   /* And we check again at every edge. */
+   while (!stable(tol, periods)) {
+      if (sc_time_stamp() >= end) {
+         PRINTF_WARN("PROBE", "%s did not get stable", name());
+         return false;
+      }
+      wait(end - sc_time_stamp(), _edge_ev);
+   }
+   return true;
+}
+
+bool pwmprobe::expectfreq(double hz, double tolpct, sc_time window) {
+   double got;
+   measure(window);
+   got = freq();
+   if (got < hz * (1.0 - tolpct/100.0) || got > hz * (1.0 + tolpct/100.0)) {
+      PRINTF_ERROR("PROBE", "%s expected %.2fHz but got %.2fHz", name(), hz,
+         got);
+      return false;
+   }
+   PRINTF_INFO("PROBE", "%s got %.2fHz", name(), got);
+   return true;
+}
+
+bool pwmprobe::expectduty(double pct, double tolpct, sc_time window) {
+   double got;
+   measure(window);
+   got = duty();
+   if (got < pct - tolpct || got > pct + tolpct) {
+      PRINTF_ERROR("PROBE", "%s expected duty %.2f%% but got %.2f%%", name(),
+         pct, got);
+      return false;
+   }
+   PRINTF_INFO("PROBE", "%s got duty %.2f%%", name(), got);
+   return true;
+}
+
+bool pwmprobe::expectedges(int n, sc_time window) {
+   measure(window);
+   if (edges() != n) {
+      PRINTF_ERROR("PROBE", "%s expected %d edges but got %d", name(), n,
+         edges());
+      return false;
+   }
+   PRINTF_INFO("PROBE", "%s got %d edges", name(), n);
+   return true;
+}
+
+void pwmprobe::trace(sc_trace_file *tf) {
+   std::string sign = std::string(name()) + ".level";
+   sc_trace(tf, _level, sign.c_str());
+}
@@ -0,0 +1,117 @@
+/*******************************************************************************
+ * pwmprobe.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a testbench probe that measures the period, duty cycle, frequency
+ *   and edge counts of a digital signal. It only looks at the time of each
+ *   edge, so it costs nothing while the signal is stable, no matter how fine
+ *   the measurement has to be.
+ *
+ *   The probe can be connected to a sc_signal<bool> through the pin port or
+ *   to a gn_signal_mix through the pinmix port. Only one of them should be
+ *   bound. For a gn_mixed net, weak levels count as the strong ones and any
+ *   other value keeps the last level.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _PWMPROBE_H
+#define _PWMPROBE_H
+
+#include <systemc.h>
+#include "gn_mixed.h"
+#undef min
+#undef max
+#include <deque>
+
+/* Number of cycles kept to check if the signal is stable. */
+#define PWMPROBE_HIST 16
+
+SC_MODULE(pwmprobe) {
+   sc_port<sc_signal_in_if<bool>,1,SC_ZERO_OR_MORE_BOUND> pin {"pin"};
+   sc_port<sc_signal_in_if<gn_mixed>,1,SC_ZERO_OR_MORE_BOUND> pinmix {"pinmix"};
+
+   /* Measurement window. The results are taken between a start and a stop. */
+   void start();
+   void stop();
+   void measure(sc_time window);
+   /* Waits until the last periods and high times agree within tol (a
+    * fraction of the period). Returns false if it does not happen in tmout.
+    */
+   bool wait_until_stable(sc_time tmout, double tol = 0.01, int periods = 4);
+
+   /* Results of the last window */
+   int edges() { return _rises + _falls; }
+   int rises() { return _rises; }
+   int falls() { return _falls; }
+   sc_time window() { return _end - _start; }
+   sc_time hightime() { return _high; }
+   sc_time period();
+   double freq();
+   double duty();
+   bool level() { return _level; }
+
+   /* Checks. They measure over the window and report an error if the value
+    * is off. The frequency tolerance is in percent of the frequency, the
+    * duty tolerance is in percentage points.
+    */
+   bool expectfreq(double hz, double tolpct, sc_time window);
+   bool expectduty(double pct, double tolpct, sc_time window);
+   bool expectedges(int n, sc_time window);
+
+   SC_CTOR(pwmprobe) {
+      _open = false;
+      _level = false;
+      _rises = 0;
+      _falls = 0;
+      _start = SC_ZERO_TIME;
+      _end = SC_ZERO_TIME;
+      _lastedge = SC_ZERO_TIME;
+      _lastrise = SC_ZERO_TIME;
+      _firstrise = SC_ZERO_TIME;
+      _high = SC_ZERO_TIME;
+      _histrise = SC_ZERO_TIME;
+      _hasrise = false;
+
+      SC_THREAD(watcher);
+   }
+
+   void trace(sc_trace_file *tf);
+
+   private:
+   void watcher();
+   bool readlevel();
+   void edge(bool nl);
+   bool stable(double tol, int periods);
+
+   bool _open;
+   bool _level;
+   int _rises;
+   int _falls;
+   sc_time _start;
+   sc_time _end;
+   sc_time _lastedge;
+   sc_time _lastrise;
+   sc_time _firstrise;
+   sc_time _high;
+   sc_event _edge_ev;
+
+   /* Last periods and high times, for the stability check. */
+   std::deque<sc_time> _histper;
+   std::deque<sc_time> _histhigh;
+   sc_time _histrise;
+   bool _hasrise;
+};
+
+#endif
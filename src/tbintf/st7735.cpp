@@ -37,6 +37,7 @@ void st7735::collect() {
          pos = 0;
          collected = 0;
          initialized = true;
+         fb.reset();
          continue;
       }
 
@@ -114,9 +115,20 @@ void st7735::collect() {
             /* If the logic is valid, we take in the ones. */
             else if (sda.read().ishigh()) collected = collected | (1 << (pos-1));
 
+            /* Once we have the byte, we pass it to the framebuffer. Bit 8
+             * is the DCX, high for data.
+             */
             if (pos == 1) {
-               printf("%s: received %03x\n", sc_time_stamp().to_string().c_str(),
-                     collected);
+               if ((collected & 0x100) == 0) {
+                  fb.command(collected & 0xff);
+                  printf("%s: %s: command %02x\n", name(),
+                     sc_time_stamp().to_string().c_str(), collected & 0xff);
+               }
+               else {
+                  fb.data(collected & 0xff);
+                  if (debug > 8) printf("%s: %s: data %02x\n", name(),
+                     sc_time_stamp().to_string().c_str(), collected & 0xff);
+               }
             }
             break;
       }
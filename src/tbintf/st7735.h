@@ -23,6 +23,7 @@
 
 #include <systemc.h>
 #include "gn_mixed.h"
+#include "tftfb.h"
 
 SC_MODULE(st7735) {
    sc_inout<gn_mixed> sda {"sda"};
@@ -54,18 +55,24 @@ SC_MODULE(st7735) {
    sc_in<gn_mixed> spi4w {"spi4w"};
    sc_in<sc_bv<3> > im {"im"};
 
+   /* Panel contents */
+   tftfb fb {128, 160};
+
    private:
    bool readmode;
    bool initialized;
    int collected;
    int pos;
+   int debug;
 
    public:
    void collect();
+   void set_debug(int lvl) { debug = lvl; }
 
    SC_CTOR(st7735) {
       initialized = false;
       readmode = false;
+      debug = 0;
 
       SC_THREAD(collect);
       sensitive << csx << scl_dcx << resx << wrx;
@@ -36,6 +36,9 @@ enum {NONE,
    SD0, SD1
 } rdstate = NONE;
 
+/* Write states */
+enum {IDLE, WRSKIP, WRE0, WR0, WR1, WR2, WR3, WRN, SLEEP};
+
 /*******************************************************************************
 ** TFT Thread ******************************************************************
 *******************************************************************************/
@@ -121,14 +124,11 @@ void tftmod::read(void) {
 
 void tftmod::write(void) {
    unsigned int msg;
-   uint32_t val, val1;
-   int cmd;
-   sc_uint<8> t;
-   enum {IDLE, WRSKIP, WRE0, WR0, WR1, WR2, WR3, WRN, SLEEP} state = IDLE;
    SC_REPORT_INFO("I2C", "Starting TFT Thread");
-   sc_time sleepchangetime;
 
    /* we begin in sleep. */
+   state = IDLE;
+   cmd = 0;
    sleepchangetime = sc_time(0, SC_NS);
 
 
@@ -156,276 +156,309 @@ void tftmod::write(void) {
       msg |= getlv(6, d6.read().logic);
       msg |= getlv(7, d7.read().logic);
 
-      /* If we see DC low and RD high, this is a new command. We then look at
-       * the msg field (d7:d0) to see what command was given.
+      /* If we see DC low and RD high, this is a new command. */
+      process(msg, dc.read() == SC_LOGIC_0 && rd.read() == SC_LOGIC_1);
+      istate = state;
+      icmd = cmd;
+   }
+}
+
+void tftmod::process(unsigned int msg, bool iscmd) {
+   /* The framebuffer decodes the commands that write to the panel. */
+   if (iscmd) fb.command(msg);
+   else fb.data(msg);
+
+   /* For a command we look at the msg field (d7:d0) to see what command was
+    * given.
+    */
+   if (iscmd) {
+      /* A command ends a memory write, so we publish what we got so far. */
+      if (state == WRN) updatesig();
+
+      /* If we get a command just after entering or exiting sleep, we need to
+       * raise a flag.
        */
-      if (dc.read() == SC_LOGIC_0 && rd.read() == SC_LOGIC_1) {
-         /* If we get a command just after entering or exiting sleep, we need to
-          * raise a flag.
-          */
-         if (sleepchangetime - sc_time_stamp() < sc_time(5, SC_MS)) {
-            SC_REPORT_WARNING("TFT",
-               "Command sent less than 5ms after sleep start or stop.");
-         }
+      if (sleepchangetime - sc_time_stamp() < sc_time(5, SC_MS)) {
+         SC_REPORT_WARNING("TFT",
+            "Command sent less than 5ms after sleep start or stop.");
+      }
 
-         cmd = msg;
-         val = 0;
-         /* We check the command to see if it is valid. */
-         switch(cmd) {
-            case 0x0:
-               printf("%s: %s: NOP\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               break;
-            case 0x1:
-               printf("%s: %s: Software Reset\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               break;
-            case 0xa:
-               printf("%s: %s: Power Mode Read\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = PM0;
-               break;
-            case 0xb:
-               printf("%s: %s: Address Mode Read\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = AM0;
-               break;
-            case 0xc:
-               printf("%s: %s: Pixel Format Read\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = PX0;
-               break;
-            case 0xd:
-               printf("%s: %s: Display Mode Read\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = DF0;
-               break;
-            case 0xe:
-               printf("%s: %s: Signal Mode Read\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = SM0;
-               break;
-            case 0xf:
-               printf("%s: %s: Self Diagnostics Read\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = SD0;
-               break;
-            case 0x10:
-               /* If we are already in sleep nothing happens. */
-               if (sleep.read()) {
-                  printf("%s: %s: Sleep request but already in Sleep Mode\n",
-                     name(), sc_time_stamp().to_string().c_str());
-                  break;
-               }
-               /* If we are not, we raise the sleep state. This in itself does
-                * not mean anything. Just means the screen will be off.
-                */
-               printf("%s: %s: Entering Sleep Mode\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               if (sleepchangetime - sc_time_stamp() < sc_time(120, SC_MS))
-                  SC_REPORT_WARNING("TFT", "Exiting Sleep mode too quick.");
-               rdstate = NONE;
-               sleep.write(1);
-               sleepchangetime = sc_time_stamp();
-               break;
-            case 0x11:
-               /* If we are not in Sleep mode, then we do nothing. */
-               if (sleep.read() == false) {
-                  printf("%s: %s: Sleep request but already in Sleep Mode\n",
-                     name(), sc_time_stamp().to_string().c_str());
-                  break;
-               }
-               /* If we got the exit sleep command, we take it. If it came in
-                * too quick, we want but keep on processing as nothing happened
-                * as we cannot tell the real impact of this.
-                */
-               printf("%s: %s: Exit Sleep Mode\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               if (sleepchangetime - sc_time_stamp() < sc_time(120, SC_MS))
-                  SC_REPORT_WARNING("TFT", "Exiting Sleep mode too quick.");
-               state = IDLE;
-               rdstate = NONE;
-               sleep.write(0);
-               sleepchangetime = sc_time_stamp();
-               break;
-            case 0x12:
-               printf("%s: %s: Entering Partial ON\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = NONE;
-               break;
-            case 0x13:
-               printf("%s: %s: Entering Normal Mode\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = NONE;
-               break;
-            case 0x20:
-               printf("%s: %s: Display Inversion Off\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = NONE;
-               break;
-            case 0x21:
-               printf("%s: %s: Display Inversion On\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = NONE;
-               break;
-            case 0x28:
-               printf("%s: %s: Display Off\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = NONE;
-               break;
-            case 0x29:
-               printf("%s: %s: Display On\n",
-                  name(), sc_time_stamp().to_string().c_str());
-               state = IDLE;
-               rdstate = NONE;
-               break;
-            case 0x2c:
-               if (debug > 8) printf("%s: %s: Receiving Data\n",
+      cmd = msg;
+      val = 0;
+      /* We check the command to see if it is valid. */
+      switch(cmd) {
+         case 0x0:
+            printf("%s: %s: NOP\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            break;
+         case 0x1:
+            printf("%s: %s: Software Reset\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            break;
+         case 0xa:
+            printf("%s: %s: Power Mode Read\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = PM0;
+            break;
+         case 0xb:
+            printf("%s: %s: Address Mode Read\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = AM0;
+            break;
+         case 0xc:
+            printf("%s: %s: Pixel Format Read\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = PX0;
+            break;
+         case 0xd:
+            printf("%s: %s: Display Mode Read\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = DF0;
+            break;
+         case 0xe:
+            printf("%s: %s: Signal Mode Read\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = SM0;
+            break;
+         case 0xf:
+            printf("%s: %s: Self Diagnostics Read\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = SD0;
+            break;
+         case 0x10:
+            /* If we are already in sleep nothing happens. */
+            if (sleep.read()) {
+               printf("%s: %s: Sleep request but already in Sleep Mode\n",
                   name(), sc_time_stamp().to_string().c_str());
-               signature = 0;
-               explength = (endcol-startcol+1) * (endrow-startrow+1) * 2;
-               llen = 0;
-               state = WRN;
-               rdstate = NONE;
                break;
-            case 0xc8:
-               printf("%s: %s: Setting Gama\n",
+            }
+            /* If we are not, we raise the sleep state. This in itself does
+             * not mean anything. Just means the screen will be off.
+             */
+            printf("%s: %s: Entering Sleep Mode\n",
+               name(), sc_time_stamp().to_string().c_str());
+            if (sleepchangetime - sc_time_stamp() < sc_time(120, SC_MS))
+               SC_REPORT_WARNING("TFT", "Exiting Sleep mode too quick.");
+            rdstate = NONE;
+            sleep.write(1);
+            sleepchangetime = sc_time_stamp();
+            break;
+         case 0x11:
+            /* If we are not in Sleep mode, then we do nothing. */
+            if (sleep.read() == false) {
+               printf("%s: %s: Sleep request but already in Sleep Mode\n",
                   name(), sc_time_stamp().to_string().c_str());
-               state = WRSKIP;
-               rdstate = NONE;
                break;
-            /* Generic Write functions */
-            /* 5 parameter funcs */
-            case 0xc0:
-               state = WRE0;
-               rdstate = NONE;
-               break;
-            /* 4 parameter funcs */
-            case 0x2a:
-            case 0x2b:
-            case 0x30:
-               state = WR0;
-               rdstate = NONE;
-               break;
-            /* 3 parameter funcs */
-            case 0xd0:
-            case 0xd1:
-               state = WR1;
-               rdstate = NONE;
-               break;
-            /* 2 parameter funcs */
-            case 0xd2:
-               state = WR2;
-               rdstate = NONE;
-               break;
-            /* 1 parameter funcs */
-            case 0xc5:
-            case 0x36:
-            case 0x3a:
-               state = WR3;
-               rdstate = NONE;
-               break;
-         }
-      }
-      else switch(state) {
-         case WRN:
-            /* If the image is taller than a font, it has to be an image.
-             * Not a good way to do this, but it works for now.
-             */
-            if (endcol - startcol > 30)
-               signature.write(do1crc((uint32_t)signature.read(), msg));
-            else if (msg == fglow || msg == fghigh)
-               signature.write(do1crc((uint32_t)signature.read(), 0xff));
-            else signature.write(do1crc((uint32_t)signature.read(), 0x00));
-            explength = explength.read() - 1;
-            llen = llen.read() + 1;
-            if (explength.read() == 1) {
-               sigdone_ev.notify();
-               state = IDLE;
             }
+            /* If we got the exit sleep command, we take it. If it came in
+             * too quick, we want but keep on processing as nothing happened
+             * as we cannot tell the real impact of this.
+             */
+            printf("%s: %s: Exit Sleep Mode\n",
+               name(), sc_time_stamp().to_string().c_str());
+            if (sleepchangetime - sc_time_stamp() < sc_time(120, SC_MS))
+               SC_REPORT_WARNING("TFT", "Exiting Sleep mode too quick.");
+            state = IDLE;
+            rdstate = NONE;
+            sleep.write(0);
+            sleepchangetime = sc_time_stamp();
             break;
-         case WRSKIP: break;
-         case WRE0: val1 = msg; state = WR0; break;
-         case WR0: val = msg << 24; state = WR1; break;
-         case WR1: val = val | (msg << 16); state = WR2; break;
-         case WR2: val = val | (msg << 8); state = WR3; break;
-         case WR3:
-            val = val | msg;
+         case 0x12:
+            printf("%s: %s: Entering Partial ON\n",
+               name(), sc_time_stamp().to_string().c_str());
             state = IDLE;
-            if (cmd == 0x2a) {
-               startcol = val>>16;
-               endcol = (val&0xffff);
-               if (debug>8) printf("%s: %s: Setting column to = %04x:%04x\n",
-                  name(), sc_time_stamp().to_string().c_str(),
-                  val>>16, val & 0xffff);
-            }
-            else if (cmd == 0x2b) {
-               startrow = val>>16;
-               endrow = (val&0xffff);
-               if (debug>8) printf("%s: %s: Setting row to = %04x:%04x\n",
-                  name(), sc_time_stamp().to_string().c_str(),
-                  val>>16, val & 0xffff);
-            }
-            else if (cmd == 0x30) {
-               if (debug>2) printf(
-                  "%s: %s: Set Partial Row Start = %08x End = %08x\n",
-                  name(), sc_time_stamp().to_string().c_str(),
-                  (val >> 16) & 0x1ff, val & 0x1ff);
-            }
-            else if (cmd == 0x36) {
-               printf("%s: %s: Memory Access Control %08x\n",
-                  name(), sc_time_stamp().to_string().c_str(), val);
-            }
-            else if (cmd == 0x3a) {
-               if (debug>2) printf("%s: %s: Pixel Format = %08x\n",
-                  name(), sc_time_stamp().to_string().c_str(), val);
-            }
-            else if (cmd == 0xc5) {
-               printf("%s: %s: Frame Rate and Inversion %08x\n",
-                  name(), sc_time_stamp().to_string().c_str(), val);
-            }
-            else if (cmd == 0xc0) {
-               printf("%s: %s: Pannel Driving %02x%08x\n",
-                  name(), sc_time_stamp().to_string().c_str(), val1, val);
-            }
-            else if (cmd == 0xd0) {
-               printf("%s: %s: Set Power %08x\n",
-                  name(), sc_time_stamp().to_string().c_str(), val);
-            }
-            else if (cmd == 0xd1) {
-               printf("%s: %s: VCOM %08x\n",
-                  name(), sc_time_stamp().to_string().c_str(), val);
-            }
-            else if (cmd == 0xd2) {
-               printf("%s: %s: Normal Power %08x\n",
-                  name(), sc_time_stamp().to_string().c_str(), val);
-            }
-            else {
-               printf("G: %s: %x: %08x\n", sc_time_stamp().to_string().c_str(),
-                  cmd, val);
-            }
+            rdstate = NONE;
+            break;
+         case 0x13:
+            printf("%s: %s: Entering Normal Mode\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = NONE;
+            break;
+         case 0x20:
+            printf("%s: %s: Display Inversion Off\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = NONE;
+            break;
+         case 0x21:
+            printf("%s: %s: Display Inversion On\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = NONE;
+            break;
+         case 0x28:
+            printf("%s: %s: Display Off\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = NONE;
+            break;
+         case 0x29:
+            printf("%s: %s: Display On\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = IDLE;
+            rdstate = NONE;
+            break;
+         case 0x2c:
+            if (debug > 8) printf("%s: %s: Receiving Data\n",
+               name(), sc_time_stamp().to_string().c_str());
+            sig = 0;
+            explen = (endcol-startcol+1) * (endrow-startrow+1) * 2;
+            linelen = 0;
+            updatesig();
+            state = WRN;
+            rdstate = NONE;
+            break;
+         case 0xc8:
+            printf("%s: %s: Setting Gama\n",
+               name(), sc_time_stamp().to_string().c_str());
+            state = WRSKIP;
+            rdstate = NONE;
+            break;
+         /* Generic Write functions */
+         /* 5 parameter funcs */
+         case 0xc0:
+            state = WRE0;
+            rdstate = NONE;
+            break;
+         /* 4 parameter funcs */
+         case 0x2a:
+         case 0x2b:
+         case 0x30:
+            state = WR0;
+            rdstate = NONE;
+            break;
+         /* 3 parameter funcs */
+         case 0xd0:
+         case 0xd1:
+            state = WR1;
+            rdstate = NONE;
+            break;
+         /* 2 parameter funcs */
+         case 0xd2:
+            state = WR2;
+            rdstate = NONE;
+            break;
+         /* 1 parameter funcs */
+         case 0xc5:
+         case 0x36:
+         case 0x3a:
+            state = WR3;
+            rdstate = NONE;
             break;
-         default: state = IDLE;
-            printf("D: %s: %02x\n", sc_time_stamp().to_string().c_str(),
-               msg);
       }
-
-      istate = state;
-      icmd = cmd;
    }
+   else switch(state) {
+      case WRN:
+         /* If the image is taller than a font, it has to be an image.
+          * Not a good way to do this, but it works for now.
+          */
+         if (endcol - startcol > 30) sig = do1crc(sig, msg);
+         else if (msg == fglow || msg == fghigh) sig = do1crc(sig, 0xff);
+         else sig = do1crc(sig, 0x00);
+         explen = explen - 1;
+         linelen = linelen + 1;
+         if (explen == 0) {
+            updatesig();
+            sigdone_ev.notify();
+            state = IDLE;
+         }
+         break;
+      case WRSKIP: break;
+      case WRE0: val1 = msg; state = WR0; break;
+      case WR0: val = msg << 24; state = WR1; break;
+      case WR1: val = val | (msg << 16); state = WR2; break;
+      case WR2: val = val | (msg << 8); state = WR3; break;
+      case WR3:
+         val = val | msg;
+         state = IDLE;
+         if (cmd == 0x2a) {
+            startcol = val>>16;
+            endcol = (val&0xffff);
+            if (debug>8) printf("%s: %s: Setting column to = %04x:%04x\n",
+               name(), sc_time_stamp().to_string().c_str(),
+               val>>16, val & 0xffff);
+         }
+         else if (cmd == 0x2b) {
+            startrow = val>>16;
+            endrow = (val&0xffff);
+            if (debug>8) printf("%s: %s: Setting row to = %04x:%04x\n",
+               name(), sc_time_stamp().to_string().c_str(),
+               val>>16, val & 0xffff);
+         }
+         else if (cmd == 0x30) {
+            if (debug>2) printf(
+               "%s: %s: Set Partial Row Start = %08x End = %08x\n",
+               name(), sc_time_stamp().to_string().c_str(),
+               (val >> 16) & 0x1ff, val & 0x1ff);
+         }
+         else if (cmd == 0x36) {
+            printf("%s: %s: Memory Access Control %08x\n",
+               name(), sc_time_stamp().to_string().c_str(), val);
+         }
+         else if (cmd == 0x3a) {
+            if (debug>2) printf("%s: %s: Pixel Format = %08x\n",
+               name(), sc_time_stamp().to_string().c_str(), val);
+         }
+         else if (cmd == 0xc5) {
+            printf("%s: %s: Frame Rate and Inversion %08x\n",
+               name(), sc_time_stamp().to_string().c_str(), val);
+         }
+         else if (cmd == 0xc0) {
+            printf("%s: %s: Pannel Driving %02x%08x\n",
+               name(), sc_time_stamp().to_string().c_str(), val1, val);
+         }
+         else if (cmd == 0xd0) {
+            printf("%s: %s: Set Power %08x\n",
+               name(), sc_time_stamp().to_string().c_str(), val);
+         }
+         else if (cmd == 0xd1) {
+            printf("%s: %s: VCOM %08x\n",
+               name(), sc_time_stamp().to_string().c_str(), val);
+         }
+         else if (cmd == 0xd2) {
+            printf("%s: %s: Normal Power %08x\n",
+               name(), sc_time_stamp().to_string().c_str(), val);
+         }
+         else {
+            printf("G: %s: %x: %08x\n", sc_time_stamp().to_string().c_str(),
+               cmd, val);
+         }
+         break;
+      default: state = IDLE;
+         printf("D: %s: %02x\n", sc_time_stamp().to_string().c_str(),
+            msg);
+   }
+
+}
+
+void tftmod::updatesig() {
+   signature = sig;
+   explength = explen;
+   llen = linelen;
+}
+
+void tftmod::spitransport(spitrans_t &t) {
+   unsigned int i;
+   bool iscmd;
+
+   /* We only listen if we are selected. The DC does not change during a
+    * transfer, so we sample it once for the whole buffer.
+    */
+   if (cs.read() != SC_LOGIC_0) return;
+   iscmd = (dc.read() == SC_LOGIC_0);
+   for(i = 0; i < t.mosibits / 8 && i < t.mosi.size(); i = i + 1)
+      process(t.mosi[i], iscmd);
+   istate = state;
+   icmd = cmd;
 }
 
 void tftmod::waitcode(tft_obj_t *t) {
@@ -25,12 +25,14 @@
 #include <systemc.h>
 #include "crccalc.h"
 #include "gn_mixed.h"
+#include "tftfb.h"
+#include "spitlm.h"
 
 struct tft_obj_t {
    unsigned int x1, y1, x2, y2, signature;
 };
 
-SC_MODULE(tftmod) {
+SC_MODULE(tftmod), public spislave_if {
    sc_inout<gn_mixed> cs {"cs"};
    sc_inout<gn_mixed> dc {"dc"};
    sc_inout<gn_mixed> rst {"rst"};
@@ -49,15 +51,24 @@ SC_MODULE(tftmod) {
    sc_signal<int> icmd{"cmd"};
    sc_signal<unsigned int> startcol {"startcol"}, endcol {"endcol"};
    sc_signal<unsigned int> startrow {"startrow"}, endrow {"endrow"};
+   /* The signature is kept in sig and only copied to these signals at the
+    * end of a memory write or when a new command comes in.
+    */
    sc_signal<unsigned int> signature {"signature"};
    sc_signal<unsigned int> explength {"explength"};
    sc_signal<unsigned int> llen {"llen"};
    sc_signal<bool> sleep {"sleep", true};
 
+   /* Panel contents */
+   tftfb fb {320, 480};
+
    /* Threads */
    void write(void);
    void read(void);
 
+   /* Bulk interface, used when the panel is attached to a SPI TLM. */
+   virtual void spitransport(spitrans_t &t);
+
    /* Helper Functions */
    void drive(unsigned int val);
    void trace(sc_trace_file *tf);
@@ -67,6 +78,9 @@ SC_MODULE(tftmod) {
 
    SC_CTOR(tftmod) {
       debug = 0;
+      sig = 0;
+      explen = 0;
+      linelen = 0;
 
       SC_THREAD(write);
       sensitive << wr;
@@ -76,6 +90,16 @@ SC_MODULE(tftmod) {
    }
 
    private:
+   void process(unsigned int msg, bool iscmd);
+   void updatesig();
+
+   int state;
+   int cmd;
+   uint32_t val, val1;
+   sc_time sleepchangetime;
+   uint32_t sig;
+   unsigned int explen;
+   unsigned int linelen;
    uint8_t fglow, fghigh;
    int debug;
 };
@@ -0,0 +1,344 @@
+/*******************************************************************************
+ * tftfb.cpp -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a framebuffer for the TFT display models. See tftfb.h.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#include <systemc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "tftfb.h"
+#include "info.h"
+
+/* MADCTL bits */
+#define MADCTL_MY 0x80
+#define MADCTL_MX 0x40
+#define MADCTL_MV 0x20
+#define MADCTL_BGR 0x08
+
+void tftfb::setsize(int w, int h) {
+   _w = w;
+   _h = h;
+   _fb.assign(w * h, 0);
+   reset();
+   cleardirty();
+   clearcounters();
+}
+
+void tftfb::reset() {
+   /* Just like a reset on the controller, the memory is left alone. */
+   _cmd = 0;
+   _param = 0;
+   _madctl = 0;
+   _colmod = 0x66;
+   _xs = 0; _xe = _w - 1;
+   _ys = 0; _ye = _h - 1;
+   _x = 0; _y = 0;
+   _ramwr = false;
+   _npix = 0;
+}
+
+void tftfb::command(uint8_t c) {
+   /* Any command ends a memory write. */
+   if (_ramwr) flushdirty();
+   _ramwr = false;
+   _cmd = c;
+   _param = 0;
+   _npix = 0;
+
+   switch(c) {
+      case 0x01: reset(); break;
+      /* RAMWR starts at the window corner, and RAMWRC where it stopped. */
+      case 0x2c: _x = _xs; _y = _ys; _ramwr = true; break;
+      case 0x3c: _ramwr = true; break;
+      default: break;
+   }
+}
+
+void tftfb::data(uint8_t d) {
+   uint16_t r, g, b;
+
+   /* Pixel data. How many bytes make a pixel depends on COLMOD. */
+   if (_ramwr) {
+      _pix[_npix] = d;
+      _npix = _npix + 1;
+      switch(_colmod & 0x7) {
+         /* 12 bits, two pixels in three bytes. */
+         case 3:
+            if (_npix == 2) {
+               r = _pix[0] >> 4; g = _pix[0] & 0xf; b = _pix[1] >> 4;
+               putpixel(((r << 1 | r >> 3) << 11) | ((g << 2 | g >> 2) << 5)
+                  | (b << 1 | b >> 3));
+            }
+            else if (_npix == 3) {
+               r = _pix[1] & 0xf; g = _pix[2] >> 4; b = _pix[2] & 0xf;
+               putpixel(((r << 1 | r >> 3) << 11) | ((g << 2 | g >> 2) << 5)
+                  | (b << 1 | b >> 3));
+               _npix = 0;
+            }
+            break;
+         /* 18 bits, the colours are in the top six bits of each byte. */
+         case 6:
+            if (_npix == 3) {
+               putpixel(((_pix[0] >> 3) << 11) | ((_pix[1] >> 2) << 5) |
+                  (_pix[2] >> 3));
+               _npix = 0;
+            }
+            break;
+         /* Anything else we take as 16 bits. */
+         default:
+            if (_npix == 2) {
+               putpixel((_pix[0] << 8) | _pix[1]);
+               _npix = 0;
+            }
+            break;
+      }
+      return;
+   }
+
+   /* Parameters. We only need the ones that change where the pixels go. */
+   if (_param < 4) _pbuf[_param] = d;
+   _param = _param + 1;
+   switch(_cmd) {
+      case 0x2a:
+         if (_param == 4) {
+            _xs = (_pbuf[0] << 8) | _pbuf[1];
+            _xe = (_pbuf[2] << 8) | _pbuf[3];
+         }
+         break;
+      case 0x2b:
+         if (_param == 4) {
+            _ys = (_pbuf[0] << 8) | _pbuf[1];
+            _ye = (_pbuf[2] << 8) | _pbuf[3];
+         }
+         break;
+      case 0x36: if (_param == 1) _madctl = d; break;
+      case 0x3a: if (_param == 1) _colmod = d; break;
+      default: break;
+   }
+}
+
+void tftfb::data(const uint8_t *d, unsigned int len) {
+   unsigned int i;
+   for(i = 0; i < len; i = i + 1) data(d[i]);
+}
+
+void tftfb::putpixel(uint16_t c) {
+   int px, py, t;
+   tftrect_t *bx;
+
+   /* We go from the address counters to the panel position. */
+   px = _x;
+   py = _y;
+   if (_madctl & MADCTL_MV) { t = px; px = py; py = t; }
+   if (_madctl & MADCTL_MX) px = _w - 1 - px;
+   if (_madctl & MADCTL_MY) py = _h - 1 - py;
+   if (_madctl & MADCTL_BGR)
+      c = (c >> 11) | (c & 0x07e0) | ((c & 0x1f) << 11);
+
+   /* Pixels outside the panel are lost. */
+   if (px >= 0 && px < _w && py >= 0 && py < _h) {
+      _written = _written + 1;
+      if (_fb[py * _w + px] != c) {
+         _fb[py * _w + px] = c;
+         _changed = _changed + 1;
+         bx = &_box;
+         if (!_hasbox) {
+            bx->x1 = px; bx->x2 = px; bx->y1 = py; bx->y2 = py;
+            _hasbox = true;
+         }
+         else {
+            if (px < bx->x1) bx->x1 = px;
+            if (px > bx->x2) bx->x2 = px;
+            if (py < bx->y1) bx->y1 = py;
+            if (py > bx->y2) bx->y2 = py;
+         }
+      }
+   }
+
+   /* And we move on in the window, wrapping at the end. */
+   _x = _x + 1;
+   if (_x > _xe) {
+      _x = _xs;
+      _y = _y + 1;
+      if (_y > _ye) _y = _ys;
+   }
+}
+
+bool tftfb::touches(const tftrect_t &a, const tftrect_t &b) {
+   return a.x1 <= b.x2 + 1 && b.x1 <= a.x2 + 1 &&
+      a.y1 <= b.y2 + 1 && b.y1 <= a.y2 + 1;
+}
+
+void tftfb::flushdirty() {
+   std::vector<tftrect_t>::iterator it;
+   bool merged;
+
+   if (!_hasbox) return;
+   _hasbox = false;
+
+   /* We merge the box with any rectangle it touches, until it touches none.
+    */
+   do {
+      merged = false;
+      for(it = _dirty.begin(); it != _dirty.end(); it++) {
+         if (!touches(*it, _box)) continue;
+         if (it->x1 < _box.x1) _box.x1 = it->x1;
+         if (it->x2 > _box.x2) _box.x2 = it->x2;
+         if (it->y1 < _box.y1) _box.y1 = it->y1;
+         if (it->y2 > _box.y2) _box.y2 = it->y2;
+         _dirty.erase(it);
+         merged = true;
+         break;
+      }
+   } while (merged);
+   _dirty.push_back(_box);
+}
+
+uint16_t tftfb::pixel(int x, int y) {
+   if (x < 0 || x >= _w || y < 0 || y >= _h) return 0;
+   return _fb[y * _w + x];
+}
+
+void tftfb::fill(uint16_t c) {
+   _fb.assign(_w * _h, c);
+}
+
+bool tftfb::saveppm(const char *fn) {
+   FILE *f;
+   int i;
+   uint16_t c;
+   uint8_t rgb[3];
+
+   f = fopen(fn, "wb");
+   if (f == NULL) {
+      PRINTF_WARN("TFTFB", "Could not open %s", fn);
+      return false;
+   }
+   fprintf(f, "P6\n%d %d\n255\n", _w, _h);
+   for(i = 0; i < _w * _h; i = i + 1) {
+      c = _fb[i];
+      rgb[0] = ((c >> 11) << 3) | (c >> 13);
+      rgb[1] = (((c >> 5) & 0x3f) << 2) | ((c >> 9) & 0x3);
+      rgb[2] = ((c & 0x1f) << 3) | ((c >> 2) & 0x7);
+      fwrite(rgb, 1, 3, f);
+   }
+   fclose(f);
+   return true;
+}
+
+/* Reads the next number in a PPM header, skipping comments. */
+static int ppmint(FILE *f) {
+   int c, v;
+   do {
+      c = fgetc(f);
+      if (c == '#') while (c != '\n' && c != EOF) c = fgetc(f);
+   } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+   if (c < '0' || c > '9') return -1;
+   v = 0;
+   while (c >= '0' && c <= '9') {
+      v = v * 10 + c - '0';
+      c = fgetc(f);
+   }
+   return v;
+}
+
+bool tftfb::loadppm(const char *fn, int &w, int &h,
+      std::vector<uint8_t> &rgb) {
+   FILE *f;
+   char magic[2];
+   int maxval, i, v;
+
+   f = fopen(fn, "rb");
+   if (f == NULL) return false;
+   if (fread(magic, 1, 2, f) != 2 || magic[0] != 'P'
+         || (magic[1] != '6' && magic[1] != '3')) {
+      fclose(f);
+      return false;
+   }
+   w = ppmint(f);
+   h = ppmint(f);
+   maxval = ppmint(f);
+   if (w <= 0 || h <= 0 || maxval <= 0 || maxval > 255) {
+      fclose(f);
+      return false;
+   }
+   rgb.assign(w * h * 3, 0);
+   /* P6 is binary, P3 is text. */
+   if (magic[1] == '6') {
+      if (fread(rgb.data(), 1, rgb.size(), f) != rgb.size()) {
+         fclose(f);
+         return false;
+      }
+   }
+   else for(i = 0; i < w * h * 3; i = i + 1) {
+      v = ppmint(f);
+      if (v < 0) { fclose(f); return false; }
+      rgb[i] = v;
+   }
+   /* We scale it all to 255. */
+   if (maxval != 255)
+      for(i = 0; i < w * h * 3; i = i + 1) rgb[i] = rgb[i] * 255 / maxval;
+   fclose(f);
+   return true;
+}
+
+int tftfb::compare(const char *golden, int tol, int x1, int y1, int x2,
+      int y2) {
+   std::vector<uint8_t> rgb;
+   int gw, gh, x, y, bad;
+   uint16_t c;
+   int d[3];
+
+   if (!loadppm(golden, gw, gh, rgb)) return -1;
+   if (gw != _w || gh != _h) {
+      PRINTF_WARN("TFTFB", "%s is %dx%d but the panel is %dx%d", golden,
+         gw, gh, _w, _h);
+      return -1;
+   }
+
+   bad = 0;
+   for(y = (y1 < 0)?0:y1; y <= y2 && y < _h; y = y + 1)
+      for(x = (x1 < 0)?0:x1; x <= x2 && x < _w; x = x + 1) {
+         c = _fb[y * _w + x];
+         d[0] = abs((((c >> 11) << 3) | (c >> 13)) - rgb[(y*_w+x)*3]);
+         d[1] = abs(((((c >> 5) & 0x3f) << 2) | ((c >> 9) & 0x3))
+            - rgb[(y*_w+x)*3+1]);
+         d[2] = abs((((c & 0x1f) << 3) | ((c >> 2) & 0x7))
+            - rgb[(y*_w+x)*3+2]);
+         if (d[0] > tol || d[1] > tol || d[2] > tol) {
+            if (bad == 0) { _badx = x; _bady = y; }
+            bad = bad + 1;
+         }
+      }
+   return bad;
+}
+
+bool tftfb::expectimage(const char *golden, int tol, int x1, int y1, int x2,
+      int y2, int maxbad) {
+   int bad = compare(golden, tol, x1, y1, x2, y2);
+   if (bad < 0) {
+      PRINTF_ERROR("TFTFB", "Could not compare to %s", golden);
+      return false;
+   }
+   if (bad > maxbad) {
+      PRINTF_ERROR("TFTFB", "%d pixels differ from %s, first at (%d,%d)",
+         bad, golden, _badx, _bady);
+      return false;
+   }
+   return true;
+}
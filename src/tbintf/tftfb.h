@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * tftfb.h -- Copyright 2020 (c) Glenn Ramalho - RFIDo Design
+ *******************************************************************************
+ * Description:
+ *   This is a framebuffer for the TFT display models. It takes the bytes
+ *   sent to the display controller, decodes the MIPI DCS commands that
+ *   write to the display memory (CASET, RASET, RAMWR, MADCTL, COLMOD,...)
+ *   and keeps the panel contents in RGB565.
+ *
+ *   The buffer is kept in the panel orientation, so MADCTL changes where
+ *   the pixels land and not how the buffer is saved. Colours are stored as
+ *   RGB, even if the panel is set to BGR.
+ *
+ *   It also keeps a list of the rectangles changed, counters for the pixels
+ *   written and the pixels that really changed, and can compare the panel,
+ *   or part of it, to a golden image in PPM format.
+ *******************************************************************************
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ */
+
+#ifndef _TFTFB_H
+#define _TFTFB_H
+
+#include <stdint.h>
+#include <vector>
+
+struct tftrect_t {
+   int x1, y1, x2, y2;
+};
+
+class tftfb {
+   public:
+   tftfb(int w, int h) { setsize(w, h); }
+
+   /* Setup */
+   void setsize(int w, int h);
+   int width() { return _w; }
+   int height() { return _h; }
+   void reset();
+
+   /* Controller interface. Each byte sent with DC low goes to command() and
+    * each one with DC high to data().
+    */
+   void command(uint8_t c);
+   void data(uint8_t d);
+   void data(const uint8_t *d, unsigned int len);
+   uint8_t getcmd() { return _cmd; }
+
+   /* Panel contents */
+   uint16_t pixel(int x, int y);
+   void fill(uint16_t c);
+   bool saveppm(const char *fn);
+
+   /* Golden image compare. A pixel is bad if any of its channels, in 8-bit
+    * units, is off by more than tol. compare() returns the number of bad
+    * pixels in the rectangle, or -1 if the file could not be read.
+    * expectimage() reports an error if there are more than maxbad of them.
+    */
+   int compare(const char *golden, int tol, int x1, int y1, int x2, int y2);
+   int compare(const char *golden, int tol = 0) {
+      return compare(golden, tol, 0, 0, _w - 1, _h - 1);
+   }
+   bool expectimage(const char *golden, int tol, int x1, int y1, int x2,
+      int y2, int maxbad = 0);
+   bool expectimage(const char *golden, int tol = 0, int maxbad = 0) {
+      return expectimage(golden, tol, 0, 0, _w - 1, _h - 1, maxbad);
+   }
+
+   /* Dirty rectangles, merged when they touch. */
+   std::vector<tftrect_t> &dirty() { flushdirty(); return _dirty; }
+   void cleardirty() { _dirty.clear(); _hasbox = false; }
+
+   /* Counters */
+   unsigned int pixelswritten() { return _written; }
+   unsigned int pixelschanged() { return _changed; }
+   void clearcounters() { _written = 0; _changed = 0; }
+
+   private:
+   int _w, _h;
+   std::vector<uint16_t> _fb;
+
+   /* Controller state */
+   uint8_t _cmd;
+   int _param;
+   uint8_t _pbuf[4];
+   int _xs, _xe, _ys, _ye;
+   int _x, _y;
+   uint8_t _madctl;
+   uint8_t _colmod;
+   bool _ramwr;
+   uint8_t _pix[3];
+   int _npix;
+
+   /* Dirty tracking and counters */
+   std::vector<tftrect_t> _dirty;
+   tftrect_t _box;
+   bool _hasbox;
+   unsigned int _written;
+   unsigned int _changed;
+   int _badx, _bady;
+
+   void putpixel(uint16_t c);
+   void flushdirty();
+   static bool touches(const tftrect_t &a, const tftrect_t &b);
+   static bool loadppm(const char *fn, int &w, int &h,
+      std::vector<uint8_t> &rgb);
+};
+
+#endif
@@ -21,8 +21,10 @@
  *******************************************************************************
  */
 
+#define SC_INCLUDE_DYNAMIC_PROCESSES
 #include <systemc.h>
 #include <stdarg.h>
+#include <algorithm>
 #include "webclient.h"
 #include "libb64/cencode.h"
 #include "mbedtls/sha1.h"
@@ -54,6 +56,12 @@ void webclient::send(int port, void *msg, int len, bool escape) {
    static int lastport = -1;
    int pos;
 
+   /* Several threads can be sending at the same time, like the load generator
+    * or the broker sessions. If the fifo fills up we could switch to one of
+    * them in the middle of a message, so we hold the lock until we are done.
+    */
+   _sendlock.lock();
+
    /* If a non-control port was requested, we then have to check if we are
     * already dealing with that port. If we are we do nothing. If we are dealing
     * with a new port, we need to send the port escape sequence.
@@ -76,13 +84,18 @@ void webclient::send(int port, void *msg, int len, bool escape) {
       lastport = -1;
    }
 
-   printf("Sending %d bytes to port %d:", len, port);
-   for(pos = 0; pos < len; pos = pos + 1) {
-      if (c[pos] == '\n' || c[pos] == '\r') ;
-      else if (isprint(c[pos])) putc(c[pos], stdout);
-      else printf("<%02x>", c[pos]);
+   /* The load generator sends far too many messages to print them all, so
+    * it turns this off.
+    */
+   if (!_quiet) {
+      printf("Sending %d bytes to port %d:", len, port);
+      for(pos = 0; pos < len; pos = pos + 1) {
+         if (c[pos] == '\n' || c[pos] == '\r') ;
+         else if (isprint(c[pos])) putc(c[pos], stdout);
+         else printf("<%02x>", c[pos]);
+      }
+      printf("\n");
    }
-   printf("\n");
    for(pos = 0; pos < len; pos = pos + 1) {
       /* If we see a 0xff and we are escaping the message we need to send two
        * 0xff.
@@ -91,6 +104,7 @@ void webclient::send(int port, void *msg, int len, bool escape) {
       if (c[pos] == 0xff && escape) i_uwifi.to.write((int)(c[pos]));
    //   wait(1, SC_US);
    }
+   _sendlock.unlock();
 }
 
 void webclient::send(int port, const char *msg, bool escape) {
@@ -171,6 +185,33 @@ int webclient::read(int port) {
    return read(port, getind(port));
 }
 
+bool webclient::waitdata(int port, sc_time tmout) {
+   sc_time deadline = sc_time_stamp() + tmout;
+   int ind;
+
+   /* We wait until something comes in, the port closes or we run out of
+    * time. The index can change while we sleep, so we look it up every time.
+    */
+   while(1) {
+      ind = getind(port);
+      if (ind < 0) return true;
+      if (_portlist[ind].buffer.size() > 0 || _portlist[ind].closed)
+         return true;
+      if (sc_time_stamp() >= deadline) return false;
+      wait(deadline - sc_time_stamp(), __fifowrite_ev);
+   }
+}
+
+/* Closes our side of a port without waiting for the DUT. What is still in the
+ * buffer can be read, then the port goes away.
+ */
+void webclient::dropport(int port) {
+   int ind = getind(port);
+   if (ind < 0) return;
+   _portlist[ind].closed = true;
+   __fifowrite_ev.notify();
+}
+
 unsigned char webclient::readchar(int port) {
    int res = read(port);
    if (res < 0) {
@@ -348,6 +389,32 @@ void webclient::openudpport(IPAddress ip, int port) {
    _portlist.push_back(wifiport_t(port, true));
 }
 
+void webclient::listen(unsigned int port) {
+   PRINTF_INFO("WEBCLI", "Listening on port %d", port);
+   _listenports.push_back(port);
+}
+
+int webclient::accept(unsigned int port) {
+   std::deque<unsigned int>::iterator it;
+
+   /* We wait for a connect request to this port to come in. */
+   while(1) {
+      for(it = _acceptq.begin(); it != _acceptq.end(); it++) {
+         if (*it == port) break;
+      }
+      if (it != _acceptq.end()) break;
+      wait(_accept_ev);
+   }
+   _acceptq.erase(it);
+
+   /* We then open the port and tell the DUT we are good to go, just like
+    * expectconnect() does.
+    */
+   _portlist.push_back(wifiport_t(port));
+   sendf(-1, false, "\xff%dy %s\r\n", port, macstr);
+   return (int)port;
+}
+
 void webclient::printpage(int port) {
    std::string msg;
    do {
@@ -360,6 +427,23 @@ void webclient::printpage(int port) {
    wait(10, SC_MS);
 }
 
+/* Like printpage() but it also returns the page, one line after the other,
+ * so the testbench can look for what it expects in it.
+ */
+std::string webclient::readpage(int port) {
+   std::string msg;
+   std::string page;
+   do {
+      msg = readln(port);
+      printf("To WiFi: %s\n", msg.c_str());
+      page = page + msg + "\n";
+   } while (!isclosed(port));
+
+   /* And we dump any remaining chars in the stream. */
+   wait(10, SC_MS);
+   return page;
+}
+
 void webclient::deleteArgs() { _arg.deleteArgs(); }
 void webclient::regArg(const char *name, const char *value) {
    _arg.regArg(name, value);
@@ -391,7 +475,7 @@ void webclient::connectclient(IPAddress toip, unsigned int toport) {
    _portlist.push_back(wifiport_t(toport));
    /* And we wait for the resposne. */
    msg = readln(toport);
-   printf("To WiFi: %s\n", msg.c_str());
+   if (!_quiet) printf("To WiFi: %s\n", msg.c_str());
    if (msg.find("\xff""y") != 0) {
       PRINTF_ERROR("WEBCLI", "Expected Accept from the DUT");
       int ind = getind(toport);
@@ -415,8 +499,11 @@ void webclient::connectclient(IPAddress toip, unsigned int toport) {
    }
 
    /* And we print a message and add the port to the connected list. */
-   PRINTF_INFO("WEBCLI", "Connected to AP BSSID %02x:%02x:%02x:%02x:%02x:%02x",
-      a[0], a[1], a[2], a[3], a[4], a[5]);
+   if (!_quiet) {
+      PRINTF_INFO("WEBCLI",
+         "Connected to AP BSSID %02x:%02x:%02x:%02x:%02x:%02x",
+         a[0], a[1], a[2], a[3], a[4], a[5]);
+   }
 }
 
 void webclient::requestpage(int port, std::string path, const char *auth) {
@@ -457,6 +544,16 @@ void webclient::answerpage(int port, std::string path, const char *auth) {
    sendifauth(port, auth, true);
    send(port, "\r\n", true);
 }
+
+/* Sends a request as it is, for the tests that need a request the other
+ * activators do not put together.
+ */
+void webclient::sendrequest(int port, std::string req) {
+   /* Get rid of any junk. */
+   flush(port);
+   send(port, (void *)req.c_str(), (int)req.length(), true);
+}
+
 void webclient::expectupgrade(int port) {
    std::string msg;
    bool found = false;
@@ -544,6 +641,18 @@ std::string webclient::packetname(mqtt_type_t type, const char *str) {
          return std::string("MQTT PUBCOMP");
       case MQTT_TYPE_SUBSCRIBE:
          return std::string("MQTT Subscribe");
+      case MQTT_TYPE_SUBACK:
+         return std::string("MQTT SUBACK");
+      case MQTT_TYPE_UNSUBSCRIBE:
+         return std::string("MQTT Unsubscribe");
+      case MQTT_TYPE_UNSUBACK:
+         return std::string("MQTT UNSUBACK");
+      case MQTT_TYPE_PINGREQ:
+         return std::string("MQTT PINGREQ");
+      case MQTT_TYPE_PINGRESP:
+         return std::string("MQTT PINGRESP");
+      case MQTT_TYPE_DISCONNECT:
+         return std::string("MQTT Disconnect");
       default:
          return std::to_string(type);
    }
@@ -857,6 +966,226 @@ void webclient::expectws(int port) {
    exit(0);
 }
 
+/*******************************************************************************
+** Load Generator **************************************************************
+*******************************************************************************/
+
+void webclient::loadclear() {
+   _loadmix.clear();
+   _loadlat.clear();
+   _loaderrors = 0;
+   _loadbytes = 0;
+}
+
+void webclient::loadmix(const char *method, std::string path, int bodylen,
+      int weight) {
+   if (weight <= 0) {
+      PRINTF_ERROR("WEBCLI", "Load mix weight must be positive");
+      return;
+   }
+   _loadmix.push_back(webloadreq_t(method, path, bodylen, weight));
+}
+
+int webclient::loadresponse(int port, int &bytes) {
+   std::string msg;
+   int code;
+   int contentlength = -1;
+   bool chunked = false;
+   int cnt;
+
+   /* First comes the status line, something like "HTTP/1.1 200 OK". */
+   msg = readln(port);
+   if (1 != sscanf(msg.c_str(), "HTTP/%*d.%*d %d", &code)) {
+      PRINTF_ERROR("WEBCLI", "Got illegal status line on port %d", port);
+      return -1;
+   }
+   bytes = msg.length() + 2;
+
+   /* Then the headers. We only need to know how long the body is. */
+   do {
+      msg = readln(port);
+      bytes = bytes + msg.length() + 2;
+      if (strncasecmp(msg.c_str(), "Content-Length:", 15) == 0)
+         contentlength = atoi(msg.c_str() + 15);
+      else if (strncasecmp(msg.c_str(), "Transfer-Encoding:", 18) == 0
+            && findend(msg, "chunked"))
+         chunked = true;
+   } while (msg != "" && !isclosed(port));
+
+   /* Now the body. If we have a length we take just that, chunked bodies we
+    * take chunk by chunk and anything else goes until the port is closed.
+    */
+   if (chunked) {
+      do {
+         msg = readln(port);
+         bytes = bytes + msg.length() + 2;
+         contentlength = (int)strtol(msg.c_str(), NULL, 16);
+         for(cnt = 0; cnt < contentlength + 2; cnt = cnt + 1) {
+            if (read(port) < 0) break;
+            bytes = bytes + 1;
+         }
+      } while (contentlength > 0 && !isclosed(port));
+   }
+   else if (contentlength >= 0) {
+      for(cnt = 0; cnt < contentlength; cnt = cnt + 1) {
+         if (read(port) < 0) break;
+         bytes = bytes + 1;
+      }
+   }
+   else {
+      while(read(port) >= 0) bytes = bytes + 1;
+   }
+
+   return code;
+}
+
+void webclient::loadworker(IPAddress toip, unsigned int toport) {
+   std::string req;
+   sc_time lat;
+   bool served;
+   int code;
+   int bytes;
+
+   while(true) {
+      /* We sleep until there is a job for us or the run is over. */
+      while(_loadjobs.size() == 0 && !_loadfinished) wait(_loadjob_ev);
+      if (_loadjobs.size() == 0) return;
+      webloadjob_t job = _loadjobs.front();
+      _loadjobs.pop_front();
+      webloadreq_t &r = _loadmix[job.req];
+
+      /* We build the whole request beforehand so it goes out in one go. */
+      req = r.method + " " + r.path + " HTTP/1.1\r\n"
+         + "Host: www.webclient.com.br\r\n";
+      if (r.bodylen > 0) {
+         req = req + "Content-Type: text/plain\r\n"
+            + "Content-Length: " + std::to_string(r.bodylen) + "\r\n\r\n"
+            + std::string(r.bodylen, 'x');
+      }
+      else req = req + "\r\n";
+
+      /* Each request gets its own connection. */
+      code = -1;
+      bytes = 0;
+      connectclient(toip, toport);
+      served = !isclosed(toport);
+      if (served) {
+         send(toport, (void *)req.c_str(), (int)req.length(), true);
+         code = loadresponse(toport, bytes);
+         lat = sc_time_stamp() - job.issued;
+
+         /* We now close our side and wait for the DUT to close its side. Only
+          * then we can open the port again for the next request.
+          */
+         if (!isclosed(toport)) sendf(-1, false, "\xff%d!\r\n", toport);
+         while(!isclosed(toport)) read(toport);
+      }
+
+      /* And we count it. A connection that failed has no latency. */
+      if (served) {
+         _loadlat.push_back(lat);
+         _loadbytes = _loadbytes + bytes;
+      }
+      if (code < 200 || code > 299) _loaderrors = _loaderrors + 1;
+      _loadpending = _loadpending - 1;
+      if (_loadpending == 0) _loaddone_ev.notify();
+   }
+}
+
+void webclient::loadrun(IPAddress toip, unsigned int toport, double rate,
+      int requests) {
+   int cnt;
+   int totalweight;
+   int pick;
+   int req;
+   sc_time next;
+
+   if (_loadmix.size() == 0) {
+      PRINTF_ERROR("WEBCLI", "Load run requested without a request mix");
+      return;
+   }
+
+   /* We add up the weights so that we can pick the requests. */
+   totalweight = 0;
+   for(req = 0; req < (int)_loadmix.size(); req = req + 1)
+      totalweight = totalweight + _loadmix[req].weight;
+
+   PRINTF_INFO("WEBCLI", "Load run: %d requests, %g req/s", requests, rate);
+
+   /* We start the worker. It quits on its own when the run is over. */
+   _quiet = true;
+   _loadfinished = false;
+   _loadlat.clear();
+   _loadlat.reserve(requests);
+   _loaderrors = 0;
+   _loadbytes = 0;
+   _loadstart = sc_time_stamp();
+   sc_spawn(sc_bind(&webclient::loadworker, this, toip, toport));
+
+   /* Now we issue the requests. With a rate we issue them at fixed intervals
+    * so that the latency includes any queueing. Without one we simply put
+    * them all in the queue and let the worker go as fast as it can.
+    */
+   for(cnt = 0; cnt < requests; cnt = cnt + 1) {
+      if (rate > 0.0) {
+         next = _loadstart + sc_time((double)cnt / rate, SC_SEC);
+         if (next > sc_time_stamp()) wait(next - sc_time_stamp());
+      }
+
+      /* We go through the mix in order, so the run is always the same. */
+      pick = cnt % totalweight;
+      for(req = 0; pick >= _loadmix[req].weight; req = req + 1)
+         pick = pick - _loadmix[req].weight;
+
+      _loadjobs.push_back(webloadjob_t(req, sc_time_stamp()));
+      _loadpending = _loadpending + 1;
+      _loadjob_ev.notify();
+   }
+
+   /* And we wait for all of them to come back. */
+   _loadfinished = true;
+   _loadjob_ev.notify();
+   while(_loadpending > 0) wait(_loaddone_ev);
+   _loadend = sc_time_stamp();
+   _quiet = false;
+
+   loadreport();
+}
+
+sc_time webclient::loadpercentile(double pct) {
+   std::vector<sc_time> sorted;
+   int ind;
+
+   if (_loadlat.size() == 0) return SC_ZERO_TIME;
+
+   /* We use the nearest rank. */
+   sorted = _loadlat;
+   std::sort(sorted.begin(), sorted.end());
+   ind = (int)ceil(pct / 100.0 * sorted.size()) - 1;
+   if (ind < 0) ind = 0;
+   if (ind >= (int)sorted.size()) ind = sorted.size() - 1;
+   return sorted[ind];
+}
+
+double webclient::loadthroughput() {
+   double elapsed = (_loadend - _loadstart).to_seconds();
+   if (elapsed <= 0.0) return 0.0;
+   return (double)_loadlat.size() / elapsed;
+}
+
+void webclient::loadreport() {
+   PRINTF_INFO("WEBCLI", "Load: %d done, %d errors, %ld bytes in %s",
+      (int)_loadlat.size(), _loaderrors, _loadbytes,
+      (_loadend - _loadstart).to_string().c_str());
+   double elapsed = (_loadend - _loadstart).to_seconds();
+   PRINTF_INFO("WEBCLI", "Load: %.2f req/s, %.0f bytes/s", loadthroughput(),
+      (elapsed > 0.0) ? (double)_loadbytes / elapsed : 0.0);
+   PRINTF_INFO("WEBCLI", "Load latency: p50 %s p95 %s p99 %s",
+      loadpercentile(50).to_string().c_str(),
+      loadpercentile(95).to_string().c_str(),
+      loadpercentile(99).to_string().c_str());
+}
+
 bool webclient::pending(int port) {
    int ind = getind(port);
    if (_portlist[ind].buffer.size() > 0) return true;
@@ -1000,17 +1329,33 @@ void webclient::fillbuffers() {
           */
       }
       else {
-         /* We take all chars until the end of the command. Then we send the
-          * notification. Note that we do not need to send the notification
-          * for every character as we know the command has to have an end.
-          */
-         _portlist[0].buffer.push_back(token);
+         /* We take all chars until the end of the command. */
+         std::string cmd;
+         unsigned int reqport;
+         char reqip[40];
+         cmd.push_back(token);
          do {
-            _portlist[0].buffer.push_back(escaped);
+            cmd.push_back(escaped);
             escaped = i_uwifi.from.read();
          } while (escaped != '\n');
-         _portlist[0].buffer.push_back(escaped);
-         __fifowrite_ev.notify();
+         cmd.push_back(escaped);
+
+         /* Connect requests to a listened port go to the accept queue. */
+         if (2 == sscanf(cmd.c_str(), "\xff""c %39[^:]:%u", reqip, &reqport)
+               && std::find(_listenports.begin(), _listenports.end(), reqport)
+                  != _listenports.end()) {
+            _acceptq.push_back(reqport);
+            _accept_ev.notify();
+         }
+         /* The rest goes to the control port. Then we send the notification.
+          * Note that we do not need to send the notification for every
+          * character as we know the command has to have an end.
+          */
+         else {
+            _portlist[0].buffer.insert(_portlist[0].buffer.end(),
+               cmd.begin(), cmd.end());
+            __fifowrite_ev.notify();
+         }
       }
    }
 }
@@ -5,7 +5,9 @@
  *   This is a model for a net client. It can behave as a web client or server,
  *   a NTP server or a MQTT Broker. This file does not implement all the
  *   details of these protocols, it simply provides a way for a testbench to
- *   generate stimulus to emulate these protocols.
+ *   generate stimulus to emulate these protocols. It also has a simple single
+ *   connection load generator to measure how fast a web server on the DUT
+ *   can answer.
  *******************************************************************************
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -45,8 +47,14 @@ typedef enum {
    MQTT_TYPE_PUBREL = 6,
    MQTT_TYPE_PUBCOMP = 7,
    MQTT_TYPE_SUBSCRIBE = 8,
-   MQTT_TYPE_SUBACK = 9
+   MQTT_TYPE_SUBACK = 9,
+   MQTT_TYPE_UNSUBSCRIBE = 10,
+   MQTT_TYPE_UNSUBACK = 11,
+   MQTT_TYPE_PINGREQ = 12,
+   MQTT_TYPE_PINGRESP = 13,
+   MQTT_TYPE_DISCONNECT = 14
 } mqtt_type_t;
+class mqttbroker;
 class handle {
     public:
        handle(String name, void (*_f)(void));
@@ -79,6 +87,28 @@ struct wifiport_t {
 
 };
 
+/* Entry in the load generator request mix. The weight sets how many requests
+ * of this kind are issued for each round through the mix.
+ */
+struct webloadreq_t {
+   std::string method;
+   std::string path;
+   int bodylen;
+   int weight;
+   webloadreq_t(const char *_m, std::string _p, int _b, int _w):
+      method(_m), path(_p) {
+      bodylen = _b;
+      weight = _w;
+   }
+};
+
+/* A request waiting for the load generator worker. */
+struct webloadjob_t {
+   int req;
+   sc_time issued;
+   webloadjob_t(int _r, sc_time _i): issued(_i) { req = _r; }
+};
+
 SC_MODULE(webclient) {
    sc_in<unsigned int> rx {"rx"};
    sc_out<unsigned int> tx {"tx"};
@@ -113,11 +143,19 @@ SC_MODULE(webclient) {
    int autoanswermqttpub(int port, mqtt_type_t &packettype, std::string &pub);
    void expectws(int port);
    void printpage(int port);
+   std::string readpage(int port);
    bool pending(int port);
    bool isclosed(int port);
    bool willclose(int port);
+   void dropport(int port);
    void respondntp(int port, time_t trec, time_t tsend);
 
+   /* Listening ports. Connect requests to a listened port are not sent to the
+    * control port, they are held until a call to accept takes them.
+    */
+   void listen(unsigned int port);
+   int accept(unsigned int port);
+
    /* Tasks */
    void fillbuffers();
 
@@ -126,17 +164,42 @@ SC_MODULE(webclient) {
    void requestpage(int port, std::string path, const char *auth = NULL);
    void expectauthenticate(int port);
    void answerpage(int port, std::string path, const char *auth = NULL);
+   void sendrequest(int port, std::string req);
+
+   /* Load generator. The link tells the connections apart by port number
+    * only, so there can be only one connection to the DUT port at a time.
+    * The requests are therefore sent over one connection after the other,
+    * and the latency includes the time a request waits for the ones before
+    * it, as it would on a server that takes one client at a time.
+    */
+   void loadclear();
+   void loadmix(const char *method, std::string path, int bodylen = 0,
+      int weight = 1);
+   void loadrun(IPAddress toip, unsigned int toport, double rate,
+      int requests);
+   void loadreport();
+   sc_time loadpercentile(double pct);
+   double loadthroughput();
+   int loaderrors() { return _loaderrors; }
 
    SC_CTOR(webclient) {
       i_uwifi.tx(tx);
       i_uwifi.rx(rx);
 
       _portclosed = false;
+      _quiet = false;
+      _loadpending = 0;
+      _loadfinished = true;
+      _loaderrors = 0;
+      _loadbytes = 0;
 
       SC_THREAD(fillbuffers);
    }
 
    private:
+   /* The broker uses the port access routines directly. */
+   friend class mqttbroker;
+
    /* Channel send */
    void send(int port, void *msg, int len, bool escape = false);
    void send(int port, const char *msg, bool escape = false);
@@ -145,6 +208,7 @@ SC_MODULE(webclient) {
    int sendifauth(int port, const char *auth, bool escape = false);
    void flush(int port);
    int read(int port);
+   bool waitdata(int port, sc_time tmout);
    unsigned char readchar(int port);
    std::string readln(int port);
    /* Server pages */
@@ -154,7 +218,29 @@ SC_MODULE(webclient) {
 
    private:
    bool _portclosed;
+   bool _quiet;
    int read(int port, int ind);
+   sc_mutex _sendlock;
+
+   /* Listening ports and connect requests waiting for an accept */
+   std::vector<unsigned int> _listenports;
+   std::deque<unsigned int> _acceptq;
+   sc_event _accept_ev;
+
+   /* Load generator state */
+   void loadworker(IPAddress toip, unsigned int toport);
+   int loadresponse(int port, int &bytes);
+   std::vector<webloadreq_t> _loadmix;
+   std::deque<webloadjob_t> _loadjobs;
+   std::vector<sc_time> _loadlat;
+   sc_event _loadjob_ev;
+   sc_event _loaddone_ev;
+   sc_time _loadstart;
+   sc_time _loadend;
+   int _loadpending;
+   bool _loadfinished;
+   int _loaderrors;
+   long _loadbytes;
 
    /* Port list and methods */
    std::vector<wifiport_t> _portlist;